@@ -188,6 +188,8 @@ static int want_network = 0;
 static int have_network = 1;
 static double bytes_sent = 0;
 static double bytes_received = 0;
+static double app_counters[APP_STATUS_MAX_COUNTERS];
+static int napp_counters = 0;
 bool boinc_disable_timer_thread = false;
     // simulate unresponsive app by setting to true (debugging)
 static FUNC_PTR timer_callback = 0;
@@ -200,7 +202,8 @@ int app_min_checkpoint_period = 0;
 
 #define TIMER_PERIOD 0.1
     // Sleep interval for timer thread;
-    // determines max rate of handling messages from client.
+    // determines max rate of handling messages from client
+    // (unless the client has a doorbell; see doorbell_timer_loop()).
     // Unix: period of worker-thread timer interrupts.
 #define TIMERS_PER_SEC 10
     // reciprocal of TIMER_PERIOD
@@ -338,6 +341,9 @@ static int setup_shared_mem() {
 #endif
 #endif  // ! _WIN32
     if (app_client_shm == NULL) return -1;
+    if (aid.shmem_ext_size > 0) {
+        app_client_shm->init_ext();
+    }
     return 0;
 }
 #endif      // MSGS_FROM_FILE
@@ -402,6 +408,16 @@ double boinc_worker_thread_cpu_time() {
     return cpu;
 }
 
+#ifndef MSGS_FROM_FILE
+// whether to report status in the binary status block
+// rather than the app_status channel
+//
+static bool have_status_block() {
+    if (!app_client_shm || !app_client_shm->shm_ext) return false;
+    return SHARED_MEM_EXT_HAS(aid.shmem_ext_size, app_status);
+}
+#endif
+
 // Communicate to the client (via shared mem)
 // the current CPU time and fraction done.
 // NOTE: various bugs could cause some of these FP numbers to be enormous,
@@ -412,9 +428,31 @@ double boinc_worker_thread_cpu_time() {
 //
 static bool update_app_progress(double cpu_t, double cp_cpu_t) {
     char msg_buf[MSG_CHANNEL_SIZE], buf[256];
+    double fdone = -1;
 
     if (standalone) return true;
 
+    if (fraction_done >= 0) {
+        double range = aid.fraction_done_end - aid.fraction_done_start;
+        fdone = aid.fraction_done_start + fraction_done*range;
+    }
+#ifndef MSGS_FROM_FILE
+    if (have_status_block()) {
+        APP_STATUS_DATA asd;
+        memset(&asd, 0, sizeof(asd));
+        asd.current_cpu_time = cpu_t;
+        asd.checkpoint_cpu_time = cp_cpu_t;
+        if (fdone >= 0) asd.fraction_done = fdone;
+        asd.bytes_sent = bytes_sent;
+        asd.bytes_received = bytes_received;
+        asd.want_network = want_network;
+        asd.ncounters = napp_counters;
+        memcpy(asd.counters, app_counters, sizeof(asd.counters));
+        app_client_shm->shm_ext->app_status.write(asd);
+        return true;
+    }
+#endif
+
     sprintf(msg_buf,
         "<current_cpu_time>%e</current_cpu_time>\n"
         "<checkpoint_cpu_time>%e</checkpoint_cpu_time>\n",
@@ -423,9 +461,7 @@ static bool update_app_progress(double cpu_t, double cp_cpu_t) {
     if (want_network) {
         strlcat(msg_buf, "<want_network>1</want_network>\n", sizeof(msg_buf));
     }
-    if (fraction_done >= 0) {
-        double range = aid.fraction_done_end - aid.fraction_done_start;
-        double fdone = aid.fraction_done_start + fraction_done*range;
+    if (fdone >= 0) {
         sprintf(buf, "<fraction_done>%e</fraction_done>\n", fdone);
         strlcat(msg_buf, buf, sizeof(msg_buf));
     }
@@ -869,6 +905,21 @@ void boinc_network_usage(double sent, double received) {
     bytes_received = received;
 }
 
+// Report an app-defined quantity (e.g. iterations done).
+// It's passed to the client in the binary status block,
+// so older clients don't get it.
+//
+int boinc_report_counter(int index, double value) {
+    if (index < 0 || index >= APP_STATUS_MAX_COUNTERS) {
+        return ERR_INVALID_PARAM;
+    }
+    app_counters[index] = value;
+    if (index >= napp_counters) {
+        napp_counters = index + 1;
+    }
+    return 0;
+}
+
 int boinc_is_standalone() {
     if (standalone) return 1;
     return 0;
@@ -965,6 +1016,23 @@ int boinc_report_app_status_aux(
     char msg_buf[MSG_CHANNEL_SIZE], buf[1024];
     if (standalone) return 0;
 
+#ifndef MSGS_FROM_FILE
+    if (have_status_block()) {
+        APP_STATUS_DATA asd;
+        memset(&asd, 0, sizeof(asd));
+        asd.current_cpu_time = cpu_time;
+        asd.checkpoint_cpu_time = checkpoint_cpu_time;
+        asd.fraction_done = _fraction_done;
+        asd.other_pid = other_pid;
+        asd.bytes_sent = _bytes_sent;
+        asd.bytes_received = _bytes_received;
+        asd.ncounters = napp_counters;
+        memcpy(asd.counters, app_counters, sizeof(asd.counters));
+        app_client_shm->shm_ext->app_status.write(asd);
+        return 0;
+    }
+#endif
+
     sprintf(msg_buf,
         "<current_cpu_time>%e</current_cpu_time>\n"
         "<checkpoint_cpu_time>%e</checkpoint_cpu_time>\n"
@@ -1242,9 +1310,30 @@ static void handle_process_control_msg() {
     release_mutex();
 }
 
-// timer handler; called every 0.1 sec in the timer thread
+// handle messages from the client
+//
+static void handle_client_msgs() {
+#ifdef MSGS_FROM_FILE
+    handle_process_control_msg();
+#else
+    if (app_client_shm) {
+        if (options.check_heartbeat) {
+            handle_heartbeat_msg();
+        }
+        if (handle_trickle_downs) {
+            handle_trickle_down_msg();
+        }
+        if (options.handle_process_control) {
+            handle_process_control_msg();
+        }
+    }
+#endif
+}
+
+// timer handler; called in the timer thread every 0.1 sec,
+// or every second (nticks = TIMERS_PER_SEC) if we have a doorbell
 //
-static void timer_handler() {
+static void timer_handler(int nticks) {
     char buf[512];
 //#ifdef VERBOSE
 #if 0
@@ -1268,27 +1357,11 @@ static void timer_handler() {
         boinc_disable_timer_thread = true;
         return;
     }
-    interrupt_count++;
+    interrupt_count += nticks;
     if (!boinc_status.suspended) {
-        running_interrupt_count++;
+        running_interrupt_count += nticks;
     }
-    // handle messages from the client
-    //
-#ifdef MSGS_FROM_FILE
-    handle_process_control_msg();
-#else
-    if (app_client_shm) {
-        if (options.check_heartbeat) {
-            handle_heartbeat_msg();
-        }
-        if (handle_trickle_downs) {
-            handle_trickle_down_msg();
-        }
-        if (options.handle_process_control) {
-            handle_process_control_msg();
-        }
-    }
-#endif
+    handle_client_msgs();
     if (interrupt_count % TIMERS_PER_SEC) return;
 
 #ifdef VERBOSE
@@ -1361,7 +1434,7 @@ static void timer_handler() {
 DWORD WINAPI timer_thread(void *) {
     while (1) {
         Sleep((int)(TIMER_PERIOD*1000));
-        timer_handler();
+        timer_handler(1);
 
         // poor man's CPU time accounting for Win9x
         //
@@ -1374,11 +1447,46 @@ DWORD WINAPI timer_thread(void *) {
 
 #else
 
+// whether the client wakes us when it sends a message
+//
+static bool have_doorbell() {
+    if (!app_client_shm || !app_client_shm->shm_ext) return false;
+    if (!SHARED_MEM_EXT_HAS(aid.shmem_ext_size, doorbell)) return false;
+    return SHM_DOORBELL::works();
+}
+
+// If the client has a doorbell, we needn't poll for messages;
+// handle them when it rings, and otherwise run once a second.
+//
+static void doorbell_timer_loop() {
+    SHM_DOORBELL& doorbell = app_client_shm->shm_ext->doorbell;
+    int seqno = doorbell.count;
+    double next_tick = dtime() + 1;
+    while (1) {
+        double dt = next_tick - dtime();
+        if (dt > 1) {
+            dt = 1;     // clock was set back
+            next_tick = dtime() + 1;
+        }
+        if (dt > 0 && doorbell.wait(seqno, dt)) {
+            if (!boinc_disable_timer_thread && !finishing) {
+                handle_client_msgs();
+            }
+            continue;
+        }
+        timer_handler(TIMERS_PER_SEC);
+        next_tick = dtime() + 1;
+    }
+}
+
 static void* timer_thread(void*) {
     block_sigalrm();
+    if (have_doorbell()) {
+        doorbell_timer_loop();
+    }
     while(1) {
         boinc_sleep(TIMER_PERIOD);
-        timer_handler();
+        timer_handler(1);
     }
     return 0;
 }
@@ -101,6 +101,7 @@ extern void boinc_need_network();
 extern int boinc_network_poll();
 extern void boinc_network_done();
 extern void boinc_network_usage(double sent, double received);
+extern int boinc_report_counter(int index, double value);
 extern int boinc_is_standalone(void);
 extern void boinc_ops_per_cpu_sec(double fp, double integer);
 extern void boinc_ops_cumulative(double fp, double integer);
@@ -69,6 +69,7 @@
 #include "client_msgs.h"
 #include "client_state.h"
 #include "procinfo.h"
+#include "proc_acct.h"
 #include "result.h"
 #include "sandbox.h"
 #include "diagnostics.h"
@@ -113,6 +114,8 @@ ACTIVE_TASK::ACTIVE_TASK() {
     peak_swap_size = 0;
     peak_disk_usage = 0;
     once_ran_edf = false;
+    prestaged = false;
+    prestage_misses = 0;
 
     fraction_done = 0;
     fraction_done_elapsed_time = 0;
@@ -138,6 +141,7 @@ ACTIVE_TASK::ACTIVE_TASK() {
     too_large = false;
     needs_shmem = false;
     want_network = 0;
+    app_status_seqno = 0;
     abort_time = 0;
     premature_exit_count = 0;
     quit_time = 0;
@@ -241,6 +245,7 @@ void ACTIVE_TASK::cleanup_task() {
     if (app_client_shm.shm) {
         detach_shmem(shm_handle, app_client_shm.shm);
         app_client_shm.shm = NULL;
+        app_client_shm.shm_ext = NULL;
     }
 #else
     int retval;
@@ -248,7 +253,7 @@ void ACTIVE_TASK::cleanup_task() {
     if (app_client_shm.shm) {
 #ifndef __EMX__
         if (app_version->api_version_at_least(6, 0)) {
-            retval = detach_shmem_mmap(app_client_shm.shm, sizeof(SHARED_MEM));
+            retval = detach_shmem_mmap(app_client_shm.shm, SHMEM_SEG_SIZE);
         } else
 #endif
         {
@@ -266,11 +271,15 @@ void ACTIVE_TASK::cleanup_task() {
             }
         }
         app_client_shm.shm = NULL;
+        app_client_shm.shm_ext = NULL;
         gstate.retry_shmem_time = 0;
     }
 #endif
 
     kill_subsidiary_processes();
+#ifdef __linux__
+    proc_acct_task_exited(this);
+#endif
 
     if (cc_config.exit_after_finish) {
         gstate.write_state_file();
@@ -348,13 +357,21 @@ void procinfo_show(PROC_MAP& pm) {
 // 2) see if exclusive apps are running
 // 3) get CPU time of non-BOINC processes
 //
+// On Linux, look only at the tasks' processes unless we need
+// to see all of them (see proc_acct.h)
+//
 void ACTIVE_TASK_SET::get_memory_usage() {
     static double last_mem_time=0;
     unsigned int i;
     int retval;
     static bool first = true;
     static double last_cpu_time;
+    static bool have_last_cpu_time = false;
     double diff=0;
+    bool full_scan = true;
+#ifdef __linux__
+    double boinc_cpu_time = 0;
+#endif
 
     if (!first) {
         diff = gstate.now - last_mem_time;
@@ -370,14 +387,19 @@ void ACTIVE_TASK_SET::get_memory_usage() {
 
     last_mem_time = gstate.now;
     PROC_MAP pm;
-    retval = procinfo_setup(pm);
-    if (retval) {
-        if (log_flags.mem_usage_debug) {
-            msg_printf(NULL, MSG_INTERNAL_ERROR,
-                "[mem_usage] procinfo_setup() returned %d", retval
-            );
+#ifdef __linux__
+    full_scan = proc_acct_full_scan();
+#endif
+    if (full_scan) {
+        retval = procinfo_setup(pm);
+        if (retval) {
+            if (log_flags.mem_usage_debug) {
+                msg_printf(NULL, MSG_INTERNAL_ERROR,
+                    "[mem_usage] procinfo_setup() returned %d", retval
+                );
+            }
+            return;
         }
-        return;
     }
     PROCINFO boinc_total;
     if (log_flags.mem_usage_debug) {
@@ -400,11 +422,22 @@ void ACTIVE_TASK_SET::get_memory_usage() {
         unsigned long last_page_fault_count = pi.page_fault_count;
         pi.clear();
         pi.id = atp->pid;
+#ifdef __linux__
+        if (full_scan) {
+            proc_acct_update(atp, pm);
+        }
+        proc_acct_task(atp, pi);
+        boinc_cpu_time += pi.kernel_time;
+        if (!atp->proc_acct.niced) {
+            boinc_cpu_time += pi.user_time;
+        }
+#else
         vector<int>* v = NULL;
         if (atp->other_pids.size()>0) {
             v = &(atp->other_pids);
         }
         procinfo_app(pi, v, pm, atp->app_version->graphics_exec_file);
+#endif
         if (atp->app_version->is_vm_app) {
             // the memory of virtual machine apps is not reported correctly,
             // at least on Windows.  Use the VM size instead.
@@ -486,6 +519,18 @@ void ACTIVE_TASK_SET::get_memory_usage() {
     // not all of them generate disk I/O,
     // so they're not useful for detecting paging/thrashing.
     //
+    double new_cpu_time = 0;
+    bool valid = true;
+#ifdef __linux__
+    retval = proc_acct_non_boinc_cpu_time(new_cpu_time, boinc_cpu_time, valid);
+    if (retval) {
+        valid = false;
+    } else if (log_flags.mem_usage_debug) {
+        msg_printf(NULL, MSG_INFO,
+            "[mem_usage] All others: CPU %.3fs", new_cpu_time
+        );
+    }
+#else
     PROCINFO pi;
     procinfo_non_boinc(pi, pm);
     if (log_flags.mem_usage_debug) {
@@ -496,8 +541,9 @@ void ACTIVE_TASK_SET::get_memory_usage() {
             pi.user_time, pi.kernel_time
         );
     }
-    double new_cpu_time = pi.user_time + pi.kernel_time;
-    if (!first) {
+    new_cpu_time = pi.user_time + pi.kernel_time;
+#endif
+    if (!first && have_last_cpu_time && valid) {
         non_boinc_cpu_usage = (new_cpu_time - last_cpu_time)/(diff*gstate.host_info.p_ncpus);
         // processes might have exited in the last 10 sec,
         // causing this to be negative.
@@ -509,6 +555,7 @@ void ACTIVE_TASK_SET::get_memory_usage() {
         }
     }
     last_cpu_time = new_cpu_time;
+    have_last_cpu_time = (retval == 0);
     first = false;
 }
 
@@ -693,6 +740,9 @@ int ACTIVE_TASK::write(MIOFILE& fout) {
         bytes_sent,
         bytes_received
     );
+    if (prestaged) {
+        fout.printf("    <prestaged/>\n");
+    }
     fout.printf("</active_task>\n");
     return 0;
 }
@@ -874,6 +924,7 @@ int ACTIVE_TASK::parse(XML_PARSER& xp) {
         else if (xp.parse_double("checkpoint_fraction_done", checkpoint_fraction_done)) continue;
         else if (xp.parse_double("checkpoint_fraction_done_elapsed_time", checkpoint_fraction_done_elapsed_time)) continue;
         else if (xp.parse_bool("once_ran_edf", once_ran_edf)) continue;
+        else if (xp.parse_bool("prestaged", prestaged)) continue;
         else if (xp.parse_double("fraction_done", fraction_done)) continue;
             // deprecated - for backwards compat
         else if (xp.parse_int("app_version_num", n)) continue;
@@ -1063,9 +1114,9 @@ int ACTIVE_TASK::handle_upload_files() {
                 get_pathname(fip, path, sizeof(path));
                 retval = md5_file(path, fip->md5_cksum, fip->nbytes);
                 if (retval) {
-                    fip->status = retval;
+                    fip->set_status(retval);
                 } else {
-                    fip->status = FILE_PRESENT;
+                    fip->set_status(FILE_PRESENT);
                 }
             } else {
                 msg_printf(wup->project, MSG_INTERNAL_ERROR,
@@ -1147,6 +1198,9 @@ void ACTIVE_TASK_SET::init() {
 #endif
 
 void ACTIVE_TASK::set_task_state(int val, const char* where) {
+#ifndef SIM
+    bool changed = (val != _task_state);
+#endif
     _task_state = val;
     if (log_flags.task_debug) {
         msg_printf(result->project, MSG_INFO,
@@ -1154,6 +1208,11 @@ void ACTIVE_TASK::set_task_state(int val, const char* where) {
             active_task_state_string(val), result->name, where
         );
     }
+#ifndef SIM
+    if (changed) {
+        gstate.gui_rpcs.task_event(this);
+    }
+#endif
 }
 
 #ifndef SIM
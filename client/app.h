@@ -26,6 +26,7 @@
 #include "app_ipc.h"
 #include "common_defs.h"
 #include "procinfo.h"
+#include "proc_acct.h"
 
 #include "client_types.h"
 
@@ -64,6 +65,7 @@ struct ACTIVE_TASK {
     APP_VERSION* app_version;
     PROCESS_ID pid;
     PROCINFO procinfo;
+    PROC_ACCT proc_acct;
 
     // START OF ITEMS SAVED IN TASK STATE FILE
     // (in addition to result name and project URL)
@@ -92,9 +94,15 @@ struct ACTIVE_TASK {
     double current_cpu_time;
         // most recent CPU time reported by app
     bool once_ran_edf;
+    bool prestaged;
+        // the slot dir was set up before the job was first scheduled
 
     // END OF ITEMS SAVED IN STATE FILE
 
+    int prestage_misses;
+        // if prestaged, the number of consecutive scheduling passes
+        // in which the job wasn't among the likely-next jobs
+
     double fraction_done;
         // App's estimate of how much of the work unit is done.
         // Passed from the application via an API call;
@@ -147,6 +155,8 @@ struct ACTIVE_TASK {
     int want_network;
         // This task wants to do network comm (for F@h)
         // this is passed via share-memory message (app_status channel)
+    int app_status_seqno;
+        // seqno of the last status read from the binary status block
     double abort_time;
         // when we sent an abort message to this app
         // kill it 5 seconds later if it doesn't exit
@@ -261,6 +271,9 @@ struct ACTIVE_TASK {
         // preempt (via suspend or quit) a running task
     int resume_or_start(bool);
     void send_network_available();
+    void send_process_control_msg(const char*);
+        // send (or queue) a message to the app's process_control_request
+        // channel, and wake the app
 #ifdef _WIN32
     void handle_exited_app(unsigned long);
 #else
@@ -286,6 +299,7 @@ struct ACTIVE_TASK {
     int copy_output_files();
     int setup_file(FILE_INFO*, FILE_REF&, char*, bool, bool);
     bool must_copy_file(FILE_REF&, bool);
+    int prestage_files();
     void write_task_state_file();
     void read_task_state_file();
 
@@ -195,10 +195,7 @@ static void print_descendants(int pid, vector<int>desc, const char* where) {
 //
 int ACTIVE_TASK::request_exit() {
     if (app_client_shm.shm) {
-        process_control_queue.msg_queue_send(
-            "<quit/>",
-            app_client_shm.shm->process_control_request
-        );
+        send_process_control_msg("<quit/>");
     }
     set_task_state(PROCESS_QUIT_PENDING, "request_exit()");
     quit_time = gstate.now;
@@ -213,10 +210,7 @@ int ACTIVE_TASK::request_exit() {
 //
 int ACTIVE_TASK::request_abort() {
     if (app_client_shm.shm) {
-        process_control_queue.msg_queue_send(
-            "<abort/>",
-            app_client_shm.shm->process_control_request
-        );
+        send_process_control_msg("<abort/>");
     }
     set_task_state(PROCESS_ABORT_PENDING, "request_abort");
     abort_time = gstate.now;
@@ -673,12 +667,18 @@ void ACTIVE_TASK_SET::send_trickle_downs() {
         if (atp->have_trickle_down) {
             if (!atp->app_client_shm.shm) continue;
             sent = atp->app_client_shm.shm->trickle_down.send_msg("<have_trickle_down/>\n");
-            if (sent) atp->have_trickle_down = false;
+            if (sent) {
+                atp->have_trickle_down = false;
+                atp->app_client_shm.ring_doorbell();
+            }
         }
         if (atp->send_upload_file_status) {
             if (!atp->app_client_shm.shm) continue;
             sent = atp->app_client_shm.shm->trickle_down.send_msg("<upload_file_status/>\n");
-            if (sent) atp->send_upload_file_status = false;
+            if (sent) {
+                atp->send_upload_file_status = false;
+                atp->app_client_shm.ring_doorbell();
+            }
        }
     }
 }
@@ -740,9 +740,13 @@ void ACTIVE_TASK_SET::process_control_poll() {
             }
             atp->kill_running_task(true);
         } else {
+            size_t n = atp->process_control_queue.msgs.size();
             atp->process_control_queue.msg_queue_poll(
                 atp->app_client_shm.shm->process_control_request
             );
+            if (atp->process_control_queue.msgs.size() < n) {
+                atp->app_client_shm.ring_doorbell();
+            }
         }
     }
 }
@@ -1028,10 +1032,7 @@ int ACTIVE_TASK::request_reread_app_info() {
     init_app_init_data(aid);
     int retval = write_app_init_file(aid);
     if (retval) return retval;
-    process_control_queue.msg_queue_send(
-        "<reread_app_info/>",
-        app_client_shm.shm->process_control_request
-    );
+    send_process_control_msg("<reread_app_info/>");
     return 0;
 }
 
@@ -1314,10 +1315,7 @@ int ACTIVE_TASK::suspend() {
     }
     int n = process_control_queue.msg_queue_purge("<resume/>");
     if (n == 0) {
-        process_control_queue.msg_queue_send(
-            "<suspend/>",
-            app_client_shm.shm->process_control_request
-        );
+        send_process_control_msg("<suspend/>");
     }
     set_task_state(PROCESS_SUSPENDED, "suspend");
     return 0;
@@ -1339,10 +1337,7 @@ int ACTIVE_TASK::unsuspend(int reason) {
     }
     int n = process_control_queue.msg_queue_purge("<suspend/>");
     if (n == 0) {
-        process_control_queue.msg_queue_send(
-            "<resume/>",
-            app_client_shm.shm->process_control_request
-        );
+        send_process_control_msg("<resume/>");
     }
     set_task_state(PROCESS_EXECUTING, "unsuspend");
     return 0;
@@ -1350,22 +1345,25 @@ int ACTIVE_TASK::unsuspend(int reason) {
 
 void ACTIVE_TASK::send_network_available() {
     if (!app_client_shm.shm) return;
+    send_process_control_msg("<network_available/>");
+    return;
+}
+
+void ACTIVE_TASK::send_process_control_msg(const char* msg) {
     process_control_queue.msg_queue_send(
-        "<network_available/>",
-        app_client_shm.shm->process_control_request
+        msg, app_client_shm.shm->process_control_request
     );
-    return;
+    app_client_shm.ring_doorbell();
 }
 
-// See if the app has placed a new message in shared mem
-// (with CPU done, frac done etc.)
-// If so parse it and return true.
+// See if the app has reported new status (CPU done, frac done etc.)
+// in the binary status block or,
+// for apps using older versions of the API, the app_status channel.
+// If so get it and return true.
 //
 bool ACTIVE_TASK::get_app_status_msg() {
     char msg_buf[MSG_CHANNEL_SIZE];
-    double fd;
-    int other_pid;
-    double dtemp;
+    APP_STATUS_DATA asd;
     static double last_msg_time=0;
 
     if (!app_client_shm.shm) {
@@ -1374,65 +1372,90 @@ bool ACTIVE_TASK::get_app_status_msg() {
         );
         return false;
     }
-    if (!app_client_shm.shm->app_status.get_msg(msg_buf)) {
+    memset(&asd, 0, sizeof(asd));
+    if (app_client_shm.shm_ext
+        && app_client_shm.shm_ext->app_status.read(asd, app_status_seqno)
+    ) {
+        if (log_flags.app_msg_receive) {
+            msg_printf(this->wup->project, MSG_INFO,
+                "[app_msg_receive] got status from slot %d: CPU %f checkpoint CPU %f fraction done %f",
+                slot, asd.current_cpu_time, asd.checkpoint_cpu_time,
+                asd.fraction_done
+            );
+            for (int i=0; i<asd.ncounters && i<APP_STATUS_MAX_COUNTERS; i++) {
+                msg_printf(this->wup->project, MSG_INFO,
+                    "[app_msg_receive]    counter %d: %f", i, asd.counters[i]
+                );
+            }
+        }
+    } else if (app_client_shm.shm->app_status.get_msg(msg_buf)) {
+        if (log_flags.app_msg_receive) {
+            msg_printf(this->wup->project, MSG_INFO,
+                "[app_msg_receive] got msg from slot %d: %s", slot, msg_buf
+            );
+        }
+        parse_double(msg_buf, "<fraction_done>", asd.fraction_done);
+        parse_double(msg_buf, "<current_cpu_time>", asd.current_cpu_time);
+        parse_double(msg_buf, "<checkpoint_cpu_time>", asd.checkpoint_cpu_time);
+        parse_double(msg_buf, "<fpops_per_cpu_sec>", result->fpops_per_cpu_sec);
+        parse_double(msg_buf, "<fpops_cumulative>", result->fpops_cumulative);
+        parse_double(msg_buf, "<intops_per_cpu_sec>", result->intops_per_cpu_sec);
+        parse_double(msg_buf, "<intops_cumulative>", result->intops_cumulative);
+        parse_double(msg_buf, "<bytes_sent>", asd.bytes_sent);
+        parse_double(msg_buf, "<bytes_received>", asd.bytes_received);
+        parse_int(msg_buf, "<want_network>", asd.want_network);
+        parse_int(msg_buf, "<other_pid>", asd.other_pid);
+    } else {
         return false;
     }
-    if (log_flags.app_msg_receive) {
-        msg_printf(this->wup->project, MSG_INFO,
-            "[app_msg_receive] got msg from slot %d: %s", slot, msg_buf
-        );
-    }
-    want_network = 0;
-    current_cpu_time = checkpoint_cpu_time = 0.0;
-    if (parse_double(msg_buf, "<fraction_done>", fd)) {
-        // fraction_done will be reported as zero
-        // until the app's first call to boinc_fraction_done().
-        // So ignore zeros.
-        //
-        if (fd) {
-            fraction_done = fd;
-            fraction_done_elapsed_time = elapsed_time;
-            if (!first_fraction_done) {
-                first_fraction_done = fd;
-                first_fraction_done_elapsed_time = elapsed_time;
-            }
-            if (log_flags.task_debug && (fd<0 || fd>1)) {
-                if (gstate.now > last_msg_time + 60) {
-                    msg_printf(this->wup->project, MSG_INFO,
-                        "[task_debug] app reported bad fraction done: %f", fd
-                    );
-                    last_msg_time = gstate.now;
-                }
+
+    // fraction_done will be reported as zero
+    // until the app's first call to boinc_fraction_done().
+    // So ignore zeros.
+    //
+    double fd = asd.fraction_done;
+    if (fd) {
+        fraction_done = fd;
+        fraction_done_elapsed_time = elapsed_time;
+        if (!first_fraction_done) {
+            first_fraction_done = fd;
+            first_fraction_done_elapsed_time = elapsed_time;
+        }
+        if (log_flags.task_debug && (fd<0 || fd>1)) {
+            if (gstate.now > last_msg_time + 60) {
+                msg_printf(this->wup->project, MSG_INFO,
+                    "[task_debug] app reported bad fraction done: %f", fd
+                );
+                last_msg_time = gstate.now;
             }
         }
     }
-    parse_double(msg_buf, "<current_cpu_time>", current_cpu_time);
-    parse_double(msg_buf, "<checkpoint_cpu_time>", checkpoint_cpu_time);
-    parse_double(msg_buf, "<fpops_per_cpu_sec>", result->fpops_per_cpu_sec);
-    parse_double(msg_buf, "<fpops_cumulative>", result->fpops_cumulative);
-    parse_double(msg_buf, "<intops_per_cpu_sec>", result->intops_per_cpu_sec);
-    parse_double(msg_buf, "<intops_cumulative>", result->intops_cumulative);
-    if (parse_double(msg_buf, "<bytes_sent>", dtemp)) {
-        if (dtemp > bytes_sent_episode) {
-            double nbytes = dtemp - bytes_sent_episode;
+    current_cpu_time = asd.current_cpu_time;
+    checkpoint_cpu_time = asd.checkpoint_cpu_time;
+
+    // network usage is reported only if nonzero
+    //
+    if (asd.bytes_sent) {
+        if (asd.bytes_sent > bytes_sent_episode) {
+            double nbytes = asd.bytes_sent - bytes_sent_episode;
             daily_xfer_history.add(nbytes, true);
             bytes_sent += nbytes;
         }
-        bytes_sent_episode = dtemp;
+        bytes_sent_episode = asd.bytes_sent;
     }
-    if (parse_double(msg_buf, "<bytes_received>", dtemp)) {
-        if (dtemp > bytes_received_episode) {
-            double nbytes = dtemp - bytes_received_episode;
+    if (asd.bytes_received) {
+        if (asd.bytes_received > bytes_received_episode) {
+            double nbytes = asd.bytes_received - bytes_received_episode;
             daily_xfer_history.add(nbytes, false);
             bytes_received += nbytes;
         }
-        bytes_received_episode = dtemp;
+        bytes_received_episode = asd.bytes_received;
     }
-    parse_int(msg_buf, "<want_network>", want_network);
-    if (parse_int(msg_buf, "<other_pid>", other_pid)) {
+    want_network = asd.want_network;
+    if (asd.other_pid) {
         // for now, we handle only one of these
         other_pids.clear();
-        other_pids.push_back(other_pid);
+        other_pids.push_back(asd.other_pid);
     }
     if (current_cpu_time < 0) {
         msg_printf(result->project, MSG_INFO,
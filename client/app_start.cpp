@@ -152,7 +152,7 @@ int ACTIVE_TASK::get_shmem_seg_name() {
     for (i=0; i<1024; i++) {
         sprintf(seg_name, "%sboinc_%d", SHM_PREFIX, i);
         shm_handle = create_shmem(
-            seg_name, sizeof(SHARED_MEM), (void**)&app_client_shm.shm,
+            seg_name, SHMEM_SEG_SIZE, (void**)&app_client_shm.shm,
             try_global
         );
         if (shm_handle) break;
@@ -281,6 +281,7 @@ void ACTIVE_TASK::init_app_init_data(APP_INIT_DATA& aid) {
 #else
     aid.shmem_seg_name = shmem_seg_name;
 #endif
+    aid.shmem_ext_size = sizeof(SHARED_MEM_EXT);
     aid.wu_cpu_time = checkpoint_cpu_time;
     APP_VERSION* avp = app_version;
     for (unsigned int i=0; i<avp->app_files.size(); i++) {
@@ -370,6 +371,7 @@ bool ACTIVE_TASK::must_copy_file(FILE_REF& fref, bool is_io_file) {
 // set up a file reference, given a slot dir and project dir.
 // This means:
 // 1) copy the file to slot dir, if reference is by copy
+//    (or hard-link it, if the user allows that)
 // 2) else make a soft link
 //
 int ACTIVE_TASK::setup_file(
@@ -413,6 +415,16 @@ int ACTIVE_TASK::setup_file(
             if (boinc_file_exists(link_path)) {
                 return 0;
             }
+            if (cc_config.hard_link_copied_files
+                && !boinc_hard_link(file_path, link_path)
+            ) {
+                if (log_flags.slot_debug) {
+                    msg_printf(project, MSG_INFO,
+                        "[slot] hard-linked %s to %s", file_path, link_path
+                    );
+                }
+                return 0;
+            }
             if (fip->nbytes > ASYNC_FILE_THRESHOLD) {
                 ASYNC_COPY* ac = new ASYNC_COPY;
                 retval = ac->init(this, fip, file_path, link_path);
@@ -449,6 +461,43 @@ int ACTIVE_TASK::setup_file(
     return 0;
 }
 
+// Set up the slot dir of a job that hasn't been scheduled yet
+// but probably will be soon: copy the files that must be copied,
+// so that the job starts quickly when it's scheduled.
+// There's at most one async copy per task;
+// call this again when it's done to do the next file.
+// Links and the init file are made when the job starts.
+//
+int ACTIVE_TASK::prestage_files() {
+    unsigned int i;
+    FILE_REF fref;
+    FILE_INFO* fip;
+    char file_path[MAXPATHLEN];
+    int retval;
+
+    if (async_copy) return 0;
+    prestaged = true;
+    for (i=0; i<app_version->app_files.size(); i++) {
+        fref = app_version->app_files[i];
+        if (!must_copy_file(fref, false)) continue;
+        fip = fref.file_info;
+        get_pathname(fip, file_path, sizeof(file_path));
+        retval = setup_file(fip, fref, file_path, true, false);
+        if (retval == ERR_IN_PROGRESS) return 0;
+        if (retval) return retval;
+    }
+    for (i=0; i<wup->input_files.size(); i++) {
+        fref = wup->input_files[i];
+        if (!must_copy_file(fref, true)) continue;
+        fip = fref.file_info;
+        get_pathname(fip, file_path, sizeof(file_path));
+        retval = setup_file(fip, fref, file_path, true, true);
+        if (retval == ERR_IN_PROGRESS) return 0;
+        if (retval) return retval;
+    }
+    return 0;
+}
+
 int ACTIVE_TASK::link_user_files() {
     PROJECT* project = wup->project;
     unsigned int i;
@@ -602,6 +651,7 @@ int ACTIVE_TASK::start(bool test) {
 
     bytes_sent_episode = 0;
     bytes_received_episode = 0;
+    app_status_seqno = 0;
 
     if (!app_client_shm.shm) {
         retval = get_shmem_seg_name();
@@ -721,6 +771,7 @@ int ACTIVE_TASK::start(bool test) {
     //
     startup_info.dwFlags = STARTF_FORCEOFFFEEDBACK;
 
+    app_client_shm.init_ext();
     app_client_shm.reset_msgs();
 
     if (cc_config.run_apps_manually) {
@@ -852,12 +903,13 @@ int ACTIVE_TASK::start(bool test) {
     //
     if (!app_client_shm.shm) {
         retval = create_shmem(
-            shmem_seg_name, sizeof(SHARED_MEM), (void**)&app_client_shm.shm
+            shmem_seg_name, SHMEM_SEG_SIZE, (void**)&app_client_shm.shm
         );
         if (retval) {
             return retval;
         }
     }
+    app_client_shm.init_ext();
     app_client_shm.reset_msgs();
 
     // save current dir
@@ -953,7 +1005,7 @@ int ACTIVE_TASK::start(bool test) {
                 }
             }
             retval = create_shmem_mmap(
-                buf, sizeof(SHARED_MEM), (void**)&app_client_shm.shm
+                buf, SHMEM_SEG_SIZE, (void**)&app_client_shm.shm
             );
             if (retval) {
                 msg_printf(wup->project, MSG_INTERNAL_ERROR,
@@ -965,7 +1017,7 @@ int ACTIVE_TASK::start(bool test) {
         } else {
             // Use shmget() shared memory
             retval = create_shmem(
-                shmem_seg_name, sizeof(SHARED_MEM), gstate.boinc_project_gid,
+                shmem_seg_name, SHMEM_SEG_SIZE, gstate.boinc_project_gid,
                 (void**)&app_client_shm.shm
             );
 
@@ -977,6 +1029,7 @@ int ACTIVE_TASK::start(bool test) {
         }
         needs_shmem = false;
     }
+    app_client_shm.init_ext();
     app_client_shm.reset_msgs();
 
 #if (defined (__APPLE__) && (defined(__i386__) || defined(__x86_64__)))
@@ -988,6 +1041,11 @@ int ACTIVE_TASK::start(bool test) {
         set_task_state(PROCESS_EXECUTING, "start");
         return 0;
     }
+#ifdef __linux__
+    proc_acct_create_cgroup(this);
+    proc_acct.niced = !cc_config.no_priority_change
+        && get_priority(high_priority) > 0;
+#endif
     pid = fork();
     if (pid == -1) {
         snprintf(buf, sizeof(buf), "fork() failed: %s", strerror(errno));
@@ -999,6 +1057,12 @@ int ACTIVE_TASK::start(bool test) {
         // If an error happens,
         // exit nonzero so that the client knows there was a problem.
 
+#ifdef __linux__
+        // do this first, so that all the task's processes are in its cgroup
+        //
+        proc_acct_enter_cgroup(this);
+#endif
+
         // don't pass stdout to the app
         //
         int fd = open("/dev/null", O_RDWR);
@@ -16,15 +16,19 @@
 // along with BOINC.  If not, see <http://www.gnu.org/licenses/>.
 
 // logic for "asynchronous" file copy and unzip/verify operations.
-// "asynchronous" means that the the operations are done in 64KB chunks
-// in the client's polling loop,
-// so that the client continues to respond to GUI RPCs
+// "asynchronous" means that the operations don't block the client,
+// so that it continues to respond to GUI RPCs
 // and the manager won't freeze.
+// The I/O is done by worker threads (see async_file.h),
+// or, if async_file_threads is zero, in 64KB chunks
+// in the client's polling loop.
 
 #ifdef _WIN32
 #include "boinc_win.h"
 #else
+#include "config.h"
 #include <string.h>
+#include <unistd.h>
 #endif
 
 #ifdef _MSC_VER
@@ -40,6 +44,7 @@
 #include "app.h"
 #include "client_msgs.h"
 #include "client_state.h"
+#include "file_store.h"
 #include "project.h"
 #include "sandbox.h"
 
@@ -50,8 +55,35 @@ using std::vector;
 vector<ASYNC_VERIFY*> async_verifies;
 vector<ASYNC_COPY*> async_copies;
 
+// ops removed while their worker was running;
+// deleted when the worker is done
+//
+static vector<ASYNC_FILE_OP*> cancelled_ops;
+
+static THREAD_LOCK async_file_lock;
+static bool async_file_quitting = false;
+    // the client is exiting; workers must not touch gstate.
+    // Protected by async_file_lock
+
 #define BUFSIZE 64*1024
 
+ASYNC_FILE_OP::ASYNC_FILE_OP() {
+    use_thread = cc_config.async_file_threads > 0;
+    thread.arg = NULL;
+    thread.quit_flag = false;
+    running = false;
+    done = false;
+    cancelled = false;
+    thread_retval = 0;
+}
+
+bool ASYNC_FILE_OP::is_cancelled() {
+    async_file_lock.lock();
+    bool c = cancelled;
+    async_file_lock.unlock();
+    return c;
+}
+
 // set up an async copy operation.
 //
 int ASYNC_COPY::init(
@@ -108,51 +140,101 @@ ASYNC_COPY::~ASYNC_COPY() {
 }
 
 // copy a 64KB chunk.
-// return nonzero if we're done (success or fail)
+// return 1 if we're at the end of the input,
+// 0 if there's more to do, or an error code
 //
-int ASYNC_COPY::copy_chunk() {
+int ASYNC_COPY::copy_data() {
     unsigned char buf[BUFSIZE];
-    int retval;
 
     size_t n = fread(buf, 1, BUFSIZE, in);
     if (n == 0) {
-        // copy done.  rename temp file
-        //
-        fclose(in);
-        fclose(out);
-        in = out = NULL;
-        retval = boinc_rename(temp_path, to_path);
+        if (ferror(in)) return ERR_FREAD;
+        return 1;
+    }
+    size_t m = fwrite(buf, 1, n, out);
+    if (m != n) {
+        return ERR_FWRITE;
+    }
+    return 0;
+}
+
+// the data has been copied.  Rename the temp file and start the task
+//
+void ASYNC_COPY::copy_done() {
+    int retval;
+
+    fclose(in);
+    fclose(out);
+    in = out = NULL;
+    retval = boinc_rename(temp_path, to_path);
+    if (retval) {
+        error(retval);
+        return;
+    }
+
+    if (log_flags.async_file_debug) {
+        msg_printf(atp->wup->project, MSG_INFO,
+            "[async] async copy of %s finished", to_path
+        );
+    }
+
+    atp->async_copy = NULL;
+    fip->set_permissions(to_path);
+
+    // If task is still scheduled, start it.
+    //
+    if (atp->scheduler_state == CPU_SCHED_SCHEDULED) {
+        retval = atp->start();
         if (retval) {
             error(retval);
-            return 1;
         }
+    }
+}
 
-        if (log_flags.async_file_debug) {
-            msg_printf(atp->wup->project, MSG_INFO,
-                "[async] async copy of %s finished", to_path
-            );
-        }
-    
-        atp->async_copy = NULL;
-        fip->set_permissions(to_path);
-
-        // If task is still scheduled, start it.
-        //
-        if (atp->scheduler_state == CPU_SCHED_SCHEDULED) {
-            retval = atp->start();
-            if (retval) {
-                error(retval);
-            }
-        }
-        return 1;       // tell caller we're done
+// do a chunk in the main loop.
+// return nonzero if we're done (success or fail)
+//
+int ASYNC_COPY::copy_chunk() {
+    int retval = copy_data();
+    if (retval == 0) return 0;
+    if (retval < 0) {
+        error(retval);
     } else {
-        size_t m = fwrite(buf, 1, n, out);
-        if (m != n) {
-            error(ERR_FWRITE);
-            return 1;
-        }
+        copy_done();
+    }
+    return 1;       // tell caller we're done
+}
+
+// Copy the whole file in a worker thread.
+// If the OS can do it without moving the data through user space
+// (see boinc_copy_fd()) use that; else fall back to read/write
+//
+int ASYNC_COPY::do_work() {
+    int retval;
+#ifndef _WIN32
+    retval = boinc_copy_fd(fileno(in), fileno(out));
+    if (retval != ERR_NOT_IMPLEMENTED) return retval;
+#endif
+    while (1) {
+        if (is_cancelled()) return 0;
+        retval = copy_data();
+        if (retval) break;
+    }
+    return (retval < 0)?retval:0;
+}
+
+void ASYNC_COPY::discard() {
+    fclose(out);
+    out = NULL;
+    boinc_delete_file(temp_path);
+}
+
+void ASYNC_COPY::work_done() {
+    if (thread_retval) {
+        error(thread_retval);
+    } else {
+        copy_done();
     }
-    return 0;
 }
 
 // handle the failure of a copy; error out the result
@@ -167,6 +249,17 @@ void ASYNC_COPY::error(int retval) {
     gstate.request_schedule_cpus("start failed");
 }
 
+// If a worker is running the op, we can't delete it yet.
+// Tell the worker to stop, and delete the op (and its temp file)
+// when it has.
+//
+static void cancel_async_file_op(ASYNC_FILE_OP* op) {
+    async_file_lock.lock();
+    op->cancelled = true;
+    async_file_lock.unlock();
+    cancelled_ops.push_back(op);
+}
+
 void remove_async_copy(ASYNC_COPY* acp) {
     vector<ASYNC_COPY*>::iterator i = async_copies.begin();
     while (i != async_copies.end()) {
@@ -176,21 +269,28 @@ void remove_async_copy(ASYNC_COPY* acp) {
         }
         ++i;
     }
+    if (acp->running) {
+        cancel_async_file_op(acp);
+        if (acp->atp) acp->atp->async_copy = NULL;
+        acp->atp = NULL;
+        return;
+    }
     delete acp;
 }
 
 int ASYNC_VERIFY::init(FILE_INFO* _fip) {
     fip = _fip;
+    gzipped = fip->download_gzipped;
     md5_init(&md5_state);
     get_pathname(fip, inpath, sizeof(inpath));
 
     if (log_flags.async_file_debug) {
         msg_printf(fip->project, MSG_INFO,
             "[async] started async MD5%s of %s",
-            fip->download_gzipped?" and uncompress":"", fip->name
+            gzipped?" and uncompress":"", fip->name
         );
     }
-    if (fip->download_gzipped) {
+    if (gzipped) {
         safe_strcpy(outpath, inpath);
         char dir[MAXPATHLEN];
         boinc_path_to_dir(outpath, dir);
@@ -200,7 +300,6 @@ int ASYNC_VERIFY::init(FILE_INFO* _fip) {
         out = boinc_temp_file(dir, "verify", temp_path);
 #endif
         if (!out) {
-            fclose(in);
             return ERR_FOPEN;
         }
 
@@ -208,6 +307,7 @@ int ASYNC_VERIFY::init(FILE_INFO* _fip) {
         gzin = gzopen(inpath, "rb");
         if (gzin == Z_NULL) {
             fclose(out);
+            out = NULL;
             boinc_delete_file(temp_path);
             return ERR_FOPEN;
         }
@@ -220,6 +320,15 @@ int ASYNC_VERIFY::init(FILE_INFO* _fip) {
     return 0;
 }
 
+ASYNC_VERIFY::~ASYNC_VERIFY() {
+    if (in) fclose(in);
+    if (out) fclose(out);
+    if (gzin) gzclose(gzin);
+    if (fip) {
+        fip->async_verify = NULL;
+    }
+}
+
 // the MD5 has been computed.  Finish up.
 //
 void ASYNC_VERIFY::finish() {
@@ -257,8 +366,10 @@ void ASYNC_VERIFY::finish() {
         );
     }
     fip->async_verify = NULL;
-    fip->status = FILE_PRESENT;
+    fip->set_status(FILE_PRESENT);
     fip->set_permissions();
+    file_store_add(fip);
+    gstate.download_finished(fip);
 }
 
 void ASYNC_VERIFY::error(int retval) {
@@ -269,46 +380,98 @@ void ASYNC_VERIFY::error(int retval) {
         );
     }
     fip->async_verify = NULL;
-    fip->status = retval;
+    if (file_store_bad_link(fip)) return;
+    fip->set_status(retval);
 }
 
-int ASYNC_VERIFY::verify_chunk() {
+// read (and maybe decompress) a 64KB chunk and add it to the MD5.
+// return 1 if we're at the end of the input,
+// 0 if there's more to do, or an error code
+//
+int ASYNC_VERIFY::verify_data() {
     size_t n;
     unsigned char buf[BUFSIZE];
-    if (fip->download_gzipped) {
-        n = gzread(gzin, buf, BUFSIZE);
-        if (n <=0) {
-            // done
-            //
-            gzclose(gzin);
-            fclose(out);
-            delete_project_owned_file(inpath, true);
-            boinc_rename(temp_path, outpath);
-            finish();
+    if (gzipped) {
+        int nr = gzread(gzin, buf, BUFSIZE);
+        if (nr <= 0) {
             return 1;
-        } else {
-            size_t m = fwrite(buf, 1, n, out);
-            if (m != n || ferror(out)) {
-                // write failed
-                //
-                error(ERR_FWRITE);
-                return 1;
-            }
-            md5_append(&md5_state, buf, (int)n);
         }
+        n = nr;
+        size_t m = fwrite(buf, 1, n, out);
+        if (m != n || ferror(out)) {
+            // write failed
+            //
+            return ERR_FWRITE;
+        }
+        md5_append(&md5_state, buf, (int)n);
     } else {
         n = fread(buf, 1, BUFSIZE, in);
         if (!n || ferror(in)) {
-            fclose(in);
-            finish();
             return 1;
-        } else {
-            md5_append(&md5_state, buf, (int)n);
         }
+        md5_append(&md5_state, buf, (int)n);
     }
     return 0;
 }
 
+// all the data has been read.
+// If we decompressed it, replace the .gz file with the result
+//
+void ASYNC_VERIFY::verify_done() {
+    if (gzipped) {
+        gzclose(gzin);
+        fclose(out);
+        gzin = NULL;
+        out = NULL;
+        delete_project_owned_file(inpath, true);
+        boinc_rename(temp_path, outpath);
+    } else {
+        fclose(in);
+        in = NULL;
+    }
+    finish();
+}
+
+// do a chunk in the main loop.
+// return nonzero if we're done (success or fail)
+//
+int ASYNC_VERIFY::verify_chunk() {
+    int retval = verify_data();
+    if (retval == 0) return 0;
+    if (retval < 0) {
+        error(retval);
+    } else {
+        verify_done();
+    }
+    return 1;
+}
+
+int ASYNC_VERIFY::do_work() {
+    int retval;
+    while (1) {
+        if (is_cancelled()) return 0;
+        retval = verify_data();
+        if (retval) break;
+    }
+    return (retval < 0)?retval:0;
+}
+
+void ASYNC_VERIFY::discard() {
+    if (out) {
+        fclose(out);
+        out = NULL;
+        boinc_delete_file(temp_path);
+    }
+}
+
+void ASYNC_VERIFY::work_done() {
+    if (thread_retval) {
+        error(thread_retval);
+    } else {
+        verify_done();
+    }
+}
+
 void remove_async_verify(ASYNC_VERIFY* avp) {
     vector<ASYNC_VERIFY*>::iterator i = async_verifies.begin();
     while (i != async_verifies.end()) {
@@ -318,28 +481,162 @@ void remove_async_verify(ASYNC_VERIFY* avp) {
         }
         ++i;
     }
+    if (avp->running) {
+        cancel_async_file_op(avp);
+        if (avp->fip) avp->fip->async_verify = NULL;
+        avp->fip = NULL;
+        return;
+    }
     delete avp;
 }
 
-// If there are any async file operations,
-// do a 64KB chunk of the first one and return true.
+// is there an op for the main loop to do a chunk of?
+//
+bool have_async_file_op() {
+    unsigned int i;
+    for (i=0; i<async_copies.size(); i++) {
+        if (!async_copies[i]->use_thread) return true;
+    }
+    for (i=0; i<async_verifies.size(); i++) {
+        if (!async_verifies[i]->use_thread) return true;
+    }
+    return false;
+}
+
+// If there are any async file operations done in the main loop,
+// do a 64KB chunk of the first one.
 //
 // Note: if there are lots of pending operations,
 // it's better to finish the oldest one before starting the rest
 //
 void do_async_file_op() {
-    if (async_copies.size()) {
-        ASYNC_COPY* acp = async_copies[0];
+    unsigned int i;
+    poll_async_file_threads();
+    for (i=0; i<async_copies.size(); i++) {
+        ASYNC_COPY* acp = async_copies[i];
+        if (acp->use_thread) continue;
         if (acp->copy_chunk()) {
-            async_copies.erase(async_copies.begin());
+            async_copies.erase(async_copies.begin()+i);
             delete acp;
         }
         return;
     }
-    if (async_verifies.size()) {
-        if (async_verifies[0]->verify_chunk()) {
-            async_verifies.erase(async_verifies.begin());
+    for (i=0; i<async_verifies.size(); i++) {
+        ASYNC_VERIFY* avp = async_verifies[i];
+        if (avp->use_thread) continue;
+        if (avp->verify_chunk()) {
+            async_verifies.erase(async_verifies.begin()+i);
+            delete avp;
         }
+        return;
     }
 }
 
+#ifdef _WIN32
+static DWORD WINAPI async_file_worker(LPVOID p) {
+#else
+static void* async_file_worker(void* p) {
+#endif
+    THREAD* tp = (THREAD*)p;
+    ASYNC_FILE_OP* op = (ASYNC_FILE_OP*)tp->arg;
+    int retval = op->do_work();
+
+    // once done is set, the main thread may delete the op
+    //
+    // Wake up the main loop, unless the client is exiting
+    // (http_ops may be cleaned up at any point after that)
+    //
+    async_file_lock.lock();
+    op->thread_retval = retval;
+    op->done = true;
+    if (!async_file_quitting) {
+        gstate.http_ops->wakeup();
+    }
+    async_file_lock.unlock();
+    return 0;
+}
+
+// is op's worker finished?
+// If so, and we haven't seen that yet, count it as no longer running
+//
+static bool check_worker_done(ASYNC_FILE_OP* op, int& nrunning) {
+    if (!op->running) return false;
+    async_file_lock.lock();
+    bool d = op->done;
+    async_file_lock.unlock();
+    if (!d) nrunning++;
+    return d;
+}
+
+// start a worker for op if we're below the limit.
+// If we can't create a thread, do the op in the main loop
+//
+static void start_worker(ASYNC_FILE_OP* op, int& nrunning) {
+    if (!op->use_thread || op->running) return;
+    int max_threads = cc_config.async_file_threads;
+    if (max_threads < 1) max_threads = 1;
+    if (nrunning >= max_threads) return;
+    int retval = op->thread.run(async_file_worker, op);
+    if (retval) {
+        op->use_thread = false;
+        return;
+    }
+    op->running = true;
+    nrunning++;
+}
+
+// Handle ops whose workers are done, and start workers for waiting ops.
+// Copies before verifies: a task is waiting for each copy.
+//
+void poll_async_file_threads() {
+    unsigned int i;
+    int nrunning = 0;
+
+    for (i=0; i<cancelled_ops.size(); ) {
+        ASYNC_FILE_OP* op = cancelled_ops[i];
+        if (check_worker_done(op, nrunning)) {
+            cancelled_ops.erase(cancelled_ops.begin()+i);
+            op->discard();
+            delete op;
+        } else {
+            i++;
+        }
+    }
+    for (i=0; i<async_copies.size(); ) {
+        ASYNC_COPY* acp = async_copies[i];
+        if (check_worker_done(acp, nrunning)) {
+            async_copies.erase(async_copies.begin()+i);
+            acp->work_done();
+            delete acp;
+        } else {
+            i++;
+        }
+    }
+    for (i=0; i<async_verifies.size(); ) {
+        ASYNC_VERIFY* avp = async_verifies[i];
+        if (check_worker_done(avp, nrunning)) {
+            async_verifies.erase(async_verifies.begin()+i);
+            avp->work_done();
+            delete avp;
+        } else {
+            i++;
+        }
+    }
+
+    for (i=0; i<async_copies.size(); i++) {
+        start_worker(async_copies[i], nrunning);
+    }
+    for (i=0; i<async_verifies.size(); i++) {
+        start_worker(async_verifies[i], nrunning);
+    }
+}
+
+// called when the client exits, before network cleanup.
+// Workers may still be running (their threads are detached);
+// once this returns, none of them will touch gstate.
+//
+void quit_async_file_threads() {
+    async_file_lock.lock();
+    async_file_quitting = true;
+    async_file_lock.unlock();
+}
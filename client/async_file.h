@@ -17,6 +17,14 @@
 
 // asynchronous file operations
 //
+// Large file copies (project dir to slot dir) and verifies
+// (MD5 and maybe decompression after download) are done either
+// - by worker threads, at most cc_config.async_file_threads at once.
+//   The thread does the I/O and checksumming;
+//   the rest (renaming, marking files present, starting the task)
+//   is done by the main thread when the worker is done.
+// - if async_file_threads is zero, in the main loop, 64KB at a time.
+//
 
 #ifndef BOINC_ASYNC_FILE_H
 #define BOINC_ASYNC_FILE_H
@@ -33,16 +41,46 @@
 #include "filesys.h"
 #include "md5.h"
 
+#include "thread.h"
+
 struct FILE_INFO;
 struct ACTIVE_TASK;
 
 #define ASYNC_FILE_THRESHOLD    1e7
     // use async ops for files exceeding this size
 
+// the part of an operation shared with its worker thread, if any
+//
+struct ASYNC_FILE_OP {
+    bool use_thread;
+        // decided when the op is created
+    THREAD thread;
+    bool running;
+        // a worker thread has been started
+    bool done;
+        // the worker is finished; protected by async_file_lock
+    bool cancelled;
+        // the op is no longer wanted; the worker stops at the next chunk.
+        // protected by async_file_lock
+    int thread_retval;
+        // result of the worker's part of the op
+
+    ASYNC_FILE_OP();
+    virtual ~ASYNC_FILE_OP(){};
+
+    bool is_cancelled();
+    virtual int do_work() = 0;
+        // the worker's part: all the I/O.  Called in the worker thread
+    virtual void work_done() = 0;
+        // finish up in the main thread
+    virtual void discard() = 0;
+        // clean up a cancelled op after its worker is done
+};
+
 // Used to copy a file from project dir to slot dir;
 // when done, start the task again.
 //
-struct ASYNC_COPY {
+struct ASYNC_COPY : ASYNC_FILE_OP {
     ACTIVE_TASK* atp;
     FILE_INFO* fip;
     FILE* in, *out;
@@ -54,16 +92,25 @@ struct ASYNC_COPY {
     int init(
         ACTIVE_TASK*, FILE_INFO*, const char* from_path, const char* _to_path
     );
+    int copy_data();
     int copy_chunk();
+    void copy_done();
     void error(int);
+    int do_work();
+    void work_done();
+    void discard();
 };
 
 // Used to verify and possibly decompress a file
 // after it has been downloaded.
 // When done, mark it as present.
+// The worker uses only the op's own fields, not the FILE_INFO,
+// which may be deleted while the worker runs.
 //
-struct ASYNC_VERIFY {
+struct ASYNC_VERIFY : ASYNC_FILE_OP {
     FILE_INFO* fip;
+    bool gzipped;
+        // copy of fip->download_gzipped
     md5_state_t md5_state;
     FILE* in, *out;
     gzFile gzin;
@@ -71,6 +118,7 @@ struct ASYNC_VERIFY {
 
     ASYNC_VERIFY(){
       fip = NULL;
+      gzipped = false;
       in = NULL;
       out = NULL;
       gzin = NULL;
@@ -78,12 +126,17 @@ struct ASYNC_VERIFY {
       safe_strcpy(temp_path, "");
       safe_strcpy(outpath, "");
     };
-    ~ASYNC_VERIFY(){};
+    ~ASYNC_VERIFY();
 
     int init(FILE_INFO*);
+    int verify_data();
     int verify_chunk();
+    void verify_done();
     void finish();
     void error(int);
+    int do_work();
+    void work_done();
+    void discard();
 };
 
 extern std::vector<ASYNC_VERIFY*> async_verifies;
@@ -91,9 +144,9 @@ extern std::vector<ASYNC_COPY*> async_copies;
 
 extern void remove_async_copy(ASYNC_COPY*);
 extern void remove_async_verify(ASYNC_VERIFY*);
-inline bool have_async_file_op() {
-    return (async_verifies.size() || async_copies.size());
-}
+extern bool have_async_file_op();
 extern void do_async_file_op();
+extern void poll_async_file_threads();
+extern void quit_async_file_threads();
 
 #endif
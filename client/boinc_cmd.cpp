@@ -70,6 +70,8 @@ Commands:\n\
  --get_cc_status\n\
  --get_daily_xfer_history           show network traffic history\n\
  --get_disk_usage                   show disk usage\n\
+ --get_events                       show task, transfer, message etc. events\n\
+                                    as they happen\n\
  --get_file_transfers               show file transfers\n\
  --get_host_info\n\
  --get_message_count                show largest message seqno\n\
@@ -126,6 +128,48 @@ const char* prio_name(int prio) {
     return "unknown";
 }
 
+void print_event(CC_EVENT& e) {
+    switch (e.type) {
+    case GUI_EVENT_TASK:
+        printf("task %s: %s, elapsed %.1f, %.2f%% done\n",
+            e.name.c_str(), active_task_state_string(e.active_task_state),
+            e.elapsed_time, e.fraction_done*100
+        );
+        break;
+    case GUI_EVENT_RESULT:
+        printf("result %s: %s\n",
+            e.name.c_str(), result_client_state_string(e.state)
+        );
+        break;
+    case GUI_EVENT_TRANSFER:
+        if (e.transfer_done) {
+            printf("%s %s: done, status %d\n",
+                e.is_upload?"upload":"download", e.name.c_str(), e.status
+            );
+        } else {
+            printf("%s %s: %.0f/%.0f bytes, %.1f KBps\n",
+                e.is_upload?"upload":"download", e.name.c_str(),
+                e.file_transfer.bytes_xferred, e.file_transfer.nbytes,
+                e.file_transfer.xfer_speed/1024
+            );
+        }
+        break;
+    case GUI_EVENT_MESSAGE:
+        strip_whitespace(e.msg.body);
+        printf("message %d: (%s) [%s] %s\n",
+            e.msg.seqno, prio_name(e.msg.priority),
+            e.msg.project.c_str(), e.msg.body.c_str()
+        );
+        break;
+    case GUI_EVENT_NOTICE:
+        strip_whitespace(e.notice.description);
+        printf("notice %d: %s\n",
+            e.notice.seqno, e.notice.description.c_str()
+        );
+        break;
+    }
+}
+
 void acct_mgr_do_rpc(
     RPC_CLIENT& rpc, char* am_url, char* am_name, char* am_passwd
 ) {
@@ -510,6 +554,23 @@ int main(int argc, char** argv) {
                 );
             }
         }
+    } else if (!strcmp(cmd, "--get_events")) {
+        retval = rpc.subscribe_events(GUI_EVENT_ALL);
+        while (!retval) {
+            CC_EVENTS events;
+            retval = rpc.get_events(events, 60);
+            if (retval == ERR_TIMEOUT) {
+                retval = 0;
+                continue;
+            }
+            if (events.dropped) {
+                printf("(%d events dropped)\n", events.dropped);
+            }
+            for (unsigned int j=0; j<events.events.size(); j++) {
+                print_event(events.events[j]);
+            }
+            fflush(stdout);
+        }
     } else if (!strcmp(cmd, "--get_host_info")) {
         HOST_INFO hi;
         retval = rpc.get_host_info(hi);
@@ -139,7 +139,9 @@ void CLIENT_STATE::check_active_task(ACTIVE_TASK& p) {
 }
 
 void CLIENT_STATE::check_pers_file_xfer(PERS_FILE_XFER& p) {
-    if (p.fxp) check_file_xfer_pointer(p.fxp);
+    if (p.fxp && !p.fxp->batch_member && !p.fxp->segmented) {
+        check_file_xfer_pointer(p.fxp);
+    }
     check_file_info_pointer(p.fip);
 }
 
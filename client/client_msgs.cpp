@@ -189,13 +189,38 @@ void MESSAGE_DESCS::insert(PROJ_AM* p, int priority, int now, char* message) {
         msgs.pop_back();
     }
     msgs.push_front(mdp);
+#ifndef SIM
+    gstate.gui_rpcs.message_event(mdp);
+#endif
+}
+
+void MESSAGE_DESC::write(MIOFILE& fout, bool translatable) {
+    char buf[1024];
+
+    safe_strcpy(buf, message.c_str());
+    if (!translatable) {
+        strip_translation(buf);
+    }
+    fout.printf(
+        "<msg>\n"
+        " <project>%s</project>\n"
+        " <pri>%d</pri>\n"
+        " <seqno>%d</seqno>\n"
+        " <body><![CDATA[\n%s\n]]></body>\n"
+        " <time>%d</time>\n",
+        project_name,
+        priority,
+        seqno,
+        buf,
+        timestamp
+    );
+    fout.printf("</msg>\n");
 }
 
 void MESSAGE_DESCS::write(int seqno, MIOFILE& fout, bool translatable) {
     int i, j;
     unsigned int k;
     MESSAGE_DESC* mdp;
-    char buf[1024];
 
     // messages are stored in descreasing seqno,
     // i.e. newer ones are at the head of the vector.
@@ -212,25 +237,7 @@ void MESSAGE_DESCS::write(int seqno, MIOFILE& fout, bool translatable) {
 
     fout.printf("<msgs>\n");
     for (i=j; i>=0; i--) {
-        mdp = msgs[i];
-        safe_strcpy(buf, mdp->message.c_str());
-        if (!translatable) {
-            strip_translation(buf);
-        }
-        fout.printf(
-            "<msg>\n"
-            " <project>%s</project>\n"
-            " <pri>%d</pri>\n"
-            " <seqno>%d</seqno>\n"
-            " <body><![CDATA[\n%s\n]]></body>\n"
-            " <time>%d</time>\n",
-            mdp->project_name,
-            mdp->priority,
-            mdp->seqno,
-            buf,
-            mdp->timestamp
-        );
-        fout.printf("</msg>\n");
+        msgs[i]->write(fout, translatable);
     }
     fout.printf("</msgs>\n");
 }
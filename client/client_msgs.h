@@ -35,6 +35,8 @@ struct MESSAGE_DESC {
     int timestamp;
     int seqno;
     std::string message;
+
+    void write(MIOFILE&, bool translatable);
 };
 
 #define MAX_SAVED_MESSAGES 2000
@@ -36,6 +36,10 @@
 #endif
 #endif
 
+#include <algorithm>
+#include <map>
+#include <string>
+
 #ifdef _MSC_VER
 #define snprintf _snprintf
 #endif
@@ -63,6 +67,7 @@
 #include "cs_proxy.h"
 #include "cs_trickle.h"
 #include "file_names.h"
+#include "file_store.h"
 #include "hostinfo.h"
 #include "http_curl.h"
 #include "network.h"
@@ -73,7 +78,9 @@
 
 #include "client_state.h"
 
+using std::map;
 using std::max;
+using std::string;
 
 CLIENT_STATE gstate;
 COPROCS coprocs;
@@ -100,6 +107,11 @@ CLIENT_STATE::CLIENT_STATE()
 #endif
     time_stats.init();
     client_state_dirty = false;
+    state_file_seqno = 0;
+    state_journal_seqno = -1;
+    state_file_size = 0;
+    state_file_write_time = 0;
+    state_journal_size = 0;
     old_major_version = 0;
     old_minor_version = 0;
     old_release = 0;
@@ -740,6 +752,7 @@ int CLIENT_STATE::init() {
     //
     msg_printf(NULL, MSG_INFO, "Setting up project and slot directories");
     delete_old_slot_dirs();
+    file_store_gc();
     retval = make_project_dirs();
     if (retval) return retval;
 
@@ -843,6 +856,9 @@ int CLIENT_STATE::init() {
     return 0;
 }
 
+#ifdef USE_CURL_MULTI_POLL
+std::vector<pollfd> gui_rpc_pollfds;
+#else
 static void double_to_timeval(double x, timeval& t) {
     t.tv_sec = (int)x;
     t.tv_usec = (int)(1000000*(x - (int)x));
@@ -851,17 +867,54 @@ static void double_to_timeval(double x, timeval& t) {
 FDSET_GROUP curl_fds;
 FDSET_GROUP gui_rpc_fds;
 FDSET_GROUP all_fds;
+#endif
 
 // Spend x seconds either doing I/O (if possible) or sleeping.
 //
 void CLIENT_STATE::do_io_or_sleep(double max_time) {
     int n;
+#ifndef USE_CURL_MULTI_POLL
     struct timeval tv;
+#endif
     set_now();
     double end_time = now + max_time;
     double time_remaining = max_time;
 
     while (1) {
+        // finish file ops whose worker threads are done,
+        // and start workers for new ones.
+        // A worker wakes us up when it's done.
+        //
+        poll_async_file_threads();
+        bool have_async = have_async_file_op();
+
+        // write GUI RPC events that happened since we last waited
+        //
+        gui_rpcs.send_events();
+
+        // prioritize network (including GUI RPC) over async file ops.
+        // if there's a pending asynch file op done in the main loop,
+        // do the select with zero timeout;
+        // otherwise do it for the remaining amount of time.
+
+#ifdef USE_CURL_MULTI_POLL
+        // curl_multi_poll() waits for curl's descriptors and ours;
+        // no fd_sets to rebuild, and no limit on descriptor numbers
+        //
+        gui_rpc_pollfds.clear();
+        if (!autologin_in_progress) {
+            gui_rpcs.get_pollfds(gui_rpc_pollfds);
+        }
+#ifdef NEW_CPU_THROTTLE
+        client_mutex.unlock();
+#endif
+        n = http_ops->poll_wait(gui_rpc_pollfds, have_async?0:time_remaining);
+#ifdef NEW_CPU_THROTTLE
+        client_mutex.lock();
+#endif
+        http_ops->perform(time_remaining);
+        gui_rpcs.got_pollfds(gui_rpc_pollfds);
+#else
         curl_fds.zero();
         gui_rpc_fds.zero();
         http_ops->get_fdset(curl_fds);
@@ -870,12 +923,6 @@ void CLIENT_STATE::do_io_or_sleep(double max_time) {
             gui_rpcs.get_fdset(gui_rpc_fds, all_fds);
         }
 
-        bool have_async = have_async_file_op();
-
-        // prioritize network (including GUI RPC) over async file ops.
-        // if there's a pending asynch file op, do the select with zero timeout;
-        // otherwise do it for the remaining amount of time.
-
         double_to_timeval(have_async?0:time_remaining, tv);
 #ifdef NEW_CPU_THROTTLE
         client_mutex.unlock();
@@ -902,6 +949,7 @@ void CLIENT_STATE::do_io_or_sleep(double max_time) {
 
         http_ops->got_select(all_fds, time_remaining);
         gui_rpcs.got_select(all_fds);
+#endif
 
         if (have_async) {
             // do the async file op only if no network activity
@@ -1202,52 +1250,137 @@ PROJECT* CLIENT_STATE::lookup_project(const char* master_url) {
     return 0;
 }
 
+// The lookup functions below use per-project indexes
+// rather than scanning the global vectors;
+// a client may have tens of thousands of jobs and files,
+// and these are called for each object in the state file
+// and in scheduler replies.
+//
+static string app_version_key(
+    APP* app, const char* platform, int version_num, const char* plan_class
+) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "\t%d\t", version_num);
+    return string(app->name) + "\t" + platform + buf + plan_class;
+}
+
 APP* CLIENT_STATE::lookup_app(PROJECT* p, const char* name) {
-    for (unsigned int i=0; i<apps.size(); i++) {
-        APP* app = apps[i];
-        if (app->project == p && !strcmp(name, app->name)) return app;
-    }
-    return 0;
+    if (!p) return 0;
+    map<string, APP*>::iterator i = p->apps_by_name.find(name);
+    if (i == p->apps_by_name.end()) return 0;
+    return i->second;
 }
 
 RESULT* CLIENT_STATE::lookup_result(PROJECT* p, const char* name) {
-    for (unsigned int i=0; i<results.size(); i++) {
-        RESULT* rp = results[i];
-        if (rp->project == p && !strcmp(name, rp->name)) return rp;
-    }
-    return 0;
+    if (!p) return 0;
+    map<string, RESULT*>::iterator i = p->results_by_name.find(name);
+    if (i == p->results_by_name.end()) return 0;
+    return i->second;
 }
 
 WORKUNIT* CLIENT_STATE::lookup_workunit(PROJECT* p, const char* name) {
-    for (unsigned int i=0; i<workunits.size(); i++) {
-        WORKUNIT* wup = workunits[i];
-        if (wup->project == p && !strcmp(name, wup->name)) return wup;
-    }
-    return 0;
+    if (!p) return 0;
+    map<string, WORKUNIT*>::iterator i = p->workunits_by_name.find(name);
+    if (i == p->workunits_by_name.end()) return 0;
+    return i->second;
 }
 
 APP_VERSION* CLIENT_STATE::lookup_app_version(
     APP* app, char* platform, int version_num, char* plan_class
 ) {
-    for (unsigned int i=0; i<app_versions.size(); i++) {
-        APP_VERSION* avp = app_versions[i];
-        if (avp->app != app) continue;
-        if (version_num != avp->version_num) continue;
-        if (strcmp(avp->platform, platform)) continue;
-        if (strcmp(avp->plan_class, plan_class)) continue;
-        return avp;
-    }
-    return 0;
+    if (!app || !app->project) return 0;
+    PROJECT* p = app->project;
+    map<string, APP_VERSION*>::iterator i = p->app_versions_by_key.find(
+        app_version_key(app, platform, version_num, plan_class)
+    );
+    if (i == p->app_versions_by_key.end()) return 0;
+    return i->second;
 }
 
 FILE_INFO* CLIENT_STATE::lookup_file_info(PROJECT* p, const char* name) {
-    for (unsigned int i=0; i<file_infos.size(); i++) {
-        FILE_INFO* fip = file_infos[i];
-        if (fip->project == p && !strcmp(fip->name, name)) {
-            return fip;
-        }
+    if (!p) return 0;
+    map<string, FILE_INFO*>::iterator i = p->file_infos_by_name.find(name);
+    if (i == p->file_infos_by_name.end()) return 0;
+    return i->second;
+}
+
+void CLIENT_STATE::index_app(APP* app) {
+    app->project->apps_by_name[app->name] = app;
+}
+
+void CLIENT_STATE::index_file_info(FILE_INFO* fip) {
+    fip->project->file_infos_by_name[fip->name] = fip;
+    queue_file_xfer_check(fip);
+}
+
+void CLIENT_STATE::index_app_version(APP_VERSION* avp) {
+    avp->project->app_versions_by_key[app_version_key(
+        avp->app, avp->platform, avp->version_num, avp->plan_class
+    )] = avp;
+}
+
+void CLIENT_STATE::index_workunit(WORKUNIT* wup) {
+    wup->project->workunits_by_name[wup->name] = wup;
+}
+
+void CLIENT_STATE::index_result(RESULT* rp) {
+    rp->project->results_by_name[rp->name] = rp;
+    queue_result_update(rp);
+}
+
+// remove an index entry, but only if it refers to this object
+//
+template <class T> static void unindex(
+    map<string, T*>& index, const string& key, T* obj
+) {
+    typename map<string, T*>::iterator i = index.find(key);
+    if (i != index.end() && i->second == obj) {
+        index.erase(i);
     }
-    return 0;
+}
+
+void CLIENT_STATE::unindex_app(APP* app) {
+    if (!app->project) return;
+    unindex(app->project->apps_by_name, app->name, app);
+}
+
+void CLIENT_STATE::unindex_file_info(FILE_INFO* fip) {
+    journal_file_infos.erase(fip);
+    if (fip->in_xfer_queue) {
+        file_xfer_queue.erase(
+            std::remove(file_xfer_queue.begin(), file_xfer_queue.end(), fip),
+            file_xfer_queue.end()
+        );
+        fip->in_xfer_queue = false;
+    }
+    if (!fip->project) return;
+    unindex(fip->project->file_infos_by_name, fip->name, fip);
+}
+
+void CLIENT_STATE::unindex_app_version(APP_VERSION* avp) {
+    if (!avp->project || !avp->app) return;
+    unindex(avp->project->app_versions_by_key,
+        app_version_key(avp->app, avp->platform, avp->version_num, avp->plan_class),
+        avp
+    );
+}
+
+void CLIENT_STATE::unindex_workunit(WORKUNIT* wup) {
+    if (!wup->project) return;
+    unindex(wup->project->workunits_by_name, wup->name, wup);
+}
+
+void CLIENT_STATE::unindex_result(RESULT* rp) {
+    journal_results.erase(rp);
+    if (rp->in_update_queue) {
+        result_update_queue.erase(
+            std::remove(result_update_queue.begin(), result_update_queue.end(), rp),
+            result_update_queue.end()
+        );
+        rp->in_update_queue = false;
+    }
+    if (!rp->project) return;
+    unindex(rp->project->results_by_name, rp->name, rp);
 }
 
 // functions to create links between state objects
@@ -1587,6 +1720,7 @@ bool CLIENT_STATE::garbage_collect_always() {
                     );
                 }
                 add_old_result(*rp);
+                unindex_result(rp);
                 delete rp;
                 result_iter = results.erase(result_iter);
                 action = true;
@@ -1662,6 +1796,7 @@ bool CLIENT_STATE::garbage_collect_always() {
                     wup->name
                 );
             }
+            unindex_workunit(wup);
             delete wup;
             wu_iter = workunits.erase(wu_iter);
             action = true;
@@ -1695,6 +1830,7 @@ bool CLIENT_STATE::garbage_collect_always() {
                 }
             }
             if (found) {
+                unindex_app_version(avp);
                 delete avp;
                 avp_iter = app_versions.erase(avp_iter);
                 action = true;
@@ -1753,12 +1889,16 @@ bool CLIENT_STATE::garbage_collect_always() {
         fip = *fi_iter;
         if (fip->ref_cnt==0) {
             fip->delete_file();
+#ifndef SIM
+            file_store_release(fip);
+#endif
             if (log_flags.state_debug) {
                 msg_printf(0, MSG_INFO,
                     "[state] CLIENT_STATE::garbage_collect(): deleting file %s\n",
                     fip->name
                 );
             }
+            unindex_file_info(fip);
             delete fip;
             fi_iter = file_infos.erase(fi_iter);
             action = true;
@@ -1774,23 +1914,69 @@ bool CLIENT_STATE::garbage_collect_always() {
     return action;
 }
 
+// does update_results() have anything to do for this result,
+// now or when file transfers finish?
+//
+static bool result_needs_update(RESULT* rp) {
+    switch (rp->state()) {
+    case RESULT_NEW:
+#ifndef SIM
+    case RESULT_FILES_DOWNLOADING:
+#endif
+    case RESULT_FILES_UPLOADING:
+        return true;
+    case RESULT_ABORTED:
+        return !rp->ready_to_report;
+    }
+    return false;
+}
+
+// add a result to the update queue.
+// Ignore objects not (or no longer) in the results vector
+//
+void CLIENT_STATE::queue_result_update(RESULT* rp) {
+    if (rp->in_update_queue) return;
+    if (!rp->project) return;
+    if (lookup_result(rp->project, rp->name) != rp) return;
+    rp->in_update_queue = true;
+    result_update_queue.push_back(rp);
+}
+
 // For results that are waiting for file transfer,
 // check if the transfer is done,
 // and if so switch to new state and take other actions.
 // Also set some fields for newly-aborted results.
 //
+// Only results in the update queue are looked at;
+// they leave it when they reach a state that needs no further checks.
+// Every RESULT_QUEUE_SCAN_PERIOD we rebuild the queue from all results,
+// in case a state change was made without set_state().
+//
 bool CLIENT_STATE::update_results() {
     RESULT* rp;
-    vector<RESULT*>::iterator result_iter;
+    unsigned int i, j;
     bool action = false;
     static double last_time=0;
+    static double last_scan_time=0;
 
     if (!clock_change && now - last_time < UPDATE_RESULTS_PERIOD) return false;
     last_time = now;
 
-    result_iter = results.begin();
-    while (result_iter != results.end()) {
-        rp = *result_iter;
+    if (clock_change || now - last_scan_time > RESULT_QUEUE_SCAN_PERIOD) {
+        last_scan_time = now;
+        for (i=0; i<results.size(); i++) {
+            if (result_needs_update(results[i])) {
+                queue_result_update(results[i]);
+            }
+        }
+    }
+
+    // set_state() may add results to the queue while we go through it;
+    // those are handled next time
+    //
+    size_t n = result_update_queue.size();
+    for (i=0; i<n; i++) {
+        rp = result_update_queue[i];
 
         switch (rp->state()) {
         case RESULT_NEW:
@@ -1840,8 +2026,19 @@ bool CLIENT_STATE::update_results() {
             }
             break;
         }
-        ++result_iter;
     }
+
+    // remove results that need no further checks
+    //
+    for (i=j=0; i<result_update_queue.size(); i++) {
+        rp = result_update_queue[i];
+        if (i < n && !result_needs_update(rp)) {
+            rp->in_update_queue = false;
+            continue;
+        }
+        result_update_queue[j++] = rp;
+    }
+    result_update_queue.resize(j);
     return action;
 }
 
@@ -2054,6 +2251,7 @@ int CLIENT_STATE::reset_project(PROJECT* project, bool detaching) {
             avp = *avp_iter;
             if (avp->project == project) {
                 avp_iter = app_versions.erase(avp_iter);
+                unindex_app_version(avp);
                 delete avp;
             } else {
                 ++avp_iter;
@@ -2065,6 +2263,7 @@ int CLIENT_STATE::reset_project(PROJECT* project, bool detaching) {
             app = *app_iter;
             if (app->project == project) {
                 app_iter = apps.erase(app_iter);
+                unindex_app(app);
                 delete app;
             } else {
                 ++app_iter;
@@ -2125,6 +2324,7 @@ int CLIENT_STATE::detach_project(PROJECT* project) {
         fip = *fi_iter;
         if (fip->project == project) {
             fi_iter = file_infos.erase(fi_iter);
+            unindex_file_info(fip);
             delete fip;
         } else {
             ++fi_iter;
@@ -2140,6 +2340,7 @@ int CLIENT_STATE::detach_project(PROJECT* project) {
             break;
         }
     }
+    journal_projects.erase(project);
 
     // delete statistics file
     //
@@ -2178,6 +2379,7 @@ int CLIENT_STATE::detach_project(PROJECT* project) {
             "Can't delete project directory: %s", boincerror(retval)
         );
     }
+    file_store_gc();
 
     // remove miscellaneous per-project files
     //
@@ -2207,9 +2409,12 @@ int CLIENT_STATE::quit_activities() {
     adjust_rec();
 
     daily_xfer_history.write_file();
-    write_state_file();
+    if (!write_state_file() && cc_config.state_snapshot) {
+        write_state_snapshot();
+    }
     gui_rpcs.close();
     abort_cpu_benchmarks();
+    quit_async_file_threads();
     time_stats.quit();
 
     // stop jobs.
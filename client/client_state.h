@@ -25,6 +25,7 @@
 // poll period is currently 1 sec.
 
 #ifndef _WIN32
+#include <set>
 #include <string>
 #include <vector>
 #include <ctime>
@@ -76,12 +77,16 @@ using std::vector;
 #define TASK_POLL_PERIOD    1.0
 
 #define UPDATE_RESULTS_PERIOD   1.0
+#define RESULT_QUEUE_SCAN_PERIOD    60
+    // how often update_results() looks at all results
 
 #define HANDLE_FINISHED_APPS_PERIOD 1.0
 
 #define BENCHMARK_POLL_PERIOD   1.0
 
 #define PERS_FILE_XFER_START_PERIOD  1.0
+#define FILE_XFER_QUEUE_SCAN_PERIOD 60
+    // how often create_and_delete_pers_file_xfers() looks at all files
 #define PERS_FILE_XFER_POLL_PERIOD  1.0
 
 #define SCHEDULER_RPC_POLL_PERIOD   5.0
@@ -337,6 +342,20 @@ struct CLIENT_STATE {
         // so that the Manager can tell the user what the problem is
 
     bool client_state_dirty;
+        // the state file must be rewritten
+    int state_file_seqno;
+        // incremented on each write of the state file;
+        // the journal is valid only for the matching seqno
+    int state_journal_seqno;
+        // seqno of the state file that the journal applies to
+    double state_file_size;
+    double state_file_write_time;
+    double state_journal_size;
+    std::set<PROJECT*> journal_projects;
+    std::set<FILE_INFO*> journal_file_infos;
+    std::set<RESULT*> journal_results;
+        // objects changed since the last state file or journal write;
+        // used only if cc_config.state_journal is set
     int old_major_version;
     int old_minor_version;
     int old_release;
@@ -403,10 +422,32 @@ struct CLIENT_STATE {
     int link_app_version(PROJECT*, APP_VERSION*);
     int link_workunit(PROJECT*, WORKUNIT*);
     int link_result(PROJECT*, RESULT*);
+
+    // Maintain the per-project name indexes used by lookup_*().
+    // Call index_*() when an object is added to one of the vectors above
+    // (after it's linked to its project)
+    // and unindex_*() when it's removed.
+    //
+    void index_app(APP*);
+    void index_file_info(FILE_INFO*);
+    void index_app_version(APP_VERSION*);
+    void index_workunit(WORKUNIT*);
+    void index_result(RESULT*);
+    void unindex_app(APP*);
+    void unindex_file_info(FILE_INFO*);
+    void unindex_app_version(APP_VERSION*);
+    void unindex_workunit(WORKUNIT*);
+    void unindex_result(RESULT*);
     void print_summary();
     bool abort_unstarted_late_jobs();
     bool garbage_collect();
     bool garbage_collect_always();
+    std::vector<RESULT*> result_update_queue;
+        // results that update_results() needs to look at:
+        // those waiting for file transfers,
+        // and new or aborted ones not yet handled.
+        // Results are added when they're created or change state
+    void queue_result_update(RESULT*);
     bool update_results();
     int nresults_for_project(PROJECT*);
     void check_clock_reset();
@@ -424,13 +465,12 @@ struct CLIENT_STATE {
     bool must_enforce_cpu_schedule;
     bool must_schedule_cpus;
     bool must_check_work_fetch;
-    void assign_results_to_projects();
-    RESULT* highest_prio_project_best_result();
     void reset_rec_accounting();
     bool schedule_cpus();
     void make_run_list(vector<RESULT*>&);
     bool enforce_run_list(vector<RESULT*>&);
     void append_unfinished_time_slice(vector<RESULT*>&);
+    void prestage_jobs();
 
     double runnable_resource_share(int);
     void adjust_rec();
@@ -516,7 +556,13 @@ struct CLIENT_STATE {
     bool start_new_file_xfer(PERS_FILE_XFER&);
 
     int make_project_dirs();
+    std::vector<FILE_INFO*> file_xfer_queue;
+        // files that may need a PERS_FILE_XFER.
+        // Files are added when they're created,
+        // when they become NOT_PRESENT, and when output files are done
+    void queue_file_xfer_check(FILE_INFO*);
     bool create_and_delete_pers_file_xfers();
+    void download_finished(FILE_INFO*);
 
 // --------------- cs_platforms.cpp:
     const char* get_primary_platform();
@@ -569,17 +615,31 @@ struct CLIENT_STATE {
     bool had_or_requested_work;
     bool scheduler_rpc_poll();
 
+// --------------- cs_snapshot.cpp:
+    int write_state_snapshot();
+    int read_state_snapshot(const char*);
+    void add_snapshot_file_infos();
+    void add_snapshot_jobs();
+
 // --------------- cs_statefile.cpp:
     void set_client_state_dirty(const char*);
+    void set_project_dirty(PROJECT*, const char*);
+    void set_file_info_dirty(FILE_INFO*, const char*);
+    void set_result_dirty(RESULT*, const char*);
     int parse_state_file();
     int parse_state_file_aux(const char*);
+    void restore_pers_file_xfer(FILE_INFO*);
+    int link_result_app_version(PROJECT*, RESULT*);
+    int parse_journal_record(XML_PARSER&);
+    void replay_state_journal();
     int write_state(MIOFILE&);
     int write_state_file();
+    int write_state_journal();
     int write_state_file_if_needed();
     void check_anonymous();
     int parse_app_info(PROJECT*, FILE*);
-    int write_state_gui(MIOFILE&);
-    int write_file_transfers_gui(MIOFILE&);
+    int write_state_gui(MIOFILE&, GUI_DELTA* delta=NULL);
+    int write_file_transfers_gui(MIOFILE&, GUI_DELTA* delta=NULL);
     int write_tasks_gui(MIOFILE&, bool);
     void sort_results();
     void sort_projects_by_name();
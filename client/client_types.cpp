@@ -184,6 +184,7 @@ int APP::write(MIOFILE& out) {
 FILE_INFO::FILE_INFO() {
     safe_strcpy(name, "");
     safe_strcpy(md5_cksum, "");
+    safe_strcpy(download_md5, "");
     max_nbytes = 0;
     nbytes = 0;
     gzipped_nbytes = 0;
@@ -202,6 +203,7 @@ FILE_INFO::FILE_INFO() {
     is_project_file = false;
     is_auto_update_file = false;
     anonymous_platform_file = false;
+    in_xfer_queue = false;
     pers_file_xfer = NULL;
     result = NULL;
     project = NULL;
@@ -531,6 +533,12 @@ int FILE_INFO::write_gui(MIOFILE& out) {
     return 0;
 }
 
+void FILE_INFO::set_status(int val) {
+    if (val == status) return;
+    status = val;
+    gstate.queue_file_xfer_check(this);
+}
+
 // delete physical underlying file associated with FILE_INFO
 //
 int FILE_INFO::delete_file() {
@@ -550,7 +558,7 @@ int FILE_INFO::delete_file() {
     if (retval && status != FILE_NOT_PRESENT) {
         msg_printf(project, MSG_INTERNAL_ERROR, "Couldn't delete file %s", path);
     }
-    status = FILE_NOT_PRESENT;
+    set_status(FILE_NOT_PRESENT);
     return retval;
 }
 
@@ -594,6 +602,20 @@ const char* URL_LIST::get_current_url(FILE_INFO& fi) {
     return urls[current_index].c_str();
 }
 
+// copy the fields that change as a file is transferred or generated;
+// used when replaying the state file journal
+//
+void FILE_INFO::copy_state_fields(FILE_INFO& f) {
+    safe_strcpy(md5_cksum, f.md5_cksum);
+    nbytes = f.nbytes;
+    gzipped_nbytes = f.gzipped_nbytes;
+    status = f.status;
+    uploaded = f.uploaded;
+    sticky = f.sticky;
+    sticky_expire_time = f.sticky_expire_time;
+    error_msg = f.error_msg;
+}
+
 // merges information from a new FILE_INFO that has the same name as one
 // that is already present in the client state file.
 //
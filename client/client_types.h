@@ -101,6 +101,9 @@ struct URL_LIST {
 struct FILE_INFO {
     char name[256];
     char md5_cksum[MD5_LEN];
+    char download_md5[MD5_LEN];
+        // MD5 computed during a segmented download;
+        // used (once) by verify_file() instead of reading the file
     double max_nbytes;
     double nbytes;
     double gzipped_nbytes;  // defined if download_gzipped is true
@@ -141,10 +144,15 @@ struct FILE_INFO {
         // if permanent error occurs during file xfer, it's recorded here
     CERT_SIGS* cert_sigs;
     ASYNC_VERIFY* async_verify;
+    bool in_xfer_queue;
+        // in CLIENT_STATE::file_xfer_queue
 
     FILE_INFO();
     ~FILE_INFO();
     void reset();
+    void set_status(int);
+        // change status; use this rather than assigning it,
+        // so that the file is checked for a needed transfer
     int set_permissions(const char* path=0);
     int parse(XML_PARSER&);
     int write(MIOFILE&, bool to_server);
@@ -154,6 +162,7 @@ struct FILE_INFO {
     bool had_failure(int& failnum);
     void failure_message(std::string&);
     int merge_info(FILE_INFO&);
+    void copy_state_fields(FILE_INFO&);
     int verify_file(bool, bool, bool);
     bool verify_file_certs();
     int gzip();
@@ -58,9 +58,11 @@
 #include "sysmon_win.h"
 #else
 #include "config.h"
+#include <algorithm>
 #include <string>
 #include <cstring>
 #include <list>
+#include <map>
 #endif
 
 
@@ -72,16 +74,19 @@
 
 #include "app.h"
 #include "app_config.h"
+#include "async_file.h"
 #include "client_msgs.h"
 #include "client_state.h"
 #include "coproc_sched.h"
 #include "log_flags.h"
 #include "project.h"
 #include "result.h"
+#include "sandbox.h"
 
 
 using std::vector;
 using std::list;
+using std::min;
 
 static double rec_sum;
 
@@ -321,108 +326,208 @@ static inline bool finished_time_slice(ACTIVE_TASK* atp) {
     return (running_beyond_sched_period && checkpointed);
 }
 
-// Choose a "best" runnable CPU job for each project
+// make_run_list() chooses jobs in several passes:
+// for each resource type, jobs of projects with deadline misses
+// in earliest-deadline order, then jobs in order of project priority.
+// Scanning all jobs for each choice would take O(ncpus*njobs),
+// which is a lot on hosts with many cores and many queued jobs.
+// Instead, at the start of make_run_list() we scan the jobs once,
+// putting them in per-project, per-resource queues
+// sorted in the order in which each pass considers them.
+// A choice then looks only at the first job in each project's queue.
 //
-// Values are returned in project->next_runnable_result
-// (skip projects for which this is already non-NULL)
-//
-// Don't choose results with already_selected == true;
-// mark chosen results as already_selected.
-//
-// The preference order:
-// 1. results with active tasks that are running
-// 2. results with active tasks that are preempted (but have a process)
-// 3. results with active tasks that have no process
-// 4. results with no active task
-//
-// TODO: this is called in a loop over NCPUs, which is silly.
-// Should call it once, and have it make an ordered list per project.
-//
-void CLIENT_STATE::assign_results_to_projects() {
-    unsigned int i;
+struct RUN_QUEUE_JOB {
     RESULT* rp;
-    PROJECT* project;
+    int rank;
+        // within a project, jobs of lower rank are chosen first;
+        // see build_run_queues()
+    int order;
+        // breaks ties: position in the results vector,
+        // or for CPU jobs with active tasks, in the active task vector
+    double runtime_remaining;
+        // for the EDF pass
+};
+
+struct RUN_QUEUE {
+    vector<RUN_QUEUE_JOB> jobs;
+    unsigned int next;
 
-    // scan results with an ACTIVE_TASK
+    void clear() {
+        jobs.clear();
+        next = 0;
+    }
+
+    // return the first job not already chosen
     //
-    for (i=0; i<active_tasks.active_tasks.size(); i++) {
-        ACTIVE_TASK *atp = active_tasks.active_tasks[i];
-        if (!atp->runnable()) continue;
-        rp = atp->result;
-        if (rp->already_selected) continue;
-        if (rp->uses_coprocs()) continue;
-        if (!rp->runnable()) continue;
-        project = rp->project;
-        if (!project->next_runnable_result) {
-            project->next_runnable_result = rp;
-            continue;
+    RUN_QUEUE_JOB* first() {
+        while (next < jobs.size()) {
+            if (!jobs[next].rp->already_selected) return &jobs[next];
+            next++;
         }
+        return NULL;
+    }
+};
 
-        // see if this task is "better" than the one currently
-        // selected for this project
-        //
-        ACTIVE_TASK *next_atp = lookup_active_task_by_result(
-            project->next_runnable_result
-        );
+struct PROJECT_RUN_QUEUES {
+    PROJECT* p;
+    RUN_QUEUE edf[MAX_RSC];
+        // jobs for the EDF pass;
+        // only for projects with deadline misses
+    RUN_QUEUE prio[MAX_RSC];
+        // jobs for the priority pass
+};
 
-        if ((next_atp->task_state() == PROCESS_UNINITIALIZED && atp->process_exists())
-            || (next_atp->scheduler_state == CPU_SCHED_PREEMPTED
-            && atp->scheduler_state == CPU_SCHED_SCHEDULED)
-        ) {
-            project->next_runnable_result = atp->result;
+static vector<PROJECT_RUN_QUEUES> run_queues;
+
+// whether the EDF pass considers the project's jobs
+// If the project's DCF is > 90 (and we're not ignoring it)
+// treat all jobs as deadline misses
+//
+static inline bool edf_project(PROJECT* p, int rsc_type) {
+    if (p->dont_use_dcf || p->duration_correction_factor < 90.0) {
+        if (p->rsc_pwf[rsc_type].deadlines_missed_copy <= 0) {
+            return false;
         }
     }
+    return true;
+}
 
-    // Now consider results that don't have an active task
-    //
-    for (i=0; i<results.size(); i++) {
-        rp = results[i];
-        if (rp->already_selected) continue;
-        if (rp->uses_coprocs()) continue;
-        if (lookup_active_task_by_result(rp)) continue;
-        if (!rp->runnable()) continue;
+// EDF order: earliest deadline first.
+// If there's a tie, pick the job with the least remaining time
+// (but don't pick an unstarted job over one that's started)
+//
+static bool edf_before(const RUN_QUEUE_JOB& j1, const RUN_QUEUE_JOB& j2) {
+    if (j1.rp->report_deadline < j2.rp->report_deadline) return true;
+    if (j1.rp->report_deadline > j2.rp->report_deadline) return false;
+    if (j1.rank != j2.rank) return j1.rank < j2.rank;
+    if (j1.runtime_remaining < j2.runtime_remaining) return true;
+    if (j1.runtime_remaining > j2.runtime_remaining) return false;
+    return j1.order < j2.order;
+}
+
+static bool rank_before(const RUN_QUEUE_JOB& j1, const RUN_QUEUE_JOB& j2) {
+    if (j1.rank != j2.rank) return j1.rank < j2.rank;
+    return j1.order < j2.order;
+}
+
+// Build the run queues.
+// The rank of a job in a priority queue is:
+// - for GPU jobs: 0 if started, else 1
+//   (see first_coproc_result())
+// - for CPU jobs:
+//      0: active task is running
+//      1: active task is preempted, but has a process
+//      2: active task has no process
+//      3: no active task
+//
+static void build_run_queues() {
+    unsigned int i;
+    int j;
+    std::map<PROJECT*, PROJECT_RUN_QUEUES*> project_queues;
+    std::map<RESULT*, int> result_tasks;
 
-        project = rp->project;
-        if (project->next_runnable_result) continue;
-        project->next_runnable_result = rp;
+    run_queues.resize(gstate.projects.size());
+    for (i=0; i<gstate.projects.size(); i++) {
+        PROJECT_RUN_QUEUES& prq = run_queues[i];
+        prq.p = gstate.projects[i];
+        for (j=0; j<coprocs.n_rsc; j++) {
+            prq.edf[j].clear();
+            prq.prio[j].clear();
+        }
+        project_queues[prq.p] = &prq;
+    }
+    for (i=0; i<gstate.active_tasks.active_tasks.size(); i++) {
+        ACTIVE_TASK* atp = gstate.active_tasks.active_tasks[i];
+        result_tasks[atp->result] = i;
     }
 
-    // mark selected results, so CPU scheduler won't try to consider
-    // a result more than once
-    //
-    for (i=0; i<projects.size(); i++) {
-        project = projects[i];
-        if (project->next_runnable_result) {
-            project->next_runnable_result->already_selected = true;
+    for (i=0; i<gstate.results.size(); i++) {
+        RESULT* rp = gstate.results[i];
+        if (!rp->runnable()) continue;
+        PROJECT* p = rp->project;
+        std::map<PROJECT*, PROJECT_RUN_QUEUES*>::iterator pi = project_queues.find(p);
+        if (pi == project_queues.end()) continue;
+        PROJECT_RUN_QUEUES& prq = *(pi->second);
+        std::map<RESULT*, int>::iterator ti = result_tasks.find(rp);
+        ACTIVE_TASK* atp = NULL;
+        if (ti != result_tasks.end()) {
+            atp = gstate.active_tasks.active_tasks[ti->second];
+        }
+        int rt = rp->resource_type();
+
+        RUN_QUEUE_JOB job;
+        job.rp = rp;
+        job.order = i;
+        job.runtime_remaining = 0;
+        if (!rp->non_cpu_intensive()) {
+            if (edf_project(p, rt)) {
+                job.rank = atp?0:1;
+                job.runtime_remaining = rp->estimated_runtime_remaining();
+                prq.edf[rt].jobs.push_back(job);
+            }
+            if (rt) {
+                job.rank = rp->not_started?1:0;
+                prq.prio[rt].jobs.push_back(job);
+            }
+        }
+        if (!rt) {
+            if (atp) {
+                if (!atp->runnable()) continue;
+                if (atp->scheduler_state == CPU_SCHED_SCHEDULED) {
+                    job.rank = 0;
+                } else if (atp->process_exists()) {
+                    job.rank = 1;
+                } else {
+                    job.rank = 2;
+                }
+                job.order = ti->second;
+            } else {
+                job.rank = 3;
+            }
+            prq.prio[0].jobs.push_back(job);
+        }
+    }
+
+    for (i=0; i<run_queues.size(); i++) {
+        PROJECT_RUN_QUEUES& prq = run_queues[i];
+        for (j=0; j<coprocs.n_rsc; j++) {
+            vector<RUN_QUEUE_JOB>& edf = prq.edf[j].jobs;
+            vector<RUN_QUEUE_JOB>& prio = prq.prio[j].jobs;
+            std::sort(edf.begin(), edf.end(), edf_before);
+            std::sort(prio.begin(), prio.end(), rank_before);
         }
     }
 }
 
-// Among projects with a "next runnable result",
+// Among projects with runnable CPU jobs,
 // find the project P with the largest priority,
-// and return its next runnable result
+// and return its first job.
+// The preference order:
+// 1. results with active tasks that are running
+// 2. results with active tasks that are preempted (but have a process)
+// 3. results with active tasks that have no process
+// 4. results with no active task
 //
-RESULT* CLIENT_STATE::highest_prio_project_best_result() {
-    PROJECT *best_project = NULL;
+// Don't choose results with already_selected == true;
+// mark the chosen result as already_selected.
+//
+static RESULT* highest_prio_project_best_result() {
+    RUN_QUEUE_JOB* best = NULL;
     double best_prio = 0;
-    bool first = true;
-    unsigned int i;
 
-    for (i=0; i<projects.size(); i++) {
-        PROJECT* p = projects[i];
-        if (!p->next_runnable_result) continue;
+    for (unsigned int i=0; i<run_queues.size(); i++) {
+        PROJECT* p = run_queues[i].p;
         if (p->non_cpu_intensive) continue;
-        if (first || p->sched_priority > best_prio) {
-            first = false;
-            best_project = p;
+        RUN_QUEUE_JOB* job = run_queues[i].prio[0].first();
+        if (!job) continue;
+        if (!best || p->sched_priority > best_prio) {
+            best = job;
             best_prio = p->sched_priority;
         }
     }
-    if (!best_project) return NULL;
-
-    RESULT* rp = best_project->next_runnable_result;
-    best_project->next_runnable_result = 0;
-    return rp;
+    if (!best) return NULL;
+    best->rp->already_selected = true;
+    return best->rp;
 }
 
 // Return a job of the given type according to the following criteria
@@ -437,54 +542,22 @@ RESULT* CLIENT_STATE::highest_prio_project_best_result() {
 // - a later job finishes downloading and starts
 // - an earlier finishes downloading and preempts
 //
-RESULT* first_coproc_result(int rsc_type) {
-    unsigned int i;
-    RESULT* best = NULL;
-    double best_prio=0, prio;
-    for (i=0; i<gstate.results.size(); i++) {
-        RESULT* rp = gstate.results[i];
-        if (rp->resource_type() != rsc_type) continue;
-        if (!rp->runnable()) {
-            //msg_printf(rp->project, MSG_INFO, "not runnable: %s", rp->name);
-            continue;
-        }
-        if (rp->non_cpu_intensive()) continue;
-        if (rp->already_selected) continue;
-        prio = rp->project->sched_priority;
-        if (!best) {
-            best = rp;
-            best_prio = prio;
-            continue;
-        }
-
-        if (prio < best_prio) {
-            continue;
-        }
-        if (prio > best_prio) {
-            best = rp;
-            best_prio = prio;
-            continue;
-        }
-
-        bool bs = !best->not_started;
-        bool rs = !rp->not_started;
-        if (rs && !bs) {
-            best = rp;
-            best_prio = prio;
-            continue;
-        }
-        if (!rs && bs) {
-            continue;
-        }
-
-        // else used "arrived first" order
-        //
-        if (rp->index < best->index) {
-            best = rp;
+static RESULT* first_coproc_result(int rsc_type) {
+    RUN_QUEUE_JOB* best = NULL;
+    double best_prio = 0, prio;
+
+    for (unsigned int i=0; i<run_queues.size(); i++) {
+        RUN_QUEUE_JOB* job = run_queues[i].prio[rsc_type].first();
+        if (!job) continue;
+        prio = run_queues[i].p->sched_priority;
+        if (!best || prio > best_prio
+            || (prio == best_prio && rank_before(*job, *best))
+        ) {
+            best = job;
             best_prio = prio;
         }
     }
-    return best;
+    return best?best->rp:NULL;
 }
 
 // Return earliest-deadline result for given resource type;
@@ -492,60 +565,17 @@ RESULT* first_coproc_result(int rsc_type) {
 // or from projects with extreme DCF
 //
 static RESULT* earliest_deadline_result(int rsc_type) {
-    RESULT *best_result = NULL;
-    ACTIVE_TASK* best_atp = NULL;
-    unsigned int i;
-
-    for (i=0; i<gstate.results.size(); i++) {
-        RESULT* rp = gstate.results[i];
-        if (rp->resource_type() != rsc_type) continue;
-        if (rp->already_selected) continue;
-        if (!rp->runnable()) continue;
-        if (rp->non_cpu_intensive()) continue;
-        PROJECT* p = rp->project;
+    RUN_QUEUE_JOB* best = NULL;
 
-        // Skip this job if the project's deadline-miss count is zero.
-        // If the project's DCF is > 90 (and we're not ignoring it)
-        // treat all jobs as deadline misses
-        //
-        if (p->dont_use_dcf || p->duration_correction_factor < 90.0) {
-            if (p->rsc_pwf[rsc_type].deadlines_missed_copy <= 0) {
-                continue;
-            }
-        }
-
-        bool new_best = false;
-        if (best_result) {
-            if (rp->report_deadline < best_result->report_deadline) {
-                new_best = true;
-            }
-        } else {
-            new_best = true;
-        }
-        if (new_best) {
-            best_result = rp;
-            best_atp = gstate.lookup_active_task_by_result(rp);
-            continue;
-        }
-        if (rp->report_deadline > best_result->report_deadline) {
-            continue;
-        }
-
-        // If there's a tie, pick the job with the least remaining time
-        // (but don't pick an unstarted job over one that's started)
-        //
-        ACTIVE_TASK* atp = gstate.lookup_active_task_by_result(rp);
-        if (best_atp && !atp) continue;
-        if (rp->estimated_runtime_remaining() < best_result->estimated_runtime_remaining()
-            || (!best_atp && atp)
-        ) {
-            best_result = rp;
-            best_atp = atp;
+    for (unsigned int i=0; i<run_queues.size(); i++) {
+        if (!edf_project(run_queues[i].p, rsc_type)) continue;
+        RUN_QUEUE_JOB* job = run_queues[i].edf[rsc_type].first();
+        if (!job) continue;
+        if (!best || edf_before(*job, *best)) {
+            best = job;
         }
     }
-    if (!best_result) return NULL;
-
-    return best_result;
+    return best?best->rp:NULL;
 }
 
 void CLIENT_STATE::reset_rec_accounting() {
@@ -783,7 +813,11 @@ bool CLIENT_STATE::schedule_cpus() {
     adjust_rec();
 
     make_run_list(run_list);
-    return enforce_run_list(run_list);
+    bool action = enforce_run_list(run_list);
+#ifndef SIM
+    prestage_jobs();
+#endif
+    return action;
 }
 
 // Mark a job J as a deadline miss if either
@@ -901,7 +935,6 @@ void CLIENT_STATE::make_run_list(vector<RESULT*>& run_list) {
     }
     for (i=0; i<projects.size(); i++) {
         p = projects[i];
-        p->next_runnable_result = NULL;
         for (int j=0; j<coprocs.n_rsc; j++) {
             p->rsc_pwf[j].deadlines_missed_copy = p->rsc_pwf[j].deadlines_missed;
         }
@@ -924,6 +957,8 @@ void CLIENT_STATE::make_run_list(vector<RESULT*>& run_list) {
         atp->result->not_started = false;
     }
 
+    build_run_queues();
+
     // first, add GPU jobs
 
     for (int j=1; j<coprocs.n_rsc; j++) {
@@ -959,7 +994,6 @@ void CLIENT_STATE::make_run_list(vector<RESULT*>& run_list) {
     // Next, choose CPU jobs from highest priority projects
     //
     while (!proc_rsc.stop_scan_cpu()) {
-        assign_results_to_projects();
         rp = highest_prio_project_best_result();
         if (!rp) break;
         atp = lookup_active_task_by_result(rp);
@@ -1427,7 +1461,8 @@ bool CLIENT_STATE::enforce_run_list(vector<RESULT*>& run_list) {
 #ifdef SIM
             first_time = atp->scheduler_state == CPU_SCHED_UNINITIALIZED;
 #else
-            first_time = is_dir_empty(atp->slot_dir);
+            first_time = is_dir_empty(atp->slot_dir) || atp->prestaged;
+            atp->prestaged = false;
 #endif
             retval = atp->resume_or_start(first_time);
             if ((retval == ERR_SHMGET) || (retval == ERR_SHMAT)) {
@@ -1577,6 +1612,128 @@ double CLIENT_STATE::nearly_runnable_resource_share() {
     return x;
 }
 
+#ifndef SIM
+// does the job need a large file copied into its slot dir?
+// Return the total size of the files to be copied in nbytes.
+//
+static bool needs_large_copy(RESULT* rp, double& nbytes) {
+    unsigned int i;
+    bool large = false;
+    APP_VERSION* avp = rp->avp;
+    WORKUNIT* wup = rp->wup;
+
+    nbytes = 0;
+    for (i=0; i<avp->app_files.size(); i++) {
+        FILE_REF& fref = avp->app_files[i];
+        if (!fref.copy_file) continue;
+        nbytes += fref.file_info->nbytes;
+        if (fref.file_info->nbytes > ASYNC_FILE_THRESHOLD) large = true;
+    }
+    for (i=0; i<wup->input_files.size(); i++) {
+        FILE_REF& fref = wup->input_files[i];
+        if (!fref.copy_file && !strlen(avp->file_prefix)) continue;
+        nbytes += fref.file_info->nbytes;
+        if (fref.file_info->nbytes > ASYNC_FILE_THRESHOLD) large = true;
+    }
+    return large;
+}
+
+#define PRESTAGE_MAX_MISSES 3
+    // release a prestaged job's slot if it hasn't been
+    // among the likely-next jobs for this many scheduling passes
+
+// Called after make_run_list() and enforce_run_list().
+// Continue the scan of CPU jobs where make_run_list() stopped;
+// the jobs found are the ones likely to run next.
+// If they need large files copied into their slot dirs,
+// create their ACTIVE_TASKs (and slots) now and start the copies,
+// so that they start quickly once scheduled.
+//
+// Prestaged jobs hold slot dirs and disk space, so
+// - there are at most min(prestage_jobs, ncpus) of them;
+// - a job is prestaged only if its copies fit in the allowed disk space;
+// - a job that drops out of the likely-next jobs for
+//   PRESTAGE_MAX_MISSES passes loses its slot.
+//
+void CLIENT_STATE::prestage_jobs() {
+    unsigned int i;
+    int nprestaged = 0;
+    double nbytes;
+    ACTIVE_TASK* atp;
+    RESULT* rp;
+    vector<RESULT*> next_jobs;
+
+    int max_jobs = min(cc_config.prestage_jobs, ncpus);
+    while ((int)next_jobs.size() < max_jobs) {
+        rp = highest_prio_project_best_result();
+        if (!rp) break;
+        if (!needs_large_copy(rp, nbytes)) continue;
+        atp = lookup_active_task_by_result(rp);
+        if (atp && !atp->prestaged) continue;
+        next_jobs.push_back(rp);
+    }
+
+    // continue with jobs we've already started on,
+    // and release those that no longer look likely to run
+    //
+    vector<ACTIVE_TASK*>::iterator iter = active_tasks.active_tasks.begin();
+    while (iter != active_tasks.active_tasks.end()) {
+        atp = *iter;
+        if (!atp->prestaged || atp->task_state() != PROCESS_UNINITIALIZED) {
+            ++iter;
+            continue;
+        }
+        rp = atp->result;
+        if (std::find(next_jobs.begin(), next_jobs.end(), rp) != next_jobs.end()) {
+            atp->prestage_misses = 0;
+        } else {
+            atp->prestage_misses++;
+        }
+        if (atp->prestage_misses < PRESTAGE_MAX_MISSES
+            && nprestaged < max_jobs
+        ) {
+            atp->prestage_files();
+            nprestaged++;
+            ++iter;
+            continue;
+        }
+        if (log_flags.slot_debug) {
+            msg_printf(rp->project, MSG_INFO,
+                "[slot] releasing slot %d of prestaged %s",
+                atp->slot, rp->name
+            );
+        }
+        char slot_dir[MAXPATHLEN];
+        safe_strcpy(slot_dir, atp->slot_dir);
+        iter = active_tasks.active_tasks.erase(iter);
+        delete atp;         // cancels the async copy, if any
+        client_clean_out_dir(slot_dir, "prestage_jobs()");
+        set_result_dirty(rp, "prestage_jobs");
+    }
+
+    // start on new ones, if there's room
+    //
+    double disk_avail = allowed_disk_usage(total_disk_usage) - total_disk_usage;
+    for (i=0; i<next_jobs.size() && nprestaged < max_jobs; i++) {
+        rp = next_jobs[i];
+        if (lookup_active_task_by_result(rp)) continue;
+        needs_large_copy(rp, nbytes);
+        if (nbytes > disk_avail) continue;
+        atp = get_task(rp);
+        if (!atp) break;
+        disk_avail -= nbytes;
+        if (log_flags.slot_debug) {
+            msg_printf(rp->project, MSG_INFO,
+                "[slot] prestaging %s in slot %d", rp->name, atp->slot
+            );
+        }
+        atp->prestage_files();
+        set_result_dirty(rp, "prestage_jobs");
+        nprestaged++;
+    }
+}
+#endif
+
 // if there's not an active task for the result, make one
 //
 ACTIVE_TASK* CLIENT_STATE::get_task(RESULT* rp) {
@@ -49,6 +49,8 @@ using std::vector;
 //
 bool CLIENT_STATE::handle_finished_apps() {
     ACTIVE_TASK* atp;
+    RESULT* rp;
+    unsigned int i;
     bool action = false;
     static double last_time = 0;
     if (!clock_change && now - last_time < HANDLE_FINISHED_APPS_PERIOD) return false;
@@ -74,9 +76,22 @@ bool CLIENT_STATE::handle_finished_apps() {
             if (!action) {
                 adjust_rec();     // update REC before erasing ACTIVE_TASK
             }
+            rp = atp->result;
             iter = active_tasks.active_tasks.erase(iter);
             delete atp;
-            set_client_state_dirty("handle_finished_apps");
+
+            // the job's result and output files changed,
+            // and adjust_rec() changed all projects
+            //
+            set_result_dirty(rp, "handle_finished_apps");
+            for (i=0; i<rp->output_files.size(); i++) {
+                set_file_info_dirty(
+                    rp->output_files[i].file_info, "handle_finished_apps"
+                );
+            }
+            for (i=0; i<projects.size(); i++) {
+                set_project_dirty(projects[i], "handle_finished_apps");
+            }
 
             // the following is critical; otherwise the result is
             // still in the "scheduled" list and enforce_schedule()
@@ -130,7 +145,7 @@ int CLIENT_STATE::app_finished(ACTIVE_TASK& at) {
 
                 // an output file is unexpectedly absent.
                 //
-                fip->status = retval;
+                fip->set_status(retval);
                 had_error = true;
                 msg_printf(
                     rp->project, MSG_INFO,
@@ -153,7 +168,7 @@ int CLIENT_STATE::app_finished(ACTIVE_TASK& at) {
                 );
 
                 fip->delete_file();
-                fip->status = ERR_FILE_TOO_BIG;
+                fip->set_status(ERR_FILE_TOO_BIG);
                 had_error = true;
             } else {
                 if (!fip->uploadable() && !fip->sticky) {
@@ -167,10 +182,10 @@ int CLIENT_STATE::app_finished(ACTIVE_TASK& at) {
                         retval = md5_file(path, fip->md5_cksum, fip->nbytes);
                     }
                     if (retval) {
-                        fip->status = retval;
+                        fip->set_status(retval);
                         had_error = true;
                     } else {
-                        fip->status = FILE_PRESENT;
+                        fip->set_status(FILE_PRESENT);
                     }
                 }
             }
@@ -47,6 +47,7 @@
 #include "client_types.h"
 #include "client_state.h"
 #include "client_msgs.h"
+#include "file_store.h"
 #include "file_xfer.h"
 #include "project.h"
 #include "sandbox.h"
@@ -76,6 +77,12 @@ bool CLIENT_STATE::start_new_file_xfer(PERS_FILE_XFER& pfx) {
         if (fip->is_user_file) continue;
         if (fip->is_project_file) continue;
 
+        // count a segmented download once
+        //
+        if (fxp->segment_of && fxp->segment_of->segment_xfers[0] != fxp) {
+            continue;
+        }
+
         // count transfers in the same direction as this
         //
         if (pfx.is_upload == fxp->is_upload) {
@@ -102,6 +109,17 @@ int CLIENT_STATE::make_project_dirs() {
     return 0;
 }
 
+// add a file to the queue checked by create_and_delete_pers_file_xfers().
+// Ignore objects not (or no longer) in the file_infos vector
+//
+void CLIENT_STATE::queue_file_xfer_check(FILE_INFO* fip) {
+    if (fip->in_xfer_queue) return;
+    if (!fip->project) return;
+    if (lookup_file_info(fip->project, fip->name) != fip) return;
+    fip->in_xfer_queue = true;
+    file_xfer_queue.push_back(fip);
+}
+
 // Is app signed by one of the Application Certifiers?
 //
 bool FILE_INFO::verify_file_certs() {
@@ -188,6 +206,13 @@ int FILE_INFO::verify_file(
 
     safe_strcpy(cksum, "");
 
+    // a segmented download computes the MD5 as it goes
+    //
+    if (verify_contents && strlen(download_md5)) {
+        safe_strcpy(cksum, download_md5);
+        safe_strcpy(download_md5, "");
+    }
+
     // see if we need to unzip it
     //
     if (download_gzipped && !boinc_file_exists(pathname)) {
@@ -198,10 +223,10 @@ int FILE_INFO::verify_file(
                 ASYNC_VERIFY* avp = new ASYNC_VERIFY;
                 retval = avp->init(this);
                 if (retval) {
-                    status = retval;
+                    set_status(retval);
                     return retval;
                 }
-                status = FILE_VERIFY_PENDING;
+                set_status(FILE_VERIFY_PENDING);
                 return ERR_IN_PROGRESS;
             }
             retval = gunzip(cksum);
@@ -209,7 +234,7 @@ int FILE_INFO::verify_file(
         } else {
             safe_strcat(gzpath, "t");
             if (!boinc_file_exists(gzpath)) {
-                status = FILE_NOT_PRESENT;
+                set_status(FILE_NOT_PRESENT);
             }
             return ERR_FILE_MISSING;
         }
@@ -220,7 +245,7 @@ int FILE_INFO::verify_file(
     // this will trigger a new download rather than erroring out
     //
     if (file_size(pathname, size)) {
-        status = FILE_NOT_PRESENT;
+        set_status(FILE_NOT_PRESENT);
         return ERR_FILE_MISSING;
     }
 
@@ -268,21 +293,21 @@ int FILE_INFO::verify_file(
             );
             return ERR_NO_SIGNATURE;
         }
-        if (allow_async && nbytes > ASYNC_FILE_THRESHOLD) {
+        if (!strlen(cksum) && allow_async && nbytes > ASYNC_FILE_THRESHOLD) {
             ASYNC_VERIFY* avp = new ASYNC_VERIFY();
             retval = avp->init(this);
             if (retval) {
-                status = retval;
+                set_status(retval);
                 return retval;
             }
-            status = FILE_VERIFY_PENDING;
+            set_status(FILE_VERIFY_PENDING);
             return ERR_IN_PROGRESS;
         }
         if (!strlen(cksum)) {
             double file_length;
             retval = md5_file(pathname, cksum, file_length);
             if (retval) {
-                status = retval;
+                set_status(retval);
                 msg_printf(project, MSG_INFO,
                     "md5_file failed for %s: %s",
                     pathname, boincerror(retval)
@@ -317,10 +342,10 @@ int FILE_INFO::verify_file(
                 ASYNC_VERIFY* avp = new ASYNC_VERIFY();
                 retval = avp->init(this);
                 if (retval) {
-                    status = retval;
+                    set_status(retval);
                     return retval;
                 }
-                status = FILE_VERIFY_PENDING;
+                set_status(FILE_VERIFY_PENDING);
                 return ERR_IN_PROGRESS;
             }
             retval = md5_file(pathname, cksum, local_nbytes);
@@ -330,7 +355,7 @@ int FILE_INFO::verify_file(
                     name, boincerror(retval)
                 );
                 error_msg = "MD5 computation error";
-                status = retval;
+                set_status(retval);
                 return retval;
             }
         }
@@ -351,7 +376,59 @@ int FILE_INFO::verify_file(
     return 0;
 }
 
-// scan FILE_INFOs and create PERS_FILE_XFERs as needed.
+// A download has finished and been verified
+// (if the verification was asynchronous, this is called when it's done);
+// let whatever uses the file know.
+//
+void CLIENT_STATE::download_finished(FILE_INFO* fip) {
+    // if it's a user file, tell running apps to reread prefs
+    //
+    if (fip->is_user_file) {
+        active_tasks.request_reread_prefs(fip->project);
+    }
+
+    // if it's a project file, make a link in project dir
+    //
+    if (fip->is_project_file) {
+        PROJECT* p = fip->project;
+        p->write_symlink_for_project_file(fip);
+        p->update_project_files_downloaded_time();
+    }
+}
+
+// The content of a file we need may already be on disk
+// under another name (see file_store.h).
+// If so, link to it and verify it.
+// Return true if no download is needed.
+//
+static bool get_file_from_store(FILE_INFO* fip) {
+    int retval;
+
+    if (file_store_link(fip)) return false;
+    retval = fip->verify_file(true, true, true);
+    if (retval == ERR_IN_PROGRESS) {
+        // ASYNC_VERIFY will mark it present, or bad
+        // (in which case it will be downloaded)
+        //
+        return true;
+    }
+    if (retval) {
+        file_store_bad_link(fip);
+        fip->set_status(FILE_NOT_PRESENT);
+        return false;
+    }
+    fip->set_permissions();
+    fip->set_status(FILE_PRESENT);
+    if (log_flags.file_xfer) {
+        msg_printf(fip->project, MSG_INFO,
+            "Found content of %s locally, skipping download", fip->name
+        );
+    }
+    gstate.download_finished(fip);
+    return true;
+}
+
+// check queued FILE_INFOs and create PERS_FILE_XFERs as needed.
 // NOTE: this doesn't start the file transfers
 // scan PERS_FILE_XFERs and delete finished ones.
 //
@@ -362,18 +439,36 @@ bool CLIENT_STATE::create_and_delete_pers_file_xfers() {
     bool action = false;
     int retval;
     static double last_time;
+    static double last_scan_time;
 
     if (!clock_change && now - last_time < PERS_FILE_XFER_START_PERIOD) return false;
     last_time = now;
 
-    // Look for FILE_INFOs for which we should start a transfer,
+    // Files are queued when they may need a transfer.
+    // Every so often queue them all,
+    // in case a status change was made without queueing the file.
+    //
+    if (clock_change || now - last_scan_time > FILE_XFER_QUEUE_SCAN_PERIOD) {
+        last_scan_time = now;
+        for (i=0; i<file_infos.size(); i++) {
+            queue_file_xfer_check(file_infos[i]);
+        }
+    }
+
+    // Look for queued FILE_INFOs for which we should start a transfer,
     // and make PERS_FILE_XFERs for them
     //
-    for (i=0; i<file_infos.size(); i++) {
-        fip = file_infos[i];
+    for (i=0; i<file_xfer_queue.size(); i++) {
+        fip = file_xfer_queue[i];
+        fip->in_xfer_queue = false;
         pfx = fip->pers_file_xfer;
         if (pfx) continue;
         if (fip->downloadable() && fip->status == FILE_NOT_PRESENT) {
+            if (file_store_pending(fip)) continue;
+            if (get_file_from_store(fip)) {
+                action = true;
+                continue;
+            }
             pfx = new PERS_FILE_XFER;
             pfx->init(fip, false);
             fip->pers_file_xfer = pfx;
@@ -388,6 +483,7 @@ bool CLIENT_STATE::create_and_delete_pers_file_xfers() {
 
         }
     }
+    file_xfer_queue.clear();
 
     // Scan existing PERS_FILE_XFERs, looking for those that are done,
     // and deleting them
@@ -427,32 +523,22 @@ bool CLIENT_STATE::create_and_delete_pers_file_xfers() {
                 //
                 retval = fip->verify_file(true, true, true);
                 if (retval == ERR_IN_PROGRESS) {
-                    // do nothing
+                    // ASYNC_VERIFY will call download_finished()
                 } else if (retval) {
                     msg_printf(fip->project, MSG_INTERNAL_ERROR,
                         "Checksum or signature error for %s", fip->name
                     );
-                    fip->status = retval;
+                    fip->set_status(retval);
                 } else {
                     // Set the appropriate permissions depending on whether
                     // it's an executable or normal file
                     //
                     retval = fip->set_permissions();
-                    fip->status = FILE_PRESENT;
+                    fip->set_status(FILE_PRESENT);
+                    file_store_add(fip);
                 }
-
-                // if it's a user file, tell running apps to reread prefs
-                //
-                if (fip->is_user_file) {
-                    active_tasks.request_reread_prefs(fip->project);
-                }
-
-                // if it's a project file, make a link in project dir
-                //
-                if (fip->is_project_file) {
-                    PROJECT* p = fip->project;
-                    p->write_symlink_for_project_file(fip);
-                    p->update_project_files_downloaded_time();
+                if (retval != ERR_IN_PROGRESS) {
+                    download_finished(fip);
                 }
             }
             iter = pers_file_xfers->pers_file_xfers.erase(iter);
@@ -460,6 +546,10 @@ bool CLIENT_STATE::create_and_delete_pers_file_xfers() {
             action = true;
             // `delete pfx' should have set pfx->fip->pfx to NULL
             assert (fip == NULL || fip->pers_file_xfer == NULL);
+
+            // the file may need another transfer
+            //
+            if (fip) queue_file_xfer_check(fip);
         } else {
             ++iter;
         }
@@ -495,16 +585,22 @@ void CLIENT_STATE::check_file_existence() {
             int retval = file_size(path, size);
             if (retval) {
                 delete_project_owned_file(path, true);
-                fip->status = FILE_NOT_PRESENT;
+                fip->set_status(FILE_NOT_PRESENT);
                 msg_printf(fip->project, MSG_INFO, "File %s not found", path);
             } else if (fip->nbytes && (size != fip->nbytes)) {
                 if (gstate.global_prefs.dont_verify_images && is_image_file(path)) continue;
                 delete_project_owned_file(path, true);
-                fip->status = FILE_NOT_PRESENT;
+                fip->set_status(FILE_NOT_PRESENT);
                 msg_printf(fip->project, MSG_INFO,
                     "File %s has wrong size: expected %.0f, got %.0f",
                     path, fip->nbytes, size
                 );
+#ifndef SIM
+            } else {
+                // share files downloaded before the store existed
+                //
+                file_store_add(fip);
+#endif
             }
         }
     }
@@ -436,6 +436,9 @@ bool NOTICES::append(NOTICE& n) {
         );
     }
     notices.push_front(n);
+#ifndef SIM
+    gstate.gui_rpcs.notice_event(n);
+#endif
 #if 0
     if (!strlen(n.feed_url)) {
         write_archive(NULL);
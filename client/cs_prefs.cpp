@@ -569,6 +569,7 @@ int PROJECT::parse_preferences_for_user_files() {
             safe_strcpy(fip->name, filename.c_str());
             fip->is_user_file = true;
             gstate.file_infos.push_back(fip);
+            gstate.index_file_info(fip);
         }
 
         fr.file_info = fip;
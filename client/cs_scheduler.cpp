@@ -829,6 +829,7 @@ int CLIENT_STATE::handle_scheduler_reply(
                 delete app;
             } else {
                 apps.push_back(app);
+                index_app(app);
             }
         }
     }
@@ -851,6 +852,7 @@ int CLIENT_STATE::handle_scheduler_reply(
                 delete fip;
             } else {
                 file_infos.push_back(fip);
+                index_file_info(fip);
             }
         }
     }
@@ -925,6 +927,7 @@ int CLIENT_STATE::handle_scheduler_reply(
              continue;
         }
         app_versions.push_back(avp);
+        index_app_version(avp);
     }
     for (i=0; i<sr.workunits.size(); i++) {
         if (lookup_workunit(project, sr.workunits[i].name)) continue;
@@ -941,6 +944,7 @@ int CLIENT_STATE::handle_scheduler_reply(
         }
         wup->clear_errors();
         workunits.push_back(wup);
+        index_workunit(wup);
     }
     double est_rsc_runtime[MAX_RSC];
     bool got_work_for_rsc[MAX_RSC];
@@ -1009,6 +1013,7 @@ int CLIENT_STATE::handle_scheduler_reply(
         rp->received_time = now;
         new_results.push_back(rp);
         results.push_back(rp);
+        index_result(rp);
     }
 
     // find the resources for which we requested work and didn't get any
@@ -1101,6 +1106,7 @@ int CLIENT_STATE::handle_scheduler_reply(
         project->send_full_workload = true;
     }
     project->dont_use_dcf = sr.dont_use_dcf;
+    project->gzip_sched_request = sr.gzip_sched_request;
     project->send_time_stats_log = sr.send_time_stats_log;
     project->send_job_log = sr.send_job_log;
     project->trickle_up_pending = false;
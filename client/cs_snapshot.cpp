@@ -0,0 +1,803 @@
+// This file is part of BOINC.
+// http://boinc.berkeley.edu
+// Copyright (C) 2026 University of California
+//
+// BOINC is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation,
+// either version 3 of the License, or (at your option) any later version.
+//
+// BOINC is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with BOINC.  If not, see <http://www.gnu.org/licenses/>.
+
+// Binary snapshot of file infos, workunits and results;
+// see cs_snapshot.h.
+//
+// Format (native byte order; the endian word rejects foreign files):
+// header:
+//      magic (8 bytes), version, endian word, state file seqno,
+//      state file size (double), body length, MD5 of body (string)
+// body:
+//      project URLs; file infos; workunits; results.
+//      Objects refer to projects by index in the URL list.
+// ints are 4 bytes, doubles 8 bytes, bools 1 byte;
+// strings are a length followed by the bytes (no terminator).
+
+#ifdef _WIN32
+#include "boinc_win.h"
+#else
+#include "config.h"
+#include <cstdio>
+#include <cstring>
+#endif
+
+#include "error_numbers.h"
+#include "filesys.h"
+#include "md5_file.h"
+#include "str_util.h"
+#include "util.h"
+
+#include "client_msgs.h"
+#include "client_state.h"
+#include "file_names.h"
+#include "pers_file_xfer.h"
+#include "project.h"
+#include "result.h"
+
+#include "cs_snapshot.h"
+
+using std::string;
+using std::vector;
+
+#define SNAPSHOT_MAGIC      "BOINCSNP"
+#define SNAPSHOT_MAGIC_LEN  8
+#define SNAPSHOT_ENDIAN     0x01020304
+
+STATE_SNAPSHOT state_snapshot;
+
+void STATE_SNAPSHOT::clear() {
+    unsigned int i;
+    for (i=0; i<file_infos.size(); i++) {
+        delete file_infos[i];
+    }
+    for (i=0; i<workunits.size(); i++) {
+        delete workunits[i];
+    }
+    for (i=0; i<results.size(); i++) {
+        delete results[i];
+    }
+    project_urls.clear();
+    file_project.clear();
+    file_infos.clear();
+    wu_project.clear();
+    workunits.clear();
+    result_project.clear();
+    results.clear();
+}
+
+// encoder
+//
+struct SNAPSHOT_OUT {
+    string buf;
+
+    void put_raw(const void* p, size_t n) {
+        buf.append((const char*)p, n);
+    }
+    void put_int(int x) {
+        put_raw(&x, sizeof(x));
+    }
+    void put_double(double x) {
+        put_raw(&x, sizeof(x));
+    }
+    void put_bool(bool x) {
+        unsigned char c = x?1:0;
+        put_raw(&c, 1);
+    }
+    void put_str(const char* p) {
+        int n = (int)strlen(p);
+        put_int(n);
+        put_raw(p, n);
+    }
+    void put_string(const string& s) {
+        put_int((int)s.size());
+        put_raw(s.data(), s.size());
+    }
+};
+
+// decoder.  On overrun, sets "error" and returns zeros;
+// the caller checks the flag at the end of each object
+//
+struct SNAPSHOT_IN {
+    const char* p;
+    const char* end;
+    bool error;
+
+    SNAPSHOT_IN(const char* _p, size_t n) {
+        p = _p;
+        end = _p + n;
+        error = false;
+    }
+    bool get_raw(void* q, size_t n) {
+        if (error || (size_t)(end - p) < n) {
+            error = true;
+            memset(q, 0, n);
+            return false;
+        }
+        memcpy(q, p, n);
+        p += n;
+        return true;
+    }
+    int get_int() {
+        int x;
+        get_raw(&x, sizeof(x));
+        return x;
+    }
+    double get_double() {
+        double x;
+        get_raw(&x, sizeof(x));
+        return x;
+    }
+    bool get_bool() {
+        unsigned char c;
+        get_raw(&c, 1);
+        return c != 0;
+    }
+    void get_string(string& s) {
+        int n = get_int();
+        if (error || n < 0 || (end - p) < n) {
+            error = true;
+            s = "";
+            return;
+        }
+        s.assign(p, n);
+        p += n;
+    }
+    void get_str(char* q, size_t len) {
+        int n = get_int();
+        if (error || n < 0 || (size_t)n >= len || (end - p) < n) {
+            error = true;
+            *q = 0;
+            return;
+        }
+        memcpy(q, p, n);
+        q[n] = 0;
+        p += n;
+    }
+};
+
+static void put_file_ref(SNAPSHOT_OUT& out, FILE_REF& fref) {
+    out.put_str(fref.file_name);
+    out.put_str(fref.open_name);
+    out.put_bool(fref.main_program);
+    out.put_bool(fref.copy_file);
+    out.put_bool(fref.optional);
+}
+
+static void get_file_ref(SNAPSHOT_IN& in, FILE_REF& fref) {
+    in.get_str(fref.file_name, sizeof(fref.file_name));
+    in.get_str(fref.open_name, sizeof(fref.open_name));
+    fref.main_program = in.get_bool();
+    fref.copy_file = in.get_bool();
+    fref.optional = in.get_bool();
+    fref.file_info = NULL;
+}
+
+static void put_urls(SNAPSHOT_OUT& out, URL_LIST& ul) {
+    out.put_int((int)ul.urls.size());
+    for (unsigned int i=0; i<ul.urls.size(); i++) {
+        out.put_string(ul.urls[i]);
+    }
+}
+
+static void get_urls(SNAPSHOT_IN& in, URL_LIST& ul) {
+    int n = in.get_int();
+    for (int i=0; i<n && !in.error; i++) {
+        string url;
+        in.get_string(url);
+        ul.add(url);
+    }
+}
+
+// the fields here are those written to the state file
+// by FILE_INFO::write(), WORKUNIT::write() and RESULT::write()
+//
+static void put_file_info(SNAPSHOT_OUT& out, FILE_INFO& fi) {
+    out.put_str(fi.name);
+    out.put_str(fi.md5_cksum);
+    out.put_double(fi.nbytes);
+    out.put_double(fi.max_nbytes);
+    out.put_double(fi.gzipped_nbytes);
+    out.put_int(fi.status);
+    out.put_bool(fi.executable);
+    out.put_bool(fi.uploaded);
+    out.put_bool(fi.sticky);
+    out.put_double(fi.sticky_expire_time);
+    out.put_bool(fi.gzip_when_done);
+    out.put_bool(fi.download_gzipped);
+    out.put_bool(fi.signature_required);
+    out.put_str(fi.file_signature);
+    out.put_str(fi.xml_signature);
+    out.put_string(fi.error_msg);
+    put_urls(out, fi.download_urls);
+    put_urls(out, fi.upload_urls);
+    PERS_FILE_XFER* pfx = fi.pers_file_xfer;
+    out.put_bool(pfx != NULL);
+    if (pfx) {
+        out.put_bool(pfx->is_upload);
+        out.put_int(pfx->nretry);
+        out.put_double(pfx->first_request_time);
+        out.put_double(pfx->next_request_time);
+        out.put_double(pfx->time_so_far);
+        out.put_double(pfx->last_bytes_xferred);
+        out.put_int((int)pfx->segments.size());
+        for (unsigned int i=0; i<pfx->segments.size(); i++) {
+            DOWNLOAD_SEGMENT& seg = pfx->segments[i];
+            out.put_double(seg.start);
+            out.put_double(seg.end);
+            out.put_double(seg.nbytes_done);
+        }
+    }
+}
+
+static FILE_INFO* get_file_info(SNAPSHOT_IN& in) {
+    FILE_INFO* fip = new FILE_INFO;
+    in.get_str(fip->name, sizeof(fip->name));
+    in.get_str(fip->md5_cksum, sizeof(fip->md5_cksum));
+    fip->nbytes = in.get_double();
+    fip->max_nbytes = in.get_double();
+    fip->gzipped_nbytes = in.get_double();
+    fip->status = in.get_int();
+    fip->executable = in.get_bool();
+    fip->uploaded = in.get_bool();
+    fip->sticky = in.get_bool();
+    fip->sticky_expire_time = in.get_double();
+    fip->gzip_when_done = in.get_bool();
+    fip->download_gzipped = in.get_bool();
+    fip->signature_required = in.get_bool();
+    in.get_str(fip->file_signature, sizeof(fip->file_signature));
+    in.get_str(fip->xml_signature, sizeof(fip->xml_signature));
+    in.get_string(fip->error_msg);
+    get_urls(in, fip->download_urls);
+    get_urls(in, fip->upload_urls);
+    if (in.get_bool()) {
+        PERS_FILE_XFER* pfx = new PERS_FILE_XFER;
+        pfx->is_upload = in.get_bool();
+        pfx->nretry = in.get_int();
+        pfx->first_request_time = in.get_double();
+        pfx->next_request_time = in.get_double();
+        pfx->time_so_far = in.get_double();
+        pfx->last_bytes_xferred = in.get_double();
+        int n = in.get_int();
+        for (int i=0; i<n && !in.error; i++) {
+            DOWNLOAD_SEGMENT seg;
+            seg.start = in.get_double();
+            seg.end = in.get_double();
+            seg.nbytes_done = in.get_double();
+            pfx->segments.push_back(seg);
+        }
+        fip->pers_file_xfer = pfx;
+    }
+    if (in.error
+        || !strlen(fip->name) || strstr(fip->name, "..") || strstr(fip->name, "%")
+    ) {
+        delete fip->pers_file_xfer;
+        fip->pers_file_xfer = NULL;
+        delete fip;
+        in.error = true;
+        return NULL;
+    }
+
+    // same adjustments as FILE_INFO::parse()
+    //
+    if (fip->status == FILE_VERIFY_PENDING) {
+        fip->status = FILE_NOT_PRESENT;
+    }
+    strip_whitespace(fip->xml_signature);
+    strip_whitespace(fip->file_signature);
+    return fip;
+}
+
+static void put_workunit(SNAPSHOT_OUT& out, WORKUNIT& wu) {
+    unsigned int i;
+    out.put_str(wu.name);
+    out.put_str(wu.app_name);
+    out.put_int(wu.version_num);
+    out.put_string(wu.command_line);
+    out.put_double(wu.rsc_fpops_est);
+    out.put_double(wu.rsc_fpops_bound);
+    out.put_double(wu.rsc_memory_bound);
+    out.put_double(wu.rsc_disk_bound);
+    out.put_int((int)wu.input_files.size());
+    for (i=0; i<wu.input_files.size(); i++) {
+        put_file_ref(out, wu.input_files[i]);
+    }
+    out.put_int((int)wu.job_keyword_ids.ids.size());
+    for (i=0; i<wu.job_keyword_ids.ids.size(); i++) {
+        out.put_int(wu.job_keyword_ids.ids[i]);
+    }
+}
+
+static WORKUNIT* get_workunit(SNAPSHOT_IN& in) {
+    int i, n;
+    WORKUNIT* wup = new WORKUNIT;
+    in.get_str(wup->name, sizeof(wup->name));
+    in.get_str(wup->app_name, sizeof(wup->app_name));
+    wup->version_num = in.get_int();
+    in.get_string(wup->command_line);
+    wup->rsc_fpops_est = in.get_double();
+    wup->rsc_fpops_bound = in.get_double();
+    wup->rsc_memory_bound = in.get_double();
+    wup->rsc_disk_bound = in.get_double();
+    n = in.get_int();
+    for (i=0; i<n && !in.error; i++) {
+        FILE_REF fref;
+        get_file_ref(in, fref);
+        wup->input_files.push_back(fref);
+    }
+    n = in.get_int();
+    for (i=0; i<n && !in.error; i++) {
+        wup->job_keyword_ids.ids.push_back(in.get_int());
+    }
+    if (in.error) {
+        delete wup;
+        return NULL;
+    }
+    return wup;
+}
+
+static void put_result(SNAPSHOT_OUT& out, RESULT& r) {
+    out.put_str(r.name);
+    out.put_str(r.wu_name);
+    out.put_double(r.received_time);
+    out.put_double(r.report_deadline);
+    out.put_int(r.version_num);
+    out.put_str(r.plan_class);
+    out.put_str(r.platform);
+    out.put_double(r.final_cpu_time);
+    out.put_double(r.final_elapsed_time);
+    out.put_double(r.final_peak_working_set_size);
+    out.put_double(r.final_peak_swap_size);
+    out.put_double(r.final_peak_disk_usage);
+    out.put_double(r.final_bytes_sent);
+    out.put_double(r.final_bytes_received);
+    out.put_double(r.fpops_per_cpu_sec);
+    out.put_double(r.fpops_cumulative);
+    out.put_double(r.intops_per_cpu_sec);
+    out.put_double(r.intops_cumulative);
+    out.put_int(r.state());
+    out.put_int(r.exit_status);
+    out.put_string(r.stderr_out);
+    out.put_bool(r.got_server_ack);
+    out.put_bool(r.ready_to_report);
+    out.put_double(r.completed_time);
+    out.put_bool(r.suspended_via_gui);
+    out.put_bool(r.report_immediately);
+    out.put_int((int)r.output_files.size());
+    for (unsigned int i=0; i<r.output_files.size(); i++) {
+        put_file_ref(out, r.output_files[i]);
+    }
+}
+
+static RESULT* get_result(SNAPSHOT_IN& in) {
+    RESULT* rp = new RESULT;
+    in.get_str(rp->name, sizeof(rp->name));
+    in.get_str(rp->wu_name, sizeof(rp->wu_name));
+    rp->received_time = in.get_double();
+    rp->report_deadline = in.get_double();
+    rp->version_num = in.get_int();
+    in.get_str(rp->plan_class, sizeof(rp->plan_class));
+    in.get_str(rp->platform, sizeof(rp->platform));
+    rp->final_cpu_time = in.get_double();
+    rp->final_elapsed_time = in.get_double();
+    rp->final_peak_working_set_size = in.get_double();
+    rp->final_peak_swap_size = in.get_double();
+    rp->final_peak_disk_usage = in.get_double();
+    rp->final_bytes_sent = in.get_double();
+    rp->final_bytes_received = in.get_double();
+    rp->fpops_per_cpu_sec = in.get_double();
+    rp->fpops_cumulative = in.get_double();
+    rp->intops_per_cpu_sec = in.get_double();
+    rp->intops_cumulative = in.get_double();
+    rp->_state = in.get_int();
+    rp->exit_status = in.get_int();
+    in.get_string(rp->stderr_out);
+    rp->got_server_ack = in.get_bool();
+    rp->ready_to_report = in.get_bool();
+    rp->completed_time = in.get_double();
+    rp->suspended_via_gui = in.get_bool();
+    rp->report_immediately = in.get_bool();
+    int n = in.get_int();
+    for (int i=0; i<n && !in.error; i++) {
+        FILE_REF fref;
+        get_file_ref(in, fref);
+        rp->output_files.push_back(fref);
+    }
+    if (in.error) {
+        delete rp;
+        return NULL;
+    }
+
+    // same as RESULT::parse_state()
+    //
+    if (rp->got_server_ack || rp->ready_to_report) {
+        switch (rp->state()) {
+        case RESULT_NEW:
+        case RESULT_FILES_DOWNLOADING:
+        case RESULT_FILES_DOWNLOADED:
+        case RESULT_FILES_UPLOADING:
+            rp->set_state(RESULT_FILES_UPLOADED, "get_result");
+            break;
+        }
+    }
+    return rp;
+}
+
+// Write the snapshot.
+// Call this right after a successful write_state_file(),
+// with no state changes in between.
+//
+int CLIENT_STATE::write_state_snapshot() {
+    SNAPSHOT_OUT body, header;
+    unsigned int i, j;
+    char md5[MD5_LEN];
+    int retval, nfiles=0, nwus=0, nresults=0;
+
+    body.put_int((int)projects.size());
+    for (j=0; j<projects.size(); j++) {
+        body.put_str(projects[j]->master_url);
+    }
+
+    // objects are written per project, in the same order as the state file
+    //
+    for (j=0; j<projects.size(); j++) {
+        PROJECT* p = projects[j];
+        for (i=0; i<file_infos.size(); i++) {
+            FILE_INFO* fip = file_infos[i];
+            if (fip->project != p) continue;
+            if (fip->anonymous_platform_file) continue;
+            nfiles++;
+        }
+    }
+    body.put_int(nfiles);
+    for (j=0; j<projects.size(); j++) {
+        PROJECT* p = projects[j];
+        for (i=0; i<file_infos.size(); i++) {
+            FILE_INFO* fip = file_infos[i];
+            if (fip->project != p) continue;
+            if (fip->anonymous_platform_file) continue;
+            body.put_int(j);
+            put_file_info(body, *fip);
+        }
+    }
+    for (j=0; j<projects.size(); j++) {
+        for (i=0; i<workunits.size(); i++) {
+            if (workunits[i]->project == projects[j]) nwus++;
+        }
+    }
+    body.put_int(nwus);
+    for (j=0; j<projects.size(); j++) {
+        for (i=0; i<workunits.size(); i++) {
+            if (workunits[i]->project != projects[j]) continue;
+            body.put_int(j);
+            put_workunit(body, *workunits[i]);
+        }
+    }
+    for (j=0; j<projects.size(); j++) {
+        for (i=0; i<results.size(); i++) {
+            if (results[i]->project == projects[j]) nresults++;
+        }
+    }
+    body.put_int(nresults);
+    for (j=0; j<projects.size(); j++) {
+        for (i=0; i<results.size(); i++) {
+            if (results[i]->project != projects[j]) continue;
+            body.put_int(j);
+            put_result(body, *results[i]);
+        }
+    }
+
+    md5_block((const unsigned char*)body.buf.data(), (int)body.buf.size(), md5);
+    header.put_raw(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN);
+    header.put_int(STATE_SNAPSHOT_VERSION);
+    header.put_int(SNAPSHOT_ENDIAN);
+    header.put_int(state_file_seqno);
+    header.put_double(state_file_size);
+    header.put_int((int)body.buf.size());
+    header.put_str(md5);
+
+    FILE* f = boinc_fopen(STATE_SNAPSHOT_FILE_NAME, "wb");
+    if (!f) {
+        msg_printf(NULL, MSG_INTERNAL_ERROR,
+            "Can't open %s", STATE_SNAPSHOT_FILE_NAME
+        );
+        return ERR_FOPEN;
+    }
+    retval = 0;
+    if (fwrite(header.buf.data(), 1, header.buf.size(), f) != header.buf.size()) {
+        retval = ERR_FWRITE;
+    }
+    if (!retval && fwrite(body.buf.data(), 1, body.buf.size(), f) != body.buf.size()) {
+        retval = ERR_FWRITE;
+    }
+    if (fclose(f)) retval = ERR_FWRITE;
+    if (retval) {
+        msg_printf(NULL, MSG_INTERNAL_ERROR,
+            "Couldn't write %s", STATE_SNAPSHOT_FILE_NAME
+        );
+        boinc_delete_file(STATE_SNAPSHOT_FILE_NAME);
+        return retval;
+    }
+    if (log_flags.statefile_debug) {
+        msg_printf(NULL, MSG_INFO,
+            "[statefile] Wrote snapshot: %d files, %d workunits, %d tasks",
+            nfiles, nwus, nresults
+        );
+    }
+    return 0;
+}
+
+// get the seqno from the end of a state file
+//
+static int state_file_seqno_of(const char* fname, int& seqno) {
+    string s;
+    int retval = read_file_string(fname, s, 4096, true);
+    if (retval) return retval;
+    const char* tag = "<state_file_seqno>";
+    string::size_type pos = s.rfind(tag);
+    if (pos == string::npos) return ERR_NOT_FOUND;
+    seqno = atoi(s.c_str() + pos + strlen(tag));
+    return 0;
+}
+
+static int decode_snapshot(SNAPSHOT_IN& in, STATE_SNAPSHOT& ss) {
+    int i, n, ip;
+    int nprojects = in.get_int();
+    for (i=0; i<nprojects && !in.error; i++) {
+        string url;
+        in.get_string(url);
+        ss.project_urls.push_back(url);
+    }
+    n = in.get_int();
+    for (i=0; i<n && !in.error; i++) {
+        ip = in.get_int();
+        if (ip < 0 || ip >= nprojects) return ERR_BAD_FORMAT;
+        FILE_INFO* fip = get_file_info(in);
+        if (!fip) return ERR_BAD_FORMAT;
+        ss.file_project.push_back(ip);
+        ss.file_infos.push_back(fip);
+    }
+    n = in.get_int();
+    for (i=0; i<n && !in.error; i++) {
+        ip = in.get_int();
+        if (ip < 0 || ip >= nprojects) return ERR_BAD_FORMAT;
+        WORKUNIT* wup = get_workunit(in);
+        if (!wup) return ERR_BAD_FORMAT;
+        ss.wu_project.push_back(ip);
+        ss.workunits.push_back(wup);
+    }
+    n = in.get_int();
+    for (i=0; i<n && !in.error; i++) {
+        ip = in.get_int();
+        if (ip < 0 || ip >= nprojects) return ERR_BAD_FORMAT;
+        RESULT* rp = get_result(in);
+        if (!rp) return ERR_BAD_FORMAT;
+        ss.result_project.push_back(ip);
+        ss.results.push_back(rp);
+    }
+    if (in.error || in.p != in.end) return ERR_BAD_FORMAT;
+    return 0;
+}
+
+// Read the snapshot, if there is one,
+// and check that it was written along with the given state file.
+// If so, decode its objects into state_snapshot and set it active.
+//
+int CLIENT_STATE::read_state_snapshot(const char* fname) {
+    double size, xml_size;
+    int retval, version, endian, seqno, xml_seqno, body_len;
+    char magic[SNAPSHOT_MAGIC_LEN], md5[MD5_LEN], md5_body[MD5_LEN];
+    const char* reason = NULL;
+
+    state_snapshot.clear();
+    state_snapshot.active = false;
+    if (file_size(STATE_SNAPSHOT_FILE_NAME, size)) return ERR_FOPEN;
+    if (size <= 0) return ERR_BAD_FORMAT;
+
+    vector<char> buf((size_t)size);
+    FILE* f = boinc_fopen(STATE_SNAPSHOT_FILE_NAME, "rb");
+    if (!f) return ERR_FOPEN;
+    size_t n = fread(&buf[0], 1, buf.size(), f);
+    fclose(f);
+    if (n != buf.size()) return ERR_FREAD;
+
+    SNAPSHOT_IN in(&buf[0], buf.size());
+    in.get_raw(magic, sizeof(magic));
+    version = in.get_int();
+    endian = in.get_int();
+    seqno = in.get_int();
+    xml_size = in.get_double();
+    body_len = in.get_int();
+    in.get_str(md5, sizeof(md5));
+    if (in.error || memcmp(magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN)) {
+        reason = "bad header";
+    } else if (version != STATE_SNAPSHOT_VERSION || endian != SNAPSHOT_ENDIAN) {
+        reason = "wrong version or byte order";
+    } else if (body_len != (int)(in.end - in.p)) {
+        reason = "truncated";
+    } else {
+        md5_block((const unsigned char*)in.p, body_len, md5_body);
+        if (strcmp(md5, md5_body)) {
+            reason = "checksum mismatch";
+        } else if (file_size(fname, size) || size != xml_size) {
+            reason = "state file size mismatch";
+        } else if (state_file_seqno_of(fname, xml_seqno) || xml_seqno != seqno) {
+            reason = "state file seqno mismatch";
+        }
+    }
+    if (!reason) {
+        retval = decode_snapshot(in, state_snapshot);
+        if (retval) {
+            reason = "bad contents";
+        }
+    }
+    if (reason) {
+        state_snapshot.clear();
+        if (log_flags.statefile_debug) {
+            msg_printf(NULL, MSG_INFO,
+                "[statefile] Not using snapshot: %s", reason
+            );
+        }
+        return ERR_BAD_FORMAT;
+    }
+    state_snapshot.active = true;
+    if (log_flags.statefile_debug) {
+        msg_printf(NULL, MSG_INFO,
+            "[statefile] Using snapshot: %d files, %d workunits, %d tasks",
+            (int)state_snapshot.file_infos.size(),
+            (int)state_snapshot.workunits.size(),
+            (int)state_snapshot.results.size()
+        );
+    }
+    return 0;
+}
+
+// Link and add the snapshot's file infos.
+// Called before parsing the state file, since app versions refer to them.
+// Error handling is the same as for <file> elements of the state file.
+//
+void CLIENT_STATE::add_snapshot_file_infos() {
+    STATE_SNAPSHOT& ss = state_snapshot;
+    int retval;
+
+    for (unsigned int i=0; i<ss.file_infos.size(); i++) {
+        FILE_INFO* fip = ss.file_infos[i];
+        PROJECT* project = lookup_project(ss.project_urls[ss.file_project[i]].c_str());
+        if (!project) {
+            delete fip;
+            continue;
+        }
+        retval = link_file_info(project, fip);
+        if (project->anonymous_platform && retval == ERR_NOT_UNIQUE) {
+            delete fip;
+            continue;
+        }
+        if (retval) {
+            msg_printf(project, MSG_INTERNAL_ERROR,
+                "Can't handle file info %s in state file",
+                fip->name
+            );
+            delete fip;
+            continue;
+        }
+        file_infos.push_back(fip);
+        index_file_info(fip);
+        restore_pers_file_xfer(fip);
+    }
+    ss.file_infos.clear();
+    ss.file_project.clear();
+}
+
+// Link and add the snapshot's workunits and results.
+// Called once the state file's apps and app versions have been parsed.
+//
+void CLIENT_STATE::add_snapshot_jobs() {
+    STATE_SNAPSHOT& ss = state_snapshot;
+    unsigned int i;
+    int retval;
+
+    for (i=0; i<ss.workunits.size(); i++) {
+        WORKUNIT* wup = ss.workunits[i];
+        PROJECT* project = lookup_project(ss.project_urls[ss.wu_project[i]].c_str());
+        if (!project) {
+            delete wup;
+            continue;
+        }
+        retval = link_workunit(project, wup);
+        if (retval) {
+            msg_printf(project, MSG_INTERNAL_ERROR,
+                "Can't handle workunit in state file"
+            );
+            delete wup;
+            continue;
+        }
+        workunits.push_back(wup);
+        index_workunit(wup);
+    }
+    ss.workunits.clear();
+    ss.wu_project.clear();
+
+    for (i=0; i<ss.results.size(); i++) {
+        RESULT* rp = ss.results[i];
+        PROJECT* project = lookup_project(ss.project_urls[ss.result_project[i]].c_str());
+        if (!project) {
+            delete rp;
+            continue;
+        }
+        retval = link_result(project, rp);
+        if (retval) {
+            msg_printf(project, MSG_INTERNAL_ERROR,
+                "Can't link task %s in state file",
+                rp->name
+            );
+            delete rp;
+            continue;
+        }
+        retval = link_result_app_version(project, rp);
+        if (retval) {
+            delete rp;
+            continue;
+        }
+        results.push_back(rp);
+        index_result(rp);
+    }
+    ss.results.clear();
+    ss.result_project.clear();
+}
+
+// elements whose contents are copied verbatim to the state file,
+// and so may contain anything
+//
+static const char* verbatim_tags[] = {
+    "stderr_out", "error_msg", "command_line",
+    "xml_signature", "file_signature", NULL
+};
+
+// Skip the rest of a state file element whose start tag was just read,
+// without parsing it.
+// Relies on the state file layout: the end tag is on a line by itself.
+//
+int skip_state_file_element(FILE* f, const char* tag) {
+    char buf[4096], end_tag[256], verbatim_end[256];
+    bool line_start = true, in_verbatim = false;
+
+    snprintf(end_tag, sizeof(end_tag), "</%s>", tag);
+    while (fgets(buf, sizeof(buf), f)) {
+        bool whole_line = line_start;
+        size_t n = strlen(buf);
+        line_start = (n && buf[n-1] == '\n');
+        if (!whole_line || !line_start) continue;
+        strip_whitespace(buf);
+        if (in_verbatim) {
+            if (!strcmp(buf, verbatim_end)) in_verbatim = false;
+            continue;
+        }
+        if (!strcmp(buf, end_tag)) return 0;
+        if (buf[0] != '<') continue;
+        for (int i=0; verbatim_tags[i]; i++) {
+            if (strlen(buf) == strlen(verbatim_tags[i])+2
+                && !strncmp(buf+1, verbatim_tags[i], strlen(verbatim_tags[i]))
+                && buf[strlen(buf)-1] == '>'
+            ) {
+                snprintf(verbatim_end, sizeof(verbatim_end), "</%s>", verbatim_tags[i]);
+                in_verbatim = true;
+                break;
+            }
+        }
+    }
+    return ERR_XML_PARSE;
+}
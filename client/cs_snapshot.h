@@ -0,0 +1,70 @@
+// This file is part of BOINC.
+// http://boinc.berkeley.edu
+// Copyright (C) 2026 University of California
+//
+// BOINC is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation,
+// either version 3 of the License, or (at your option) any later version.
+//
+// BOINC is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with BOINC.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BOINC_CS_SNAPSHOT_H
+#define BOINC_CS_SNAPSHOT_H
+
+// Binary snapshot of the bulk of the client state.
+//
+// On hosts with many tasks, most of the startup time goes into
+// parsing <file>, <workunit> and <result> elements of client_state.xml.
+// If cc_config.state_snapshot is set, the client writes these objects
+// in a binary form (client_state_snapshot.bin) on exit,
+// right after the final write of the state file.
+//
+// On startup, the snapshot is used only if it's intact
+// (checksum matches) and was written together with the state file
+// we're reading (same seqno and size).
+// In that case the objects are created from the snapshot,
+// and the corresponding elements of the state file are skipped
+// without being parsed.
+// Everything else (projects, apps, app versions, active tasks etc.)
+// still comes from the state file, which remains authoritative;
+// any problem with the snapshot means we parse the state file as usual.
+
+#include <string>
+#include <vector>
+
+#include "client_types.h"
+#include "result.h"
+
+#define STATE_SNAPSHOT_VERSION  2
+
+struct STATE_SNAPSHOT {
+    bool active;
+        // a valid snapshot was read; skip its objects in the state file
+    std::vector<std::string> project_urls;
+    std::vector<int> file_project;
+    std::vector<FILE_INFO*> file_infos;
+    std::vector<int> wu_project;
+    std::vector<WORKUNIT*> workunits;
+    std::vector<int> result_project;
+    std::vector<RESULT*> results;
+        // objects decoded from the snapshot, not yet linked.
+        // The *_project vectors are indices into project_urls
+
+    STATE_SNAPSHOT() {
+        active = false;
+    }
+    void clear();
+};
+
+extern STATE_SNAPSHOT state_snapshot;
+
+extern int skip_state_file_element(FILE*, const char* tag);
+
+#endif
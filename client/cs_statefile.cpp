@@ -43,12 +43,18 @@
 #include "client_msgs.h"
 #include "client_state.h"
 #include "cs_proxy.h"
+#include "cs_snapshot.h"
 #include "file_names.h"
 #include "project.h"
 #include "result.h"
 
 #define MAX_STATE_FILE_WRITE_ATTEMPTS 2
 
+#define STATE_JOURNAL_MIN_COMPACT_SIZE  (1024.*1024.)
+    // don't compact the journal until it's at least this big
+#define STATE_JOURNAL_MAX_AGE           3600
+    // rewrite the state file at least this often if journaling
+
 void CLIENT_STATE::set_client_state_dirty(const char* source) {
     if (log_flags.statefile_debug) {
         msg_printf(0, MSG_INFO, "[statefile] set dirty: %s\n", source);
@@ -56,6 +62,47 @@ void CLIENT_STATE::set_client_state_dirty(const char* source) {
     client_state_dirty = true;
 }
 
+// The following are used when a change affects only a single object.
+// If the state journal is enabled, the object is appended to the journal
+// on the next write, rather than rewriting the entire state file.
+//
+void CLIENT_STATE::set_project_dirty(PROJECT* p, const char* source) {
+    if (!cc_config.state_journal) {
+        set_client_state_dirty(source);
+        return;
+    }
+    if (log_flags.statefile_debug) {
+        msg_printf(p, MSG_INFO, "[statefile] set project dirty: %s\n", source);
+    }
+    journal_projects.insert(p);
+}
+
+void CLIENT_STATE::set_file_info_dirty(FILE_INFO* fip, const char* source) {
+    if (!cc_config.state_journal) {
+        set_client_state_dirty(source);
+        return;
+    }
+    if (log_flags.statefile_debug) {
+        msg_printf(fip->project, MSG_INFO,
+            "[statefile] set file %s dirty: %s\n", fip->name, source
+        );
+    }
+    journal_file_infos.insert(fip);
+}
+
+void CLIENT_STATE::set_result_dirty(RESULT* rp, const char* source) {
+    if (!cc_config.state_journal) {
+        set_client_state_dirty(source);
+        return;
+    }
+    if (log_flags.statefile_debug) {
+        msg_printf(rp->project, MSG_INFO,
+            "[statefile] set task %s dirty: %s\n", rp->name, source
+        );
+    }
+    journal_results.insert(rp);
+}
+
 static bool valid_state_file(const char* fname) {
     char buf[256];
     FILE* f = boinc_fopen(fname, "r");
@@ -118,7 +165,85 @@ int CLIENT_STATE::parse_state_file() {
         old_release = BOINC_RELEASE;
         return ERR_FOPEN;
     }
-    return parse_state_file_aux(fname);
+#ifndef SIM
+    if (cc_config.state_snapshot) {
+        read_state_snapshot(fname);
+    }
+#endif
+    int retval = parse_state_file_aux(fname);
+#ifndef SIM
+    if (!retval) {
+        replay_state_journal();
+    }
+#endif
+    return retval;
+}
+
+// If a file from the state file was being transferred,
+// set up its PERS_FILE_XFER
+//
+void CLIENT_STATE::restore_pers_file_xfer(FILE_INFO* fip) {
+#ifndef SIM
+    int retval;
+
+    // If the file had a failure before,
+    // don't start another file transfer
+    //
+    int failnum;
+    if (fip->had_failure(failnum)) {
+        if (fip->pers_file_xfer) {
+            delete fip->pers_file_xfer;
+            fip->pers_file_xfer = NULL;
+        }
+    }
+    if (fip->pers_file_xfer) {
+        retval = fip->pers_file_xfer->init(fip, fip->pers_file_xfer->is_upload);
+        if (retval) {
+            msg_printf(fip->project, MSG_INTERNAL_ERROR,
+                "Can't initialize file transfer for %s",
+                fip->name
+            );
+        }
+        retval = pers_file_xfers->insert(fip->pers_file_xfer);
+        if (retval) {
+            msg_printf(fip->project, MSG_INTERNAL_ERROR,
+                "Can't start persistent file transfer for %s",
+                fip->name
+            );
+        }
+    }
+#endif
+}
+
+// find the app version of a result from the state file
+//
+int CLIENT_STATE::link_result_app_version(PROJECT* project, RESULT* rp) {
+    // handle transition from old clients which didn't store result.platform;
+    // skip for anon platform
+    if (!project->anonymous_platform) {
+        if (!strlen(rp->platform) || !is_supported_platform(rp->platform)) {
+            safe_strcpy(rp->platform, get_primary_platform());
+            rp->version_num = latest_version(rp->wup->app, rp->platform);
+        }
+    }
+    rp->avp = lookup_app_version(
+        rp->wup->app, rp->platform, rp->version_num, rp->plan_class
+    );
+    if (!rp->avp) {
+        msg_printf(project, MSG_INTERNAL_ERROR,
+            "No application found for task: %s %d %s; discarding",
+            rp->platform, rp->version_num, rp->plan_class
+        );
+        return ERR_NOT_FOUND;
+    }
+    if (rp->avp->missing_coproc) {
+        msg_printf(project, MSG_INFO,
+            "Missing coprocessor for task %s", rp->name
+        );
+        rp->coproc_missing = true;
+    }
+    rp->wup->version_num = rp->version_num;
+    return 0;
 }
 
 int CLIENT_STATE::parse_state_file_aux(const char* fname) {
@@ -131,6 +256,13 @@ int CLIENT_STATE::parse_state_file_aux(const char* fname) {
     MIOFILE mf;
     XML_PARSER xp(&mf);
     mf.init_file(f);
+
+    // if we have a valid snapshot, its file infos, workunits and results
+    // replace those in the state file
+    //
+    if (state_snapshot.active) {
+        add_snapshot_file_infos();
+    }
     while (!xp.get_tag()) {
         if (xp.match_tag("/client_state")) {
             break;
@@ -194,9 +326,14 @@ int CLIENT_STATE::parse_state_file_aux(const char* fname) {
                 continue;
             }
             apps.push_back(app);
+            index_app(app);
             continue;
         }
         if (xp.match_tag("file_info") || xp.match_tag("file")) {
+            if (state_snapshot.active) {
+                skip_state_file_element(f, xp.parsed_tag);
+                continue;
+            }
             FILE_INFO* fip = new FILE_INFO;
             retval = fip->parse(xp);
             if (!project) {
@@ -227,34 +364,8 @@ int CLIENT_STATE::parse_state_file_aux(const char* fname) {
                 continue;
             }
             file_infos.push_back(fip);
-#ifndef SIM
-            // If the file had a failure before,
-            // don't start another file transfer
-            //
-            int failnum;
-            if (fip->had_failure(failnum)) {
-                if (fip->pers_file_xfer) {
-                    delete fip->pers_file_xfer;
-                    fip->pers_file_xfer = NULL;
-                }
-            }
-            if (fip->pers_file_xfer) {
-                retval = fip->pers_file_xfer->init(fip, fip->pers_file_xfer->is_upload);
-                if (retval) {
-                    msg_printf(project, MSG_INTERNAL_ERROR,
-                        "Can't initialize file transfer for %s",
-                        fip->name
-                    );
-                }
-                retval = pers_file_xfers->insert(fip->pers_file_xfer);
-                if (retval) {
-                    msg_printf(project, MSG_INTERNAL_ERROR,
-                        "Can't start persistent file transfer for %s",
-                        fip->name
-                    );
-                }
-            }
-#endif
+            index_file_info(fip);
+            restore_pers_file_xfer(fip);
             continue;
         }
         if (xp.match_tag("app_version")) {
@@ -308,9 +419,14 @@ int CLIENT_STATE::parse_state_file_aux(const char* fname) {
                 continue;
             }
             app_versions.push_back(avp);
+            index_app_version(avp);
             continue;
         }
         if (xp.match_tag("workunit")) {
+            if (state_snapshot.active) {
+                skip_state_file_element(f, "workunit");
+                continue;
+            }
             WORKUNIT* wup = new WORKUNIT;
             retval = wup->parse(xp);
             if (!project) {
@@ -336,9 +452,14 @@ int CLIENT_STATE::parse_state_file_aux(const char* fname) {
                 continue;
             }
             workunits.push_back(wup);
+            index_workunit(wup);
             continue;
         }
         if (xp.match_tag("result")) {
+            if (state_snapshot.active) {
+                skip_state_file_element(f, "result");
+                continue;
+            }
             RESULT* rp = new RESULT;
             retval = rp->parse_state(xp);
             if (!project) {
@@ -365,33 +486,13 @@ int CLIENT_STATE::parse_state_file_aux(const char* fname) {
                 delete rp;
                 continue;
             }
-            // handle transition from old clients which didn't store result.platform;
-            // skip for anon platform
-            if (!project->anonymous_platform) {
-                if (!strlen(rp->platform) || !is_supported_platform(rp->platform)) {
-                    safe_strcpy(rp->platform, get_primary_platform());
-                    rp->version_num = latest_version(rp->wup->app, rp->platform);
-                }
-            }
-            rp->avp = lookup_app_version(
-                rp->wup->app, rp->platform, rp->version_num, rp->plan_class
-            );
-            if (!rp->avp) {
-                msg_printf(project, MSG_INTERNAL_ERROR,
-                    "No application found for task: %s %d %s; discarding",
-                    rp->platform, rp->version_num, rp->plan_class
-                );
+            retval = link_result_app_version(project, rp);
+            if (retval) {
                 delete rp;
                 continue;
             }
-            if (rp->avp->missing_coproc) {
-                msg_printf(project, MSG_INFO,
-                    "Missing coprocessor for task %s", rp->name
-                );
-                rp->coproc_missing = true;
-            }
-            rp->wup->version_num = rp->version_num;
             results.push_back(rp);
+            index_result(rp);
             continue;
         }
         if (xp.match_tag("project_files")) {
@@ -440,6 +541,9 @@ int CLIENT_STATE::parse_state_file_aux(const char* fname) {
             continue;
         }
         if (xp.match_tag("active_task_set")) {
+            if (state_snapshot.active) {
+                add_snapshot_jobs();
+            }
             retval = active_tasks.parse(xp);
             if (retval) {
                 msg_printf(NULL, MSG_INTERNAL_ERROR,
@@ -477,6 +581,9 @@ int CLIENT_STATE::parse_state_file_aux(const char* fname) {
         if (xp.parse_int("core_client_major_version", old_major_version)) {
             continue;
         }
+        if (xp.parse_int("state_file_seqno", state_file_seqno)) {
+            continue;
+        }
         if (xp.parse_int("core_client_minor_version", old_minor_version)) {
             continue;
         }
@@ -533,6 +640,11 @@ int CLIENT_STATE::parse_state_file_aux(const char* fname) {
         }
         xp.skip_unexpected();
     }
+    if (state_snapshot.active) {
+        add_snapshot_jobs();
+        state_snapshot.clear();
+        state_snapshot.active = false;
+    }
     sort_results();
     fclose(f);
     
@@ -602,6 +714,7 @@ int CLIENT_STATE::write_state_file() {
     char win_error_msg[4096];
 #endif
 
+    state_file_seqno++;
     for (attempt=1; attempt<=MAX_STATE_FILE_WRITE_ATTEMPTS; attempt++) {
         if (attempt > 1) boinc_sleep(1.0);
             
@@ -710,6 +823,20 @@ int CLIENT_STATE::write_state_file() {
         if (attempt < MAX_STATE_FILE_WRITE_ATTEMPTS) continue;
         return ERR_RENAME;
     }
+
+    // the state file now includes everything in the journal;
+    // start a new journal
+    //
+    state_journal_seqno = state_file_seqno;
+    state_journal_size = 0;
+    journal_projects.clear();
+    journal_file_infos.clear();
+    journal_results.clear();
+    state_file_write_time = now;
+    file_size(STATE_FILE_NAME, state_file_size);
+    if (boinc_file_exists(STATE_JOURNAL_FILE_NAME)) {
+        boinc_delete_file(STATE_JOURNAL_FILE_NAME);
+    }
     return 0;
 }
 
@@ -777,7 +904,8 @@ int CLIENT_STATE::write_state(MIOFILE& f) {
         "<user_gpu_prev_request>%d</user_gpu_prev_request>\n"
         "<user_network_request>%d</user_network_request>\n"
         "<new_version_check_time>%f</new_version_check_time>\n"
-        "<all_projects_list_check_time>%f</all_projects_list_check_time>\n",
+        "<all_projects_list_check_time>%f</all_projects_list_check_time>\n"
+        "<state_file_seqno>%d</state_file_seqno>\n",
         get_primary_platform(),
         core_client_version.major,
         core_client_version.minor,
@@ -788,7 +916,8 @@ int CLIENT_STATE::write_state(MIOFILE& f) {
         gpu_run_mode.get_prev(),
         network_run_mode.get_perm(),
         new_version_check_time,
-        all_projects_list_check_time
+        all_projects_list_check_time,
+        state_file_seqno
     );
     if (strlen(language)) {
         f.printf("<language>%s</language>\n", language);
@@ -812,7 +941,8 @@ int CLIENT_STATE::write_state(MIOFILE& f) {
     return 0;
 }
 
-// Write the client_state.xml file if necessary
+// Write the client_state.xml file if necessary,
+// or append changed objects to the journal
 // TODO: write no more often than X seconds
 //
 int CLIENT_STATE::write_state_file_if_needed() {
@@ -821,10 +951,242 @@ int CLIENT_STATE::write_state_file_if_needed() {
         client_state_dirty = false;
         retval = write_state_file();
         if (retval) return retval;
+    } else if (journal_projects.size() || journal_file_infos.size() || journal_results.size()) {
+        retval = write_state_journal();
+        if (retval) return retval;
+    }
+    return 0;
+}
+
+// The state journal (client_state_journal.xml) is a sequence of
+//
+// <journal_record>
+//    <project_master_url>...</project_master_url>
+//    <project>...</project>, <file>...</file>, or <result>...</result>
+// </journal_record>
+//
+// each giving the current state of an object
+// that changed since the state file was written.
+// It starts with the seqno of the state file it applies to,
+// and is deleted when the state file is rewritten.
+// The file is synced after each append,
+// so a crash loses at most a partial last record, which is ignored.
+
+static void start_journal_record(MIOFILE& f, PROJECT* p) {
+    f.printf(
+        "<journal_record>\n"
+        "<project_master_url>%s</project_master_url>\n",
+        p->master_url
+    );
+}
+
+// Append changed objects to the journal.
+// Compact (i.e. rewrite the state file) if the journal is big or old,
+// or if it doesn't correspond to the current state file.
+//
+int CLIENT_STATE::write_state_journal() {
+    MFILE mf;
+    MIOFILE f;
+    int retval;
+    std::set<PROJECT*>::iterator pi;
+    std::set<FILE_INFO*>::iterator fi;
+    std::set<RESULT*>::iterator ri;
+
+    if (state_journal_seqno != state_file_seqno
+        || state_journal_size > std::max(STATE_JOURNAL_MIN_COMPACT_SIZE, state_file_size/2)
+        || now > state_file_write_time + STATE_JOURNAL_MAX_AGE
+    ) {
+        if (log_flags.statefile_debug) {
+            msg_printf(0, MSG_INFO,
+                "[statefile] compacting state journal (%.0f bytes)",
+                state_journal_size
+            );
+        }
+        return write_state_file();
+    }
+
+    if (log_flags.statefile_debug) {
+        msg_printf(0, MSG_INFO,
+            "[statefile] Appending %d projects, %d files, %d tasks to state journal",
+            (int)journal_projects.size(), (int)journal_file_infos.size(),
+            (int)journal_results.size()
+        );
+    }
+    retval = mf.open(STATE_JOURNAL_FILE_NAME, state_journal_size?"a":"w");
+    if (retval) {
+        msg_printf(0, MSG_INTERNAL_ERROR,
+            "Can't open %s: %s", STATE_JOURNAL_FILE_NAME, boincerror(retval)
+        );
+        return write_state_file();
+    }
+    f.init_mfile(&mf);
+    if (state_journal_size == 0) {
+        f.printf(
+            "<state_journal>\n"
+            "<state_file_seqno>%d</state_file_seqno>\n",
+            state_file_seqno
+        );
+    }
+    for (pi = journal_projects.begin(); pi != journal_projects.end(); ++pi) {
+        PROJECT* p = *pi;
+        start_journal_record(f, p);
+        p->write_state(f);
+        f.printf("</journal_record>\n");
     }
+    for (fi = journal_file_infos.begin(); fi != journal_file_infos.end(); ++fi) {
+        FILE_INFO* fip = *fi;
+        if (fip->anonymous_platform_file) continue;
+        start_journal_record(f, fip->project);
+        fip->write(f, false);
+        f.printf("</journal_record>\n");
+    }
+    for (ri = journal_results.begin(); ri != journal_results.end(); ++ri) {
+        RESULT* rp = *ri;
+        start_journal_record(f, rp->project);
+        rp->write(f, false);
+        f.printf("</journal_record>\n");
+    }
+    retval = mf.close();
+    if (retval) {
+        msg_printf(0, MSG_INTERNAL_ERROR,
+            "Couldn't write state journal: %s", boincerror(retval)
+        );
+        return write_state_file();
+    }
+    journal_projects.clear();
+    journal_file_infos.clear();
+    journal_results.clear();
+    file_size(STATE_JOURNAL_FILE_NAME, state_journal_size);
     return 0;
 }
 
+// parse a journal record and apply it to the corresponding object.
+// Objects are applied only when the record is complete.
+//
+int CLIENT_STATE::parse_journal_record(XML_PARSER& xp) {
+    char master_url[256];
+    PROJECT temp_project;
+    FILE_INFO temp_fi;
+    RESULT temp_result;
+    bool have_project=false, have_fi=false, have_result=false;
+    int retval = ERR_XML_PARSE;
+
+    safe_strcpy(master_url, "");
+    while (!xp.get_tag()) {
+        if (xp.match_tag("/journal_record")) {
+            retval = 0;
+            break;
+        }
+        if (xp.parse_str("project_master_url", master_url, sizeof(master_url))) {
+            continue;
+        }
+        if (xp.match_tag("project")) {
+            if (temp_project.parse_state(xp)) break;
+            have_project = true;
+            continue;
+        }
+        if (xp.match_tag("file")) {
+            if (temp_fi.parse(xp)) break;
+            have_fi = true;
+            continue;
+        }
+        if (xp.match_tag("result")) {
+            if (temp_result.parse_state(xp)) break;
+            have_result = true;
+            continue;
+        }
+        xp.skip_unexpected();
+    }
+
+    PROJECT* p = retval?NULL:lookup_project(master_url);
+    if (p && have_project) {
+        p->copy_state_fields(temp_project);
+    }
+    FILE_INFO* fip = (p && have_fi)?lookup_file_info(p, temp_fi.name):NULL;
+    if (fip) {
+        fip->copy_state_fields(temp_fi);
+        PERS_FILE_XFER* pfx = fip->pers_file_xfer;
+        PERS_FILE_XFER* temp_pfx = temp_fi.pers_file_xfer;
+        int failnum;
+        if (pfx && (!temp_pfx || fip->had_failure(failnum))) {
+            // the transfer finished or failed
+            //
+            pers_file_xfers->remove(pfx);
+            delete pfx;
+            fip->pers_file_xfer = NULL;
+        } else if (pfx) {
+            pfx->copy_state_fields(*temp_pfx);
+        }
+        queue_file_xfer_check(fip);
+    }
+    if (temp_fi.pers_file_xfer) {
+        delete temp_fi.pers_file_xfer;
+        temp_fi.pers_file_xfer = NULL;
+    }
+    RESULT* rp = (p && have_result)?lookup_result(p, temp_result.name):NULL;
+    if (rp) {
+        rp->copy_state_fields(temp_result);
+        queue_result_update(rp);
+    }
+    return retval;
+}
+
+// apply the state journal, if any, to the state file we just parsed
+//
+void CLIENT_STATE::replay_state_journal() {
+    int retval, seqno = -1, nrecords = 0;
+
+    FILE* f = boinc_fopen(STATE_JOURNAL_FILE_NAME, "r");
+    if (!f) return;
+    MIOFILE mf;
+    XML_PARSER xp(&mf);
+    mf.init_file(f);
+    while (!xp.get_tag()) {
+        if (xp.match_tag("state_journal")) continue;
+        if (xp.parse_int("state_file_seqno", seqno)) {
+            if (seqno != state_file_seqno) {
+                if (log_flags.statefile_debug) {
+                    msg_printf(0, MSG_INFO,
+                        "[statefile] state journal is for seqno %d, not %d; ignoring",
+                        seqno, state_file_seqno
+                    );
+                }
+                break;
+            }
+            continue;
+        }
+        if (xp.match_tag("journal_record")) {
+            if (seqno != state_file_seqno) break;
+            retval = parse_journal_record(xp);
+            if (retval) break;      // partial record at end
+            nrecords++;
+            continue;
+        }
+        break;
+    }
+    fclose(f);
+    if (!nrecords) return;
+    msg_printf(0, MSG_INFO, "Applied %d records from state journal", nrecords);
+
+    // Discard active tasks whose jobs finished according to the journal
+    // (ACTIVE_TASK::parse() does the same check on the state file)
+    //
+    vector<ACTIVE_TASK*>::iterator iter = active_tasks.active_tasks.begin();
+    while (iter != active_tasks.active_tasks.end()) {
+        ACTIVE_TASK* atp = *iter;
+        RESULT* rp = atp->result;
+        if (rp->got_server_ack
+            || rp->ready_to_report
+            || rp->state() != RESULT_FILES_DOWNLOADED
+        ) {
+            iter = active_tasks.active_tasks.erase(iter);
+            delete atp;
+        } else {
+            ++iter;
+        }
+    }
+}
+
 #endif // ifndef SIM
 
 // look for app_versions.xml file in project dir.
@@ -908,6 +1270,7 @@ int CLIENT_STATE::parse_app_info(PROJECT* p, FILE* in) {
             fip->status = FILE_PRESENT;
             fip->anonymous_platform_file = true;
             file_infos.push_back(fip);
+            index_file_info(fip);
             continue;
         }
         if (xp.match_tag("app")) {
@@ -922,6 +1285,7 @@ int CLIENT_STATE::parse_app_info(PROJECT* p, FILE* in) {
             }
             link_app(p, app);
             apps.push_back(app);
+            index_app(app);
             continue;
         }
         if (xp.match_tag("app_version")) {
@@ -952,6 +1316,7 @@ int CLIENT_STATE::parse_app_info(PROJECT* p, FILE* in) {
                 continue;
             }
             app_versions.push_back(avp);
+            index_app_version(avp);
             continue;
         }
         if (log_flags.unparsed_xml) {
@@ -966,11 +1331,17 @@ int CLIENT_STATE::parse_app_info(PROJECT* p, FILE* in) {
 
 #ifndef SIM
 
-int CLIENT_STATE::write_state_gui(MIOFILE& f) {
+// if delta is given, write only the workunits and results it includes
+// (see gui_rpc_server.h)
+//
+int CLIENT_STATE::write_state_gui(MIOFILE& f, GUI_DELTA* delta) {
     unsigned int i, j;
     int retval;
 
     f.printf("<client_state>\n");
+    if (delta) {
+        delta->write_header(f);
+    }
 
     retval = host_info.write(f, true, true);
     if (retval) return retval;
@@ -1010,12 +1381,19 @@ int CLIENT_STATE::write_state_gui(MIOFILE& f) {
             if (app_versions[i]->project == p) app_versions[i]->write(f);
         }
         for (i=0; i<workunits.size(); i++) {
-            if (workunits[i]->project == p) workunits[i]->write(f, true);
+            if (workunits[i]->project != p) continue;
+            if (delta && !delta->includes(workunits[i])) continue;
+            workunits[i]->write(f, true);
         }
         for (i=0; i<results.size(); i++) {
-            if (results[i]->project == p) results[i]->write_gui(f);
+            if (results[i]->project != p) continue;
+            if (delta && !delta->includes(results[i])) continue;
+            results[i]->write_gui(f);
         }
     }
+    if (delta) {
+        delta->write_deleted(f);
+    }
     f.printf(
         "<platform_name>%s</platform_name>\n"
         "<core_client_major_version>%d</core_client_major_version>\n"
@@ -1063,15 +1441,21 @@ int CLIENT_STATE::write_tasks_gui(MIOFILE& f, bool active_only) {
     return 0;
 }
 
-int CLIENT_STATE::write_file_transfers_gui(MIOFILE& f) {
+int CLIENT_STATE::write_file_transfers_gui(MIOFILE& f, GUI_DELTA* delta) {
     unsigned int i;
 
     f.printf("<file_transfers>\n");
+    if (delta) {
+        delta->write_header(f);
+    }
     for (i=0; i<file_infos.size(); i++) {
         FILE_INFO* fip = file_infos[i];
-        if (fip->pers_file_xfer) {
-            fip->write_gui(f);
-        }
+        if (!fip->pers_file_xfer) continue;
+        if (delta && !delta->includes(fip)) continue;
+        fip->write_gui(f);
+    }
+    if (delta) {
+        delta->write_deleted(f);
     }
     f.printf("</file_transfers>\n");
 
@@ -0,0 +1,314 @@
+// This file is part of BOINC.
+// http://boinc.berkeley.edu
+// Copyright (C) 2026 University of California
+//
+// BOINC is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation,
+// either version 3 of the License, or (at your option) any later version.
+//
+// BOINC is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with BOINC.  If not, see <http://www.gnu.org/licenses/>.
+
+// content-addressed store of downloaded files; see file_store.h
+
+#include "cpp.h"
+
+#ifdef _WIN32
+#include "boinc_win.h"
+#else
+#include "config.h"
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#include "error_numbers.h"
+#include "filesys.h"
+#include "str_replace.h"
+#include "str_util.h"
+
+#include "async_file.h"
+#include "cc_config.h"
+#include "client_msgs.h"
+#include "client_state.h"
+#include "file_names.h"
+#include "log_flags.h"
+#include "project.h"
+#include "sandbox.h"
+
+#include "file_store.h"
+
+// identity and link count of a file
+//
+struct FILE_LINKS {
+    unsigned long long dev;
+    unsigned long long ino;
+    int nlinks;
+};
+
+static int get_file_links(const char* path, FILE_LINKS& fl) {
+#ifdef _WIN32
+    BY_HANDLE_FILE_INFORMATION info;
+    HANDLE h = CreateFileA(path, 0,
+        FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+        NULL, OPEN_EXISTING, 0, NULL
+    );
+    if (h == INVALID_HANDLE_VALUE) return ERR_NOT_FOUND;
+    BOOL ok = GetFileInformationByHandle(h, &info);
+    CloseHandle(h);
+    if (!ok) return ERR_STAT;
+    fl.dev = info.dwVolumeSerialNumber;
+    fl.ino = ((unsigned long long)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    fl.nlinks = info.nNumberOfLinks;
+#else
+    struct stat sbuf;
+    if (stat(path, &sbuf)) return ERR_NOT_FOUND;
+    fl.dev = sbuf.st_dev;
+    fl.ino = sbuf.st_ino;
+    fl.nlinks = sbuf.st_nlink;
+#endif
+    return 0;
+}
+
+static int make_hard_link(const char* existing, const char* path) {
+#ifdef _WIN32
+    if (!CreateHardLinkA(path, existing, NULL)) return ERR_SYMLINK;
+#else
+    if (link(existing, path)) return ERR_SYMLINK;
+#endif
+    return 0;
+}
+
+static void make_file_store_dir() {
+    if (is_dir(FILE_STORE_DIR)) return;
+    boinc_mkdir(FILE_STORE_DIR);
+#ifndef _WIN32
+    if (g_use_sandbox) {
+        mode_t old_mask = umask(2);
+        chmod(FILE_STORE_DIR,
+            S_IRUSR|S_IWUSR|S_IXUSR
+            |S_IRGRP|S_IWGRP|S_IXGRP
+        );
+        umask(old_mask);
+        set_to_project_group(FILE_STORE_DIR);
+    }
+#endif
+}
+
+// The MD5 comes from the server and is part of a path name;
+// accept only a well-formed one
+//
+static bool valid_md5(const char* p) {
+    if (strlen(p) != 32) return false;
+    for (int i=0; i<32; i++) {
+        if (!isxdigit(p[i])) return false;
+    }
+    return true;
+}
+
+static void get_file_store_path(FILE_INFO* fip, char* path, int len) {
+    snprintf(path, len, "%s/%s_%.0f",
+        FILE_STORE_DIR, fip->md5_cksum, fip->nbytes
+    );
+}
+
+static bool has_store_path(FILE_INFO* fip) {
+    return fip->nbytes > 0 && valid_md5(fip->md5_cksum);
+}
+
+bool file_store_eligible(FILE_INFO* fip) {
+    if (cc_config.dont_dedup_files) return false;
+    if (!fip->project) return false;
+    if (!fip->downloadable()) return false;
+#ifdef ENABLE_AUTO_UPDATE
+    if (fip->is_auto_update_file) return false;
+#endif
+    return has_store_path(fip);
+}
+
+static bool same_content(FILE_INFO* fip, FILE_INFO* fip2) {
+    if (fip2 == fip) return false;
+    if (fip2->nbytes != fip->nbytes) return false;
+    if (strcmp(fip2->md5_cksum, fip->md5_cksum)) return false;
+    return file_store_eligible(fip2);
+}
+
+static void queue_same_content(FILE_INFO* fip) {
+    for (unsigned int i=0; i<gstate.file_infos.size(); i++) {
+        FILE_INFO* fip2 = gstate.file_infos[i];
+        if (fip2->status != FILE_NOT_PRESENT) continue;
+        if (same_content(fip, fip2)) {
+            gstate.queue_file_xfer_check(fip2);
+        }
+    }
+}
+
+void file_store_add(FILE_INFO* fip) {
+    char path[MAXPATHLEN], store_path[MAXPATHLEN], tmp_path[MAXPATHLEN];
+    FILE_LINKS fl, store_fl;
+    int retval;
+
+    if (!file_store_eligible(fip)) return;
+    get_pathname(fip, path, sizeof(path));
+    get_file_store_path(fip, store_path, sizeof(store_path));
+    if (get_file_links(path, fl)) return;
+
+    if (get_file_links(store_path, store_fl)) {
+        make_file_store_dir();
+        retval = make_hard_link(path, store_path);
+        if (log_flags.file_xfer_debug) {
+            if (retval) {
+                msg_printf(fip->project, MSG_INFO,
+                    "[file_xfer] can't add %s to file store: %s",
+                    fip->name, boincerror(retval)
+                );
+            } else {
+                msg_printf(fip->project, MSG_INFO,
+                    "[file_xfer] added %s to file store", fip->name
+                );
+            }
+        }
+        if (!retval) queue_same_content(fip);
+        return;
+    }
+    if (fl.dev == store_fl.dev && fl.ino == store_fl.ino) {
+        queue_same_content(fip);
+        return;
+    }
+
+    // The store already has this content
+    // (e.g. another job downloaded it at the same time).
+    // Replace our copy with a link to it.
+    //
+    int n = snprintf(tmp_path, sizeof(tmp_path), "%s.link", path);
+    if (n < 0 || n >= (int)sizeof(tmp_path)) return;
+    retval = make_hard_link(store_path, tmp_path);
+    if (!retval) {
+        retval = boinc_rename(tmp_path, path);
+        if (retval) {
+            boinc_delete_file(tmp_path);
+        } else {
+            fip->set_permissions();
+        }
+    }
+    if (retval) return;
+    if (log_flags.file_xfer_debug) {
+        msg_printf(fip->project, MSG_INFO,
+            "[file_xfer] replaced %s with link to file store", fip->name
+        );
+    }
+    queue_same_content(fip);
+}
+
+bool file_store_pending(FILE_INFO* fip) {
+    unsigned int i;
+
+    if (!file_store_eligible(fip)) return false;
+    for (i=0; i<gstate.pers_file_xfers->pers_file_xfers.size(); i++) {
+        PERS_FILE_XFER* pfx = gstate.pers_file_xfers->pers_file_xfers[i];
+        if (pfx->is_upload) continue;
+        if (same_content(fip, pfx->fip)) return true;
+    }
+    for (i=0; i<async_verifies.size(); i++) {
+        if (same_content(fip, async_verifies[i]->fip)) return true;
+    }
+    return false;
+}
+
+int file_store_link(FILE_INFO* fip) {
+    char path[MAXPATHLEN], store_path[MAXPATHLEN];
+    double size;
+    int retval;
+
+    if (!file_store_eligible(fip)) return ERR_NOT_FOUND;
+    get_file_store_path(fip, store_path, sizeof(store_path));
+    if (file_size(store_path, size)) return ERR_NOT_FOUND;
+    if (size != fip->nbytes) return ERR_WRONG_SIZE;
+
+    // remove any partial download
+    //
+    get_pathname(fip, path, sizeof(path));
+    delete_project_owned_file(path, true);
+    safe_strcat(path, ".gz");
+    delete_project_owned_file(path, true);
+    safe_strcat(path, "t");
+    delete_project_owned_file(path, true);
+
+    get_pathname(fip, path, sizeof(path));
+    retval = make_hard_link(store_path, path);
+    if (retval) {
+        if (log_flags.file_xfer_debug) {
+            msg_printf(fip->project, MSG_INFO,
+                "[file_xfer] can't link %s from file store: %s",
+                fip->name, boincerror(retval)
+            );
+        }
+        return retval;
+    }
+    return 0;
+}
+
+void file_store_release(FILE_INFO* fip) {
+    char store_path[MAXPATHLEN];
+    FILE_LINKS fl;
+
+    if (!has_store_path(fip)) return;
+    get_file_store_path(fip, store_path, sizeof(store_path));
+    if (get_file_links(store_path, fl)) return;
+    if (fl.nlinks > 1) return;
+    delete_project_owned_file(store_path, true);
+    if (log_flags.file_xfer_debug) {
+        msg_printf(fip->project, MSG_INFO,
+            "[file_xfer] removed %s from file store", fip->name
+        );
+    }
+}
+
+bool file_store_bad_link(FILE_INFO* fip) {
+    char path[MAXPATHLEN], store_path[MAXPATHLEN];
+    FILE_LINKS fl, store_fl;
+
+    if (!has_store_path(fip)) return false;
+    get_pathname(fip, path, sizeof(path));
+    get_file_store_path(fip, store_path, sizeof(store_path));
+    if (get_file_links(path, fl)) return false;
+    if (get_file_links(store_path, store_fl)) return false;
+    if (fl.dev != store_fl.dev || fl.ino != store_fl.ino) return false;
+
+    msg_printf(fip->project, MSG_INFO,
+        "Local copy of %s is bad; downloading it", fip->name
+    );
+    delete_project_owned_file(store_path, true);
+    fip->delete_file();
+    return true;
+}
+
+void file_store_gc() {
+    char filename[256], path[MAXPATHLEN];
+    FILE_LINKS fl;
+    DIRREF dirp;
+
+    dirp = dir_open(FILE_STORE_DIR);
+    if (!dirp) return;
+    while (!dir_scan(filename, dirp, sizeof(filename))) {
+        snprintf(path, sizeof(path), "%s/%s", FILE_STORE_DIR, filename);
+        if (get_file_links(path, fl)) continue;
+        if (fl.nlinks > 1) continue;
+        delete_project_owned_file(path, true);
+        if (log_flags.file_xfer_debug) {
+            msg_printf(NULL, MSG_INFO,
+                "[file_xfer] removed unused file store entry %s", filename
+            );
+        }
+    }
+    dir_close(dirp);
+}
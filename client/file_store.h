@@ -0,0 +1,71 @@
+// This file is part of BOINC.
+// http://boinc.berkeley.edu
+// Copyright (C) 2026 University of California
+//
+// BOINC is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation,
+// either version 3 of the License, or (at your option) any later version.
+//
+// BOINC is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with BOINC.  If not, see <http://www.gnu.org/licenses/>.
+
+// Content-addressed store of downloaded files.
+//
+// Jobs and projects sometimes use identical files under different names.
+// When a download with an MD5 checksum has been verified,
+// a hard link to it is made in file_store/, named by (MD5, size).
+// Before downloading a file we look there;
+// if the content is present we link it into the project directory
+// and skip the network.
+//
+// The reference count of an entry is its number of hard links:
+// when a FILE_INFO is garbage-collected
+// and the store holds the only remaining link, the entry is deleted.
+// Entries orphaned in other ways (e.g. by removing a project directory)
+// are deleted by file_store_gc().
+
+#ifndef BOINC_FILE_STORE_H
+#define BOINC_FILE_STORE_H
+
+#include "client_types.h"
+
+#define FILE_STORE_DIR "file_store"
+
+extern bool file_store_eligible(FILE_INFO*);
+    // whether the file's content can be shared via the store
+
+extern void file_store_add(FILE_INFO*);
+    // the file has been downloaded and verified; add it to the store.
+    // If the store already has the content,
+    // replace the file with a link to it.
+    // Queue files that are waiting for the content.
+
+extern bool file_store_pending(FILE_INFO*);
+    // whether another file with the same content
+    // is being downloaded or verified.
+    // If so, don't download this one;
+    // file_store_add() will queue it when the content is in the store.
+
+extern int file_store_link(FILE_INFO*);
+    // if the store has the file's content,
+    // link it into the project directory and return 0
+
+extern void file_store_release(FILE_INFO*);
+    // the file has been deleted;
+    // delete its store entry if nothing else links to it
+
+extern bool file_store_bad_link(FILE_INFO*);
+    // verification of the file failed.
+    // If it's linked from the store, the store's copy is bad:
+    // delete both, so the file will be downloaded, and return true
+
+extern void file_store_gc();
+    // delete store entries with no other links
+
+#endif
@@ -50,12 +50,63 @@ FILE_XFER::FILE_XFER() {
     file_size_query = false;
     is_upload = false;
     starting_size = 0.0;
+    batch_leader = NULL;
+    batch_member = false;
+    safe_strcpy(batch_file, "");
+    segmented = false;
+    segment_of = NULL;
+    segment = -1;
 }
 
 FILE_XFER::~FILE_XFER() {
-    if (fip && fip->pers_file_xfer) {
+    unsigned int i;
+
+    if (fip && fip->pers_file_xfer && fip->pers_file_xfer->fxp == this) {
         fip->pers_file_xfer->fxp = NULL;
     }
+
+    // a member that goes away is still sent (it's in the temp file)
+    // but its status is ignored.
+    // If the leader goes away before finishing,
+    // members are retried
+    //
+    if (batch_leader) {
+        vector<FILE_XFER*>& v = batch_leader->batch;
+        for (i=0; i<v.size(); i++) {
+            if (v[i] == this) {
+                v.erase(v.begin()+i);
+                break;
+            }
+        }
+    }
+    for (i=0; i<batch.size(); i++) {
+        FILE_XFER* fxp = batch[i];
+        fxp->batch_leader = NULL;
+        fxp->file_xfer_done = true;
+        fxp->file_xfer_retval = ERR_RETRY;
+    }
+    if (strlen(batch_file)) {
+        close_file();
+        boinc_delete_file(batch_file);
+    }
+
+    // a segmented download owns its segments
+    //
+    if (segment_of) {
+        vector<FILE_XFER*>& v = segment_of->segment_xfers;
+        for (i=0; i<v.size(); i++) {
+            if (v[i] == this) {
+                v.erase(v.begin()+i);
+                break;
+            }
+        }
+    }
+    for (i=0; i<segment_xfers.size(); i++) {
+        FILE_XFER* fxp = segment_xfers[i];
+        fxp->segment_of = NULL;
+        gstate.file_xfers->remove(fxp);
+        delete fxp;
+    }
 }
 
 int FILE_XFER::init_download(FILE_INFO& file_info) {
@@ -81,6 +132,46 @@ int FILE_XFER::init_download(FILE_INFO& file_info) {
     );
 }
 
+// the part of an upload request that describes a file
+//
+static void file_upload_header(FILE_INFO& file_info, char* buf, int len) {
+    snprintf(buf, len,
+        "<file_upload>\n"
+        "<file_info>\n"
+        "<name>%s</name>\n"
+        "<xml_signature>\n"
+        "%s"
+        "</xml_signature>\n"
+        "<max_nbytes>%.0f</max_nbytes>\n"
+        "</file_info>\n"
+        "<nbytes>%.0f</nbytes>\n"
+        "<md5_cksum>%s</md5_cksum>\n"
+        "<offset>%.0f</offset>\n"
+        "<data>\n",
+        file_info.name,
+        file_info.xml_signature,
+        file_info.max_nbytes,
+        file_info.nbytes,
+        file_info.md5_cksum,
+        file_info.upload_offset
+    );
+}
+
+// download part of a file, as a segment of the given download
+//
+int FILE_XFER::init_download_segment(
+    FILE_INFO& file_info, int seg, double start, double end, const char* url
+) {
+    is_upload = false;
+    fip = &file_info;
+    segment = seg;
+    get_pathname(fip, pathname, sizeof(pathname));
+    starting_size = start;
+    return HTTP_OP::init_get_range(
+        file_info.project, url, pathname, start, end
+    );
+}
+
 // for uploads, we need to build a header with xml_signature etc.
 // (see doc/upload.php)
 // Do this in memory.
@@ -127,32 +218,19 @@ int FILE_XFER::init_upload(FILE_INFO& file_info) {
             file_info.project, url, header, sizeof(header), NULL, 0
         );
     } else {
+        if (batch.size()) {
+            return init_upload_batch();
+        }
         bytes_xferred = file_info.upload_offset;
         snprintf(header, sizeof(header), 
             "<data_server_request>\n"
             "    <core_client_major_version>%d</core_client_major_version>\n"
             "    <core_client_minor_version>%d</core_client_minor_version>\n"
-            "    <core_client_release>%d</core_client_release>\n"
-            "<file_upload>\n"
-            "<file_info>\n"
-            "<name>%s</name>\n"
-            "<xml_signature>\n"
-            "%s"
-            "</xml_signature>\n"
-            "<max_nbytes>%.0f</max_nbytes>\n"
-            "</file_info>\n"
-            "<nbytes>%.0f</nbytes>\n"
-            "<md5_cksum>%s</md5_cksum>\n"
-            "<offset>%.0f</offset>\n"
-            "<data>\n",
-            BOINC_MAJOR_VERSION, BOINC_MINOR_VERSION, BOINC_RELEASE,
-            file_info.name,
-            file_info.xml_signature,
-            file_info.max_nbytes,
-            file_info.nbytes,
-            file_info.md5_cksum,
-            file_info.upload_offset
+            "    <core_client_release>%d</core_client_release>\n",
+            BOINC_MAJOR_VERSION, BOINC_MINOR_VERSION, BOINC_RELEASE
         );
+        int n = (int)strlen(header);
+        file_upload_header(file_info, header+n, sizeof(header)-n);
         file_size_query = false;
         const char* url = fip->upload_urls.get_current_url(file_info);
         if (!url) return ERR_INVALID_URL;
@@ -163,12 +241,172 @@ int FILE_XFER::init_upload(FILE_INFO& file_info) {
     }
 }
 
+// Make this a member of a batch upload
+//
+void FILE_XFER::add_to_batch(FILE_XFER* leader, FILE_INFO& file_info) {
+    fip = &file_info;
+    is_upload = true;
+    batch_member = true;
+    batch_leader = leader;
+    fip->upload_offset = 0;
+    safe_strcpy(m_url, fip->upload_urls.get_current_url(file_info));
+    leader->batch.push_back(this);
+}
+
+// Upload our file and those of the batch members in one request:
+// <data_server_request>, version info, <file_uploads>,
+// then for each file a <file_upload> section as in a single upload
+// followed by a newline and </file_upload>.
+// All but the first part is written to a temp file.
+//
+int FILE_XFER::init_upload_batch() {
+    static int batch_seqno = 0;
+    char path[MAXPATHLEN], buf[4096];
+    unsigned int i;
+    size_t n;
+
+    const char* url = fip->upload_urls.get_current_url(*fip);
+    if (!url) return ERR_INVALID_URL;
+    snprintf(batch_file, sizeof(batch_file), "upload_batch_%d", batch_seqno++);
+    FILE* out = boinc_fopen(batch_file, "wb");
+    if (!out) return ERR_FOPEN;
+    for (i=0; i<=batch.size(); i++) {
+        FILE_INFO& fi = i ? *batch[i-1]->fip : *fip;
+        fi.upload_offset = 0;
+        file_upload_header(fi, buf, sizeof(buf));
+        fputs(buf, out);
+        get_pathname(&fi, path, sizeof(path));
+        FILE* in = boinc_fopen(path, "rb");
+        if (!in) {
+            fclose(out);
+            return ERR_FOPEN;
+        }
+        while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+            fwrite(buf, 1, n, out);
+        }
+        fclose(in);
+        fputs("\n</file_upload>\n", out);
+    }
+    fputs("</file_uploads>\n</data_server_request>\n", out);
+    if (fclose(out)) return ERR_FWRITE;
+
+    // the reply has a <file_status> per file
+    //
+    batch_buf.assign(1024*(batch.size()+2), 0);
+    snprintf(&batch_buf[0], batch_buf.size(),
+        "<data_server_request>\n"
+        "    <core_client_major_version>%d</core_client_major_version>\n"
+        "    <core_client_minor_version>%d</core_client_minor_version>\n"
+        "    <core_client_release>%d</core_client_release>\n"
+        "<file_uploads>\n",
+        BOINC_MAJOR_VERSION, BOINC_MINOR_VERSION, BOINC_RELEASE
+    );
+    bytes_xferred = 0;
+    file_size_query = false;
+    if (log_flags.file_xfer_debug) {
+        msg_printf(fip->project, MSG_INFO,
+            "[file_xfer] uploading %d files in one request",
+            (int)batch.size()+1
+        );
+    }
+    return HTTP_OP::init_post2(
+        fip->project, url, &batch_buf[0], (int)batch_buf.size(),
+        batch_file, 0
+    );
+}
+
+// A batch upload is done;
+// give each file its status from the reply, and detach the members.
+//
+void FILE_XFER::finish_batch(std::set<std::string>& no_batch_urls) {
+    char buf[256], name[256];
+    unsigned int i;
+    int x, retval = file_xfer_retval;
+    bool found = false, own_status = false;
+
+    if (!retval) {
+        retval = ERR_UPLOAD_TRANSIENT;
+        char* p = req1;
+        while ((p = strstr(p, "<file_status>"))) {
+            found = true;
+            char* q = strstr(p, "</file_status>");
+            if (!q) break;
+            *q = 0;
+            if (parse_str(p, "<name>", name, sizeof(name))
+                && parse_int(p, "<status>", x)
+            ) {
+                FILE_XFER* fxp = NULL;
+                if (!strcmp(name, fip->name)) {
+                    fxp = this;
+                    own_status = true;
+                } else {
+                    for (i=0; i<batch.size(); i++) {
+                        if (!strcmp(name, batch[i]->fip->name)) {
+                            fxp = batch[i];
+                            break;
+                        }
+                    }
+                }
+                if (fxp) {
+                    switch (x) {
+                    case -1: fxp->file_xfer_retval = ERR_UPLOAD_PERMANENT; break;
+                    case 0: fxp->file_xfer_retval = 0; break;
+                    default: fxp->file_xfer_retval = ERR_UPLOAD_TRANSIENT; break;
+                    }
+                    fxp->file_xfer_done = true;
+                    if (parse_str(p, "<message>", buf, sizeof(buf))) {
+                        msg_printf(fip->project, MSG_INTERNAL_ERROR,
+                            "Error reported by file upload server for %s: %s",
+                            name, buf
+                        );
+                    }
+                }
+            }
+            *q = '<';
+            p = q;
+        }
+        if (!found) {
+            // The upload handler doesn't do batches.
+            // It handled the first file (ours); send the others singly
+            //
+            no_batch_urls.insert(m_url);
+            if (log_flags.file_xfer_debug) {
+                msg_printf(fip->project, MSG_INFO,
+                    "[file_xfer] %s doesn't accept batch uploads", m_url
+                );
+            }
+            retval = ERR_RETRY;
+        } else if (!own_status) {
+            file_xfer_retval = ERR_UPLOAD_TRANSIENT;
+        }
+    }
+
+    for (i=0; i<batch.size(); i++) {
+        FILE_XFER* fxp = batch[i];
+        if (!fxp->file_xfer_done) {
+            fxp->file_xfer_retval = retval;
+            fxp->file_xfer_done = true;
+        }
+        if (!fxp->file_xfer_retval) {
+            fxp->bytes_xferred = fxp->fip->nbytes;
+        }
+        fxp->xfer_speed = xfer_speed;
+        fxp->batch_leader = NULL;
+    }
+    batch.clear();
+}
+
 // Parse the file upload handler response in req1
 //
 int FILE_XFER::parse_upload_response(double &nbytes) {
     int status = ERR_UPLOAD_TRANSIENT, x;
     char buf[256];
 
+    // per-file elements of a batch reply are handled in finish_batch()
+    //
+    char* p = strstr(req1, "<file_status>");
+    if (p) *p = 0;
+
     nbytes = -1;
     parse_double(req1, "<file_size>", nbytes);
     if (parse_int(req1, "<status>", x)) {
@@ -187,6 +425,7 @@ int FILE_XFER::parse_upload_response(double &nbytes) {
             "Error reported by file upload server: %s", buf
         );
     }
+    if (p) *p = '<';
     if (log_flags.file_xfer_debug) {
         msg_printf(fip->project, MSG_INFO,
             "[file_xfer] parsing upload response: %s", req1
@@ -222,6 +461,7 @@ int FILE_XFER_SET::insert(FILE_XFER* fxp) {
 int FILE_XFER_SET::remove(FILE_XFER* fxp) {
     vector<FILE_XFER*>::iterator iter;
 
+    if (fxp->batch_member || fxp->segmented) return 0;
     http_ops->remove(fxp);
 
     iter = file_xfers.begin();
@@ -266,6 +506,11 @@ bool FILE_XFER_SET::poll() {
             );
         }
         fxp->file_xfer_retval = fxp->http_op_retval;
+
+        // segments are checked by their PERS_FILE_XFER
+        //
+        if (fxp->segment >= 0) continue;
+
         if (fxp->file_xfer_retval == 0) {
             if (fxp->is_upload) {
                 fxp->file_xfer_retval = fxp->parse_upload_response(
@@ -313,6 +558,10 @@ bool FILE_XFER_SET::poll() {
             fxp->fip->error_msg = "Local copy is at least as large as server copy";
         }
 
+        if (fxp->batch.size()) {
+            fxp->finish_batch(no_batch_urls);
+        }
+
         // deal with various error cases for downloads
         //
         if (!fxp->is_upload) {
@@ -21,8 +21,23 @@
 // A FILE_XFER object represents a file transfer "episode"
 // (see pers_file_xfer.h), i.e. an HTTP transaction with a
 // particular data server.
+//
+// Small uploads to the same URL may be sent in one HTTP transaction.
+// The FILE_XFER doing the transaction (the "leader") has a list
+// of FILE_XFERs for the other files ("members").
+// Members aren't HTTP ops and aren't in the FILE_XFER_SET;
+// they're marked as done, with their own status, when the leader is.
+//
+// Similarly, a large download may be done in segments
+// (see PERS_FILE_XFER::start_segments()).
+// The PERS_FILE_XFER's FILE_XFER isn't an HTTP op;
+// it has a FILE_XFER, in the FILE_XFER_SET, for each segment in progress.
 // 
 
+#include <set>
+#include <string>
+#include <vector>
+
 #include "client_types.h"
 #include "http_curl.h"
 
@@ -45,12 +60,36 @@ public:
         // 2) lets us recover when server ignored Range request
         // and sent us whole file
 
+    std::vector<FILE_XFER*> batch;
+        // leader: the members
+    FILE_XFER* batch_leader;
+        // member: the leader (NULL once it's gone)
+    bool batch_member;
+    std::vector<char> batch_buf;
+        // leader: request envelope; also used for the reply
+    char batch_file[256];
+        // leader: temp file with the rest of the request
+    bool segmented;
+        // a segmented download
+    std::vector<FILE_XFER*> segment_xfers;
+        // segmented download: the segments in progress
+    FILE_XFER* segment_of;
+        // segment: the segmented download (NULL once it's gone)
+    int segment;
+        // segment: index in PERS_FILE_XFER::segments
+
     FILE_XFER();
     ~FILE_XFER();
 
     int parse_upload_response(double &offset);
     int init_download(FILE_INFO&);
     int init_upload(FILE_INFO&);
+    int init_upload_batch();
+    int init_download_segment(
+        FILE_INFO&, int seg, double start, double end, const char* url
+    );
+    void add_to_batch(FILE_XFER* leader, FILE_INFO&);
+    void finish_batch(std::set<std::string>& no_batch_urls);
     bool file_xfer_done;
     int file_xfer_retval;
 };
@@ -61,6 +100,8 @@ public:
     bool up_active, down_active;
         // has there been transfer activity since last call to check_active()?
     std::vector<FILE_XFER*> file_xfers;
+    std::set<std::string> no_batch_urls;
+        // upload URLs whose handler doesn't accept batches
     FILE_XFER_SET(HTTP_OP_SET*);
     int insert(FILE_XFER*);
     int remove(FILE_XFER*);
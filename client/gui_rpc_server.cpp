@@ -65,10 +65,19 @@
 #include "file_names.h"
 #include "client_msgs.h"
 #include "client_state.h"
+#include "cs_notice.h"
+#include "result.h"
 #include "sandbox.h"
 
 using std::string;
 using std::vector;
+using std::deque;
+
+#ifdef MSG_NOSIGNAL
+#define GUI_RPC_SEND_FLAGS  MSG_NOSIGNAL
+#else
+#define GUI_RPC_SEND_FLAGS  0
+#endif
 
 GUI_RPC_CONN::GUI_RPC_CONN(int s) :
     xp(&mfin),
@@ -89,6 +98,9 @@ GUI_RPC_CONN::GUI_RPC_CONN(int s) :
     quit_flag = false;
     au_ss_state = AU_SS_INIT;
     au_mgr_state = AU_MGR_INIT;
+    event_mask = 0;
+    events_dropped = 0;
+    async_output = false;
 
     notice_refresh = false;
 }
@@ -97,13 +109,283 @@ GUI_RPC_CONN::~GUI_RPC_CONN() {
     boinc_close_socket(sock);
 }
 
+// called when the connection subscribes to events;
+// from now on, don't block writing to the socket
+//
+void GUI_RPC_CONN::set_async_output() {
+    if (async_output) return;
+    boinc_socket_asynch(sock, true);
+    async_output = true;
+}
+
+static bool would_block() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+// send a reply.
+// Return nonzero if the connection should be closed
+//
+int GUI_RPC_CONN::send_output(const char* p, int n) {
+    if (!async_output) {
+        send(sock, p, n, 0);
+        return 0;
+    }
+    out_buf.append(p, n);
+    return flush_output();
+}
+
+// write as much of out_buf as the socket will take
+//
+int GUI_RPC_CONN::flush_output() {
+    while (!out_buf.empty()) {
+        int n = send(
+            sock, out_buf.data(), (int)out_buf.size(), GUI_RPC_SEND_FLAGS
+        );
+        if (n < 0) {
+            if (would_block()) return 0;
+            return ERR_WRITE;
+        }
+        out_buf.erase(0, n);
+    }
+    return 0;
+}
+
+void GUI_RPC_CONN::queue_event(GUI_EVENT& e) {
+    if (!(event_mask & e.type)) return;
+    if (!e.key.empty()) {
+        for (deque<GUI_EVENT>::iterator i = events.begin(); i != events.end(); ++i) {
+            if (i->key == e.key) {
+                i->xml = e.xml;
+                return;
+            }
+        }
+    }
+    if (events.size() >= GUI_EVENTS_MAX_QUEUED) {
+        events.pop_front();
+        events_dropped++;
+    }
+    events.push_back(e);
+}
+
+// if the last batch has been written, send queued events as a new batch.
+// Return nonzero if the connection should be closed
+//
+int GUI_RPC_CONN::send_events() {
+    if (!out_buf.empty()) {
+        return flush_output();
+    }
+    if (events.empty() && !events_dropped) return 0;
+    char buf[256];
+    out_buf = "<boinc_gui_rpc_events>\n";
+    if (events_dropped) {
+        snprintf(buf, sizeof(buf), "<dropped>%d</dropped>\n", events_dropped);
+        out_buf += buf;
+        events_dropped = 0;
+    }
+    for (unsigned int i=0; i<events.size(); i++) {
+        out_buf += events[i].xml;
+    }
+    events.clear();
+    out_buf += "</boinc_gui_rpc_events>\n\003";
+    return flush_output();
+}
+
 GUI_RPC_CONN_SET::GUI_RPC_CONN_SET() {
     remote_hosts_file_exists = false;
     lsock = -1;
     time_of_last_rpc_needing_network = 0;
+    last_transfer_events = 0;
     safe_strcpy(password,"");
 }
 
+int GUI_RPC_CONN_SET::event_mask() {
+    int mask = 0;
+    for (unsigned int i=0; i<gui_rpcs.size(); i++) {
+        mask |= gui_rpcs[i]->event_mask;
+    }
+    return mask;
+}
+
+void GUI_RPC_CONN_SET::post_event(GUI_EVENT& e) {
+    for (unsigned int i=0; i<gui_rpcs.size(); i++) {
+        gui_rpcs[i]->queue_event(e);
+    }
+}
+
+// Format an event record.
+// MIOFILE::printf() into an MFILE doesn't limit the size
+//
+static void event_xml(MFILE& m, string& xml) {
+    char* p;
+    int n;
+    m.get_buf(p, n);
+    if (p) {
+        xml = p;
+        free(p);
+    }
+}
+
+void GUI_RPC_CONN_SET::task_event(ACTIVE_TASK* atp) {
+    if (!(event_mask() & GUI_EVENT_TASK)) return;
+    RESULT* rp = atp->result;
+    GUI_EVENT e;
+    MFILE m;
+    MIOFILE mf;
+    mf.init_mfile(&m);
+    mf.printf(
+        "<task_event>\n"
+        "    <project_url>%s</project_url>\n"
+        "    <name>%s</name>\n"
+        "    <active_task_state>%d</active_task_state>\n"
+        "    <scheduler_state>%d</scheduler_state>\n"
+        "    <elapsed_time>%f</elapsed_time>\n"
+        "    <fraction_done>%f</fraction_done>\n"
+        "</task_event>\n",
+        rp->project->master_url,
+        rp->name,
+        atp->task_state(),
+        atp->scheduler_state,
+        atp->elapsed_time,
+        atp->fraction_done
+    );
+    event_xml(m, e.xml);
+    e.type = GUI_EVENT_TASK;
+    e.key = string("task ") + rp->project->master_url + " " + rp->name;
+    post_event(e);
+}
+
+void GUI_RPC_CONN_SET::result_event(RESULT* rp) {
+    if (!(event_mask() & GUI_EVENT_RESULT)) return;
+    GUI_EVENT e;
+    MFILE m;
+    MIOFILE mf;
+    mf.init_mfile(&m);
+    mf.printf(
+        "<result_event>\n"
+        "    <project_url>%s</project_url>\n"
+        "    <name>%s</name>\n"
+        "    <state>%d</state>\n"
+        "    <exit_status>%d</exit_status>\n"
+        "</result_event>\n",
+        rp->project->master_url,
+        rp->name,
+        rp->state(),
+        rp->exit_status
+    );
+    event_xml(m, e.xml);
+    e.type = GUI_EVENT_RESULT;
+    e.key = string("result ") + rp->project->master_url + " " + rp->name;
+    post_event(e);
+}
+
+// send the progress of active transfers
+//
+void GUI_RPC_CONN_SET::transfer_events() {
+    if (gstate.now < last_transfer_events + GUI_EVENT_TRANSFER_PERIOD) return;
+    if (!(event_mask() & GUI_EVENT_TRANSFER)) return;
+    last_transfer_events = gstate.now;
+    vector<PERS_FILE_XFER*>& pfxs = gstate.pers_file_xfers->pers_file_xfers;
+    for (unsigned int i=0; i<pfxs.size(); i++) {
+        PERS_FILE_XFER* pfx = pfxs[i];
+        if (!pfx->fxp) continue;
+        FILE_INFO* fip = pfx->fip;
+        GUI_EVENT e;
+        MFILE m;
+        MIOFILE mf;
+        mf.init_mfile(&m);
+        fip->write_gui(mf);
+        event_xml(m, e.xml);
+        e.type = GUI_EVENT_TRANSFER;
+        e.key = string("transfer ") + fip->project->master_url + " " + fip->name;
+        post_event(e);
+    }
+}
+
+// a transfer has finished (or given up);
+// this replaces any queued progress event
+//
+void GUI_RPC_CONN_SET::transfer_done_event(PERS_FILE_XFER* pfx) {
+    if (!(event_mask() & GUI_EVENT_TRANSFER)) return;
+    FILE_INFO* fip = pfx->fip;
+    GUI_EVENT e;
+    MFILE m;
+    MIOFILE mf;
+    mf.init_mfile(&m);
+    mf.printf(
+        "<transfer_done>\n"
+        "    <project_url>%s</project_url>\n"
+        "    <name>%s</name>\n"
+        "    <is_upload>%d</is_upload>\n"
+        "    <status>%d</status>\n"
+        "</transfer_done>\n",
+        fip->project->master_url,
+        fip->name,
+        pfx->is_upload?1:0,
+        fip->status
+    );
+    event_xml(m, e.xml);
+    e.type = GUI_EVENT_TRANSFER;
+    e.key = string("transfer ") + fip->project->master_url + " " + fip->name;
+    post_event(e);
+}
+
+void GUI_RPC_CONN_SET::message_event(MESSAGE_DESC* mdp) {
+    if (!(event_mask() & GUI_EVENT_MESSAGE)) return;
+    GUI_EVENT e;
+    MFILE m;
+    MIOFILE mf;
+    mf.init_mfile(&m);
+    mdp->write(mf, false);
+    event_xml(m, e.xml);
+    e.type = GUI_EVENT_MESSAGE;
+    post_event(e);
+}
+
+// private notices go only to connections that have authenticated
+// (as with get_notices)
+//
+void GUI_RPC_CONN_SET::notice_event(NOTICE& n) {
+    if (!(event_mask() & GUI_EVENT_NOTICE)) return;
+    GUI_EVENT e;
+    MFILE m;
+    MIOFILE mf;
+    mf.init_mfile(&m);
+    n.write(mf, true);
+    event_xml(m, e.xml);
+    e.type = GUI_EVENT_NOTICE;
+    for (unsigned int i=0; i<gui_rpcs.size(); i++) {
+        GUI_RPC_CONN* gr = gui_rpcs[i];
+        if (n.is_private && gr->auth_needed) continue;
+        gr->queue_event(e);
+    }
+}
+
+// called before waiting for I/O:
+// send queued events, and close connections whose sockets failed
+//
+void GUI_RPC_CONN_SET::send_events() {
+    transfer_events();
+    vector<GUI_RPC_CONN*>::iterator iter = gui_rpcs.begin();
+    while (iter != gui_rpcs.end()) {
+        GUI_RPC_CONN* gr = *iter;
+        if (gr->async_output && gr->send_events()) {
+            if (log_flags.gui_rpc_debug) {
+                msg_printf(NULL, MSG_INFO,
+                    "[gui_rpc] can't send events, closing socket"
+                );
+            }
+            delete gr;
+            iter = gui_rpcs.erase(iter);
+            continue;
+        }
+        ++iter;
+    }
+}
+
 bool GUI_RPC_CONN_SET::poll() {
     unsigned int i;
     bool action = false;
@@ -415,6 +697,9 @@ void GUI_RPC_CONN_SET::get_fdset(FDSET_GROUP& fg, FDSET_GROUP& all) {
 
         FD_SET(s, &all.read_fds);
         FD_SET(s, &all.exc_fds);
+        if (!gr->out_buf.empty()) {
+            FD_SET(s, &all.write_fds);
+        }
         if (s > all.max_fd) all.max_fd = s;
     }
     FD_SET(lsock, &fg.read_fds);
@@ -434,79 +719,87 @@ bool GUI_RPC_CONN_SET::check_allowed_list(sockaddr_storage& peer_ip) {
     return false;
 }
 
-void GUI_RPC_CONN_SET::got_select(FDSET_GROUP& fg) {
-    int sock, retval;
-    vector<GUI_RPC_CONN*>::iterator iter;
+// accept a connection on the listening socket
+//
+void GUI_RPC_CONN_SET::accept_connection() {
+    int sock;
     GUI_RPC_CONN* gr;
+    struct sockaddr_storage addr;
+
+    // For unknown reasons, the listening socket is reported readable
+    // after a SIGTERM, SIGHUP, SIGINT or SIGQUIT is received,
+    // even if there is no data available on the socket.
+    // This causes the accept() call to block, preventing the main 
+    // loop from processing the exit request.
+    // This is a workaround for that problem.
+    //
+    if (gstate.requested_exit) {
+        return;
+    }
 
-    if (lsock < 0) return;
-
-    if (FD_ISSET(lsock, &fg.read_fds)) {
-        struct sockaddr_storage addr;
-
-        // For unknown reasons, the FD_ISSET() above succeeds
-        // after a SIGTERM, SIGHUP, SIGINT or SIGQUIT is received,
-        // even if there is no data available on the socket.
-        // This causes the accept() call to block, preventing the main 
-        // loop from processing the exit request.
-        // This is a workaround for that problem.
-        //
-        if (gstate.requested_exit) {
-            return;
-        }
-
-        BOINC_SOCKLEN_T addr_len = sizeof(addr);
-        sock = accept(lsock, (struct sockaddr*)&addr, (BOINC_SOCKLEN_T*)&addr_len);
-        if (sock == -1) {
-            return;
-        }
+    BOINC_SOCKLEN_T addr_len = sizeof(addr);
+    sock = accept(lsock, (struct sockaddr*)&addr, (BOINC_SOCKLEN_T*)&addr_len);
+    if (sock == -1) {
+        return;
+    }
 
-        // apps shouldn't inherit the socket!
-        //
+    // apps shouldn't inherit the socket!
+    //
 #ifndef _WIN32
-        fcntl(sock, F_SETFD, FD_CLOEXEC);
+    fcntl(sock, F_SETFD, FD_CLOEXEC);
 #endif
 
-        bool host_allowed;
-         
-        // accept the connection if:
-        // 1) allow_remote_gui_rpc is set or
-        // 2) client host is included in "remote_hosts" file or
-        // 3) client is on localhost
+    bool host_allowed;
+     
+    // accept the connection if:
+    // 1) allow_remote_gui_rpc is set or
+    // 2) client host is included in "remote_hosts" file or
+    // 3) client is on localhost
+    //
+    if (gstate.gui_rpc_unix_domain) {
+        host_allowed = true;
+    } else if (cc_config.allow_remote_gui_rpc) {
+        host_allowed = true;
+    } else if (is_localhost(addr)) {
+        host_allowed = true;
+    } else {
+        // reread host file because IP addresses might have changed
         //
+        get_allowed_hosts();
+        host_allowed = check_allowed_list(addr);
+    }
+
+    if (!host_allowed) {
+        show_connect_error(addr);
+        boinc_close_socket(sock);
+    } else {
+        gr = new GUI_RPC_CONN(sock);
+        if (strlen(password)) {
+            gr->auth_needed = true;
+        }
         if (gstate.gui_rpc_unix_domain) {
-            host_allowed = true;
-        } else if (cc_config.allow_remote_gui_rpc) {
-            host_allowed = true;
-        } else if (is_localhost(addr)) {
-            host_allowed = true;
+            gr->is_local = true;
         } else {
-            // reread host file because IP addresses might have changed
-            //
-            get_allowed_hosts();
-            host_allowed = check_allowed_list(addr);
+            gr->is_local = is_localhost(addr);
         }
-
-        if (!host_allowed) {
-            show_connect_error(addr);
-            boinc_close_socket(sock);
-        } else {
-            gr = new GUI_RPC_CONN(sock);
-            if (strlen(password)) {
-                gr->auth_needed = true;
-            }
-            if (gstate.gui_rpc_unix_domain) {
-                gr->is_local = true;
-            } else {
-                gr->is_local = is_localhost(addr);
-            }
-            if (log_flags.gui_rpc_debug) {
-                msg_printf(0, MSG_INFO,
-                    "[gui_rpc] got new GUI RPC connection"
-                );
-            }
-            insert(gr);
+        if (log_flags.gui_rpc_debug) {
+            msg_printf(0, MSG_INFO,
+                "[gui_rpc] got new GUI RPC connection"
+            );
         }
+        insert(gr);
+    }
+}
+
+void GUI_RPC_CONN_SET::got_select(FDSET_GROUP& fg) {
+    int retval;
+    vector<GUI_RPC_CONN*>::iterator iter;
+    GUI_RPC_CONN* gr;
+
+    if (lsock < 0) return;
+
+    if (FD_ISSET(lsock, &fg.read_fds)) {
+        accept_connection();
     }
 
     // delete connections with failed sockets
@@ -522,11 +815,19 @@ void GUI_RPC_CONN_SET::got_select(FDSET_GROUP& fg) {
         ++iter;
     }
 
-    // handle RPCs on connections with pending requests
+    // handle RPCs on connections with pending requests,
+    // and write pending output
     //
     iter = gui_rpcs.begin();
     while (iter != gui_rpcs.end()) {
         gr = *iter;
+        if (!gr->out_buf.empty() && FD_ISSET(gr->sock, &fg.write_fds)) {
+            if (gr->flush_output()) {
+                delete gr;
+                iter = gui_rpcs.erase(iter);
+                continue;
+            }
+        }
         if (FD_ISSET(gr->sock, &fg.read_fds)) {
             retval = gr->handle_rpc();
             if (retval) {
@@ -545,6 +846,88 @@ void GUI_RPC_CONN_SET::got_select(FDSET_GROUP& fg) {
     }
 }
 
+#ifndef _WIN32
+// Same as get_fdset() and got_select(), but for poll();
+// this has no limit on descriptor numbers.
+// The first entry is the listening socket,
+// followed by the connections in order.
+//
+void GUI_RPC_CONN_SET::get_pollfds(vector<pollfd>& pfds) {
+    pollfd pfd;
+
+    pfds.clear();
+    if (lsock < 0) return;
+    pfd.fd = lsock;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    pfds.push_back(pfd);
+    for (unsigned int i=0; i<gui_rpcs.size(); i++) {
+        pfd.fd = gui_rpcs[i]->sock;
+        pfd.events = POLLIN;
+        if (!gui_rpcs[i]->out_buf.empty()) {
+            pfd.events |= POLLOUT;
+        }
+        pfds.push_back(pfd);
+    }
+}
+
+void GUI_RPC_CONN_SET::got_pollfds(vector<pollfd>& pfds) {
+    int retval;
+    unsigned int i;
+    vector<GUI_RPC_CONN*>::iterator iter;
+    GUI_RPC_CONN* gr;
+
+    if (lsock < 0 || pfds.empty()) return;
+
+    // connections accepted below are appended to gui_rpcs;
+    // only the first nconns have entries in pfds
+    //
+    size_t nconns = pfds.size() - 1;
+    if (nconns > gui_rpcs.size()) nconns = gui_rpcs.size();
+
+    if (pfds[0].revents & POLLIN) {
+        accept_connection();
+    }
+
+    // delete connections with failed sockets,
+    // and handle RPCs on connections with pending requests
+    //
+    i = 0;
+    iter = gui_rpcs.begin();
+    while (iter != gui_rpcs.end() && i < nconns) {
+        gr = *iter;
+        short revents = pfds[++i].revents;
+        if (revents & (POLLERR|POLLNVAL)) {
+            delete gr;
+            iter = gui_rpcs.erase(iter);
+            continue;
+        }
+        if (revents & POLLOUT) {
+            if (gr->flush_output()) {
+                delete gr;
+                iter = gui_rpcs.erase(iter);
+                continue;
+            }
+        }
+        if (revents & (POLLIN|POLLHUP)) {
+            retval = gr->handle_rpc();
+            if (retval) {
+                if (log_flags.gui_rpc_debug) {
+                    msg_printf(NULL, MSG_INFO,
+                        "[gui_rpc] handler returned %d, closing socket\n",
+                        retval
+                    );
+                }
+                delete gr;
+                iter = gui_rpcs.erase(iter);
+                continue;
+            }
+        }
+        ++iter;
+    }
+}
+#endif
+
 // called when client is shutting down
 //
 void GUI_RPC_CONN_SET::close() {
@@ -18,9 +18,24 @@
 #ifndef BOINC_GUI_RPC_SERVER_H
 #define BOINC_GUI_RPC_SERVER_H
 
+#ifndef _WIN32
+#include <poll.h>
+#endif
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+
 #include "network.h"
 #include "acct_setup.h"
 
+struct ACTIVE_TASK;
+struct RESULT;
+class PERS_FILE_XFER;
+struct MESSAGE_DESC;
+class NOTICE;
+
 // FSM states for auto-update
 
 #define AU_SS_INIT          0
@@ -39,6 +54,35 @@
 
 #define GUI_RPC_REQ_MSG_SIZE    100000
 
+// Event subscriptions.
+// A connection that does subscribe_events gets, in addition to
+// replies to its requests, batches of event records:
+//
+// <boinc_gui_rpc_events>
+// [ <dropped>N</dropped> ]
+// ... <task_event>, <result_event>, <file_transfer>, <msg> etc.
+// </boinc_gui_rpc_events>
+// \003
+//
+// Events are queued per connection, and a batch is formatted
+// only when the previous one has been written to the socket.
+// So for a slow reader, queued events for the same task, result
+// or transfer are coalesced (the latest replaces the earlier),
+// and beyond GUI_EVENTS_MAX_QUEUED the oldest are dropped;
+// <dropped> says how many, so the reader can resync by polling.
+
+#define GUI_EVENTS_MAX_QUEUED   1000
+#define GUI_EVENT_TRANSFER_PERIOD   1
+    // how often to send transfer progress
+
+struct GUI_EVENT {
+    int type;
+        // GUI_EVENT_*
+    std::string key;
+        // a queued event with the same (nonempty) key is replaced
+    std::string xml;
+};
+
 class GUI_RPC_CONN {
 public:
     int sock;
@@ -63,6 +107,17 @@ public:
     bool quit_flag;
     int au_ss_state;
     int au_mgr_state;
+    int event_mask;
+        // the classes of events subscribed to
+    std::deque<GUI_EVENT> events;
+        // events not yet sent
+    int events_dropped;
+        // events discarded since the last batch
+    bool async_output;
+        // the connection has subscribed to events at some point.
+        // The socket is non-blocking, and data that can't be written
+        // right away is kept in out_buf
+    std::string out_buf;
     GUI_HTTP gui_http;
     GET_PROJECT_CONFIG_OP get_project_config_op;
     LOOKUP_ACCOUNT_OP lookup_account_op;
@@ -86,6 +141,79 @@ public:
     int handle_rpc();
     void handle_auth1(MIOFILE&);
     int handle_auth2(char*, MIOFILE&);
+    void set_async_output();
+    int send_output(const char*, int);
+    int flush_output();
+    void queue_event(GUI_EVENT&);
+    int send_events();
+};
+
+// Change tracking for the delta forms of get_state, get_results
+// and get_file_transfers.
+//
+// When one of these is done with <since_seqno>N</since_seqno>,
+// we scan the relevant objects and compare a hash of the fields
+// shown in the GUI with the hash from the previous scan.
+// Objects that are new or have changed get the next sequence number;
+// objects that have gone away are added to a list of deletions.
+// Objects that change continually (running tasks, active transfers)
+// get a new sequence number on each scan.
+// The reply has only objects with seqno > N, and deletions since N.
+//
+// If N is zero, the client has restarted since N was issued
+// (<seqno_epoch> differs) or deletions after N have been discarded,
+// the reply has all the objects, and includes <full/>.
+
+#define GUI_CHANGES_MAX_DELETED 1000
+    // remember this many deletions of each type of object
+
+struct GUI_CHANGE_ITEM {
+    std::string project_url;
+    std::string name;
+    unsigned long long hash;
+    unsigned long long seqno;
+    int scan;
+};
+
+struct GUI_CHANGE_LIST {
+    const char* deleted_tag;
+    std::map<void*, GUI_CHANGE_ITEM> items;
+        // objects seen in the last scan
+    std::deque<GUI_CHANGE_ITEM> deleted;
+    unsigned long long lost_seqno;
+        // deletions with seqno <= this have been discarded
+    int scan;
+
+    GUI_CHANGE_LIST(const char* tag) {
+        deleted_tag = tag;
+        lost_seqno = 0;
+        scan = 0;
+    }
+    unsigned long long update(
+        void*, const char* url, const char* name,
+        unsigned long long hash, bool always
+    );
+        // note that an object was seen in the current scan;
+        // return its seqno
+    void end_scan();
+        // objects not seen in the scan have been deleted
+    void write_deleted(MIOFILE&, unsigned long long since);
+};
+
+struct GUI_DELTA {
+    unsigned long long since;
+    bool full;
+    std::set<void*> send;
+        // if not full, the objects to send
+    std::vector<GUI_CHANGE_LIST*> lists;
+
+    GUI_DELTA(unsigned long long s, double epoch);
+    bool includes(void* p) {
+        return full || send.count(p) > 0;
+    }
+    void add_list(GUI_CHANGE_LIST&);
+    void write_header(MIOFILE&);
+    void write_deleted(MIOFILE&);
 };
 
 // authentication for GUI RPCs:
@@ -98,6 +226,10 @@ class GUI_RPC_CONN_SET {
     int get_allowed_hosts();
     void get_password();
     int insert(GUI_RPC_CONN*);
+    void accept_connection();
+    double last_transfer_events;
+    void post_event(GUI_EVENT&);
+    void transfer_events();
     bool check_allowed_list(sockaddr_storage& ip_addr);
     bool remote_hosts_file_exists;
 public:
@@ -109,6 +241,10 @@ public:
     char password[256];
     void get_fdset(FDSET_GROUP&, FDSET_GROUP&);
     void got_select(FDSET_GROUP&);
+#ifndef _WIN32
+    void get_pollfds(std::vector<pollfd>&);
+    void got_pollfds(std::vector<pollfd>&);
+#endif
     int init_tcp(bool last_time);
     int init_unix_domain();
     void close();
@@ -116,6 +252,16 @@ public:
     void send_quits();
     bool quits_sent();
     bool poll();
+    void send_events();
+
+    int event_mask();
+        // union of subscribed event classes
+    void task_event(ACTIVE_TASK*);
+    void result_event(RESULT*);
+    void transfer_done_event(PERS_FILE_XFER*);
+    void message_event(MESSAGE_DESC*);
+    void notice_event(NOTICE&);
+
     void set_notice_refresh() {
         for (unsigned int i=0; i<gui_rpcs.size(); i++) {
             gui_rpcs[i]->set_notice_refresh();
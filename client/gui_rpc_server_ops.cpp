@@ -40,6 +40,8 @@
 #endif
 #include <vector>
 #include <cstring>
+#include <cmath>
+#include <cerrno>
 #if HAVE_NETINET_IN_H
 #include <netinet/in.h>
 #endif
@@ -229,7 +231,7 @@ static void handle_project_reset(GUI_RPC_CONN& grc) {
 static void handle_project_suspend(GUI_RPC_CONN& grc) {
     PROJECT* p = get_project_parse(grc);
     if (!p) return;
-    gstate.set_client_state_dirty("Project modified by user");
+    gstate.set_project_dirty(p, "Project modified by user");
     msg_printf(p, MSG_INFO, "project suspended by user");
     p->suspend();
     grc.mfout.printf("<success/>\n");
@@ -238,7 +240,7 @@ static void handle_project_suspend(GUI_RPC_CONN& grc) {
 static void handle_project_resume(GUI_RPC_CONN& grc) {
     PROJECT* p = get_project_parse(grc);
     if (!p) return;
-    gstate.set_client_state_dirty("Project modified by user");
+    gstate.set_project_dirty(p, "Project modified by user");
     msg_printf(p, MSG_INFO, "project resumed by user");
     p->resume();
     grc.mfout.printf("<success/>\n");
@@ -264,7 +266,7 @@ static void handle_project_detach(GUI_RPC_CONN& grc) {
 static void handle_project_update(GUI_RPC_CONN& grc) {
     PROJECT* p = get_project_parse(grc);
     if (!p) return;
-    gstate.set_client_state_dirty("Project modified by user");
+    gstate.set_project_dirty(p, "Project modified by user");
     msg_printf(p, MSG_INFO, "update requested by user");
     p->sched_rpc_pending = RPC_REASON_USER_REQ;
     p->min_rpc_time = 0;
@@ -278,7 +280,7 @@ static void handle_project_update(GUI_RPC_CONN& grc) {
 static void handle_project_nomorework(GUI_RPC_CONN& grc) {
     PROJECT* p = get_project_parse(grc);
     if (!p) return;
-    gstate.set_client_state_dirty("Project modified by user");
+    gstate.set_project_dirty(p, "Project modified by user");
     msg_printf(p, MSG_INFO, "work fetch suspended by user");
     p->dont_request_more_work = true;
     grc.mfout.printf("<success/>\n");
@@ -287,7 +289,7 @@ static void handle_project_nomorework(GUI_RPC_CONN& grc) {
 static void handle_project_allowmorework(GUI_RPC_CONN& grc) {
     PROJECT* p = get_project_parse(grc);
     if (!p) return;
-    gstate.set_client_state_dirty("Project modified by user");
+    gstate.set_project_dirty(p, "Project modified by user");
     msg_printf(p, MSG_INFO, "work fetch resumed by user");
     p->dont_request_more_work = false;
     gstate.request_work_fetch("project work fetch resumed by user");
@@ -297,7 +299,7 @@ static void handle_project_allowmorework(GUI_RPC_CONN& grc) {
 static void handle_project_detach_when_done(GUI_RPC_CONN& grc) {
     PROJECT* p = get_project_parse(grc);
     if (!p) return;
-    gstate.set_client_state_dirty("Project modified by user");
+    gstate.set_project_dirty(p, "Project modified by user");
     msg_printf(p, MSG_INFO, "detach when done set by user");
     p->detach_when_done = true;
     p->dont_request_more_work = true;
@@ -307,7 +309,7 @@ static void handle_project_detach_when_done(GUI_RPC_CONN& grc) {
 static void handle_project_dont_detach_when_done(GUI_RPC_CONN& grc) {
     PROJECT* p = get_project_parse(grc);
     if (!p) return;
-    gstate.set_client_state_dirty("Project modified by user");
+    gstate.set_project_dirty(p, "Project modified by user");
     msg_printf(p, MSG_INFO, "detach when done cleared by user");
     p->detach_when_done = false;
     p->dont_request_more_work = false;
@@ -493,6 +495,51 @@ static void handle_get_messages(GUI_RPC_CONN& grc) {
     message_descs.write(seqno, grc.mfout, translatable);
 }
 
+// <subscribe_events>
+//    [ <task/> ] [ <result/> ] [ <transfer/> ] [ <message/> ] [ <notice/> ]
+// </subscribe_events>
+// Replace the connection's subscriptions with the given event classes;
+// none means unsubscribe.
+// Events are then sent on the connection as they happen
+// (see gui_rpc_server.h).
+// Private notices are sent only if the connection has authenticated.
+//
+static void handle_subscribe_events(GUI_RPC_CONN& grc) {
+    int mask = 0;
+    bool flag;
+
+    while (!grc.xp.get_tag()) {
+        if (grc.xp.parse_bool("task", flag)) {
+            if (flag) mask |= GUI_EVENT_TASK;
+            continue;
+        }
+        if (grc.xp.parse_bool("result", flag)) {
+            if (flag) mask |= GUI_EVENT_RESULT;
+            continue;
+        }
+        if (grc.xp.parse_bool("transfer", flag)) {
+            if (flag) mask |= GUI_EVENT_TRANSFER;
+            continue;
+        }
+        if (grc.xp.parse_bool("message", flag)) {
+            if (flag) mask |= GUI_EVENT_MESSAGE;
+            continue;
+        }
+        if (grc.xp.parse_bool("notice", flag)) {
+            if (flag) mask |= GUI_EVENT_NOTICE;
+            continue;
+        }
+    }
+    grc.event_mask = mask;
+    if (mask) {
+        grc.set_async_output();
+    } else {
+        grc.events.clear();
+        grc.events_dropped = 0;
+    }
+    grc.mfout.printf("<event_mask>%d</event_mask>\n", mask);
+}
+
 static void handle_get_message_count(GUI_RPC_CONN& grc) {
     grc.mfout.printf("<seqno>%d</seqno>\n", message_descs.highest_seqno());
 }
@@ -540,7 +587,7 @@ static void handle_file_transfer_op(GUI_RPC_CONN& grc, const char* op) {
         grc.mfout.printf("<error>unknown op</error>\n");
         return;
     }
-    gstate.set_client_state_dirty("File transfer RPC");
+    gstate.set_file_info_dirty(f, "File transfer RPC");
     grc.mfout.printf("<success/>\n");
 }
 
@@ -595,7 +642,7 @@ static void handle_result_op(GUI_RPC_CONN& grc, const char* op) {
         rp->suspended_via_gui = false;
     }
     gstate.request_schedule_cpus("task suspended, resumed or aborted by user");
-    gstate.set_client_state_dirty("Result RPC");
+    gstate.set_result_dirty(rp, "Result RPC");
     grc.mfout.printf("<success/>\n");
 }
 
@@ -1105,8 +1152,268 @@ static void read_all_projects_list_file(GUI_RPC_CONN& grc) {
     }
 }
 
+////////// change tracking for delta RPCs; see gui_rpc_server.h
+
+static double gui_seqno_epoch = 0;
+    // distinguishes seqnos from different runs of the client
+static unsigned long long gui_seqno = 0;
+static GUI_CHANGE_LIST result_changes("deleted_result");
+static GUI_CHANGE_LIST wu_changes("deleted_workunit");
+static GUI_CHANGE_LIST file_xfer_changes("deleted_file_transfer");
+
+unsigned long long GUI_CHANGE_LIST::update(
+    void* p, const char* url, const char* name,
+    unsigned long long hash, bool always
+) {
+    std::map<void*, GUI_CHANGE_ITEM>::iterator i = items.find(p);
+    if (i != items.end()) {
+        GUI_CHANGE_ITEM& gci = i->second;
+        if (gci.name == name && gci.project_url == url) {
+            if (always || gci.hash != hash) {
+                gci.hash = hash;
+                gci.seqno = ++gui_seqno;
+            }
+            gci.scan = scan;
+            return gci.seqno;
+        }
+
+        // the object was deleted and another one allocated at its address
+        //
+        gci.seqno = ++gui_seqno;
+        deleted.push_back(gci);
+        items.erase(i);
+    }
+    GUI_CHANGE_ITEM gci;
+    gci.project_url = url;
+    gci.name = name;
+    gci.hash = hash;
+    gci.seqno = ++gui_seqno;
+    gci.scan = scan;
+    items[p] = gci;
+    return gci.seqno;
+}
+
+void GUI_CHANGE_LIST::end_scan() {
+    std::map<void*, GUI_CHANGE_ITEM>::iterator i = items.begin();
+    while (i != items.end()) {
+        if (i->second.scan != scan) {
+            i->second.seqno = ++gui_seqno;
+            deleted.push_back(i->second);
+            items.erase(i++);
+        } else {
+            ++i;
+        }
+    }
+    while (deleted.size() > GUI_CHANGES_MAX_DELETED) {
+        lost_seqno = deleted.front().seqno;
+        deleted.pop_front();
+    }
+    scan++;
+}
+
+void GUI_CHANGE_LIST::write_deleted(MIOFILE& f, unsigned long long since) {
+    for (unsigned int i=0; i<deleted.size(); i++) {
+        GUI_CHANGE_ITEM& gci = deleted[i];
+        if (gci.seqno <= since) continue;
+        f.printf(
+            "<%s>\n"
+            "    <project_url>%s</project_url>\n"
+            "    <name>%s</name>\n"
+            "</%s>\n",
+            deleted_tag, gci.project_url.c_str(), gci.name.c_str(), deleted_tag
+        );
+    }
+}
+
+GUI_DELTA::GUI_DELTA(unsigned long long s, double epoch) {
+    if (!gui_seqno_epoch) gui_seqno_epoch = floor(dtime());
+    since = s;
+    full = (since == 0 || epoch != gui_seqno_epoch);
+}
+
+void GUI_DELTA::add_list(GUI_CHANGE_LIST& l) {
+    lists.push_back(&l);
+    if (since < l.lost_seqno) full = true;
+}
+
+void GUI_DELTA::write_header(MIOFILE& f) {
+    f.printf(
+        "<seqno>%llu</seqno>\n"
+        "<seqno_epoch>%f</seqno_epoch>\n",
+        gui_seqno, gui_seqno_epoch
+    );
+    if (full) {
+        f.printf("<full/>\n");
+    }
+}
+
+void GUI_DELTA::write_deleted(MIOFILE& f) {
+    if (full) return;
+    for (unsigned int i=0; i<lists.size(); i++) {
+        lists[i]->write_deleted(f, since);
+    }
+}
+
+// FNV-1a hash of the GUI-visible fields of an object
+//
+struct GUI_HASH {
+    unsigned long long h;
+    GUI_HASH() {
+        h = 14695981039346656037ULL;
+    }
+    void add(const void* p, size_t n) {
+        const unsigned char* q = (const unsigned char*)p;
+        for (size_t i=0; i<n; i++) {
+            h ^= q[i];
+            h *= 1099511628211ULL;
+        }
+    }
+    void add(double x) {
+        add(&x, sizeof(x));
+    }
+    void add(int x) {
+        add(&x, sizeof(x));
+    }
+    void add(const char* s) {
+        add(s, strlen(s));
+    }
+};
+
+static unsigned long long result_gui_hash(RESULT* rp) {
+    GUI_HASH h;
+    h.add(rp->state());
+    h.add(rp->exit_status);
+    h.add(rp->final_cpu_time);
+    h.add(rp->final_elapsed_time);
+    h.add(rp->report_deadline);
+    h.add(rp->received_time);
+    h.add((int)rp->estimated_runtime_remaining());
+    h.add(rp->completed_time);
+    h.add(
+        (rp->got_server_ack?1:0)
+        | (rp->ready_to_report?2:0)
+        | (rp->suspended_via_gui?4:0)
+        | (rp->project->suspended_via_gui?8:0)
+        | (rp->report_immediately?16:0)
+        | (rp->edf_scheduled?32:0)
+        | (rp->coproc_missing?64:0)
+        | ((rp->avp->needs_network && gstate.network_suspended)?128:0)
+    );
+    if (rp->schedule_backoff > gstate.now) {
+        h.add(rp->schedule_backoff_reason);
+    }
+    return h.h;
+}
+
+// scan results; add those changed since delta.since to delta.send
+//
+static void scan_results(GUI_DELTA& delta) {
+    unsigned int i;
+    std::set<RESULT*> active;
+    for (i=0; i<gstate.active_tasks.active_tasks.size(); i++) {
+        active.insert(gstate.active_tasks.active_tasks[i]->result);
+    }
+    for (i=0; i<gstate.results.size(); i++) {
+        RESULT* rp = gstate.results[i];
+        bool always = active.count(rp) > 0;
+        unsigned long long seqno = result_changes.update(
+            rp, rp->project->master_url, rp->name,
+            always?0:result_gui_hash(rp), always
+        );
+        if (seqno > delta.since) {
+            delta.send.insert(rp);
+        }
+    }
+    result_changes.end_scan();
+    delta.add_list(result_changes);
+}
+
+// scan workunits.  These don't change,
+// but a changed result is always sent with its workunit
+//
+static void scan_wus(GUI_DELTA& delta) {
+    unsigned int i;
+    for (i=0; i<gstate.workunits.size(); i++) {
+        WORKUNIT* wup = gstate.workunits[i];
+        unsigned long long seqno = wu_changes.update(
+            wup, wup->project->master_url, wup->name, 0, false
+        );
+        if (seqno > delta.since) {
+            delta.send.insert(wup);
+        }
+    }
+    for (i=0; i<gstate.results.size(); i++) {
+        RESULT* rp = gstate.results[i];
+        if (delta.send.count(rp)) {
+            delta.send.insert(rp->wup);
+        }
+    }
+    wu_changes.end_scan();
+    delta.add_list(wu_changes);
+}
+
+static void scan_file_xfers(GUI_DELTA& delta) {
+    unsigned int i;
+    for (i=0; i<gstate.file_infos.size(); i++) {
+        FILE_INFO* fip = gstate.file_infos[i];
+        PERS_FILE_XFER* pfx = fip->pers_file_xfer;
+        if (!pfx) continue;
+        FILE_XFER_BACKOFF& fxb = fip->project->file_xfer_backoff(pfx->is_upload);
+        bool always = pfx->fxp || fxb.next_xfer_time > gstate.now;
+        GUI_HASH h;
+        if (!always) {
+            h.add(fip->status);
+            h.add(fip->download_gzipped?fip->gzipped_nbytes:fip->nbytes);
+            h.add(fip->max_nbytes);
+            h.add(pfx->nretry);
+            h.add(pfx->first_request_time);
+            h.add(pfx->next_request_time);
+            h.add(pfx->time_so_far);
+            h.add(pfx->last_bytes_xferred);
+            h.add(pfx->is_upload?1:0);
+        }
+        unsigned long long seqno = file_xfer_changes.update(
+            fip, fip->project->master_url, fip->name, h.h, always
+        );
+        if (seqno > delta.since) {
+            delta.send.insert(fip);
+        }
+    }
+    file_xfer_changes.end_scan();
+    delta.add_list(file_xfer_changes);
+}
+
+// get_state, get_results and get_file_transfers take an optional
+// <since_seqno>N</since_seqno> and <seqno_epoch>X</seqno_epoch>
+// (from the previous reply) to get only changes since then
+//
+static bool parse_delta_args(
+    GUI_RPC_CONN& grc, unsigned long long& since, double& epoch
+) {
+    bool found = false;
+    since = 0;
+    epoch = 0;
+    while (!grc.xp.get_tag()) {
+        if (grc.xp.parse_ulonglong("since_seqno", since)) {
+            found = true;
+            continue;
+        }
+        if (grc.xp.parse_double("seqno_epoch", epoch)) continue;
+    }
+    return found;
+}
+
 static void handle_get_state(GUI_RPC_CONN& grc) {
-    gstate.write_state_gui(grc.mfout);
+    unsigned long long since;
+    double epoch;
+    if (!parse_delta_args(grc, since, epoch)) {
+        gstate.write_state_gui(grc.mfout);
+        return;
+    }
+    GUI_DELTA delta(since, epoch);
+    scan_results(delta);
+    scan_wus(delta);
+    gstate.write_state_gui(grc.mfout, &delta);
 }
 
 static void handle_get_cc_config(GUI_RPC_CONN& grc) {
@@ -1232,11 +1539,32 @@ static void handle_get_old_results(GUI_RPC_CONN& grc) {
 
 static void handle_get_results(GUI_RPC_CONN& grc) {
     bool active_only = false;
+    bool delta_rpc = false;
+    unsigned long long since = 0;
+    double epoch = 0;
     while (!grc.xp.get_tag()) {
         if (grc.xp.parse_bool("active_only", active_only)) continue;
+        if (grc.xp.parse_ulonglong("since_seqno", since)) {
+            delta_rpc = true;
+            continue;
+        }
+        if (grc.xp.parse_double("seqno_epoch", epoch)) continue;
     }
     grc.mfout.printf("<results>\n");
-    gstate.write_tasks_gui(grc.mfout, active_only);
+    if (delta_rpc && !active_only) {
+        GUI_DELTA delta(since, epoch);
+        scan_results(delta);
+        delta.write_header(grc.mfout);
+        for (unsigned int i=0; i<gstate.results.size(); i++) {
+            RESULT* rp = gstate.results[i];
+            if (delta.includes(rp)) {
+                rp->write_gui(grc.mfout);
+            }
+        }
+        delta.write_deleted(grc.mfout);
+    } else {
+        gstate.write_tasks_gui(grc.mfout, active_only);
+    }
     grc.mfout.printf("</results>\n");
 }
 
@@ -1245,7 +1573,15 @@ static void handle_get_all_projects_list(GUI_RPC_CONN& grc) {
 }
 
 static void handle_get_file_transfers(GUI_RPC_CONN& grc) {
-    gstate.write_file_transfers_gui(grc.mfout);
+    unsigned long long since;
+    double epoch;
+    if (!parse_delta_args(grc, since, epoch)) {
+        gstate.write_file_transfers_gui(grc.mfout);
+        return;
+    }
+    GUI_DELTA delta(since, epoch);
+    scan_file_xfers(delta);
+    gstate.write_file_transfers_gui(grc.mfout, &delta);
 }
 
 static void handle_read_global_prefs_override(GUI_RPC_CONN& grc) {
@@ -1404,6 +1740,7 @@ GUI_RPC gui_rpcs[] = {
     GUI_RPC("get_simple_gui_info", handle_get_simple_gui_info,      false,  false,  true),
     GUI_RPC("get_state", handle_get_state,                          false,  false,  true),
     GUI_RPC("get_statistics", handle_get_statistics,                false,  false,  true),
+    GUI_RPC("subscribe_events", handle_subscribe_events,            false,  false,  true),
 
     // ops requiring local auth start here
 
@@ -1509,6 +1846,11 @@ int GUI_RPC_CONN::handle_rpc() {
     n = recv(sock, request_msg+request_nbytes, left, 0);
 #else
     n = read(sock, request_msg+request_nbytes, left);
+#endif
+#ifndef _WIN32
+    if (n < 0 && async_output && errno == EAGAIN) {
+        return 0;     // non-blocking socket, spurious wakeup
+    }
 #endif
     if (n <= 0) {
         request_nbytes = 0;
@@ -1611,10 +1953,12 @@ int GUI_RPC_CONN::handle_rpc() {
             "<?xml version=\"1.0\" encoding=\"ISO-8859-1\" ?>\n",
             n
         );
-        send(sock, buf, (int)strlen(buf), 0);
+        send_output(buf, (int)strlen(buf));
     }
     if (p) {
-        send(sock, p, n, 0);
+        if (send_output(p, n)) {
+            retval = ERR_WRITE;
+        }
         p[n-1]=0;   // replace 003 with NULL
         if (log_flags.gui_rpc_debug) {
             if (n > 128) p[128] = 0;
@@ -29,6 +29,8 @@
 #include <cstring>
 #include <sstream>
 #include <algorithm>
+#include <map>
+#include <string>
 #include <sys/stat.h>
 #include <cerrno>
 #include <unistd.h>
@@ -36,6 +38,9 @@
 #if HAVE_SYS_SOCKET_H
 #include <sys/socket.h>
 #endif
+#if HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif
 #endif
 
 #include "base64.h"
@@ -59,8 +64,18 @@
 
 using std::min;
 using std::vector;
+using std::string;
+using std::map;
 
 static CURLM* g_curlMulti = NULL;
+static CURLSH* g_curlShare = NULL;
+#ifndef USE_CURL_MULTI_POLL
+static int g_wakeup_sock = -1;
+    // a loopback UDP socket connected to itself.
+    // select() waits for it, and wakeup() sends a datagram to it.
+    // It's a socket rather than a pipe because on Windows
+    // select() works only on sockets.
+#endif
 static char g_user_agent_string[256] = {""};
 static unsigned int g_trace_count = 0;
 static bool got_expectation_failed = false;
@@ -87,6 +102,17 @@ size_t libcurl_write(void *ptr, size_t size, size_t nmemb, HTTP_OP* phop) {
     // TODO: maybe assert stRead == size*nmemb,
     // add exception handling on phop members
     //
+
+    // for a range request, anything but partial content
+    // (e.g. the whole file) would be written in the wrong place
+    //
+    if (phop->range_end) {
+        long response = 0;
+        curl_easy_getinfo(phop->curlEasy, CURLINFO_RESPONSE_CODE, &response);
+        if (response != HTTP_STATUS_PARTIAL_CONTENT) {
+            return 0;
+        }
+    }
     size_t stWrite = fwrite(ptr, size, nmemb, phop->fileOut);
     if (log_flags.http_xfer_debug) {
         msg_printf(NULL, MSG_INFO,
@@ -236,6 +262,7 @@ void HTTP_OP::reset() {
     req1 = NULL;
     req1_len = 0;
     safe_strcpy(infile, "");
+    gzip_request = false;
     safe_strcpy(outfile, "");
     safe_strcpy(error_msg, "");
     CurlResult = CURLE_OK;
@@ -251,6 +278,7 @@ void HTTP_OP::reset() {
     start_bytes_xferred = 0;
     bSentHeader = false;
     project = 0;
+    range_end = 0;
     close_socket();
 }
 
@@ -308,13 +336,37 @@ int HTTP_OP::init_get(
     return HTTP_OP::libcurl_exec(url, NULL, out, off, size, false);
 }
 
+// Initialize HTTP GET operation for part of a file;
+// bytes [start, end) are written at that position of the
+// (existing) output file.
+// The op fails if the server doesn't return partial content.
+//
+int HTTP_OP::init_get_range(
+    PROJECT* p, const char* url, const char* out, double start, double end
+) {
+    HTTP_OP::init(p);
+    file_offset = start;
+    range_end = end;
+    bytes_xferred = start;
+    start_bytes_xferred = start;
+    http_op_type = HTTP_OP_GET;
+    http_op_state = HTTP_STATE_CONNECTING;
+    if (log_flags.http_debug) {
+        msg_printf(project, MSG_INFO,
+            "[http] HTTP_OP::init_get_range(): %s bytes %.0f-%.0f",
+            url, start, end-1
+        );
+    }
+    return HTTP_OP::libcurl_exec(url, NULL, out, start, end-start, false);
+}
+
 // Initialize HTTP POST operation where
 // the input is a file, and the output is a file,
 // and both are read/written from the beginning (no resumption of partial ops)
 // This is used for scheduler requests and account mgr RPCs.
 //
 int HTTP_OP::init_post(
-    PROJECT* p, const char* url, const char* in, const char* out
+    PROJECT* p, const char* url, const char* in, const char* out, bool gzipped
 ) {
     int retval;
     double size;
@@ -328,6 +380,7 @@ int HTTP_OP::init_post(
         content_length = (int)size;
     }
     HTTP_OP::init(p);
+    gzip_request = gzipped;
     http_op_type = HTTP_OP_POST;
     http_op_state = HTTP_STATE_CONNECTING;
     if (log_flags.http_debug) {
@@ -414,6 +467,88 @@ static int set_cloexec(void*, curl_socket_t fd, curlsocktype purpose) {
 
 // the following will do an HTTP GET or POST using libcurl
 //
+// Reuse of connections.
+// Connections, TLS sessions and DNS lookups are kept in g_curlShare,
+// so a series of transfers to the same server
+// (e.g. uploading many small output files, then a scheduler RPC)
+// uses a keep-alive connection and doesn't redo the TCP and TLS handshakes.
+// In addition, easy handles of finished operations are kept
+// (up to cc_config.http_pool_size per server)
+// and reset for the next operation to that server.
+// Connections idle longer than cc_config.http_pool_idle_timeout
+// aren't reused; pooled handles idle that long are freed.
+
+struct IDLE_CURL_HANDLE {
+    CURL* handle;
+    double idle_since;
+};
+
+static map<string, vector<IDLE_CURL_HANDLE> > idle_curl_handles;
+    // key is server (scheme, host, port)
+
+static void curl_pool_key(const char* url, string& key) {
+    PARSED_URL purl;
+    char buf[512];
+    parse_url(url, purl);
+    snprintf(buf, sizeof(buf), "%d:%s:%d", purl.protocol, purl.host, purl.port);
+    key = buf;
+}
+
+static CURL* get_curl_handle(const char* url) {
+    if (cc_config.http_pool_size > 0) {
+        string key;
+        curl_pool_key(url, key);
+        vector<IDLE_CURL_HANDLE>& v = idle_curl_handles[key];
+        if (!v.empty()) {
+            CURL* c = v.back().handle;
+            v.pop_back();
+            curl_easy_reset(c);
+            return c;
+        }
+    }
+    return curl_easy_init();
+}
+
+static void release_curl_handle(const char* url, CURL* c) {
+    if (cc_config.http_pool_size > 0) {
+        string key;
+        curl_pool_key(url, key);
+        vector<IDLE_CURL_HANDLE>& v = idle_curl_handles[key];
+        if ((int)v.size() < cc_config.http_pool_size) {
+            IDLE_CURL_HANDLE ich;
+            ich.handle = c;
+            ich.idle_since = gstate.now;
+            v.push_back(ich);
+            return;
+        }
+    }
+    curl_easy_cleanup(c);
+}
+
+// free pooled handles that have been idle too long
+// (or all of them, if all is set)
+//
+static void free_idle_curl_handles(bool all) {
+    map<string, vector<IDLE_CURL_HANDLE> >::iterator i = idle_curl_handles.begin();
+    while (i != idle_curl_handles.end()) {
+        vector<IDLE_CURL_HANDLE>& v = i->second;
+        vector<IDLE_CURL_HANDLE>::iterator j = v.begin();
+        while (j != v.end()) {
+            if (all || j->idle_since < gstate.now - cc_config.http_pool_idle_timeout) {
+                curl_easy_cleanup(j->handle);
+                j = v.erase(j);
+            } else {
+                ++j;
+            }
+        }
+        if (v.empty()) {
+            idle_curl_handles.erase(i++);
+        } else {
+            ++i;
+        }
+    }
+}
+
 int HTTP_OP::libcurl_exec(
     const char* url, const char* in, const char* out, double offset,
 #ifdef _WIN32
@@ -443,7 +578,7 @@ int HTTP_OP::libcurl_exec(
         snprintf(outfile, sizeof(outfile), "http_temp_%d", outfile_seqno++);
     }
 
-    curlEasy = curl_easy_init(); // get a curl_easy handle to use
+    curlEasy = get_curl_handle(url); // get a curl_easy handle to use
     if (!curlEasy) {
         if (log_flags.http_debug) {
             msg_printf(project, MSG_INFO, "Couldn't create curlEasy handle");
@@ -457,6 +592,15 @@ int HTTP_OP::libcurl_exec(
     string_substitute(url, m_url, sizeof(m_url), " ", "%20");
     curl_easy_setopt(curlEasy, CURLOPT_URL, m_url);
 
+    if (cc_config.http_pool_size > 0 && g_curlShare) {
+        curl_easy_setopt(curlEasy, CURLOPT_SHARE, g_curlShare);
+#if LIBCURL_VERSION_NUM >= 0x074100
+        curl_easy_setopt(curlEasy, CURLOPT_MAXAGE_CONN,
+            (long)cc_config.http_pool_idle_timeout
+        );
+#endif
+    }
+
     // This option determines whether curl verifies that the server
     // claims to be who you want it to be.
     // When negotiating an SSL connection,
@@ -587,7 +731,9 @@ int HTTP_OP::libcurl_exec(
     // Per: http://curl.haxx.se/dev/readme-encoding.html
     // NULL disables, empty string accepts all.
     if (out) {
-        if (ends_with(out, ".gzt") || ends_with(out, ".gz") || ends_with(out, ".tgz")) {
+        if (range_end
+            || ends_with(out, ".gzt") || ends_with(out, ".gz") || ends_with(out, ".tgz")
+        ) {
             curl_easy_setopt(curlEasy, CURLOPT_ENCODING, NULL);
         } else {
             curl_easy_setopt(curlEasy, CURLOPT_ENCODING, "");
@@ -607,7 +753,12 @@ int HTTP_OP::libcurl_exec(
 
     // set the file offset for resumable downloads
     //
-    if (!is_post && offset>0.0f) {
+    if (!is_post && range_end) {
+        snprintf(buf, sizeof(buf), "Range: bytes=%.0f-%.0f",
+            offset, range_end-1
+        );
+        pcurlList = curl_slist_append(pcurlList, buf);
+    } else if (!is_post && offset>0.0f) {
         file_offset = offset;
         snprintf(buf, sizeof(buf), "Range: bytes=%.0f-", offset);
         pcurlList = curl_slist_append(pcurlList, buf);
@@ -616,7 +767,16 @@ int HTTP_OP::libcurl_exec(
     // set up an output file for the reply
     //
     if (strlen(outfile)) {
-        if (file_offset > 0) {
+        if (range_end) {
+            fileOut = boinc_fopen(outfile, "r+b");
+            if (fileOut) {
+#ifdef _WIN32
+                _fseeki64(fileOut, (__int64)offset, SEEK_SET);
+#else
+                fseeko(fileOut, (off_t)offset, SEEK_SET);
+#endif
+            }
+        } else if (file_offset > 0) {
             fileOut = boinc_fopen(outfile, "ab+");
         } else {
 #ifdef _WIN32
@@ -649,6 +809,9 @@ int HTTP_OP::libcurl_exec(
     if (is_post) {
         want_upload = true;
         want_download = false;
+        if (gzip_request) {
+            pcurlList = curl_slist_append(pcurlList, "Content-Encoding: gzip");
+        }
         if (infile && strlen(infile)>0) {
             fileIn = boinc_fopen(infile, "rb");
             if (!fileIn) {
@@ -907,17 +1070,65 @@ fd_set read_fds, write_fds, error_fds;
 
 // call these once at the start of the program and once at the end
 //
+#ifndef USE_CURL_MULTI_POLL
+static void wakeup_init() {
+    sockaddr_in addr;
+    BOINC_SOCKLEN_T len = sizeof(addr);
+
+    int sock = (int)socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) return;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(sock, (sockaddr*)&addr, sizeof(addr))
+        || getsockname(sock, (sockaddr*)&addr, &len)
+        || connect(sock, (sockaddr*)&addr, sizeof(addr))
+        || boinc_socket_asynch(sock, true)
+    ) {
+        boinc_close_socket(sock);
+        return;
+    }
+    g_wakeup_sock = sock;
+}
+#endif
+
 int curl_init() {
+#ifndef USE_CURL_MULTI_POLL
+    wakeup_init();
+#endif
     curl_global_init(CURL_GLOBAL_ALL);
     g_curlMulti = curl_multi_init();
+
+    // all HTTP ops are done in the main thread,
+    // so the share doesn't need lock functions
+    //
+    g_curlShare = curl_share_init();
+    if (g_curlShare) {
+        curl_share_setopt(g_curlShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(g_curlShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+        curl_share_setopt(g_curlShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+    }
     return (int)(g_curlMulti == NULL);
 }
 
 int curl_cleanup() {
+    free_idle_curl_handles(true);
     if (g_curlMulti) {
         curl_multi_cleanup(g_curlMulti);
     }
+    if (g_curlShare) {
+        curl_share_cleanup(g_curlShare);
+        g_curlShare = NULL;
+    }
     curl_global_cleanup();
+#ifndef USE_CURL_MULTI_POLL
+    if (g_wakeup_sock >= 0) {
+        boinc_close_socket(g_wakeup_sock);
+        g_wakeup_sock = -1;
+    }
+#endif
     return 0;
 }
 
@@ -935,7 +1146,7 @@ void HTTP_OP::close_socket() {
     }
     if (curlEasy && g_curlMulti) {  // release this handle
         curl_multi_remove_handle(g_curlMulti, curlEasy);
-        curl_easy_cleanup(curlEasy);
+        release_curl_handle(m_url, curlEasy);
         curlEasy = NULL;
     }
 }
@@ -959,8 +1170,62 @@ void HTTP_OP_SET::get_fdset(FDSET_GROUP& fg) {
     curl_multi_fdset(
         g_curlMulti, &fg.read_fds, &fg.write_fds, &fg.exc_fds, &fg.max_fd
     );
+#ifndef USE_CURL_MULTI_POLL
+    if (g_wakeup_sock >= 0) {
+        FD_SET(g_wakeup_sock, &fg.read_fds);
+        if (g_wakeup_sock > fg.max_fd) fg.max_fd = g_wakeup_sock;
+    }
+#endif
 }
 
+#ifdef USE_CURL_MULTI_POLL
+// Wait up to the given time for activity on curl's descriptors
+// or the given extra ones (whose revents are filled in).
+// Returns the number of descriptors with activity.
+//
+int HTTP_OP_SET::poll_wait(vector<pollfd>& pfds, double timeout) {
+    static vector<curl_waitfd> wfds;
+    unsigned int i;
+    int n = 0;
+
+    wfds.resize(pfds.size());
+    for (i=0; i<pfds.size(); i++) {
+        wfds[i].fd = pfds[i].fd;
+        wfds[i].events = 0;
+        if (pfds[i].events & POLLIN) wfds[i].events |= CURL_WAIT_POLLIN;
+        if (pfds[i].events & POLLOUT) wfds[i].events |= CURL_WAIT_POLLOUT;
+        wfds[i].revents = 0;
+    }
+    CURLMcode mc = curl_multi_poll(
+        g_curlMulti, wfds.empty()?NULL:&wfds[0], (unsigned int)wfds.size(),
+        (int)(timeout*1000), &n
+    );
+    if (mc != CURLM_OK) {
+        boinc_sleep(timeout);
+        n = 0;
+    }
+    for (i=0; i<pfds.size(); i++) {
+        // curl reports only these for extra descriptors;
+        // a closed connection shows up as readable
+        //
+        pfds[i].revents = 0;
+        if (wfds[i].revents & CURL_WAIT_POLLIN) pfds[i].revents |= POLLIN;
+        if (wfds[i].revents & CURL_WAIT_POLLOUT) pfds[i].revents |= POLLOUT;
+        if (wfds[i].revents & CURL_WAIT_POLLPRI) pfds[i].revents |= POLLPRI;
+    }
+    return n;
+}
+
+void HTTP_OP_SET::wakeup() {
+    curl_multi_wakeup(g_curlMulti);
+}
+#else
+void HTTP_OP_SET::wakeup() {
+    if (g_wakeup_sock < 0) return;
+    send(g_wakeup_sock, "w", 1, 0);
+}
+#endif
+
 // we have a message for this HTTP_OP.
 // get the response code for this request
 //
@@ -1105,7 +1370,20 @@ void HTTP_OP::handle_messages(CURLMsg *pcurlMsg) {
     }
 }
 
-void HTTP_OP_SET::got_select(FDSET_GROUP&, double timeout) {
+// a select() has returned.
+// curl finds its own ready descriptors; we just look for wakeups
+//
+void HTTP_OP_SET::got_select(FDSET_GROUP& fg, double timeout) {
+#ifndef USE_CURL_MULTI_POLL
+    if (g_wakeup_sock >= 0 && FD_ISSET(g_wakeup_sock, &fg.read_fds)) {
+        char buf[64];
+        while (recv(g_wakeup_sock, buf, sizeof(buf), 0) > 0) ;
+    }
+#endif
+    perform(timeout);
+}
+
+void HTTP_OP_SET::perform(double timeout) {
     int iNumMsg;
     HTTP_OP* hop = NULL;
     CURLMsg *pcurlMsg = NULL;
@@ -1135,6 +1413,8 @@ void HTTP_OP_SET::got_select(FDSET_GROUP&, double timeout) {
         if (!hop) continue;
         hop->handle_messages(pcurlMsg);
     }
+
+    free_idle_curl_handles(false);
 }
 
 // Return the HTTP_OP object with given Curl object
@@ -25,10 +25,22 @@
 #define BOINC_HTTP_CURL_H
 
 #include <curl/curl.h>
+#include <vector>
+#ifndef _WIN32
+#include <poll.h>
+#endif
 
 #include "network.h"
 #include "proxy_info.h"
 
+#if !defined(_WIN32) && LIBCURL_VERSION_NUM >= 0x074400
+#define USE_CURL_MULTI_POLL
+    // wait for network and GUI RPC activity with curl_multi_poll()
+    // rather than select().
+    // It's poll()-based, so there's no FD_SETSIZE limit,
+    // and its wait can be cut short from other threads
+#endif
+
 extern int curl_init();
 extern int curl_cleanup();
 
@@ -87,8 +99,13 @@ public:
         // if not NULL, send this string first
     char infile[256];
         // then (is nonempty) this file
+    bool gzip_request;
+        // infile is gzip-encoded; say so in the request header
     double file_offset;
         // starting at this offset
+    double range_end;
+        // if nonzero, GET only bytes [file_offset, range_end)
+        // and write them at that position of outfile
 
     // reply message stuff
     //
@@ -160,8 +177,13 @@ public:
         PROJECT*, const char* url, const char* outfile,
         bool del_old_file, double offset, double size
     );
+    int init_get_range(
+        PROJECT*, const char* url, const char* outfile,
+        double start, double end
+    );
     int init_post(
-        PROJECT*, const char* url, const char* infile, const char* outfile
+        PROJECT*, const char* url, const char* infile, const char* outfile,
+        bool gzipped=false
     );
     int init_post2(
         PROJECT*,
@@ -200,6 +222,15 @@ public:
 
     void get_fdset(FDSET_GROUP&);
     void got_select(FDSET_GROUP&, double);
+#ifdef USE_CURL_MULTI_POLL
+    int poll_wait(std::vector<pollfd>&, double);
+#endif
+    void perform(double);
+        // do whatever transfers are possible,
+        // and handle the ones that have finished
+    void wakeup();
+        // make the main loop's current or next wait return immediately.
+        // Can be called from any thread
     HTTP_OP* lookup_curl(CURL* pcurl);
         // lookup by easycurl handle
     void cleanup_temp_files();
@@ -190,6 +190,9 @@ void CC_CONFIG::show() {
     if (dont_check_file_sizes) {
         msg_printf(NULL, MSG_INFO, "Config: don't check file sizes");
     }
+    if (dont_dedup_files) {
+        msg_printf(NULL, MSG_INFO, "Config: don't share identical files between jobs");
+    }
     if (dont_suspend_nci) {
         msg_printf(NULL, MSG_INFO, "Config: don't suspend NCI tasks");
     }
@@ -237,6 +240,9 @@ void CC_CONFIG::show() {
     if (http_1_0) {
         msg_printf(NULL, MSG_INFO, "Config: use HTTP 1.0");
     }
+    if (http_pool_size <= 0) {
+        msg_printf(NULL, MSG_INFO, "Config: don't pool HTTP connections");
+    }
     for (int j=1; j<NPROC_TYPES; j++) {
         show_gpu_ignore(ignore_gpu_instance[j], j);
     }
@@ -252,6 +258,12 @@ void CC_CONFIG::show() {
             msg_printf(NULL, MSG_INFO, "Config: event log limit disabled");
         }
     }
+    if (max_download_segments <= 1) {
+        msg_printf(NULL, MSG_INFO, "Config: don't use segmented downloads");
+    }
+    if (max_upload_batch <= 1) {
+        msg_printf(NULL, MSG_INFO, "Config: don't batch uploads");
+    }
     if (ncpus>0) {
         msg_printf(NULL, MSG_INFO, "Config: simulate %d CPUs", cc_config.ncpus);
     }
@@ -331,6 +343,7 @@ int CC_CONFIG::parse_options_client(XML_PARSER& xp) {
             alt_platforms.push_back(s);
             continue;
         }
+        if (xp.parse_int("async_file_threads", async_file_threads)) continue;
         if (xp.match_tag("coproc")) {
             COPROC c;
             retval = c.parse(xp);
@@ -351,6 +364,7 @@ int CC_CONFIG::parse_options_client(XML_PARSER& xp) {
         if (xp.parse_bool("disallow_attach", disallow_attach)) continue;
         if (xp.parse_bool("dont_check_file_sizes", dont_check_file_sizes)) continue;
         if (xp.parse_bool("dont_contact_ref_site", dont_contact_ref_site)) continue;
+        if (xp.parse_bool("dont_dedup_files", dont_dedup_files)) continue;
         if (xp.parse_bool("lower_client_priority", lower_client_priority)) continue;
         if (xp.parse_bool("dont_suspend_nci", dont_suspend_nci)) continue;
         if (xp.parse_bool("dont_use_vbox", dont_use_vbox)) continue;
@@ -393,7 +407,10 @@ int CC_CONFIG::parse_options_client(XML_PARSER& xp) {
             downcase_string(force_auth);
             continue;
         }
+        if (xp.parse_bool("hard_link_copied_files", hard_link_copied_files)) continue;
         if (xp.parse_bool("http_1_0", http_1_0)) continue;
+        if (xp.parse_int("http_pool_idle_timeout", http_pool_idle_timeout)) continue;
+        if (xp.parse_int("http_pool_size", http_pool_size)) continue;
         if (xp.parse_int("http_transfer_timeout", http_transfer_timeout)) continue;
         if (xp.parse_int("http_transfer_timeout_bps", http_transfer_timeout_bps)) continue;
         if (xp.parse_int("ignore_cuda_dev", n)||xp.parse_int("ignore_nvidia_dev", n)) {
@@ -408,19 +425,23 @@ int CC_CONFIG::parse_options_client(XML_PARSER& xp) {
             ignore_gpu_instance[PROC_TYPE_INTEL_GPU].push_back(n);
             continue;
         }
+        if (xp.parse_int("max_download_segments", max_download_segments)) continue;
         if (xp.parse_int("max_event_log_lines", max_event_log_lines)) continue;
         if (xp.parse_int("max_file_xfers", max_file_xfers)) continue;
         if (xp.parse_int("max_file_xfers_per_project", max_file_xfers_per_project)) continue;
         if (xp.parse_int("max_stderr_file_size", max_stderr_file_size)) continue;
         if (xp.parse_int("max_stdout_file_size", max_stdout_file_size)) continue;
         if (xp.parse_int("max_tasks_reported", max_tasks_reported)) continue;
+        if (xp.parse_int("max_upload_batch", max_upload_batch)) continue;
         if (xp.parse_int("ncpus", ncpus)) continue;
         if (xp.parse_bool("no_alt_platform", no_alt_platform)) continue;
+        if (xp.parse_bool("no_cgroups", no_cgroups)) continue;
         if (xp.parse_bool("no_gpus", no_gpus)) continue;
         if (xp.parse_bool("no_info_fetch", no_info_fetch)) continue;
         if (xp.parse_bool("no_opencl", no_opencl)) continue;
         if (xp.parse_bool("no_priority_change", no_priority_change)) continue;
         if (xp.parse_bool("os_random_only", os_random_only)) continue;
+        if (xp.parse_int("prestage_jobs", prestage_jobs)) continue;
         if (xp.parse_int("process_priority", process_priority)) continue;
         if (xp.parse_int("process_priority_special", process_priority_special)) continue;
 #ifndef SIM
@@ -442,9 +463,12 @@ int CC_CONFIG::parse_options_client(XML_PARSER& xp) {
         if (xp.parse_bool("report_results_immediately", report_results_immediately)) continue;
         if (xp.parse_bool("run_apps_manually", run_apps_manually)) continue;
         if (xp.parse_int("save_stats_days", save_stats_days)) continue;
+        if (xp.parse_double("segmented_download_threshold", segmented_download_threshold)) continue;
         if (xp.parse_bool("simple_gui_only", simple_gui_only)) continue;
         if (xp.parse_bool("skip_cpu_benchmarks", skip_cpu_benchmarks)) continue;
         if (xp.parse_double("start_delay", start_delay)) continue;
+        if (xp.parse_bool("state_journal", state_journal)) continue;
+        if (xp.parse_bool("state_snapshot", state_snapshot)) continue;
         if (xp.parse_bool("stderr_head", stderr_head)) continue;
         if (xp.parse_bool("suppress_net_info", suppress_net_info)) continue;
         if (xp.parse_bool("unsigned_apps_ok", unsigned_apps_ok)) continue;
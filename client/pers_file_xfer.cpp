@@ -21,6 +21,7 @@
 #include "boinc_win.h"
 #else
 #include "config.h"
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #endif
@@ -52,6 +53,9 @@ PERS_FILE_XFER::PERS_FILE_XFER() {
     pers_xfer_done = false;
     fxp = NULL;
     fip = NULL;
+    no_segments = false;
+    md5_offset = 0;
+    md5_init(&md5_state);
 }
 
 PERS_FILE_XFER::~PERS_FILE_XFER() {
@@ -92,15 +96,16 @@ int PERS_FILE_XFER::create_xfer() {
     int retval;
 
     // if download, see if file already exists and is valid
+    // (unless we're resuming a segmented download)
     //
-    if (!is_upload) {
+    if (!is_upload && segments.empty()) {
         char pathname[256];
         get_pathname(fip, pathname, sizeof(pathname));
 
         retval = fip->verify_file(true, false, true);
         if (!retval) {
             retval = fip->set_permissions();
-            fip->status = FILE_PRESENT;
+            fip->set_status(FILE_PRESENT);
             pers_xfer_done = true;
 
             if (log_flags.file_xfer) {
@@ -118,7 +123,7 @@ int PERS_FILE_XFER::create_xfer() {
             // Mark file as not present but don't delete it.
             // It might be partly downloaded.
             //
-            fip->status = FILE_NOT_PRESENT;
+            fip->set_status(FILE_NOT_PRESENT);
         }
     }
 
@@ -131,8 +136,15 @@ int PERS_FILE_XFER::create_xfer() {
     URL_LIST& ul = fip->get_url_list(is_upload);
     file_xfer = new FILE_XFER;
     fxp = file_xfer;
-    retval = start_xfer();
-    if (!retval) retval = gstate.file_xfers->insert(file_xfer);
+    if (is_upload) {
+        add_batch_members();
+    }
+    if (use_segments()) {
+        retval = start_segments();
+    } else {
+        retval = start_xfer();
+        if (!retval) retval = gstate.file_xfers->insert(file_xfer);
+    }
     if (retval) {
         if (log_flags.http_debug) {
             msg_printf(
@@ -170,6 +182,279 @@ int PERS_FILE_XFER::create_xfer() {
     return 0;
 }
 
+// can this upload be sent in a batch with others?
+//
+bool PERS_FILE_XFER::batch_ok() {
+    if (fip->nbytes >= FILE_SIZE_CHECK_THRESHOLD) return false;
+    const char* url = fip->upload_urls.get_current_url(*fip);
+    if (!url) return false;
+    if (gstate.file_xfers->no_batch_urls.count(url)) return false;
+    char path[MAXPATHLEN];
+    get_pathname(fip, path, sizeof(path));
+    return boinc_file_exists(path);
+}
+
+// We're about to start a small upload.
+// Add other small uploads from the project to the same URL
+// that are ready to start, so that they're sent in the same request
+//
+void PERS_FILE_XFER::add_batch_members() {
+    unsigned int i;
+
+    if (cc_config.max_upload_batch <= 1) return;
+    if (!batch_ok()) return;
+    const char* url = fip->upload_urls.get_current_url(*fip);
+    FILE_XFER_BACKOFF& fxb = fip->project->file_xfer_backoff(true);
+    vector<PERS_FILE_XFER*>& pfxs = gstate.pers_file_xfers->pers_file_xfers;
+    for (i=0; i<pfxs.size(); i++) {
+        if ((int)fxp->batch.size()+1 >= cc_config.max_upload_batch) break;
+        PERS_FILE_XFER* pfx = pfxs[i];
+        if (pfx == this) continue;
+        if (!pfx->is_upload) continue;
+        if (pfx->pers_xfer_done || pfx->fxp) continue;
+        if (pfx->fip->project != fip->project) continue;
+        if (gstate.now < pfx->next_request_time) continue;
+        if (!fxb.ok_to_transfer() && pfx->nretry>0) continue;
+        if (!pfx->batch_ok()) continue;
+        if (strcmp(url, pfx->fip->upload_urls.get_current_url(*pfx->fip))) {
+            continue;
+        }
+        FILE_XFER* mfxp = new FILE_XFER;
+        mfxp->add_to_batch(fxp, *pfx->fip);
+        pfx->fxp = mfxp;
+        pfx->last_time = gstate.now;
+        if (log_flags.file_xfer) {
+            msg_printf(
+                fip->project, MSG_INFO, "Started upload of %s (with %s)",
+                pfx->fip->name, fip->name
+            );
+        }
+    }
+}
+
+int DOWNLOAD_SEGMENT::parse(XML_PARSER& xp) {
+    start = end = nbytes_done = 0;
+    while (!xp.get_tag()) {
+        if (xp.match_tag("/segment")) return 0;
+        if (xp.parse_double("start", start)) continue;
+        if (xp.parse_double("end", end)) continue;
+        if (xp.parse_double("nbytes_done", nbytes_done)) continue;
+    }
+    return ERR_XML_PARSE;
+}
+
+static int seek_file(FILE* f, double offset) {
+#ifdef _WIN32
+    return _fseeki64(f, (__int64)offset, SEEK_SET);
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET);
+#endif
+}
+
+// should this download be done in segments?
+//
+bool PERS_FILE_XFER::use_segments() {
+    char path[MAXPATHLEN];
+    double size;
+
+    if (is_upload) return false;
+    if (no_segments) return false;
+    if (segments.size()) return true;
+    if (cc_config.max_download_segments <= 1) return false;
+    if (fip->nbytes < cc_config.segmented_download_threshold) return false;
+    if (fip->download_gzipped) return false;
+
+    // finish a partial download the usual way
+    //
+    get_pathname(fip, path, sizeof(path));
+    if (!file_size(path, size) && size > 0) return false;
+    return true;
+}
+
+// Start a segmented download:
+// divide the file into segments if we haven't already,
+// and start a FILE_XFER for each unfinished segment,
+// using the file's URLs in turn.
+// fxp tracks the download as a whole; it isn't an HTTP op.
+//
+int PERS_FILE_XFER::start_segments() {
+    char path[MAXPATHLEN];
+    unsigned int i;
+    int retval, n=0;
+
+    get_pathname(fip, path, sizeof(path));
+    if (segments.empty() || !boinc_file_exists(path)) {
+        FILE* f = boinc_fopen(path, "wb");
+        if (!f) return ERR_FOPEN;
+        fclose(f);
+        segments.clear();
+        int nsegs = cc_config.max_download_segments;
+        double size = ceil(fip->nbytes/nsegs);
+        for (i=0; i<(unsigned int)nsegs; i++) {
+            DOWNLOAD_SEGMENT seg;
+            seg.start = i*size;
+            seg.end = std::min(fip->nbytes, seg.start + size);
+            seg.nbytes_done = 0;
+            if (seg.start >= seg.end) break;
+            segments.push_back(seg);
+        }
+        md5_offset = 0;
+        md5_init(&md5_state);
+    }
+
+    URL_LIST& ul = fip->download_urls;
+    const char* url = ul.get_current_url(*fip);
+    if (!url) return ERR_INVALID_URL;
+    fxp->fip = fip;
+    fxp->segmented = true;
+    safe_strcpy(fxp->m_url, url);
+    for (i=0; i<segments.size(); i++) {
+        DOWNLOAD_SEGMENT& seg = segments[i];
+        if (seg.done()) continue;
+        int k = (ul.current_index + n) % (int)ul.urls.size();
+        FILE_XFER* sxp = new FILE_XFER;
+        retval = sxp->init_download_segment(
+            *fip, i, seg.start + seg.nbytes_done, seg.end, ul.urls[k].c_str()
+        );
+        if (retval) {
+            delete sxp;
+            return retval;
+        }
+        gstate.file_xfers->insert(sxp);
+        sxp->segment_of = fxp;
+        fxp->segment_xfers.push_back(sxp);
+        n++;
+    }
+    if (log_flags.file_xfer_debug) {
+        msg_printf(fip->project, MSG_INFO,
+            "[file_xfer] downloading %s in %d segments (%d started)",
+            fip->name, (int)segments.size(), n
+        );
+    }
+    return 0;
+}
+
+// extend the MD5 of a segmented download
+// over the contiguous downloaded part of the file
+//
+void PERS_FILE_XFER::update_segment_md5() {
+    char path[MAXPATHLEN];
+    unsigned char buf[64*1024];
+    double end = 0;
+    unsigned int i;
+
+    for (i=0; i<segments.size(); i++) {
+        DOWNLOAD_SEGMENT& seg = segments[i];
+        end = seg.start + seg.nbytes_done;
+        if (!seg.done()) break;
+    }
+    end = std::min(end, md5_offset + SEGMENT_MD5_CHUNK);
+    if (end <= md5_offset) return;
+
+    get_pathname(fip, path, sizeof(path));
+    FILE* f = boinc_fopen(path, "rb");
+    if (!f) return;
+    if (!seek_file(f, md5_offset)) {
+        while (md5_offset < end) {
+            size_t n = (size_t)std::min((double)sizeof(buf), end - md5_offset);
+            n = fread(buf, 1, n, f);
+            if (!n) break;
+            md5_append(&md5_state, buf, (int)n);
+            md5_offset += n;
+        }
+    }
+    fclose(f);
+}
+
+// Check on a segmented download.
+// If a segment fails, or if all are done and we have the MD5,
+// mark fxp as done; poll() then handles it like any other transfer
+//
+void PERS_FILE_XFER::poll_segments() {
+    unsigned int i;
+    double nbytes = 0, speed = 0;
+    int retval = 0;
+    bool no_range = false;
+
+    for (i=0; i<fxp->segment_xfers.size(); i++) {
+        FILE_XFER* sxp = fxp->segment_xfers[i];
+        DOWNLOAD_SEGMENT& seg = segments[sxp->segment];
+
+        // flush, so that the bytes we count are in the file
+        //
+        if (sxp->fileOut) {
+            fflush(sxp->fileOut);
+        }
+        seg.nbytes_done = sxp->bytes_xferred - seg.start;
+        speed += sxp->xfer_speed;
+        if (!sxp->file_xfer_done) continue;
+
+        if (sxp->response == HTTP_STATUS_OK) {
+            no_range = true;
+            break;
+        } else if (sxp->response >= 500) {
+            retval = ERR_HTTP_TRANSIENT;
+        } else if (sxp->response >= 400) {
+            retval = ERR_HTTP_PERMANENT;
+        } else if (sxp->file_xfer_retval) {
+            retval = sxp->file_xfer_retval;
+        } else if (!seg.done()) {
+            retval = ERR_HTTP_TRANSIENT;
+        }
+        if (retval) break;
+        gstate.file_xfers->remove(sxp);
+        delete sxp;
+        i--;
+    }
+
+    if (no_range) {
+        // The server sent the whole file.
+        // Start over, and download it as a single stream
+        //
+        char path[MAXPATHLEN];
+        while (fxp->segment_xfers.size()) {
+            FILE_XFER* sxp = fxp->segment_xfers[0];
+            gstate.file_xfers->remove(sxp);
+            delete sxp;
+        }
+        segments.clear();
+        no_segments = true;
+        get_pathname(fip, path, sizeof(path));
+        boinc_delete_file(path);
+        if (log_flags.file_xfer) {
+            msg_printf(fip->project, MSG_INFO,
+                "Server doesn't support range requests; restarting download of %s",
+                fip->name
+            );
+        }
+        retval = ERR_RETRY;
+    }
+    if (retval) {
+        fxp->file_xfer_retval = retval;
+        fxp->file_xfer_done = true;
+        return;
+    }
+
+    for (i=0; i<segments.size(); i++) {
+        nbytes += segments[i].nbytes_done;
+    }
+    fxp->bytes_xferred = nbytes;
+    fxp->xfer_speed = speed;
+
+    update_segment_md5();
+    if (fxp->segment_xfers.empty() && md5_offset >= fip->nbytes) {
+        unsigned char binout[16];
+        md5_finish(&md5_state, binout);
+        for (i=0; i<16; i++) {
+            sprintf(fip->download_md5+2*i, "%02x", binout[i]);
+        }
+        fip->download_md5[32] = 0;
+        segments.clear();
+        fxp->file_xfer_retval = 0;
+        fxp->file_xfer_done = true;
+    }
+}
+
 // Poll the status of this persistent file transfer.
 // If it's time to start it, then attempt to start it.
 // If it has finished or failed:
@@ -207,6 +492,10 @@ bool PERS_FILE_XFER::poll() {
         return false;
     }
 
+    if (fxp->segmented && !fxp->file_xfer_done) {
+        poll_segments();
+    }
+
     // copy bytes_xferred for use in GUI
     //
     last_bytes_xferred = fxp->bytes_xferred;
@@ -253,6 +542,13 @@ bool PERS_FILE_XFER::poll() {
         case ERR_UPLOAD_PERMANENT:
             permanent_failure(fxp->file_xfer_retval);
             break;
+        case ERR_RETRY:
+            // this was part of a batch upload that didn't happen,
+            // or the server handled only the first file,
+            // or a segmented download that the server didn't support.
+            // Start over right away.
+            //
+            break;
         case ERR_NOT_FOUND:
         case ERR_HTTP_PERMANENT:
             if (is_upload) {
@@ -312,7 +608,7 @@ void PERS_FILE_XFER::permanent_failure(int retval) {
         gstate.file_xfers->remove(fxp);
         delete fxp;
         fxp = NULL;
-        fip->status = retval;
+        fip->set_status(retval);
         pers_xfer_done = true;
         if (log_flags.file_xfer) {
             msg_printf(
@@ -389,7 +685,7 @@ void PERS_FILE_XFER::abort() {
         delete fxp;
         fxp = NULL;
     }
-    fip->status = ERR_ABORTED_VIA_GUI;
+    fip->set_status(ERR_ABORTED_VIA_GUI);
     fip->error_msg = "user requested transfer abort";
     pers_xfer_done = true;
 }
@@ -409,6 +705,13 @@ int PERS_FILE_XFER::parse(XML_PARSER& xp) {
         else if (xp.parse_double("time_so_far", time_so_far)) continue;
         else if (xp.parse_double("last_bytes_xferred", last_bytes_xferred)) continue;
         else if (xp.parse_bool("is_upload", is_upload)) continue;
+        else if (xp.match_tag("segment")) {
+            DOWNLOAD_SEGMENT seg;
+            if (!seg.parse(xp)) {
+                segments.push_back(seg);
+            }
+            continue;
+        }
         else {
             if (log_flags.unparsed_xml) {
                 msg_printf(NULL, MSG_INFO,
@@ -421,6 +724,18 @@ int PERS_FILE_XFER::parse(XML_PARSER& xp) {
     return ERR_XML_PARSE;
 }
 
+// copy the fields written to the state file;
+// used when replaying the state file journal
+//
+void PERS_FILE_XFER::copy_state_fields(PERS_FILE_XFER& p) {
+    nretry = p.nretry;
+    first_request_time = p.first_request_time;
+    next_request_time = p.next_request_time;
+    time_so_far = p.time_so_far;
+    last_bytes_xferred = p.last_bytes_xferred;
+    segments = p.segments;
+}
+
 // Write XML information about a persistent file transfer
 //
 int PERS_FILE_XFER::write(MIOFILE& fout) {
@@ -431,8 +746,7 @@ int PERS_FILE_XFER::write(MIOFILE& fout) {
         "        <next_request_time>%f</next_request_time>\n"
         "        <time_so_far>%f</time_so_far>\n"
         "        <last_bytes_xferred>%f</last_bytes_xferred>\n"
-        "        <is_upload>%d</is_upload>\n"
-        "    </persistent_file_xfer>\n",
+        "        <is_upload>%d</is_upload>\n",
         nretry,
         first_request_time,
         next_request_time,
@@ -440,6 +754,18 @@ int PERS_FILE_XFER::write(MIOFILE& fout) {
         last_bytes_xferred,
         is_upload?1:0
     );
+    for (unsigned int i=0; i<segments.size(); i++) {
+        DOWNLOAD_SEGMENT& seg = segments[i];
+        fout.printf(
+            "        <segment>\n"
+            "            <start>%.0f</start>\n"
+            "            <end>%.0f</end>\n"
+            "            <nbytes_done>%.0f</nbytes_done>\n"
+            "        </segment>\n",
+            seg.start, seg.end, seg.nbytes_done
+        );
+    }
+    fout.printf("    </persistent_file_xfer>\n");
 
     // the following is for GUI RPCs
     //
@@ -494,16 +820,22 @@ bool PERS_FILE_XFER_SET::poll() {
     // try to finish ones we've already started
     //
     for (i=0; i<pers_file_xfers.size(); i++) {
-        if (!pers_file_xfers[i]->last_bytes_xferred) continue;
-        action |= pers_file_xfers[i]->poll();
+        PERS_FILE_XFER* pfx = pers_file_xfers[i];
+        if (!pfx->last_bytes_xferred) continue;
+        if (pfx->poll()) {
+            gstate.set_file_info_dirty(pfx->fip, "pers_file_xfer_set poll");
+            action = true;
+        }
     }
     for (i=0; i<pers_file_xfers.size(); i++) {
-        if (pers_file_xfers[i]->last_bytes_xferred) continue;
-        action |= pers_file_xfers[i]->poll();
+        PERS_FILE_XFER* pfx = pers_file_xfers[i];
+        if (pfx->last_bytes_xferred) continue;
+        if (pfx->poll()) {
+            gstate.set_file_info_dirty(pfx->fip, "pers_file_xfer_set poll");
+            action = true;
+        }
     }
 
-    if (action) gstate.set_client_state_dirty("pers_file_xfer_set poll");
-
     return action;
 }
 
@@ -525,6 +857,9 @@ int PERS_FILE_XFER_SET::remove(PERS_FILE_XFER* pfx) {
     while (iter != pers_file_xfers.end()) {
         if (*iter == pfx) {
             iter = pers_file_xfers.erase(iter);
+#ifndef SIM
+            gstate.gui_rpcs.transfer_done_event(pfx);
+#endif
             return 0;
         }
         ++iter;
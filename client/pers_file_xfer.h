@@ -18,6 +18,10 @@
 #ifndef BOINC_PERS_FILE_XFER_H
 #define BOINC_PERS_FILE_XFER_H
 
+#include <vector>
+
+#include "md5.h"
+
 #include "client_types.h"
 #include "file_xfer.h"
 
@@ -29,6 +33,30 @@
 #define PERS_GIVEUP             (SECONDS_PER_DAY*90)
     // give up on xfer if this time elapses since last byte xferred
 
+#define SEGMENT_MD5_CHUNK   (32*MEGA)
+    // for segmented downloads, compute the MD5 of at most
+    // this many bytes per poll
+
+// Large downloads may be split into byte ranges ("segments")
+// fetched concurrently, possibly from different URLs,
+// each written directly to its place in the file.
+// Progress is saved in the state file so that segments can be resumed.
+// The MD5 of the file is computed as the downloaded prefix grows,
+// so the file doesn't have to be read again to verify it.
+//
+struct DOWNLOAD_SEGMENT {
+    double start;
+    double end;
+        // the segment is bytes [start, end) of the file
+    double nbytes_done;
+        // bytes downloaded, starting at start
+
+    bool done() {
+        return start + nbytes_done >= end;
+    }
+    int parse(XML_PARSER&);
+};
+
 // PERS_FILE_XFER represents a "persistent file transfer",
 // i.e. a long-term effort to upload or download a file.
 // This may consist of several "episodes",
@@ -78,13 +106,13 @@
 //   zeroed in PERS_FILE_XFER destructor
 
 class PERS_FILE_XFER {
+    void do_backoff();
+
+public:
     int nretry;
         // # of retries so far
     double first_request_time;
         // time of first transfer request
-    void do_backoff();
-
-public:
     bool is_upload;
     double next_request_time;
         // time to next retry the file request
@@ -102,6 +130,13 @@ public:
     FILE_XFER* fxp;
         // nonzero if file xfer in progress
     FILE_INFO* fip;
+    std::vector<DOWNLOAD_SEGMENT> segments;
+        // if nonempty, a segmented download
+    bool no_segments;
+        // a server didn't honor a range request; don't use segments
+    double md5_offset;
+    md5_state_t md5_state;
+        // for segmented downloads: MD5 state for the first md5_offset bytes
 
     PERS_FILE_XFER();
     ~PERS_FILE_XFER();
@@ -112,8 +147,15 @@ public:
     void abort();
     int write(MIOFILE& fout);
     int parse(XML_PARSER&);
+    void copy_state_fields(PERS_FILE_XFER&);
     int create_xfer();
     int start_xfer();
+    bool batch_ok();
+    void add_batch_members();
+    bool use_segments();
+    int start_segments();
+    void poll_segments();
+    void update_segment_md5();
     void suspend();
 };
 
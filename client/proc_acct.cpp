@@ -0,0 +1,480 @@
+// This file is part of BOINC.
+// http://boinc.berkeley.edu
+// Copyright (C) 2026 University of California
+//
+// BOINC is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation,
+// either version 3 of the License, or (at your option) any later version.
+//
+// BOINC is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with BOINC.  If not, see <http://www.gnu.org/licenses/>.
+
+// incremental accounting of task resource usage; see proc_acct.h
+
+#include "config.h"
+
+#ifdef __linux__
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <sys/param.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "error_numbers.h"
+#include "filesys.h"
+#include "str_replace.h"
+#include "str_util.h"
+#include "util.h"
+
+#include "app.h"
+#include "client_msgs.h"
+#include "client_state.h"
+#include "log_flags.h"
+#include "result.h"
+
+#include "proc_acct.h"
+
+using std::string;
+using std::vector;
+
+#define CGROUP_ROOT "/sys/fs/cgroup"
+#define CLIENT_CGROUP_NAME "client"
+    // leaf cgroup the client moves itself into
+
+#define PROC_TREE_RESCAN_PERIODS 6
+    // if we can't find new child processes directly,
+    // do a full scan this often
+
+static bool initialized = false;
+static bool have_children_files = false;
+static bool use_cgroups = false;
+static string cgroup_base;
+    // the cgroup we were started in;
+    // the client's cgroup and the tasks' are its children
+static int scan_count = 0;
+static bool task_started = false;
+static bool task_exited = false;
+
+// write a cgroup control file.
+// Use plain system calls since this is called in a newly forked process.
+//
+static int write_cgroup_file(const char* dir, const char* name, const char* val) {
+    char path[MAXPATHLEN];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    int fd = open(path, O_WRONLY);
+    if (fd < 0) return ERR_FOPEN;
+    ssize_t n = write(fd, val, strlen(val));
+    close(fd);
+    if (n != (ssize_t)strlen(val)) return ERR_WRITE;
+    return 0;
+}
+
+// see if we can run tasks in their own cgroups (v2).
+// We need to be the only process in a cgroup that we own,
+// and the memory controller must be available for its children.
+// Move ourselves to a leaf cgroup and enable the memory controller.
+//
+static bool init_cgroups() {
+    char buf[4096];
+    string path, s;
+    struct stat sbuf;
+
+    if (cc_config.no_cgroups) return false;
+    if (!boinc_file_exists(CGROUP_ROOT "/cgroup.controllers")) return false;
+
+    FILE* f = fopen("/proc/self/cgroup", "r");
+    if (!f) return false;
+    while (fgets(buf, sizeof(buf), f)) {
+        if (strstr(buf, "0::") == buf) {
+            strip_whitespace(buf);
+            path = buf+3;
+            break;
+        }
+    }
+    fclose(f);
+    if (path.empty() || path == "/") return false;
+    cgroup_base = string(CGROUP_ROOT) + path;
+
+    if (stat(cgroup_base.c_str(), &sbuf)) return false;
+    if (sbuf.st_uid != geteuid()) return false;
+    if (access(cgroup_base.c_str(), W_OK)) return false;
+
+    if (read_file_string((cgroup_base + "/cgroup.procs").c_str(), s)) {
+        return false;
+    }
+    if (atoi(s.c_str()) != getpid() || s.find('\n') != s.rfind('\n')) {
+        // there are other processes in our cgroup
+        //
+        return false;
+    }
+    if (read_file_string((cgroup_base + "/cgroup.controllers").c_str(), s)) {
+        return false;
+    }
+    if (s.find("memory") == string::npos) return false;
+
+    string client_dir = cgroup_base + "/" + CLIENT_CGROUP_NAME;
+    if (mkdir(client_dir.c_str(), 0755) && !is_dir(client_dir.c_str())) {
+        return false;
+    }
+    snprintf(buf, sizeof(buf), "%d", getpid());
+    if (write_cgroup_file(client_dir.c_str(), "cgroup.procs", buf)) {
+        return false;
+    }
+    if (write_cgroup_file(cgroup_base.c_str(), "cgroup.subtree_control", "+memory")) {
+        write_cgroup_file(cgroup_base.c_str(), "cgroup.procs", buf);
+        return false;
+    }
+    return true;
+}
+
+static void init() {
+    char path[MAXPATHLEN];
+    if (initialized) return;
+    initialized = true;
+    snprintf(path, sizeof(path), "/proc/%d/task/%d/children", getpid(), getpid());
+    have_children_files = boinc_file_exists(path);
+    use_cgroups = init_cgroups();
+    if (log_flags.mem_usage_debug) {
+        if (use_cgroups) {
+            msg_printf(NULL, MSG_INFO,
+                "[mem_usage] running tasks in cgroups under %s",
+                cgroup_base.c_str()
+            );
+        } else {
+            msg_printf(NULL, MSG_INFO,
+                "[mem_usage] not using cgroups; tracking task processes%s",
+                have_children_files?"":" (with periodic full scans)"
+            );
+        }
+    }
+}
+
+bool proc_acct_full_scan() {
+    init();
+    if (cc_config.exclusive_apps.size()) return true;
+    if (cc_config.exclusive_gpu_apps.size()) return true;
+    if (have_children_files) return false;
+
+    // a new task's children are probably created right away
+    //
+    if (task_started) {
+        task_started = false;
+        scan_count = 1;
+        return true;
+    }
+    return (scan_count++ % PROC_TREE_RESCAN_PERIODS) == 0;
+}
+
+// replace a task's process map with a new one.
+// Add the CPU time and page faults of processes that went away
+// (or whose PIDs were reused) to the task's exited totals.
+//
+static void set_procs(PROC_ACCT& pa, PROC_MAP& pm) {
+    PROC_MAP::iterator i, j;
+    for (i=pa.procs.begin(); i!=pa.procs.end(); ++i) {
+        PROCINFO& old = i->second;
+        j = pm.find(i->first);
+        if (j != pm.end()) {
+            PROCINFO& p = j->second;
+            if (p.user_time + p.kernel_time >= old.user_time + old.kernel_time) {
+                continue;
+            }
+        }
+        pa.exited_user_time += old.user_time;
+        pa.exited_kernel_time += old.kernel_time;
+        pa.exited_page_fault_count += old.page_fault_count;
+    }
+    pa.procs.swap(pm);
+}
+
+static void get_roots(ACTIVE_TASK* atp, bool include_main, vector<int>& roots) {
+    roots.clear();
+    if (include_main) roots.push_back(atp->pid);
+    for (unsigned int i=0; i<atp->other_pids.size(); i++) {
+        roots.push_back(atp->other_pids[i]);
+    }
+}
+
+// read the task's process tree, starting from the given roots
+//
+static void read_procs(ACTIVE_TASK* atp, vector<int>& roots, PROC_MAP& pm) {
+    PROC_MAP::iterator i;
+    unsigned int k;
+    vector<int> pids = roots;
+
+    if (have_children_files) {
+        for (k=0; k<pids.size(); k++) {
+            PROCINFO p;
+            if (pm.count(pids[k])) continue;
+            if (procinfo_pid(pids[k], p)) continue;
+            pm.insert(std::pair<int, PROCINFO>(p.id, p));
+            procinfo_children(pids[k], pids);
+        }
+        return;
+    }
+
+    // re-read the processes we know about,
+    // and drop those that are no longer in the tree
+    //
+    for (i=atp->proc_acct.procs.begin(); i!=atp->proc_acct.procs.end(); ++i) {
+        pids.push_back(i->first);
+    }
+    for (k=0; k<pids.size(); k++) {
+        PROCINFO p;
+        if (pm.count(pids[k])) continue;
+        if (procinfo_pid(pids[k], p)) continue;
+        pm.insert(std::pair<int, PROCINFO>(p.id, p));
+    }
+    bool found;
+    do {
+        found = false;
+        for (i=pm.begin(); i!=pm.end(); ) {
+            if (!in_vector(i->first, roots) && !pm.count(i->second.parentid)) {
+                pm.erase(i++);
+                found = true;
+            } else {
+                ++i;
+            }
+        }
+    } while (found);
+}
+
+// add up a process map as procinfo_app() does:
+// sum for the roots, max memory over descendants
+//
+static void add_procs(PROCINFO& pi, PROC_MAP& pm, vector<int>& roots) {
+    PROC_MAP::iterator i;
+    double swap = 0, wss = 0;
+    for (i=pm.begin(); i!=pm.end(); ++i) {
+        PROCINFO& p = i->second;
+        pi.user_time += p.user_time;
+        pi.kernel_time += p.kernel_time;
+        pi.page_fault_count += p.page_fault_count;
+        if (in_vector(p.id, roots)) {
+            pi.swap_size += p.swap_size;
+            pi.working_set_size += p.working_set_size;
+        } else {
+            if (p.swap_size > swap) swap = p.swap_size;
+            if (p.working_set_size > wss) wss = p.working_set_size;
+        }
+    }
+    if (swap > pi.swap_size) pi.swap_size = swap;
+    if (wss > pi.working_set_size) pi.working_set_size = wss;
+}
+
+// read a cgroup's memory.stat and cpu.stat
+//
+static int read_cgroup(const string& dir, PROCINFO& pi) {
+    char buf[256], name[64];
+    double x, anon=0, mapped=0, swap=0;
+    bool found = false;
+
+    FILE* f = fopen((dir + "/memory.stat").c_str(), "r");
+    if (!f) return ERR_FOPEN;
+    while (fgets(buf, sizeof(buf), f)) {
+        if (sscanf(buf, "%63s %lf", name, &x) != 2) continue;
+        if (!strcmp(name, "anon")) {
+            anon = x;
+            found = true;
+        } else if (!strcmp(name, "file_mapped")) {
+            mapped = x;
+        } else if (!strcmp(name, "pgfault")) {
+            pi.page_fault_count += (unsigned long)x;
+        }
+    }
+    fclose(f);
+    if (!found) return ERR_NULL;
+
+    f = fopen((dir + "/memory.swap.current").c_str(), "r");
+    if (f) {
+        if (fscanf(f, "%lf", &x) == 1) swap = x;
+        fclose(f);
+    }
+
+    f = fopen((dir + "/cpu.stat").c_str(), "r");
+    if (!f) return ERR_FOPEN;
+    while (fgets(buf, sizeof(buf), f)) {
+        if (sscanf(buf, "%63s %lf", name, &x) != 2) continue;
+        if (!strcmp(name, "user_usec")) {
+            pi.user_time += x/1e6;
+        } else if (!strcmp(name, "system_usec")) {
+            pi.kernel_time += x/1e6;
+        }
+    }
+    fclose(f);
+
+    // count resident anonymous and mapped file pages, like RSS.
+    // memory.current also includes page cache
+    // (e.g. from reading input files) which we don't want.
+    //
+    pi.working_set_size += anon + mapped;
+    pi.swap_size += anon + swap;
+    return 0;
+}
+
+static bool cgroup_has_pid(const string& dir, int pid) {
+    string s;
+    if (read_file_string((dir + "/cgroup.procs").c_str(), s)) return false;
+    const char* p = s.c_str();
+    while (*p) {
+        char* q;
+        long n = strtol(p, &q, 10);
+        if (q == p) break;
+        if (n == pid) return true;
+        p = q;
+    }
+    return false;
+}
+
+int proc_acct_task(ACTIVE_TASK* atp, PROCINFO& pi) {
+    PROC_ACCT& pa = atp->proc_acct;
+    vector<int> roots;
+    PROC_MAP pm;
+    int retval;
+
+    init();
+    if (!pa.cgroup_dir.empty()) {
+        if (!pa.in_cgroup && !cgroup_has_pid(pa.cgroup_dir, atp->pid)) {
+            // the task didn't get into its cgroup;
+            // fall back to tracking its processes
+            //
+            if (log_flags.mem_usage_debug) {
+                msg_printf(atp->result->project, MSG_INFO,
+                    "[mem_usage] %s is not in its cgroup",
+                    atp->result->name
+                );
+            }
+            rmdir(pa.cgroup_dir.c_str());
+            pa.cgroup_dir.clear();
+            task_exited = true;
+        } else {
+            pa.in_cgroup = true;
+            retval = read_cgroup(pa.cgroup_dir, pi);
+            if (retval) return retval;
+        }
+    }
+
+    // processes outside the cgroup, or all of them if none
+    //
+    get_roots(atp, pa.cgroup_dir.empty(), roots);
+    if (roots.empty()) return 0;
+    read_procs(atp, roots, pm);
+    set_procs(pa, pm);
+    add_procs(pi, pa.procs, roots);
+    pi.user_time += pa.exited_user_time;
+    pi.kernel_time += pa.exited_kernel_time;
+    pi.page_fault_count += pa.exited_page_fault_count;
+    return 0;
+}
+
+void proc_acct_update(ACTIVE_TASK* atp, PROC_MAP& pm) {
+    PROC_ACCT& pa = atp->proc_acct;
+    vector<int> pids;
+    PROC_MAP tree;
+    unsigned int k, j;
+
+    if (have_children_files) return;
+    get_roots(atp, pa.cgroup_dir.empty(), pids);
+    for (k=0; k<pids.size(); k++) {
+        PROC_MAP::iterator i = pm.find(pids[k]);
+        if (i == pm.end()) continue;
+        if (tree.count(pids[k])) continue;
+        tree.insert(*i);
+        for (j=0; j<i->second.children.size(); j++) {
+            pids.push_back(i->second.children[j]);
+        }
+    }
+    set_procs(pa, tree);
+}
+
+int proc_acct_non_boinc_cpu_time(double& t, double boinc_time, bool& valid) {
+    struct rusage ru;
+    double total;
+    int retval = procinfo_system_cpu_time(total);
+    if (retval) return retval;
+
+    // the client's own CPU time
+    //
+    getrusage(RUSAGE_SELF, &ru);
+    boinc_time += ru.ru_stime.tv_sec + ru.ru_stime.tv_usec/1e6;
+    if (getpriority(PRIO_PROCESS, 0) <= 0) {
+        boinc_time += ru.ru_utime.tv_sec + ru.ru_utime.tv_usec/1e6;
+    }
+    t = total - boinc_time;
+
+    // if a task exited since the last call,
+    // its CPU time is no longer in boinc_time,
+    // so the difference isn't meaningful
+    //
+    valid = !task_exited;
+    task_exited = false;
+    return 0;
+}
+
+int proc_acct_create_cgroup(ACTIVE_TASK* atp) {
+    char buf[256];
+    PROC_ACCT& pa = atp->proc_acct;
+
+    init();
+    pa.clear();
+    if (!use_cgroups) {
+        task_started = true;
+        return 0;
+    }
+    snprintf(buf, sizeof(buf), "/slot_%d", atp->slot);
+    string dir = cgroup_base + buf;
+
+    // if the slot's cgroup is left over from an earlier task,
+    // recreate it so that its counts start from zero.
+    // If that fails, processes of the earlier task are still there;
+    // don't use a cgroup for this task.
+    //
+    if (is_dir(dir.c_str())) rmdir(dir.c_str());
+    if (mkdir(dir.c_str(), 0755)) {
+        if (log_flags.mem_usage_debug) {
+            msg_printf(atp->result->project, MSG_INFO,
+                "[mem_usage] can't create cgroup %s", dir.c_str()
+            );
+        }
+        return ERR_MKDIR;
+    }
+    pa.cgroup_dir = dir;
+    return 0;
+}
+
+void proc_acct_enter_cgroup(ACTIVE_TASK* atp) {
+    char buf[256];
+    if (atp->proc_acct.cgroup_dir.empty()) return;
+    snprintf(buf, sizeof(buf), "%d", getpid());
+    if (write_cgroup_file(atp->proc_acct.cgroup_dir.c_str(), "cgroup.procs", buf)) {
+        perror("cgroup.procs");
+    }
+}
+
+void proc_acct_task_exited(ACTIVE_TASK* atp) {
+    PROC_ACCT& pa = atp->proc_acct;
+    if (!pa.cgroup_dir.empty()) {
+        // this fails if processes are left in the cgroup;
+        // we'll reuse it for the next task in this slot
+        //
+        rmdir(pa.cgroup_dir.c_str());
+    }
+    pa.clear();
+    task_exited = true;
+}
+
+#endif
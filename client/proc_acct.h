@@ -0,0 +1,108 @@
+// This file is part of BOINC.
+// http://boinc.berkeley.edu
+// Copyright (C) 2026 University of California
+//
+// BOINC is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation,
+// either version 3 of the License, or (at your option) any later version.
+//
+// BOINC is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with BOINC.  If not, see <http://www.gnu.org/licenses/>.
+
+// Incremental accounting of the memory and CPU usage of tasks (Linux).
+//
+// On other platforms, ACTIVE_TASK_SET::get_memory_usage() enumerates
+// all processes in the system every MEMORY_USAGE_PERIOD seconds
+// and finds each task's descendants.
+// On Linux we look only at the tasks' own processes:
+//
+// - If the client has been given a cgroup v2 subtree
+//   (e.g. systemd with Delegate=yes) each task runs in its own cgroup
+//   (slot_N, a sibling of the client's own leaf cgroup),
+//   and we read its memory.stat and cpu.stat.
+//   This also covers processes that have left the task's process tree.
+// - Otherwise we keep each task's process tree
+//   and re-read /proc/PID/stat for just those processes.
+//   New descendants are found via /proc/PID/task/TID/children;
+//   if the kernel lacks these, the tree is refreshed from
+//   a full scan every few periods.
+//
+// Non-BOINC CPU usage is derived from /proc/stat
+// minus the CPU time of tasks and the client.
+//
+// A full scan is still done each period if exclusive apps are configured,
+// since we need to see all process names.
+
+#ifndef BOINC_PROC_ACCT_H
+#define BOINC_PROC_ACCT_H
+
+#include <string>
+
+#include "procinfo.h"
+
+struct ACTIVE_TASK;
+
+struct PROC_ACCT {
+    std::string cgroup_dir;
+        // the task's cgroup, if any
+    bool in_cgroup;
+        // we've seen the task's main process in its cgroup
+    PROC_MAP procs;
+        // the task's processes (not in its cgroup) as of the last poll
+    double exited_user_time;
+    double exited_kernel_time;
+    unsigned long exited_page_fault_count;
+        // CPU time and page faults of processes that have left procs
+    bool niced;
+        // task runs at reduced priority;
+        // its user time is not in /proc/stat "user"
+
+    PROC_ACCT() {
+        clear();
+    }
+    void clear() {
+        cgroup_dir.clear();
+        in_cgroup = false;
+        procs.clear();
+        exited_user_time = 0;
+        exited_kernel_time = 0;
+        exited_page_fault_count = 0;
+        niced = false;
+    }
+};
+
+#ifdef __linux__
+
+extern bool proc_acct_full_scan();
+    // whether get_memory_usage() should enumerate all processes
+    // this period
+
+extern int proc_acct_task(ACTIVE_TASK*, PROCINFO&);
+    // get usage for a task (pi.id is the main process)
+
+extern void proc_acct_update(ACTIVE_TASK*, PROC_MAP&);
+    // after a full scan, refresh a task's process tree
+
+extern int proc_acct_non_boinc_cpu_time(
+    double& t, double boinc_time, bool& valid
+);
+    // get the CPU time of non-BOINC processes,
+    // given the non-niced CPU time of tasks.
+    // valid is false if the change since the last call isn't meaningful
+
+extern int proc_acct_create_cgroup(ACTIVE_TASK*);
+    // before starting a task: create its cgroup (if we use them)
+extern void proc_acct_enter_cgroup(ACTIVE_TASK*);
+    // in the new process: move into the task's cgroup
+extern void proc_acct_task_exited(ACTIVE_TASK*);
+    // after the task's main process exits: remove its cgroup
+
+#endif
+
+#endif
@@ -95,6 +95,7 @@ void PROJECT::init() {
     send_job_log = 0;
     send_full_workload = false;
     dont_use_dcf = false;
+    gzip_sched_request = false;
     suspended_via_gui = false;
     dont_request_more_work = false;
     detach_when_done = false;
@@ -103,7 +104,6 @@ void PROJECT::init() {
     safe_strcpy(code_sign_key, "");
     user_files.clear();
     project_files.clear();
-    next_runnable_result = NULL;
     duration_correction_factor = 1;
     project_files_downloaded_time = 0;
     use_symlinks = false;
@@ -236,6 +236,7 @@ int PROJECT::parse_state(XML_PARSER& xp) {
         if (xp.parse_int("send_job_log", send_job_log)) continue;
         if (xp.parse_bool("send_full_workload", send_full_workload)) continue;
         if (xp.parse_bool("dont_use_dcf", dont_use_dcf)) continue;
+        if (xp.parse_bool("gzip_sched_request", gzip_sched_request)) continue;
         if (xp.parse_bool("non_cpu_intensive", non_cpu_intensive)) continue;
         if (xp.parse_bool("verify_files_on_app_start", verify_files_on_app_start)) continue;
         if (xp.parse_bool("suspended_via_gui", suspended_via_gui)) continue;
@@ -412,7 +413,7 @@ int PROJECT::write_state(MIOFILE& out, bool gui_rpc) {
         "    <njobs_error>%d</njobs_error>\n"
         "    <elapsed_time>%f</elapsed_time>\n"
         "    <last_rpc_time>%f</last_rpc_time>\n"
-        "%s%s%s%s%s%s%s%s%s%s%s%s%s%s",
+        "%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s",
         master_url,
         project_name,
         symstore,
@@ -454,6 +455,7 @@ int PROJECT::write_state(MIOFILE& out, bool gui_rpc) {
         trickle_up_pending?"    <trickle_up_pending/>\n":"",
         send_full_workload?"    <send_full_workload/>\n":"",
         dont_use_dcf?"    <dont_use_dcf/>\n":"",
+        gzip_sched_request?"    <gzip_sched_request/>\n":"",
         non_cpu_intensive?"    <non_cpu_intensive/>\n":"",
         verify_files_on_app_start?"    <verify_files_on_app_start/>\n":"",
         suspended_via_gui?"    <suspended_via_gui/>\n":"",
@@ -595,6 +597,7 @@ void PROJECT::copy_state_fields(PROJECT& p) {
     pwf = p.pwf;
     send_full_workload = p.send_full_workload;
     dont_use_dcf = p.dont_use_dcf;
+    gzip_sched_request = p.gzip_sched_request;
     send_time_stats_log = p.send_time_stats_log;
     send_job_log = p.send_job_log;
     non_cpu_intensive = p.non_cpu_intensive;
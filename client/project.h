@@ -18,6 +18,9 @@
 #ifndef BOINC_PROJECT_H
 #define BOINC_PROJECT_H
 
+#include <map>
+#include <string>
+
 #include "app_config.h"
 #include "client_types.h"
 
@@ -190,6 +193,8 @@ struct PROJECT : PROJ_AM {
     bool send_full_workload;
 
     bool dont_use_dcf;
+    bool gzip_sched_request;
+        // the scheduler accepts gzip-encoded requests
 
     bool suspended_via_gui;
     bool dont_request_more_work; 
@@ -207,6 +212,17 @@ struct PROJECT : PROJ_AM {
     std::vector<FILE_REF> project_files;
         // files not specific to apps or work - e.g. icons
 
+    // this project's objects, indexed for CLIENT_STATE::lookup_*().
+    // Kept in sync with the CLIENT_STATE vectors
+    // by CLIENT_STATE::index_*() and unindex_*()
+    //
+    std::map<std::string, APP*> apps_by_name;
+    std::map<std::string, FILE_INFO*> file_infos_by_name;
+    std::map<std::string, APP_VERSION*> app_versions_by_key;
+        // key is app name, platform, version num, plan class
+    std::map<std::string, WORKUNIT*> workunits_by_name;
+    std::map<std::string, RESULT*> results_by_name;
+
     ///////////////// member functions /////////////////
 
     void set_min_rpc_time(double future_time, const char* reason);
@@ -247,8 +263,6 @@ struct PROJECT : PROJ_AM {
     int n_concurrent;
         // used to enforce APP_CONFIGS::max_concurrent
 
-    struct RESULT *next_runnable_result;
-        // the next result to run for this project
     int nuploading_results;
         // number of results in UPLOADING state
         // Don't start new results if these exceeds 2*ncpus.
@@ -94,6 +94,9 @@ void RESULT::clear() {
     rrsim_finish_delay = 0;
     rrsim_flops = 0;
     rrsim_done = false;
+    rrsim_finish_time = 0;
+    rrsim_active = false;
+    rrsim_pick = 0;
     already_selected = false;
     rr_sim_misses_deadline = false;
     unfinished_time_slice = false;
@@ -104,6 +107,32 @@ void RESULT::clear() {
     safe_strcpy(schedule_backoff_reason, "");
 }
 
+// copy the fields that change during a result's lifetime;
+// used when replaying the state file journal
+//
+void RESULT::copy_state_fields(RESULT& r) {
+    report_deadline = r.report_deadline;
+    ready_to_report = r.ready_to_report;
+    completed_time = r.completed_time;
+    got_server_ack = r.got_server_ack;
+    final_cpu_time = r.final_cpu_time;
+    final_elapsed_time = r.final_elapsed_time;
+    final_peak_working_set_size = r.final_peak_working_set_size;
+    final_peak_swap_size = r.final_peak_swap_size;
+    final_peak_disk_usage = r.final_peak_disk_usage;
+    final_bytes_sent = r.final_bytes_sent;
+    final_bytes_received = r.final_bytes_received;
+    fpops_per_cpu_sec = r.fpops_per_cpu_sec;
+    fpops_cumulative = r.fpops_cumulative;
+    intops_per_cpu_sec = r.intops_per_cpu_sec;
+    intops_cumulative = r.intops_cumulative;
+    _state = r._state;
+    exit_status = r.exit_status;
+    stderr_out = r.stderr_out;
+    suspended_via_gui = r.suspended_via_gui;
+    report_immediately = r.report_immediately;
+}
+
 // parse a <result> element from scheduling server.
 //
 int RESULT::parse_server(XML_PARSER& xp) {
@@ -492,6 +521,7 @@ void RESULT::clear_uploaded_flags() {
     for (i=0; i<output_files.size(); i++) {
         fip = output_files[i].file_info;
         fip->uploaded = false;
+        gstate.queue_file_xfer_check(fip);
     }
 }
 
@@ -685,13 +715,22 @@ static const char* result_state_name(int val) {
 }
 
 void RESULT::set_state(int val, const char* where) {
+#ifndef SIM
+    bool changed = (val != _state);
+#endif
     _state = val;
+    gstate.queue_result_update(this);
     if (log_flags.task_debug) {
         msg_printf(project, MSG_INFO,
             "[task] result state=%s for %s from %s",
             result_state_name(val), name, where
         );
     }
+#ifndef SIM
+    if (changed) {
+        gstate.gui_rpcs.result_event(this);
+    }
+#endif
 }
 
 void add_old_result(RESULT& r) {
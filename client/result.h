@@ -94,11 +94,17 @@ struct RESULT {
     WORKUNIT* wup;
     PROJECT* project;
 
+    bool in_update_queue;
+        // in CLIENT_STATE::result_update_queue.
+        // Not reset by clear(), since it refers to this object
+
     RESULT(){
         clear();
+        in_update_queue = false;
     }
     ~RESULT(){}
     void clear();
+    void copy_state_fields(RESULT&);
     int parse_server(XML_PARSER&);
     int parse_state(XML_PARSER&);
     int parse_name(XML_PARSER&, const char* end_tag);
@@ -171,6 +177,11 @@ struct RESULT {
     double rrsim_finish_delay;
     double rrsim_flops;
     bool rrsim_done;
+    double rrsim_finish_time;
+        // if active in the simulation: when the job will finish
+    bool rrsim_active;
+    int rrsim_pick;
+        // the last job selection that made this job active
 
     bool already_selected;
         // used to keep cpu scheduler from scheduling a result twice
@@ -40,6 +40,7 @@
 #include "boinc_win.h"
 #else
 #include "config.h"
+#include <cstring>
 #endif
 
 #ifdef _MSC_VER
@@ -86,18 +87,66 @@ static inline void set_bits(
     }
 }
 
+// an active job, and the time it will finish if it keeps running
+//
+struct RR_SIM_EVENT {
+    double time;
+    RESULT* rp;
+
+    RR_SIM_EVENT(double t, RESULT* r) {
+        time = t;
+        rp = r;
+    }
+};
+
+// comparison for the finish-time heap: earliest first
+//
+static inline bool later_finish(const RR_SIM_EVENT& e1, const RR_SIM_EVENT& e2) {
+    return e1.time > e2.time;
+}
+
+// comparison for the project heap: highest priority first
+//
+static inline bool lower_sched_priority(PROJECT* p1, PROJECT* p2) {
+    return p1->sched_priority < p2->sched_priority;
+}
+
 // this is here (rather than rr_sim.h) because its inline functions
 // refer to RESULT
 //
 struct RR_SIM {
-    vector<RESULT*> active;
+    vector<RESULT*> active[MAX_RSC];
+        // jobs running in the simulation, per resource type
+    vector<RR_SIM_EVENT> finish_heap;
+        // finish times of active jobs.
+        // Entries of jobs that were preempted are stale;
+        // they're discarded when they reach the top.
+    vector<PROJECT*> project_heap[MAX_RSC];
+        // projects with pending jobs not yet picked, per resource type,
+        // as of the end of the last pick
+    double sim_now;
+    int npicks;
+
+    // Jobs run at a constant rate while they're active,
+    // so a job's finish time doesn't change until it's preempted.
+    // Count usage only for the job's own resource type,
+    // so that each type can be picked independently.
+    //
+    inline void start(RESULT* rp) {
+        rp->rrsim_active = true;
+        rp->rrsim_finish_time = sim_now + rp->rrsim_flops_left/rp->rrsim_flops;
+        finish_heap.push_back(RR_SIM_EVENT(rp->rrsim_finish_time, rp));
+        push_heap(finish_heap.begin(), finish_heap.end(), later_finish);
+    }
 
     inline void activate(RESULT* rp) {
         PROJECT* p = rp->project;
-        active.push_back(rp);
-        rsc_work_fetch[0].sim_nused += rp->avp->avg_ncpus;
-        p->rsc_pwf[0].sim_nused += rp->avp->avg_ncpus;
         int rt = rp->avp->gpu_usage.rsc_type;
+        active[rt].push_back(rp);
+        rp->rrsim_pick = npicks;
+        if (!rp->rrsim_active) {
+            start(rp);
+        }
         if (rt) {
             rsc_work_fetch[rt].sim_nused += rp->avp->gpu_usage.usage;
             p->rsc_pwf[rt].sim_nused += rp->avp->gpu_usage.usage;
@@ -115,14 +164,56 @@ struct RR_SIM {
                 );
 #endif
             }
+        } else {
+            rsc_work_fetch[0].sim_nused += rp->avp->avg_ncpus;
+            p->rsc_pwf[0].sim_nused += rp->avp->avg_ncpus;
+        }
+    }
+
+    // the job finished; it no longer uses its resource
+    //
+    inline void remove_usage(RESULT* rp) {
+        PROJECT* p = rp->project;
+        int rt = rp->avp->gpu_usage.rsc_type;
+        double x = rt?rp->avp->gpu_usage.usage:rp->avp->avg_ncpus;
+        rsc_work_fetch[rt].sim_nused -= x;
+        p->rsc_pwf[rt].sim_nused -= x;
+    }
+
+    // the job was preempted; note how much work it has left
+    //
+    inline void deactivate(RESULT* rp) {
+        rp->rrsim_active = false;
+        rp->rrsim_flops_left = (rp->rrsim_finish_time - sim_now)*rp->rrsim_flops;
+        if (rp->rrsim_flops_left < 0) {
+            rp->rrsim_flops_left = 0;
+        }
+    }
+
+    // return the active job that finishes first
+    //
+    inline RESULT* first_finish() {
+        while (!finish_heap.empty()) {
+            RR_SIM_EVENT& e = finish_heap.front();
+            if (e.rp->rrsim_active && e.time == e.rp->rrsim_finish_time) {
+                return e.rp;
+            }
+            pop_heap(finish_heap.begin(), finish_heap.end(), later_finish);
+            finish_heap.pop_back();
         }
+        return NULL;
     }
 
     void init_pending_lists();
-    void pick_jobs_to_run(double reltime);
+    void pick_jobs_to_run(int rt, double reltime);
+    void pick_more_jobs(int rt, double reltime);
+    bool replace_finished_job(RESULT* rp, double reltime);
     void simulate();
 
-    RR_SIM() {}
+    RR_SIM() {
+        sim_now = 0;
+        npicks = 0;
+    }
     ~RR_SIM() {}
 
 };
@@ -145,6 +236,26 @@ void set_rrsim_flops(RESULT* rp) {
     }
 }
 
+static void log_start(RESULT* rp, double reltime) {
+    char buf[256];
+    if (rp->already_selected) return;
+    rsc_string(rp, buf, sizeof(buf));
+    msg_printf(rp->project, MSG_INFO,
+        "[rr_sim_detail] %.2f: starting %s (%s) (%.2fG/%.2fG)",
+        reltime, rp->name, buf, rp->rrsim_flops_left/1e9, rp->rrsim_flops/1e9
+    );
+    rp->already_selected = true;
+}
+
+// whether two jobs use the same app and resources
+//
+static inline bool same_usage(RESULT* rp1, RESULT* rp2) {
+    if (rp1->app != rp2->app) return false;
+    if (rp1->avp->avg_ncpus != rp2->avp->avg_ncpus) return false;
+    if (rp1->avp->gpu_usage.usage != rp2->avp->gpu_usage.usage) return false;
+    return true;
+}
+
 void print_deadline_misses() {
     unsigned int i;
     RESULT* rp;
@@ -188,6 +299,7 @@ void RR_SIM::init_pending_lists() {
         RESULT* rp = gstate.results[i];
         rp->rr_sim_misses_deadline = false;
         rp->already_selected = false;
+        rp->rrsim_active = false;
         if (!rp->nearly_runnable()) continue;
         if (rp->some_download_stalled()) continue;
         if (rp->project->non_cpu_intensive) continue;
@@ -207,126 +319,239 @@ void RR_SIM::init_pending_lists() {
             p->rsc_pwf[rt].n_runnable_jobs++;
             p->rsc_pwf[rt].queue_est += rp->rrsim_flops_left/rp->rrsim_flops;
         }
-        p->rsc_pwf[rt].pending.push_back(rp);
+        RSC_PROJECT_WORK_FETCH& rsc_pwf = p->rsc_pwf[rt];
+        if (rsc_pwf.pending.empty()) {
+            rsc_pwf.pending_uniform = true;
+        } else if (!same_usage(rsc_pwf.pending.front(), rp)) {
+            rsc_pwf.pending_uniform = false;
+        }
+        rsc_pwf.pending.push_back(rp);
         rp->rrsim_done = false;
     }
 }
 
-// Pick jobs to run, putting them in "active" list.
+// Pick jobs of the given resource type to run,
+// putting them in its "active" list.
 // Simulate what the job scheduler would do:
 // pick a job from the project P with highest scheduling priority,
 // then adjust P's scheduling priority.
 //
-// This is called at the start of the simulation,
-// and again each time a job finishes.
-// In the latter case, some resources may be saturated.
+// This is called for each resource type at the start of the simulation,
+// and again for a type when one of its jobs finishes
+// and replace_finished_job() can't update the list.
+// The choice depends only on the pending lists and the projects' REC,
+// which doesn't change during the simulation;
+// so nothing else requires a new pick.
 //
-void RR_SIM::pick_jobs_to_run(double reltime) {
-    active.clear();
+void RR_SIM::pick_jobs_to_run(int rt, double reltime) {
+    vector<RESULT*> prev;
+    vector<PROJECT*>& heap = project_heap[rt];
 
-    // save and restore rec_temp
+    npicks++;
+    prev.swap(active[rt]);
+
+    // Make a heap of projects with runnable jobs for this resource.
+    // Clear usage counts.
+    // Initialize iterators to the pending list of each project.
     //
+    heap.clear();
+    rsc_work_fetch[rt].sim_nused = 0;
     for (unsigned int i=0; i<gstate.projects.size(); i++) {
+        PROJECT* p = gstate.projects[i];
+        RSC_PROJECT_WORK_FETCH& rsc_pwf = p->rsc_pwf[rt];
+        if (rsc_pwf.pending.size() ==0) continue;
+        rsc_pwf.pending_iter = rsc_pwf.pending.begin();
+        rsc_pwf.sim_nused = 0;
+        rsc_pwf.sim_rec_temp = p->pwf.rec;
+        heap.push_back(p);
+    }
+    pick_more_jobs(rt, reltime);
+
+    // jobs that were running and weren't picked are preempted
+    //
+    for (unsigned int i=0; i<prev.size(); i++) {
+        RESULT* rp = prev[i];
+        if (rp->rrsim_active && rp->rrsim_pick != npicks) {
+            deactivate(rp);
+        }
+    }
+}
+
+// Pick jobs until the resource is saturated or there are no more jobs,
+// starting from the state at the end of the last pick
+//
+void RR_SIM::pick_more_jobs(int rt, double reltime) {
+    vector<PROJECT*>& heap = project_heap[rt];
+    unsigned int i;
+
+    if (heap.empty()) return;
+
+    // save and restore rec_temp
+    //
+    for (i=0; i<gstate.projects.size(); i++) {
         PROJECT* p = gstate.projects[i];
         p->pwf.rec_temp_save = p->pwf.rec_temp;
     }
 
-    // loop over resource types; do the GPUs first
+    // order the projects by scheduling priority
     //
-    for (int rt=coprocs.n_rsc-1; rt>=0; rt--) {
-        vector<PROJECT*> project_heap;
+    for (i=0; i<heap.size(); i++) {
+        PROJECT* p = heap[i];
+        p->pwf.rec_temp = p->rsc_pwf[rt].sim_rec_temp;
+        p->compute_sched_priority();
+    }
+    make_heap(heap.begin(), heap.end(), lower_sched_priority);
+
+    // Loop over jobs.
+    //
+    while (1) {
+        if (heap.empty()) break;
+
+        // check whether resource is saturated
+        //
+        if (rt) {
+            if (rsc_work_fetch[rt].sim_nused >= coprocs.coprocs[rt].count) break;
+        } else {
+            if (rsc_work_fetch[rt].sim_nused >= gstate.ncpus) break;
+        }
 
-        // Make a heap of projects with runnable jobs for this resource,
-        // ordered by scheduling priority.
-        // Clear usage counts.
-        // Initialize iterators to the pending list of each project.
+        // p is the highest-priority project with work for this resource
         //
-        rsc_work_fetch[rt].sim_nused = 0;
-        for (unsigned int i=0; i<gstate.projects.size(); i++) {
-            PROJECT* p = gstate.projects[i];
-            RSC_PROJECT_WORK_FETCH& rsc_pwf = p->rsc_pwf[rt];
-            if (rsc_pwf.pending.size() ==0) continue;
-            rsc_pwf.pending_iter = rsc_pwf.pending.begin();
-            rsc_pwf.sim_nused = 0;
-            p->pwf.rec_temp = p->pwf.rec;
-            p->compute_sched_priority();
-            project_heap.push_back(p);
-        }
-        make_heap(project_heap.begin(), project_heap.end());
-
-        // Loop over jobs.
-        // Keep going until the resource is saturated or there are no more jobs.
+        PROJECT* p = heap.front();
+        RSC_PROJECT_WORK_FETCH& rsc_pwf = p->rsc_pwf[rt];
+
+        // replace_finished_job() may have started the project's last job
         //
-        while (1) {
-            if (project_heap.empty()) break;
+        if (rsc_pwf.pending_iter == rsc_pwf.pending.end()) {
+            pop_heap(heap.begin(), heap.end(), lower_sched_priority);
+            heap.pop_back();
+            continue;
+        }
+        RESULT* rp = *rsc_pwf.pending_iter;
 
-            // p is the highest-priority project with work for this resource
+        // garbage-collect jobs that already completed in our simulation
+        // (this is just a handy place to do this)
+        //
+        if (rp->rrsim_done) {
+            rsc_pwf.pending_iter = rsc_pwf.pending.erase(rsc_pwf.pending_iter);
+        } else {
+            // add job to active list, and adjust project priority
             //
-            PROJECT* p = project_heap.front();
-            RSC_PROJECT_WORK_FETCH& rsc_pwf = p->rsc_pwf[rt];
-            RESULT* rp = *rsc_pwf.pending_iter;
+            activate(rp);
+            adjust_rec_sched(rp);
+            rsc_pwf.sim_rec_temp = p->pwf.rec_temp;
+            if (log_flags.rrsim_detail) {
+                log_start(rp, reltime);
+            }
 
-            // garbage-collect jobs that already completed in our simulation
-            // (this is just a handy place to do this)
+            // the iterator is left after the project's last active job;
+            // see replace_finished_job()
             //
-            if (rp->rrsim_done) {
-                rsc_pwf.pending_iter = rsc_pwf.pending.erase(rsc_pwf.pending_iter);
-            } else {
-                // add job to active list, and adjust project priority
-                //
-                activate(rp);
-                adjust_rec_sched(rp);
-                if (log_flags.rrsim_detail && !rp->already_selected) {
-                    char buf[256];
-                    rsc_string(rp, buf, sizeof(buf));
-                    msg_printf(rp->project, MSG_INFO,
-                        "[rr_sim_detail] %.2f: starting %s (%s) (%.2fG/%.2fG)",
-                        reltime, rp->name, buf, rp->rrsim_flops_left/1e9, rp->rrsim_flops/1e9
-                    );
-                    rp->already_selected = true;
-                }
+            ++rsc_pwf.pending_iter;
 
-                // check whether resource is saturated
-                //
-                if (rt) {
-                    if (rsc_work_fetch[rt].sim_nused >= coprocs.coprocs[rt].count) {
-                        break;
-                    }
-
-                    // if a GPU isn't saturated but this project is using
-                    // its max given exclusions, remove it from project heap
-                    //
-                    if (rsc_pwf.sim_nused >= coprocs.coprocs[rt].count - p->rsc_pwf[rt].ncoprocs_excluded) {
-                        pop_heap(project_heap.begin(), project_heap.end());
-                        project_heap.pop_back();
-                        continue;
-                    }
-                } else {
-                    if (rsc_work_fetch[rt].sim_nused >= gstate.ncpus) break;
-                }
-                ++rsc_pwf.pending_iter;
+            // if a GPU isn't saturated but this project is using
+            // its max given exclusions, remove it from project heap
+            //
+            if (rt && rsc_pwf.sim_nused >= coprocs.coprocs[rt].count - rsc_pwf.ncoprocs_excluded) {
+                pop_heap(heap.begin(), heap.end(), lower_sched_priority);
+                heap.pop_back();
+                continue;
             }
+        }
 
-            if (rsc_pwf.pending_iter == rsc_pwf.pending.end()) {
-                // if this project now has no more jobs for the resource,
-                // remove it from the project heap
-                //
-                pop_heap(project_heap.begin(), project_heap.end());
-                project_heap.pop_back();
-            } else if (!rp->rrsim_done) {
-                // Otherwise reshuffle the project heap
-                //
-                make_heap(project_heap.begin(), project_heap.end());
-            }
+        if (rsc_pwf.pending_iter == rsc_pwf.pending.end()) {
+            // if this project now has no more jobs for the resource,
+            // remove it from the project heap
+            //
+            pop_heap(heap.begin(), heap.end(), lower_sched_priority);
+            heap.pop_back();
+        } else if (!rp->rrsim_done) {
+            // Otherwise move the project to its new place in the heap;
+            // only its priority has changed
+            //
+            pop_heap(heap.begin(), heap.end(), lower_sched_priority);
+            push_heap(heap.begin(), heap.end(), lower_sched_priority);
         }
     }
 
-    for (unsigned int i=0; i<gstate.projects.size(); i++) {
+    for (i=0; i<gstate.projects.size(); i++) {
         PROJECT* p = gstate.projects[i];
         p->pwf.rec_temp = p->pwf.rec_temp_save;
     }
 }
 
+// whether the project's active jobs for the resource
+// that follow the given one in its pending list
+// use the same app and resources
+//
+static bool rest_alike(RSC_PROJECT_WORK_FETCH& rsc_pwf, RESULT* rp) {
+    if (rsc_pwf.pending_uniform) return true;
+    std::deque<RESULT*>::iterator it = rsc_pwf.pending_iter;
+    while (it != rsc_pwf.pending.begin()) {
+        --it;
+        if (*it == rp) break;
+        if ((*it)->rrsim_done) continue;
+        if (!same_usage(*it, rp)) return false;
+    }
+    return true;
+}
+
+// A job has finished.
+// Consider the pick that made the current active list,
+// and a new pick without the job.
+// If the project's later active jobs are like the finished one,
+// each would move up one place, and the projects would be picked
+// in the same order.  So:
+// - if the project has another job like the finished one,
+//   it would be picked in the last place; start it.
+// - if the project has no more jobs, the new pick would continue
+//   where the last one stopped; do that.
+// Return false if neither is the case and a new pick is needed.
+//
+bool RR_SIM::replace_finished_job(RESULT* rpdone, double reltime) {
+    PROJECT* p = rpdone->project;
+    int rt = rpdone->avp->gpu_usage.rsc_type;
+    RSC_PROJECT_WORK_FETCH& rsc_pwf = p->rsc_pwf[rt];
+    vector<RESULT*>& act = active[rt];
+    std::deque<RESULT*>::iterator it;
+    unsigned int i;
+
+    it = rsc_pwf.pending_iter;
+    while (it != rsc_pwf.pending.end() && (*it)->rrsim_done) {
+        ++it;
+    }
+    if (it == rsc_pwf.pending.end()) {
+        if (!rest_alike(rsc_pwf, rpdone)) return false;
+        for (i=0; i<act.size(); i++) {
+            if (act[i] == rpdone) {
+                act[i] = act.back();
+                act.pop_back();
+                break;
+            }
+        }
+        remove_usage(rpdone);
+        pick_more_jobs(rt, reltime);
+        return true;
+    }
+
+    RESULT* rp = *it;
+    if (!same_usage(rp, rpdone)) return false;
+    if (!rest_alike(rsc_pwf, rpdone)) return false;
+    rsc_pwf.pending_iter = ++it;
+    for (i=0; i<act.size(); i++) {
+        if (act[i] == rpdone) {
+            act[i] = rp;
+            break;
+        }
+    }
+    rp->rrsim_pick = npicks;
+    start(rp);
+    if (log_flags.rrsim_detail) {
+        log_start(rp, reltime);
+    }
+    return true;
+}
+
 static void record_nidle_now() {
     // note the number of idle instances
     //
@@ -372,8 +597,7 @@ static void handle_missed_deadline(RESULT* rpbest, double diff, double ar) {
 
 void RR_SIM::simulate() {
     PROJECT* pbest;
-    RESULT* rp, *rpbest;
-    unsigned int u;
+    RESULT* rpbest;
 
     double ar = gstate.available_ram();
 
@@ -393,30 +617,24 @@ void RR_SIM::simulate() {
     project_priority_init(false);
     init_pending_lists();
 
-    // Simulation loop.  Keep going until all jobs done
-    //
     double buf_end = gstate.now + gstate.work_buf_total();
-    double sim_now = gstate.now;
-    bool first = true;
-    while (1) {
-        pick_jobs_to_run(sim_now-gstate.now);
-        if (first) {
-            record_nidle_now();
-            first = false;
-        }
+    sim_now = gstate.now;
 
-        if (!active.size()) break;
+    // pick initial jobs; do the GPUs first
+    //
+    for (int rt=coprocs.n_rsc-1; rt>=0; rt--) {
+        pick_jobs_to_run(rt, 0);
+    }
+    record_nidle_now();
 
-        // compute finish times and see which job finishes first
+    // Simulation loop.  Keep going until all jobs done
+    //
+    while (1) {
+        // see which job finishes first
         //
-        rpbest = NULL;
-        for (u=0; u<active.size(); u++) {
-            rp = active[u];
-            rp->rrsim_finish_delay = rp->rrsim_flops_left/rp->rrsim_flops;
-            if (!rpbest || rp->rrsim_finish_delay < rpbest->rrsim_finish_delay) {
-                rpbest = rp;
-            }
-        }
+        rpbest = first_finish();
+        if (!rpbest) break;
+        rpbest->rrsim_finish_delay = rpbest->rrsim_finish_time - sim_now;
 
         // see if we finish a time slice before first job ends
         //
@@ -444,7 +662,11 @@ void RR_SIM::simulate() {
                 );
             }
         } else {
+            pop_heap(finish_heap.begin(), finish_heap.end(), later_finish);
+            finish_heap.pop_back();
             rpbest->rrsim_done = true;
+            rpbest->rrsim_active = false;
+            rpbest->rrsim_flops_left = 0;
             pbest = rpbest->project;
             if (log_flags.rr_simulation) {
                 char buf[256];
@@ -476,53 +698,19 @@ void RR_SIM::simulate() {
             }
         }
 
-        // adjust FLOPS left of other active jobs
-        //
-        for (unsigned int i=0; i<active.size(); i++) {
-            rp = active[i];
-            rp->rrsim_flops_left -= rp->rrsim_flops*delta_t;
-
-            // can be slightly less than 0 due to roundoff
-            //
-            if (rp->rrsim_flops_left < -1e6) {
-                if (log_flags.rr_simulation) {
-                    msg_printf(rp->project, MSG_INTERNAL_ERROR,
-                        "%s: negative FLOPs left %f", rp->name, rp->rrsim_flops_left
-                    );
-                }
-            }
-            if (rp->rrsim_flops_left < 0) {
-                rp->rrsim_flops_left = 0;
-            }
-        }
-
         for (int i=0; i<coprocs.n_rsc; i++) {
             rsc_work_fetch[i].update_stats(sim_now, delta_t, buf_end);
         }
 
-        // update project REC
+        sim_now += delta_t;
+
+        // a job finished; start others in its place
         //
-        double f = gstate.host_info.p_fpops;
-        for (unsigned int i=0; i<gstate.projects.size(); i++) {
-            PROJECT* p = gstate.projects[i];
-            double dtemp = sim_now;
-            double x = 0;
-            for (int j=0; j<coprocs.n_rsc; j++) {
-                x += p->rsc_pwf[j].sim_nused * delta_t * f * rsc_work_fetch[j].relative_speed;
-            }
-            x *= COBBLESTONE_SCALE;
-            update_average(
-                sim_now+delta_t,
-                sim_now,
-                x,
-                cc_config.rec_half_life,
-                p->pwf.rec_temp,
-                dtemp
+        if (rpbest && !replace_finished_job(rpbest, sim_now-gstate.now)) {
+            pick_jobs_to_run(
+                rpbest->avp->gpu_usage.rsc_type, sim_now-gstate.now
             );
-            p->compute_sched_priority();
         }
-
-        sim_now += delta_t;
     }
 
     // identify GPU instances starved because of exclusions
@@ -554,15 +742,110 @@ void RR_SIM::simulate() {
     }
 }
 
+// rr_simulation() is called by both the job scheduler and work fetch,
+// often several times in a few seconds with nothing changed.
+// If its inputs are the same as in the last simulation,
+// and that was less than this long ago, use its results.
+// (The remaining runtime of running jobs changes continuously,
+// and isn't treated as an input.)
+//
+#define RR_SIM_CACHE_PERIOD 10
+
+static bool rr_sim_cached = false;
+static double rr_sim_time;
+static unsigned long long rr_sim_inputs;
+
+static inline void hash_bits(unsigned long long& h, unsigned long long x) {
+    h = (h ^ x) * 1099511628211ULL;
+}
+
+static inline void hash_double(unsigned long long& h, double x) {
+    unsigned long long y;
+    memcpy(&y, &x, sizeof(y));
+    hash_bits(h, y);
+}
+
+static inline void hash_ptr(unsigned long long& h, void* p) {
+    hash_bits(h, (unsigned long long)(size_t)p);
+}
+
+// return a hash of the inputs of the simulation
+//
+static unsigned long long get_rr_sim_inputs() {
+    unsigned long long h = 14695981039346656037ULL;
+    unsigned int i;
+
+    hash_double(h, gstate.ncpus);
+    hash_double(h, gstate.work_buf_min());
+    hash_double(h, gstate.work_buf_total());
+    hash_double(h, gstate.available_ram());
+    hash_double(h, gstate.overall_cpu_frac());
+    hash_double(h, gstate.overall_cpu_and_network_frac());
+    hash_double(h, gstate.overall_gpu_frac());
+    hash_double(h, coprocs.n_rsc);
+    for (int j=1; j<coprocs.n_rsc; j++) {
+        hash_double(h, coprocs.coprocs[j].count);
+        hash_double(h, rsc_work_fetch[j].has_exclusions);
+    }
+    for (i=0; i<gstate.projects.size(); i++) {
+        PROJECT* p = gstate.projects[i];
+        hash_ptr(h, p);
+        hash_double(h, p->resource_share);
+        hash_double(h, p->pwf.rec);
+        hash_double(h, p->non_cpu_intensive);
+        hash_double(h, p->duration_correction_factor);
+        for (int j=1; j<coprocs.n_rsc; j++) {
+            hash_double(h, p->rsc_pwf[j].ncoprocs_excluded);
+        }
+    }
+    for (i=0; i<gstate.results.size(); i++) {
+        RESULT* rp = gstate.results[i];
+        hash_ptr(h, rp);
+        if (!rp->nearly_runnable()) continue;
+        hash_double(h, rp->some_download_stalled());
+        hash_double(h, rp->report_deadline);
+        APP_VERSION* avp = rp->avp;
+        hash_ptr(h, avp);
+        hash_double(h, avp->flops);
+        hash_double(h, avp->avg_ncpus);
+        int rt = avp->gpu_usage.rsc_type;
+        if (rt) {
+            hash_double(h, avp->gpu_usage.usage);
+            hash_bits(h, rp->app->non_excluded_instances[rt]);
+        }
+    }
+    return h;
+}
+
 void rr_simulation() {
+    unsigned long long inputs = get_rr_sim_inputs();
+    if (rr_sim_cached
+        && inputs == rr_sim_inputs
+        && gstate.now >= rr_sim_time
+        && gstate.now < rr_sim_time + RR_SIM_CACHE_PERIOD
+    ) {
+        work_fetch.rr_init_nonsim();
+        if (log_flags.rr_simulation) {
+            msg_printf(0, MSG_INFO,
+                "[rr_sim] inputs unchanged; using results from %.2f sec ago",
+                gstate.now - rr_sim_time
+            );
+        }
+        return;
+    }
+
     RR_SIM rr_sim;
     rr_sim.simulate();
+    rr_sim_cached = true;
+    rr_sim_time = gstate.now;
+    rr_sim_inputs = inputs;
 }
 
 // Compute the number of idle instances of each resource
 // Put results in global state (rsc_work_fetch)
 //
 void get_nidle() {
+    rr_sim_cached = false;      // we overwrite its nidle_now
     int nidle_rsc = coprocs.n_rsc;
     for (int i=1; i<coprocs.n_rsc; i++) {
         rsc_work_fetch[i].nidle_now = coprocs.coprocs[i].count;
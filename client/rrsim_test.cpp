@@ -15,437 +15,311 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with BOINC.  If not, see <http://www.gnu.org/licenses/>.
 
-// This is a test framework for the rr_simulation() function.
-// To use it:
-// - cut and paste the current code from cpu_sched.C (see below)
-// - edit main() to set up your test case
-
-#include <vector>
-#include <cstdarg>
-
-using std::vector;
-
-#define CPU_PESSIMISM_FACTOR 1.0
-#define SECONDS_PER_DAY 86400
-
-struct RESULT;
-
-struct PROJECT {
-    char name[256];
-    double resource_share;
-    bool non_cpu_intensive;
-    vector<RESULT*>active;
-    vector<RESULT*>pending;
-    double cpu_shortfall;
-    double rrsim_proc_rate;
-    int rr_sim_deadlines_missed;
-    PROJECT(char* n, double rs) {
-        safe_strcpy(name,  n);
-        resource_share = rs;
-        non_cpu_intensive = false;
-    }
-    char* get_project_name() {
-        return name;
-    }
-    void set_rrsim_proc_rate(double);
-};
-
-struct RESULT {
-    char name[256];
-    double ectr;
-    double estimated_cpu_time_remaining() {
-        return ectr;
-    }
-    double rrsim_finish_delay;
-    double rrsim_cpu_left;
-    double report_deadline;
-    bool rr_sim_misses_deadline;
-    bool last_rr_sim_missed_deadline;
-    PROJECT* project;
-    RESULT(PROJECT* p, char* n, double e, double rd) {
-        project = p;
-        safe_strcpy(name,  n);
-        ectr = e;
-        report_deadline = rd;
-    }
-    bool nearly_runnable() {
-        return true;
-    }
-    double computation_deadline();
-};
-
-struct FLAGS {
-    bool rr_simulation;
-};
-
-FLAGS log_flags;
-
-struct PREFS {
-    double work_buf_min_days;
-    double work_buf_additional_days;
-    double cpu_scheduling_period_minutes;
-};
-
-struct CLIENT_STATE {
-    double nearly_runnable_resource_share();
-    double total_resource_share();
-    double now;
-    int ncpus;
-    vector<RESULT*>results;
-    vector<PROJECT*>projects;
-    PREFS global_prefs;
-    double cpu_shortfall;
-    double overall_cpu_frac() {
-        return 1;
-    }
-    bool rr_simulation();
-    double work_buf_min() {
-        return global_prefs.work_buf_min_days*86400;
-    }
-    double work_buf_additional() {
-        return global_prefs.work_buf_additional_days * 86400;
-    }
-};
-
-struct CLIENT_STATE gstate;
-
-double CLIENT_STATE::nearly_runnable_resource_share() {
-    double x=0;
-    for (unsigned int i=0; i<projects.size(); i++) {
-        x += projects[i]->resource_share;
-    }
-    return x;
-}
-
-double CLIENT_STATE::total_resource_share() {
-    return nearly_runnable_resource_share();
-}
-
-#define MSG_INFO 0
+// Performance regression test for rr_simulation()
+// and for the job scheduler (make_run_list()).
+//
+// Creates a synthetic workload - a host with many CPUs and some GPUs,
+// and thousands of queued jobs from several projects -
+// and measures the time it takes to simulate it
+// and to make the list of jobs to run.
+// It also prints the results of the simulation
+// (shortfalls and deadline misses) and a summary of the run list;
+// these should change only if the scheduling policy changes.
+//
+// This is linked with the client simulator's object files;
+// to build it:
+//      make -f makefile_sim rrsim_test
+//
+// usage: rrsim_test [options]
+// --ncpus N        # of CPUs (default 256)
+// --ngpus N        # of GPUs (default 4)
+// --nprojects N    # of projects (default 10)
+// --njobs N        # of jobs (default 5000)
+// --niters N       # of simulations to time (default 10)
+// --max_time X     exit with status 1 if a simulation or run list
+//                  takes longer than X seconds on average
+// --verbose        show rr_simulation() log messages and the run list
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "str_replace.h"
+#include "util.h"
+
+#include "client_state.h"
+#include "log_flags.h"
+#include "project.h"
+#include "result.h"
+#include "rr_sim.h"
+#include "sim.h"
+
+// globals normally defined in sim.cpp
+//
+FILE* logfile;
+std::string html_msg;
+bool cpu_sched_rr_only = false;
+RANDOM_PROCESS on_proc;
+RANDOM_PROCESS active_proc;
+RANDOM_PROCESS gpu_active_proc;
+RANDOM_PROCESS connected_proc;
+
+#define CPU_FLOPS   3e9
+#define GPU_FLOPS   1e12
+
+// job runtimes and deadlines are chosen at random from these ranges
+//
+#define MIN_RUNTIME     600
+#define MAX_RUNTIME     86400
+#define MIN_DEADLINE    (2*86400)
+#define MAX_DEADLINE    (14*86400)
 
-void msg_printf(PROJECT* p, int, const char* fmt, ...) {
-    char buf[8192];
-    va_list ap;
-    va_start(ap, fmt);
-    vsnprintf(buf, sizeof(buf), fmt, ap);
-    va_end(ap);
-    printf("%s: %s\n", p?p->name:"BOINC", buf);
+static double rand_range(double lo, double hi) {
+    return lo + (hi-lo)*rand()/(double)RAND_MAX;
 }
 
-/////////////////////  CUT AND PASTE FROM CPU_SCHED.C //////////////
+static void make_host(int ncpus, int ngpus) {
+    gstate.ncpus = ncpus;
+    gstate.host_info.p_ncpus = ncpus;
+    gstate.host_info.p_fpops = CPU_FLOPS;
+    gstate.host_info.m_nbytes = 64e9;
+    gstate.global_prefs.work_buf_min_days = 0.5;
+    gstate.global_prefs.work_buf_additional_days = 1;
 
-double RESULT::computation_deadline() {
-    return report_deadline - (
-        gstate.global_prefs.work_buf_min_days * SECONDS_PER_DAY
-            // Seconds that the host will not be connected to the Internet
-        + gstate.global_prefs.cpu_scheduling_period()
-            // Seconds that the CPU may be busy with some other result
-        + SECONDS_PER_DAY
-            // Deadline cusion
-    );
+    coprocs.clear();
+    if (ngpus) {
+        COPROC cp;
+        safe_strcpy(cp.type, "NVIDIA");
+        cp.count = ngpus;
+        cp.peak_flops = GPU_FLOPS;
+        coprocs.add(cp);
+    }
+    work_fetch.init();
 }
 
-void PROJECT::set_rrsim_proc_rate(double rrs) {
-    int nactive = (int)active.size();
-    if (nactive == 0) return;
-    double x;
-
-    if (rrs) {
-        x = resource_share/rrs;
-    } else {
-        x = 1;      // pathological case; maybe should be 1/# runnable projects
-    }
+// Each project has a CPU app version;
+// some have two multithreaded versions, and half have a GPU version.
+// Jobs are divided among projects unevenly.
+//
+static void make_workload(int nprojects, int njobs) {
+    vector<APP_VERSION*> avps;
+    int i;
+
+    for (i=0; i<nprojects; i++) {
+        PROJECT* p = new PROJECT;
+        snprintf(p->master_url, sizeof(p->master_url),
+            "http://project%d.test/", i
+        );
+        snprintf(p->project_name, sizeof(p->project_name), "project %d", i);
+        p->resource_share = 100*(1 + i%3);
+        p->pwf.rec = rand_range(1, 1000);
+        gstate.projects.push_back(p);
+
+        APP* app = new APP;
+        snprintf(app->name, sizeof(app->name), "app%d", i);
+        app->project = p;
+        gstate.apps.push_back(app);
+
+        APP_VERSION* avp = new APP_VERSION;
+        avp->project = p;
+        avp->app = app;
+        safe_strcpy(avp->app_name, app->name);
+        avp->avg_ncpus = (i%4 == 3)?8:1;
+        avp->flops = CPU_FLOPS*avp->avg_ncpus;
+        gstate.app_versions.push_back(avp);
+        avps.push_back(avp);
+
+        if (i%4 == 3) {
+            avp = new APP_VERSION;
+            avp->project = p;
+            avp->app = app;
+            safe_strcpy(avp->app_name, app->name);
+            avp->avg_ncpus = 4;
+            avp->flops = CPU_FLOPS*avp->avg_ncpus;
+            gstate.app_versions.push_back(avp);
+            avps.push_back(avp);
+        }
 
-    // if this project has fewer active results than CPUs,
-    // scale up its share to reflect this
-    //
-    if (nactive < gstate.ncpus) {
-        x *= ((double)gstate.ncpus)/nactive;
+        if (coprocs.n_rsc > 1 && i%2) {
+            avp = new APP_VERSION;
+            avp->project = p;
+            avp->app = app;
+            safe_strcpy(avp->app_name, app->name);
+            avp->avg_ncpus = 0.2;
+            avp->gpu_usage.rsc_type = 1;
+            avp->gpu_usage.usage = (i%4 == 1)?0.5:1;
+            avp->flops = GPU_FLOPS*0.2;
+            gstate.app_versions.push_back(avp);
+            avps.push_back(avp);
+        }
     }
 
-    // But its rate on a given CPU can't exceed 1
-    //
-    if (x>1) {
-        x = 1;
-    }
-    rrsim_proc_rate = x*gstate.overall_cpu_frac();
-    if (log_flags.rr_simulation) {
-        msg_printf(this, MSG_INFO,
-            "set_rrsim_proc_rate: %f (rrs %f, rs %f, nactive %d, ocf %f",
-            rrsim_proc_rate, rrs, resource_share, nactive, gstate.overall_cpu_frac()
-        );
+    for (i=0; i<njobs; i++) {
+        // skew the distribution so that low-numbered app versions
+        // get most of the jobs
+        //
+        double x = rand_range(0, 1);
+        APP_VERSION* avp = avps[(int)(x*x*avps.size())];
+
+        WORKUNIT* wup = new WORKUNIT;
+        snprintf(wup->name, sizeof(wup->name), "wu_%d", i);
+        wup->project = avp->project;
+        wup->app = avp->app;
+        wup->rsc_fpops_est = avp->flops*rand_range(MIN_RUNTIME, MAX_RUNTIME);
+        gstate.workunits.push_back(wup);
+
+        RESULT* rp = new RESULT;
+        snprintf(rp->name, sizeof(rp->name), "result_%d", i);
+        snprintf(rp->wu_name, sizeof(rp->wu_name), "wu_%d", i);
+        rp->project = avp->project;
+        rp->wup = wup;
+        rp->app = avp->app;
+        rp->avp = avp;
+        rp->sim_flops_left = wup->rsc_fpops_est;
+        rp->report_deadline = gstate.now + rand_range(MIN_DEADLINE, MAX_DEADLINE);
+        rp->set_state(RESULT_FILES_DOWNLOADED, "rrsim_test");
+        gstate.results.push_back(rp);
     }
 }
-bool CLIENT_STATE::rr_simulation() {
-    double rrs = nearly_runnable_resource_share();
-    double trs = total_resource_share();
-    PROJECT* p, *pbest;
-    RESULT* rp, *rpbest;
-    vector<RESULT*> active;
-    unsigned int i;
-    double x;
-    vector<RESULT*>::iterator it;
-    bool rval = false;
 
-    if (log_flags.rr_simulation) {
-        msg_printf(0, MSG_INFO,
-            "rr_sim start: work_buf_min %f rrs %f trs %f",
-            work_buf_min(), rrs, trs
+static void print_results() {
+    for (int i=0; i<coprocs.n_rsc; i++) {
+        RSC_WORK_FETCH& rwf = rsc_work_fetch[i];
+        printf("%s: shortfall %.2f nidle_now %.2f saturated %.2f busy %.2f\n",
+            rsc_name_long(i), rwf.shortfall, rwf.nidle_now,
+            rwf.saturated_time, rwf.busy_time_estimator.get_busy_time()
         );
     }
-
-    // Initialize result lists for each project:
-    // "active" is what's currently running (in the simulation)
-    // "pending" is what's queued
-    //
-    for (i=0; i<projects.size(); i++) {
-        p = projects[i];
-        p->active.clear();
-        p->pending.clear();
-        p->rr_sim_deadlines_missed = 0;
-        p->cpu_shortfall = 0;
-    }
-
-    for (i=0; i<results.size(); i++) {
-        rp = results[i];
-        if (!rp->nearly_runnable()) continue;
-        if (rp->project->non_cpu_intensive) continue;
-        rp->rrsim_cpu_left = rp->estimated_cpu_time_remaining();
-        p = rp->project;
-        if (p->active.size() < (unsigned int)ncpus) {
-            active.push_back(rp);
-            p->active.push_back(rp);
-        } else {
-            p->pending.push_back(rp);
+    for (unsigned int i=0; i<gstate.projects.size(); i++) {
+        PROJECT* p = gstate.projects[i];
+        printf("%s: %d runnable jobs, deadline misses:",
+            p->project_name, p->pwf.n_runnable_jobs
+        );
+        for (int j=0; j<coprocs.n_rsc; j++) {
+            printf(" %s %d", rsc_name_long(j), p->rsc_pwf[j].deadlines_missed);
         }
-        rp->last_rr_sim_missed_deadline = rp->rr_sim_misses_deadline;
-        rp->rr_sim_misses_deadline = false;
+        printf("\n");
     }
+}
 
-    for (i=0; i<projects.size(); i++) {
-        p = projects[i];
-        p->set_rrsim_proc_rate(rrs);
-        // if there are no results for a project,
-        // the shortfall is its entire share.
-        //
-        if (!p->active.size()) {
-            double rsf = trs ? p->resource_share/trs : 1;
-            p->cpu_shortfall = (work_buf_min()+work_buf_additional()) * overall_cpu_frac() * ncpus * rsf;
-            if (log_flags.rr_simulation) {
-                msg_printf(p, MSG_INFO,
-                    "no results; shortfall %f wbm %f ocf %f rsf %f",
-                    p->cpu_shortfall, work_buf_min(), overall_cpu_frac(), rsf
-                );
-            }
-        }
+// start the jobs the scheduler picks, so that the timed passes
+// see a mix of running, preempted and unstarted jobs
+//
+static void start_jobs() {
+    vector<RESULT*> run_list;
+    gstate.make_run_list(run_list);
+    gstate.enforce_run_list(run_list);
+    for (unsigned int i=0; i<gstate.active_tasks.active_tasks.size(); i++) {
+        ACTIVE_TASK* atp = gstate.active_tasks.active_tasks[i];
+        atp->run_interval_start_wall_time = gstate.now;
+        atp->checkpoint_wall_time = gstate.now;
     }
+}
 
-    double buf_end = now + work_buf_min() + work_buf_additional();
-
-    // Simulation loop.  Keep going until work done
-    //
-    double sim_now = now;
-    cpu_shortfall = 0;
-    while (active.size()) {
-
-        // compute finish times and see which result finishes first
-        //
-        rpbest = NULL;
-        for (i=0; i<active.size(); i++) {
-            rp = active[i];
-            p = rp->project;
-            rp->rrsim_finish_delay = rp->rrsim_cpu_left/p->rrsim_proc_rate;
-            if (!rpbest || rp->rrsim_finish_delay < rpbest->rrsim_finish_delay) {
-                rpbest = rp;
-            }
-        }
-
-        pbest = rpbest->project;
-
-        if (log_flags.rr_simulation) {
-            msg_printf(pbest, MSG_INFO,
-                "rr_sim: result %s finishes after %f (%f/%f)",
-                rpbest->name, rpbest->rrsim_finish_delay, rpbest->rrsim_cpu_left, pbest->rrsim_proc_rate
+static void print_run_list(vector<RESULT*>& run_list, bool verbose) {
+    int nedf = 0, ngpu = 0;
+    for (unsigned int i=0; i<run_list.size(); i++) {
+        RESULT* rp = run_list[i];
+        if (rp->edf_scheduled) nedf++;
+        if (rp->uses_coprocs()) ngpu++;
+        if (verbose) {
+            printf("run list %d: %s (%s)%s\n",
+                i, rp->name, rp->project->project_name,
+                rp->edf_scheduled?" EDF":""
             );
         }
+    }
+    printf("run list: %d jobs, %d EDF, %d GPU\n",
+        (int)run_list.size(), nedf, ngpu
+    );
+}
 
-        // "rpbest" is first result to finish.  Does it miss its deadline?
-        //
-        double diff = sim_now + rpbest->rrsim_finish_delay - ((rpbest->computation_deadline()-now)*CPU_PESSIMISM_FACTOR + now);
-        if (diff > 0) {
-            rpbest->rr_sim_misses_deadline = true;
-            pbest->rr_sim_deadlines_missed++;
-            rval = true;
-            if (log_flags.rr_simulation) {
-                msg_printf(0, MSG_INFO,
-                    "rr_sim: result %s misses deadline by %f",
-                    rpbest->name, diff
-                );
-            }
-        }
-
-        int last_active_size = active.size();
-        int last_proj_active_size = pbest->active.size();
-
-        // remove *rpbest from active set,
-        // and adjust CPU time left for other results
-        //
-        it = active.begin();
-        while (it != active.end()) {
-            rp = *it;
-            if (rp == rpbest) {
-                it = active.erase(it);
-            } else {
-                x = rp->project->rrsim_proc_rate*rpbest->rrsim_finish_delay;
-                rp->rrsim_cpu_left -= x;
-                ++it;
-            }
-        }
-
-        // remove *rpbest from its project's active set
-        //
-        it = pbest->active.begin();
-        while (it != pbest->active.end()) {
-            rp = *it;
-            if (rp == rpbest) {
-                it = pbest->active.erase(it);
-            } else {
-                ++it;
-            }
-        }
+static void usage(char* prog) {
+    fprintf(stderr,
+        "usage: %s [--ncpus N] [--ngpus N] [--nprojects N] [--njobs N]\n"
+        "    [--niters N] [--max_time X] [--verbose]\n",
+        prog
+    );
+    exit(1);
+}
 
-        // If project has more results, add one to active set.
-        //
-        if (pbest->pending.size()) {
-            rp = pbest->pending[0];
-            pbest->pending.erase(pbest->pending.begin());
-            active.push_back(rp);
-            pbest->active.push_back(rp);
-        }
+int main(int argc, char** argv) {
+    int ncpus = 256, ngpus = 4, nprojects = 10, njobs = 5000, niters = 10;
+    double max_time = 0;
+    bool verbose = false;
+    int i;
 
-        // If all work done for a project, subtract that project's share
-        // and recompute processing rates
-        //
-        if (pbest->active.size() == 0) {
-            rrs -= pbest->resource_share;
-            if (log_flags.rr_simulation) {
-                msg_printf(pbest, MSG_INFO,
-                    "rr_sim: decr rrs by %f, new value %f",
-                    pbest->resource_share, rrs
-                );
-            }
-            for (i=0; i<projects.size(); i++) {
-                p = projects[i];
-                p->set_rrsim_proc_rate(rrs);
-            }
+    for (i=1; i<argc; i++) {
+        if (!strcmp(argv[i], "--verbose")) {
+            verbose = true;
+            continue;
         }
-
-        // increment CPU shortfalls if necessary
-        //
-        if (sim_now < buf_end) {
-            double end_time = sim_now + rpbest->rrsim_finish_delay;
-            if (end_time > buf_end) end_time = buf_end;
-            double d_time = end_time - sim_now;
-            int nidle_cpus = ncpus - last_active_size;
-            if (nidle_cpus<0) nidle_cpus = 0;
-            if (nidle_cpus > 0) cpu_shortfall += d_time*nidle_cpus;
-
-            double rsf = trs?pbest->resource_share/trs:1;
-            double proj_cpu_share = ncpus*rsf;
-
-            if (last_proj_active_size < proj_cpu_share) {
-                pbest->cpu_shortfall += d_time*(proj_cpu_share - last_proj_active_size);
-                if (log_flags.rr_simulation) {
-                    msg_printf(pbest, MSG_INFO,
-                        "rr_sim: new shortfall %f d_time %f proj_cpu_share %f lpas %d",
-                        pbest->cpu_shortfall, d_time, proj_cpu_share, last_proj_active_size
-                    );
-                }
-            }
-
-            if (end_time < buf_end) {
-                d_time = buf_end - end_time;
-                // if this is the last result for this project, account for the tail
-                if (!pbest->active.size()) { 
-                    pbest->cpu_shortfall += d_time * proj_cpu_share;
-                    if (log_flags.rr_simulation) {
-                         msg_printf(pbest, MSG_INFO, "rr_sim proj out of work; shortfall %f d %f pcs %f",
-                             pbest->cpu_shortfall, d_time, proj_cpu_share
-                         );
-                    }
-                }
-            }
-            if (log_flags.rr_simulation) {
-                msg_printf(0, MSG_INFO,
-                    "rr_sim total: idle cpus %d, last active %d, active %d, shortfall %f",
-                    nidle_cpus, last_active_size, (int)active.size(), cpu_shortfall
-                    
-                );
-                msg_printf(0, MSG_INFO,
-                    "rr_sim proj %s: last active %d, active %d, shortfall %f",
-                    pbest->get_project_name(), last_proj_active_size, (int)pbest->active.size(),
-                    pbest->cpu_shortfall
-                );
-            }
+        if (i+1 >= argc) usage(argv[0]);
+        if (!strcmp(argv[i], "--ncpus")) {
+            ncpus = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--ngpus")) {
+            ngpus = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--nprojects")) {
+            nprojects = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--njobs")) {
+            njobs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--niters")) {
+            niters = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--max_time")) {
+            max_time = atof(argv[++i]);
+        } else {
+            usage(argv[0]);
         }
-
-        sim_now += rpbest->rrsim_finish_delay;
-    }
-
-    if (sim_now < buf_end) {
-        cpu_shortfall += (buf_end - sim_now) * ncpus;
     }
-
-    if (log_flags.rr_simulation) {
-        for (i=0; i<projects.size(); i++) {
-            p = projects[i];
-            if (p->cpu_shortfall) {
-                msg_printf(p, MSG_INFO,
-                    "rr_sim: shortfall %f\n", p->cpu_shortfall
-                );
-            }
-        }
-        msg_printf(NULL, MSG_INFO,
-            "rr_simulation: end; returning %s; total shortfall %f\n",
-            rval?"true":"false",
-            cpu_shortfall
-        );
+    if (ncpus <= 0 || nprojects <= 0 || njobs <= 0 || niters <= 0) {
+        usage(argv[0]);
     }
-    return rval;
-}
-
-////////////////////// END CUT AND PASTE ////////////////
 
-int main() {
-    PROJECT* p;
-    RESULT* r;
-    log_flags.rr_simulation = true;
-
-    gstate.global_prefs.work_buf_min_days = 1;
-    gstate.global_prefs.work_buf_additional_days = 1;
-    gstate.global_prefs.cpu_scheduling_period_minutes = 60;
-    gstate.ncpus = 1;
-    gstate.now = 0;
+    logfile = stdout;
+    srand(1);       // make it deterministic
+    gstate.now = 1e9;
+    make_host(ncpus, ngpus);
+    make_workload(nprojects, njobs);
 
-    p = new PROJECT("project A", 33.);
-    gstate.projects.push_back(p);
-
-    r = new RESULT(p, "result 1", 9, 1e6);
-    gstate.results.push_back(r);
-    r = new RESULT(p, "result 2", 9, 1e6);
-    gstate.results.push_back(r);
-    r = new RESULT(p, "result 3", 9, 1e6);
-    gstate.results.push_back(r);
+    printf("%d CPUs, %d GPUs, %d projects, %d jobs\n",
+        ncpus, ngpus, nprojects, njobs
+    );
+    start_jobs();
+    log_flags.rr_simulation = verbose;
 
-    p = new PROJECT("project B", 33.);
-    gstate.projects.push_back(p);
-    r = new RESULT(p, "result 4", 20, 1e6);
-    gstate.results.push_back(r);
+    // a simulation at a later time can't use the previous results
+    //
+    double t0 = dtime();
+    for (i=0; i<niters; i++) {
+        gstate.now += 60;
+        rr_simulation();
+    }
+    double t = (dtime() - t0)/niters;
 
-    p = new PROJECT("project C", 33.);
-    gstate.projects.push_back(p);
-    r = new RESULT(p, "result 5", 30, 1e6);
-    gstate.results.push_back(r);
+    // at the same time with nothing changed, it can
+    //
+    t0 = dtime();
+    rr_simulation();
+    double t_cached = dtime() - t0;
 
-    gstate.rr_simulation();
+    // time the job scheduler's choice of jobs;
+    // the simulation it does first reuses the above results
+    //
+    vector<RESULT*> run_list;
+    t0 = dtime();
+    for (i=0; i<niters; i++) {
+        run_list.clear();
+        gstate.make_run_list(run_list);
+    }
+    double t_run_list = (dtime() - t0)/niters;
+
+    print_results();
+    print_run_list(run_list, verbose);
+    printf("simulation: %f sec; unchanged inputs: %f sec\n", t, t_cached);
+    printf("run list: %f sec\n", t_run_list);
+    if (max_time && (t > max_time || t_run_list > max_time)) {
+        printf("FAIL: took more than %f sec\n", max_time);
+        return 1;
+    }
+    return 0;
 }
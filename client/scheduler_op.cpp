@@ -19,12 +19,15 @@
 
 #ifdef _WIN32
 #include "boinc_win.h"
+#include "zlib.h"
 #else
 #include "config.h"
 #include <cmath>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <ctime>
+#include <zlib.h>
 #endif
 
 #ifdef _MSC_VER
@@ -231,6 +234,55 @@ static void request_string(char* buf, int len) {
     }
 }
 
+// gzip a scheduler request file
+//
+static int gzip_request_file(const char* path, const char* gzpath) {
+    unsigned char inbuf[16384], outbuf[16384];
+    z_stream zs;
+    int flush, zret = Z_OK, retval = 0;
+
+    FILE* in = boinc_fopen(path, "rb");
+    if (!in) return ERR_FOPEN;
+    FILE* out = boinc_fopen(gzpath, "wb");
+    if (!out) {
+        fclose(in);
+        return ERR_FOPEN;
+    }
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+        16+MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK
+    ) {
+        fclose(in);
+        fclose(out);
+        return ERR_WRITE;
+    }
+    do {
+        size_t n = fread(inbuf, 1, sizeof(inbuf), in);
+        if (ferror(in)) {
+            retval = ERR_READ;
+            break;
+        }
+        flush = feof(in)?Z_FINISH:Z_NO_FLUSH;
+        zs.next_in = inbuf;
+        zs.avail_in = (uInt)n;
+        do {
+            zs.next_out = outbuf;
+            zs.avail_out = sizeof(outbuf);
+            zret = deflate(&zs, flush);
+            size_t m = sizeof(outbuf) - zs.avail_out;
+            if (fwrite(outbuf, 1, m, out) != m) {
+                retval = ERR_WRITE;
+                break;
+            }
+        } while (zs.avail_out == 0);
+    } while (!retval && flush != Z_FINISH);
+    deflateEnd(&zs);
+    fclose(in);
+    if (fclose(out)) retval = ERR_WRITE;
+    if (!retval && zret != Z_STREAM_END) retval = ERR_WRITE;
+    return retval;
+}
+
 // low-level routine to initiate an RPC
 // If successful, creates an HTTP_OP that must be polled
 // PRECONDITION: the request file has been created
@@ -279,9 +331,29 @@ int SCHEDULER_OP::start_rpc(PROJECT* p) {
     get_sched_request_filename(*p, request_file, sizeof(request_file));
     get_sched_reply_filename(*p, reply_file, sizeof(reply_file));
 
+    // if the scheduler accepts it, send the request gzipped
+    //
+    bool gzipped = false;
+    if (p->gzip_sched_request) {
+        int n = snprintf(buf, sizeof(buf), "%s.gz", request_file);
+        if (n < 0 || n >= (int)sizeof(buf)) {
+            // path too long; send it uncompressed
+        } else if (!gzip_request_file(request_file, buf)) {
+            safe_strcpy(request_file, buf);
+            gzipped = true;
+        } else {
+            boinc_delete_file(buf);
+        }
+    }
+
     cur_proj = p;
-    retval = http_op.init_post(p, scheduler_url, request_file, reply_file);
+    retval = http_op.init_post(
+        p, scheduler_url, request_file, reply_file, gzipped
+    );
     if (retval) {
+        if (gzipped) {
+            boinc_delete_file(request_file);
+        }
         if (log_flags.sched_ops) {
             msg_printf(p, MSG_INFO,
                 "Scheduler request initialization failed: %s", boincerror(retval)
@@ -483,6 +555,9 @@ bool SCHEDULER_OP::poll() {
         if (http_op.http_op_state == HTTP_STATE_DONE) {
             state = SCHEDULER_OP_STATE_IDLE;
             http_ops->remove(&http_op);
+            if (http_op.gzip_request) {
+                boinc_delete_file(http_op.infile);
+            }
             if (http_op.http_op_retval) {
                 if (log_flags.sched_ops) {
                     msg_printf(cur_proj, MSG_INFO,
@@ -490,6 +565,14 @@ bool SCHEDULER_OP::poll() {
                     );
                 }
 
+                // If the server rejected a gzipped request
+                // (e.g. a proxy or a downgraded scheduler)
+                // send uncompressed ones until it says otherwise
+                //
+                if (http_op.gzip_request && http_op.response >= 400) {
+                    cur_proj->gzip_sched_request = false;
+                }
+
                 // scheduler RPC failed.  Try another scheduler if one exists
                 //
                 while (1) {
@@ -554,6 +637,7 @@ void SCHEDULER_REPLY::clear() {
     send_file_list = false;
     send_full_workload = false;
     dont_use_dcf = false;
+    gzip_sched_request = false;
     send_time_stats_log = 0;
     send_job_log = 0;
     scheduler_version = 0;
@@ -892,6 +976,8 @@ int SCHEDULER_REPLY::parse(FILE* in, PROJECT* project) {
             continue;
         } else if (xp.parse_bool("dont_use_dcf", dont_use_dcf)) {
             continue;
+        } else if (xp.parse_bool("gzip_sched_request", gzip_sched_request)) {
+            continue;
         } else if (xp.parse_int("send_time_stats_log", send_time_stats_log)){
             continue;
         } else if (xp.parse_int("send_job_log", send_job_log)) {
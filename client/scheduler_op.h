@@ -124,6 +124,7 @@ struct SCHEDULER_REPLY {
     bool send_file_list;      
     bool send_full_workload;      
     bool dont_use_dcf;      
+    bool gzip_sched_request;
     int send_time_stats_log;
     int send_job_log;
     int scheduler_version;
@@ -54,8 +54,24 @@
 //      use only RR scheduling
 //  [--rec_half_life X]
 //      half-life of recent est credit
+//
+//  Batch mode:
+//  [--batch F]
+//      Simulate each scenario listed in F under each policy listed in F,
+//      in parallel, and write a summary (batch.xml) of the results:
+//      figures of merit, deadline misses, and wall time per simulated day.
+//      This can be used to compare policies,
+//      or as a benchmark of the client's scheduling code.
+//      Per-simulation output files have prefix sN_policy_.
+//      Not supported on Windows.
+//  [--nprocs N]
+//      run at most N simulations at once (default: # of CPUs)
 
 #include <cmath>
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #include "error_numbers.h"
 #include "str_replace.h"
@@ -86,6 +102,7 @@ const char* outfile_prefix = "./";
 #define RESULTS_TXT_FNAME "results.txt"
 #define SUMMARY_FNAME "summary.txt"
 #define REC_FNAME "rec.dat"
+#define BATCH_FNAME "batch.xml"
 
 bool user_active;
 double duration = 86400, delta = 60;
@@ -103,6 +120,8 @@ bool server_uses_workload = false;
 bool cpu_sched_rr_only = false;
 bool existing_jobs_only = false;
 bool include_empty_projects;
+const char* batch_file = NULL;
+int batch_nprocs = 0;
 
 RANDOM_PROCESS on_proc;
 RANDOM_PROCESS active_proc;
@@ -127,7 +146,9 @@ void usage(char* prog) {
         "[--delta X]\n"
         "[--server_uses_workload]\n"
         "[--cpu_sched_rr_only]\n"
-        "[--rec_half_life X]\n",
+        "[--rec_half_life X]\n"
+        "[--batch F]\n"
+        "[--nprocs N]\n",
         prog
     );
     exit(1);
@@ -279,6 +300,7 @@ void CLIENT_STATE::handle_completed_results(PROJECT* p) {
                 spp->project_results.nresults_met_deadline++;
             }
             html_msg += buf;
+            unindex_result(rp);
             delete rp;
             result_iter = results.erase(result_iter);
         } else {
@@ -438,6 +460,7 @@ bool CLIENT_STATE::simulate_rpc(PROJECT* p) {
         sent_something = true;
         rp->set_state(RESULT_FILES_DOWNLOADED, "simulate_rpc");
         results.push_back(rp);
+        index_result(rp);
         new_results.push_back(rp);
 #if 0
         sprintf(buf, "got job %s: CPU time %.2f, deadline %s<br>",
@@ -1038,8 +1061,9 @@ void make_graph(const char* title, const char* fname, int field) {
 
 static void write_inputs() {
     char buf[256];
-    sprintf(buf, "%s/%s", outfile_prefix, INPUTS_FNAME);
+    sprintf(buf, "%s%s", outfile_prefix, INPUTS_FNAME);
     FILE* f = fopen(buf, "w");
+    if (!f) return;
     fprintf(f,
         "Existing jobs only: %s\n"
         "Round-robin only: %s\n"
@@ -1369,6 +1393,7 @@ void cull_projects() {
     while (ri != gstate.results.end()) {
         RESULT* rp = *ri;
         if (rp->project->ignore) {
+            gstate.unindex_result(rp);
             ri = gstate.results.erase(ri);
         } else {
             ++ri;
@@ -1525,17 +1550,16 @@ char* next_arg(int argc, char** argv, int& i) {
     return argv[i++];
 }
 
-int main(int argc, char** argv) {
-    int i;
-    char buf[256];
-
-    sim_results.clear();
-    for (i=1; i<argc;) {
+// parse options starting at argv[i].
+// In batch mode this is also used for policy options.
+//
+void parse_options(int argc, char** argv, int i) {
+    while (i<argc) {
         char* opt = argv[i++];
         if (!strcmp(opt, "--infile_prefix")) {
-            infile_prefix = argv[i++];
+            infile_prefix = next_arg(argc, argv, i);
         } else if (!strcmp(opt, "--outfile_prefix")) {
-            outfile_prefix = argv[i++];
+            outfile_prefix = next_arg(argc, argv, i);
         } else if (!strcmp(opt, "--existing_jobs_only")) {
             existing_jobs_only = true;
         } else if (!strcmp(opt, "--duration")) {
@@ -1549,7 +1573,11 @@ int main(int argc, char** argv) {
         } else if (!strcmp(opt, "--include_empty_projects")) {
             include_empty_projects = true;
         } else if (!strcmp(opt, "--rec_half_life")) {
-            cc_config.rec_half_life = atof(argv[i++]);
+            cc_config.rec_half_life = atof(next_arg(argc, argv, i));
+        } else if (!strcmp(opt, "--batch")) {
+            batch_file = next_arg(argc, argv, i);
+        } else if (!strcmp(opt, "--nprocs")) {
+            batch_nprocs = atoi(next_arg(argc, argv, i));
         } else {
             usage(argv[0]);
         }
@@ -1563,6 +1591,10 @@ int main(int argc, char** argv) {
         fprintf(stderr, "delta <= 0\n");
         exit(1);
     }
+}
+
+void run_simulation() {
+    char buf[256];
 
     sprintf(buf, "%s%s", outfile_prefix, "index.html");
     index_file = fopen(buf, "w");
@@ -1584,3 +1616,350 @@ int main(int argc, char** argv) {
     srand(1);       // make it deterministic
     do_client_simulation();
 }
+
+// Batch mode: simulate each scenario under each policy,
+// several at a time, and write a summary of the results.
+// The simulator's state (gstate etc.) is global,
+// so each simulation runs in a separate process.
+//
+// The batch file has lines of the form
+//      scenario dir/
+//          an input file prefix
+//      policy name [options]
+//          a name, and options (as above) for the simulations
+// Blank lines and lines starting with # are ignored.
+// If there are no policy lines, the command-line options are used.
+//
+struct BATCH_POLICY {
+    string name;
+    vector<string> args;
+};
+
+struct BATCH_SIM {
+    int scenario;
+    int policy;
+    char outfile_prefix[256];
+    int pid;
+    int fd;             // read end of pipe from child
+    int status;         // 0 if simulation finished
+    SIM_RESULTS results;
+    double duration;
+    double wall_time;
+    double cpu_time;
+};
+
+vector<string> batch_scenarios;
+vector<BATCH_POLICY> batch_policies;
+
+void read_batch_file() {
+    char buf[1024];
+    FILE* f = fopen(batch_file, "r");
+    if (!f) {
+        fprintf(stderr, "Can't open %s\n", batch_file);
+        exit(1);
+    }
+    while (fgets(buf, sizeof(buf), f)) {
+        vector<string> words;
+        char* p = strtok(buf, " \t\r\n");
+        while (p) {
+            words.push_back(p);
+            p = strtok(NULL, " \t\r\n");
+        }
+        if (words.empty() || words[0][0] == '#') continue;
+        if (words[0] == "scenario" && words.size() == 2) {
+            batch_scenarios.push_back(words[1]);
+        } else if (words[0] == "policy" && words.size() >= 2) {
+            BATCH_POLICY bp;
+            bp.name = words[1];
+            bp.args.assign(words.begin()+2, words.end());
+            batch_policies.push_back(bp);
+        } else {
+            fprintf(stderr, "%s: bad line: %s\n", batch_file, words[0].c_str());
+            exit(1);
+        }
+    }
+    fclose(f);
+    if (batch_scenarios.empty()) {
+        fprintf(stderr, "%s: no scenarios\n", batch_file);
+        exit(1);
+    }
+    if (batch_policies.empty()) {
+        BATCH_POLICY bp;
+        bp.name = "default";
+        batch_policies.push_back(bp);
+    }
+}
+
+#ifndef _WIN32
+
+// runs in the child process: do the simulation
+// and write its results to the pipe
+//
+void batch_child(BATCH_SIM& bs, char* prog, int fd) {
+    BATCH_POLICY& bp = batch_policies[bs.policy];
+    vector<char*> argv;
+    unsigned int i;
+
+    argv.push_back(prog);
+    for (i=0; i<bp.args.size(); i++) {
+        argv.push_back((char*)bp.args[i].c_str());
+    }
+    parse_options((int)argv.size(), &argv[0], 1);
+    infile_prefix = batch_scenarios[bs.scenario].c_str();
+    outfile_prefix = bs.outfile_prefix;
+
+    double t0 = dtime();
+    run_simulation();
+    double cpu_time;
+    boinc_calling_thread_cpu_time(cpu_time);
+
+    FILE* f = fdopen(fd, "w");
+    fprintf(f, "%f %f %f %f %d %d %f %f %f\n",
+        sim_results.wasted_frac, sim_results.idle_frac,
+        sim_results.share_violation, sim_results.monotony,
+        sim_results.nresults_met_deadline,
+        sim_results.nresults_missed_deadline,
+        duration, dtime() - t0, cpu_time
+    );
+    fclose(f);
+
+    // _exit() doesn't flush stdio buffers; the output files are still open
+    //
+    fflush(NULL);
+    _exit(0);
+}
+
+void batch_start(BATCH_SIM& bs, char* prog) {
+    int fds[2];
+    if (pipe(fds)) {
+        perror("pipe");
+        exit(1);
+    }
+    fflush(stdout);
+    fflush(stderr);
+    bs.pid = fork();
+    if (bs.pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+    if (bs.pid == 0) {
+        close(fds[0]);
+        batch_child(bs, prog, fds[1]);
+    }
+    close(fds[1]);
+    bs.fd = fds[0];
+}
+
+void batch_finish(BATCH_SIM& bs, int status) {
+    char buf[256];
+    int n = 0;
+    FILE* f = fdopen(bs.fd, "r");
+    if (f) {
+        if (fgets(buf, sizeof(buf), f)) {
+            n = sscanf(buf, "%lf %lf %lf %lf %d %d %lf %lf %lf",
+                &bs.results.wasted_frac, &bs.results.idle_frac,
+                &bs.results.share_violation, &bs.results.monotony,
+                &bs.results.nresults_met_deadline,
+                &bs.results.nresults_missed_deadline,
+                &bs.duration, &bs.wall_time, &bs.cpu_time
+            );
+        }
+        fclose(f);
+    } else {
+        close(bs.fd);
+    }
+    if (WIFEXITED(status)) {
+        bs.status = WEXITSTATUS(status);
+    } else {
+        bs.status = ERR_EXEC;
+    }
+    if (!bs.status && n != 9) bs.status = ERR_XML_PARSE;
+    printf("%s %s: ",
+        batch_scenarios[bs.scenario].c_str(),
+        batch_policies[bs.policy].name.c_str()
+    );
+    if (bs.status) {
+        printf("failed (%d); see %s%s\n", bs.status, bs.outfile_prefix, LOG_FNAME);
+    } else {
+        printf("idle %f wasted %f sv %f missed %d; %.2f sec\n",
+            bs.results.idle_frac, bs.results.wasted_frac,
+            bs.results.share_violation, bs.results.nresults_missed_deadline,
+            bs.wall_time
+        );
+    }
+}
+
+#endif
+
+void print_batch_results(FILE* f, vector<BATCH_SIM>& sims, double wall_time) {
+    char buf[1024];
+    unsigned int i, j;
+
+    fprintf(f,
+        "<sim_batch>\n"
+        "    <nprocs>%d</nprocs>\n"
+        "    <wall_time>%f</wall_time>\n",
+        batch_nprocs, wall_time
+    );
+    for (i=0; i<sims.size(); i++) {
+        BATCH_SIM& bs = sims[i];
+        xml_escape(batch_scenarios[bs.scenario].c_str(), buf, sizeof(buf));
+        fprintf(f,
+            "    <sim>\n"
+            "        <scenario>%s</scenario>\n",
+            buf
+        );
+        xml_escape(batch_policies[bs.policy].name.c_str(), buf, sizeof(buf));
+        fprintf(f,
+            "        <policy>%s</policy>\n"
+            "        <status>%d</status>\n",
+            buf, bs.status
+        );
+        if (!bs.status) {
+            fprintf(f,
+                "        <wasted_frac>%f</wasted_frac>\n"
+                "        <idle_frac>%f</idle_frac>\n"
+                "        <share_violation>%f</share_violation>\n"
+                "        <monotony>%f</monotony>\n"
+                "        <deadlines_met>%d</deadlines_met>\n"
+                "        <deadlines_missed>%d</deadlines_missed>\n"
+                "        <duration>%f</duration>\n"
+                "        <wall_time>%f</wall_time>\n"
+                "        <cpu_time>%f</cpu_time>\n"
+                "        <wall_time_per_day>%f</wall_time_per_day>\n",
+                bs.results.wasted_frac, bs.results.idle_frac,
+                bs.results.share_violation, bs.results.monotony,
+                bs.results.nresults_met_deadline,
+                bs.results.nresults_missed_deadline,
+                bs.duration, bs.wall_time, bs.cpu_time,
+                bs.wall_time*86400/bs.duration
+            );
+        }
+        fprintf(f, "    </sim>\n");
+    }
+
+    // for each policy, the average figures of merit
+    // and the total deadline misses over scenarios
+    //
+    for (j=0; j<batch_policies.size(); j++) {
+        SIM_RESULTS total;
+        double wall_time_per_day = 0;
+        int n = 0, nfailed = 0;
+        total.clear();
+        for (i=0; i<sims.size(); i++) {
+            BATCH_SIM& bs = sims[i];
+            if (bs.policy != (int)j) continue;
+            if (bs.status) {
+                nfailed++;
+                continue;
+            }
+            total.add(bs.results);
+            total.nresults_met_deadline += bs.results.nresults_met_deadline;
+            total.nresults_missed_deadline += bs.results.nresults_missed_deadline;
+            wall_time_per_day += bs.wall_time*86400/bs.duration;
+            n++;
+        }
+        if (n) {
+            total.divide(n);
+            wall_time_per_day /= n;
+        }
+        xml_escape(batch_policies[j].name.c_str(), buf, sizeof(buf));
+        fprintf(f,
+            "    <policy_summary>\n"
+            "        <policy>%s</policy>\n"
+            "        <nsims>%d</nsims>\n"
+            "        <nfailed>%d</nfailed>\n"
+            "        <wasted_frac>%f</wasted_frac>\n"
+            "        <idle_frac>%f</idle_frac>\n"
+            "        <share_violation>%f</share_violation>\n"
+            "        <monotony>%f</monotony>\n"
+            "        <deadlines_met>%d</deadlines_met>\n"
+            "        <deadlines_missed>%d</deadlines_missed>\n"
+            "        <wall_time_per_day>%f</wall_time_per_day>\n"
+            "    </policy_summary>\n",
+            buf, n, nfailed,
+            total.wasted_frac, total.idle_frac,
+            total.share_violation, total.monotony,
+            total.nresults_met_deadline, total.nresults_missed_deadline,
+            wall_time_per_day
+        );
+    }
+    fprintf(f, "</sim_batch>\n");
+}
+
+int do_batch(char* prog) {
+#ifdef _WIN32
+    fprintf(stderr, "%s: --batch is not supported on Windows\n", prog);
+    return 1;
+#else
+    vector<BATCH_SIM> sims;
+    unsigned int i, j;
+    int nrunning = 0, nfailed = 0;
+    char buf[256];
+
+    read_batch_file();
+    if (batch_nprocs <= 0) {
+        batch_nprocs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (batch_nprocs <= 0) batch_nprocs = 1;
+    }
+    for (i=0; i<batch_scenarios.size(); i++) {
+        for (j=0; j<batch_policies.size(); j++) {
+            BATCH_SIM bs;
+            memset(&bs, 0, sizeof(bs));
+            bs.scenario = i;
+            bs.policy = j;
+            snprintf(bs.outfile_prefix, sizeof(bs.outfile_prefix),
+                "%ss%d_%s_", outfile_prefix, i, batch_policies[j].name.c_str()
+            );
+            sims.push_back(bs);
+        }
+    }
+
+    double t0 = dtime();
+    i = 0;
+    while (i < sims.size() || nrunning) {
+        if (i < sims.size() && nrunning < batch_nprocs) {
+            batch_start(sims[i++], prog);
+            nrunning++;
+            continue;
+        }
+        int status;
+        int pid = wait(&status);
+        if (pid < 0) {
+            perror("wait");
+            return 1;
+        }
+        for (j=0; j<i; j++) {
+            if (sims[j].pid == pid) {
+                batch_finish(sims[j], status);
+                if (sims[j].status) nfailed++;
+                nrunning--;
+                break;
+            }
+        }
+    }
+    double wall_time = dtime() - t0;
+
+    sprintf(buf, "%s%s", outfile_prefix, BATCH_FNAME);
+    FILE* f = fopen(buf, "w");
+    if (!f) {
+        fprintf(stderr, "Can't open %s\n", buf);
+        return 1;
+    }
+    print_batch_results(f, sims, wall_time);
+    fclose(f);
+    printf("%d simulations, %d failed, %.2f sec; results in %s\n",
+        (int)sims.size(), nfailed, wall_time, buf
+    );
+    return nfailed?1:0;
+#endif
+}
+
+int main(int argc, char** argv) {
+    sim_results.clear();
+    parse_options(argc, argv, 1);
+    if (batch_file) {
+        return do_batch(argv[0]);
+    }
+    run_simulation();
+}
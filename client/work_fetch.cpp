@@ -77,7 +77,6 @@ inline bool has_coproc_app(PROJECT* p, int rsc_type) {
 ///////////////  RSC_PROJECT_WORK_FETCH  ///////////////
 
 void RSC_PROJECT_WORK_FETCH::rr_init() {
-    fetchable_share = 0;
     n_runnable_jobs = 0;
     sim_nused = 0;
     nused_total = 0;
@@ -176,7 +175,6 @@ void RSC_WORK_FETCH::rr_init() {
     shortfall = 0;
     nidle_now = 0;
     sim_nused = 0;
-    total_fetchable_share = 0;
     deadline_missed_instances = 0;
     saturated_time = 0;
     busy_time_estimator.reset();
@@ -347,8 +345,7 @@ void PROJECT_WORK_FETCH::reset(PROJECT* p) {
     }
 }
 
-void PROJECT_WORK_FETCH::rr_init(PROJECT* p) {
-    project_reason = compute_project_reason(p);
+void PROJECT_WORK_FETCH::rr_init() {
     n_runnable_jobs = 0;
 }
 
@@ -379,7 +376,11 @@ void PROJECT_WORK_FETCH::print_state(PROJECT* p) {
 
 ///////////////  WORK_FETCH  ///////////////
 
-void WORK_FETCH::rr_init() {
+// Initialize the parts of work-fetch state that rr_simulation()
+// doesn't compute.
+// This is done even if rr_simulation() reuses its previous results.
+//
+void WORK_FETCH::rr_init_nonsim() {
     // compute PROJECT::RSC_PROJECT_WORK_FETCH::has_deferred_job
     //
     for (unsigned int i=0; i<gstate.projects.size(); i++) {
@@ -401,12 +402,26 @@ void WORK_FETCH::rr_init() {
         }
     }
 
+    for (int i=0; i<coprocs.n_rsc; i++) {
+        rsc_work_fetch[i].total_fetchable_share = 0;
+    }
+    for (unsigned int i=0; i<gstate.projects.size(); i++) {
+        PROJECT* p = gstate.projects[i];
+        p->pwf.project_reason = p->pwf.compute_project_reason(p);
+        for (int j=0; j<coprocs.n_rsc; j++) {
+            p->rsc_pwf[j].fetchable_share = 0;
+        }
+    }
+}
+
+void WORK_FETCH::rr_init() {
+    rr_init_nonsim();
     for (int i=0; i<coprocs.n_rsc; i++) {
         rsc_work_fetch[i].rr_init();
     }
     for (unsigned int i=0; i<gstate.projects.size(); i++) {
         PROJECT* p = gstate.projects[i];
-        p->pwf.rr_init(p);
+        p->pwf.rr_init();
         for (int j=0; j<coprocs.n_rsc; j++) {
             p->rsc_pwf[j].rr_init();
         }
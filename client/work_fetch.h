@@ -86,6 +86,8 @@ struct RSC_PROJECT_WORK_FETCH {
     int n_runnable_jobs;
     double sim_nused;
         // # of instances used at this point in the simulation
+    double sim_rec_temp;
+        // REC as adjusted by job selection in the simulation
     double nused_total;     // sum of instances over all runnable jobs
     int ncoprocs_excluded;
         // number of excluded instances
@@ -97,6 +99,9 @@ struct RSC_PROJECT_WORK_FETCH {
         // copy of the above used during schedule_cpus()
     std::deque<RESULT*> pending;
     std::deque<RESULT*>::iterator pending_iter;
+    bool pending_uniform;
+        // all pending jobs use the same app and resources.
+        // In rr_sim, if one finishes, the next one takes its place.
     bool has_deferred_job;
         // This project has a coproc job of the given type for which
         // the job is deferred because of a temporary_exit() call.
@@ -114,12 +119,14 @@ struct RSC_PROJECT_WORK_FETCH {
         fetchable_share = 0;
         n_runnable_jobs = 0;
         sim_nused = 0;
+        sim_rec_temp = 0;
         nused_total = 0;
         ncoprocs_excluded = 0;
         non_excluded_instances = 0;
         deadlines_missed = 0;
         deadlines_missed_copy = 0;
         pending.clear();
+        pending_uniform = false;
         has_deferred_job = false;
         rsc_project_reason = 0;
     }
@@ -305,7 +312,7 @@ struct PROJECT_WORK_FETCH {
         memset(this, 0, sizeof(*this));
     }
     void reset(PROJECT*);
-    void rr_init(PROJECT*);
+    void rr_init();
     void print_state(PROJECT*);
 };
 
@@ -332,6 +339,7 @@ struct WORK_FETCH {
     void print_state();
     void init();
     void rr_init();
+    void rr_init_nonsim();
     void clear_request();
     void compute_shares();
     void clear_backoffs(APP_VERSION&);
@@ -112,6 +112,7 @@ void BADGE_USER::clear() {memset(this, 0, sizeof(*this));}
 void BADGE_TEAM::clear() {memset(this, 0, sizeof(*this));}
 void CREDIT_USER::clear() {memset(this, 0, sizeof(*this));}
 void CREDIT_TEAM::clear() {memset(this, 0, sizeof(*this));}
+void CREDIT_JOURNAL::clear() {memset(this, 0, sizeof(*this));}
 void CONSENT_TYPE::clear() {memset(this, 0, sizeof(*this));}
 void DEVICE_STATUS::clear() {memset(this, 0, sizeof(*this));}
 
@@ -195,6 +196,8 @@ DB_CREDIT_USER::DB_CREDIT_USER(DB_CONN* dc) :
     DB_BASE("credit_user", dc?dc:&boinc_db){}
 DB_CREDIT_TEAM::DB_CREDIT_TEAM(DB_CONN* dc) :
     DB_BASE("credit_team", dc?dc:&boinc_db){}
+DB_CREDIT_JOURNAL::DB_CREDIT_JOURNAL(DB_CONN* dc) :
+    DB_BASE("credit_journal", dc?dc:&boinc_db){}
 DB_CONSENT_TYPE::DB_CONSENT_TYPE(DB_CONN* dc) :
     DB_BASE("consent_type", dc?dc:&boinc_db){}
 DB_DEVICE_STATUS::DB_DEVICE_STATUS(DB_CONN* dc) :
@@ -219,6 +222,7 @@ DB_ID_TYPE DB_FILESET::get_id() {return id;}
 DB_ID_TYPE DB_SCHED_TRIGGER::get_id() {return id;}
 DB_ID_TYPE DB_VDA_FILE::get_id() {return id;}
 DB_ID_TYPE DB_CONSENT_TYPE::get_id() {return id;}
+DB_ID_TYPE DB_CREDIT_JOURNAL::get_id() {return id;}
 
 void DB_PLATFORM::db_print(char* buf){
     sprintf(buf,
@@ -2946,6 +2950,38 @@ void DB_CREDIT_TEAM::db_parse(MYSQL_ROW &r) {
     credit_type = atoi(r[i++]);
 }
 
+void DB_CREDIT_JOURNAL::db_print(char* buf) {
+    sprintf(buf,
+        "create_time=%.15e, "
+        "userid=%lu, "
+        "teamid=%lu, "
+        "appid=%lu, "
+        "start_time=%.15e, "
+        "credit=%.15e, "
+        "by_app=%d ",
+        create_time,
+        userid,
+        teamid,
+        appid,
+        start_time,
+        credit,
+        by_app?1:0
+    );
+}
+
+void DB_CREDIT_JOURNAL::db_parse(MYSQL_ROW &r) {
+    int i=0;
+    clear();
+    id = atol(r[i++]);
+    create_time = atof(r[i++]);
+    userid = atol(r[i++]);
+    teamid = atol(r[i++]);
+    appid = atol(r[i++]);
+    start_time = atof(r[i++]);
+    credit = atof(r[i++]);
+    by_app = (atoi(r[i++]) != 0);
+}
+
 void DB_CONSENT_TYPE::db_print(char *buf) {
     sprintf(buf,
 	"id=%lu, "
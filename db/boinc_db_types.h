@@ -887,6 +887,25 @@ struct CREDIT_TEAM {
     void clear();
 };
 
+// a credit grant waiting to be applied to user and team totals
+//
+struct CREDIT_JOURNAL {
+    DB_ID_TYPE id;
+    double create_time;
+        // when credit was granted; used as "now" when updating averages
+    DB_ID_TYPE userid;
+    DB_ID_TYPE teamid;
+        // used only if by_app; otherwise the user's current team gets it
+    DB_ID_TYPE appid;
+    double start_time;
+        // when the work started (result.sent_time)
+    double credit;
+    bool by_app;
+        // if set, goes to credit_user and credit_team;
+        // otherwise to user.total_credit and team.total_credit
+    void clear();
+};
+
 struct CONSENT_TYPE {
     DB_ID_TYPE id;
     char shortname[256];
@@ -782,6 +782,22 @@ create table credit_team (
     primary key (teamid, appid, credit_type)
 ) engine=InnoDB;
 
+-- credit grants not yet folded into user/team/credit_user/credit_team.
+-- Written by the validator if <credit_journal> is set;
+-- processed and deleted by credit_aggregator.
+--
+create table credit_journal (
+    id                      integer         not null auto_increment,
+    create_time             double          not null,
+    userid                  integer         not null,
+    teamid                  integer         not null,
+    appid                   integer         not null,
+    start_time              double          not null,
+    credit                  double          not null,
+    by_app                  tinyint         not null,
+    primary key (id)
+) engine=InnoDB;
+
 create table token (
     token                   varchar(255)    not null,
     userid                  integer         not null,
@@ -1230,6 +1230,21 @@ SELECT userid,
     ");
 }
 
+function update_10_19_2026() {
+    do_query("create table credit_journal (
+        id                      integer         not null auto_increment,
+        create_time             double          not null,
+        userid                  integer         not null,
+        teamid                  integer         not null,
+        appid                   integer         not null,
+        start_time              double          not null,
+        credit                  double          not null,
+        by_app                  tinyint         not null,
+        primary key (id)
+        ) engine=InnoDB
+    ");
+}
+
 // Updates are done automatically if you use "upgrade".
 //
 // If you need to do updates manually,
@@ -1289,7 +1304,8 @@ $db_updates = array (
     array(27025, "update_4_19_2018"),
     array(27026, "update_5_9_2018"),
     array(27027, "update_8_23_2018"),
-    array(27028, "update_9_12_2018")
+    array(27028, "update_9_12_2018"),
+    array(27029, "update_10_19_2026")
 );
 
 ?>
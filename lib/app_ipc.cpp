@@ -21,8 +21,15 @@
 #include "stdwx.h"
 #else
 #include "config.h"
+#include <climits>
 #include <cstring>
+#include <ctime>
 #include <string>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 #endif
 
 #include "error_numbers.h"
@@ -72,6 +79,7 @@ void APP_INIT_DATA::copy(const APP_INIT_DATA& a) {
     safe_strcpy(result_name, a.result_name);
     safe_strcpy(authenticator, a.authenticator);
     memcpy(&shmem_seg_name, &a.shmem_seg_name, sizeof(SHMEM_SEG_NAME));
+    shmem_ext_size              = a.shmem_ext_size;
     safe_strcpy(gpu_type, a.gpu_type);
                 
     // use assignment for the rest, especially the classes
@@ -204,7 +212,8 @@ int write_init_data_file(FILE* f, APP_INIT_DATA& ai) {
         "<rsc_memory_bound>%f</rsc_memory_bound>\n"
         "<rsc_disk_bound>%f</rsc_disk_bound>\n"
         "<computation_deadline>%f</computation_deadline>\n"
-        "<vbox_window>%d</vbox_window>\n",
+        "<vbox_window>%d</vbox_window>\n"
+        "<shmem_ext_size>%d</shmem_ext_size>\n",
         ai.slot,
         ai.client_pid,
         ai.wu_cpu_time,
@@ -229,7 +238,8 @@ int write_init_data_file(FILE* f, APP_INIT_DATA& ai) {
         ai.rsc_memory_bound,
         ai.rsc_disk_bound,
         ai.computation_deadline,
-        ai.vbox_window
+        ai.vbox_window,
+        ai.shmem_ext_size
     );
     MIOFILE mf;
     mf.init_file(f);
@@ -295,6 +305,7 @@ void APP_INIT_DATA::clear() {
     gpu_usage = 0;
     ncpus = 0;
     memset(&shmem_seg_name, 0, sizeof(shmem_seg_name));
+    shmem_ext_size = 0;
     wu_cpu_time = 0;
     vbox_window = false;
 }
@@ -403,6 +414,7 @@ int parse_init_data_file(FILE* f, APP_INIT_DATA& ai) {
         if (xp.parse_double("fraction_done_start", ai.fraction_done_start)) continue;
         if (xp.parse_double("fraction_done_end", ai.fraction_done_end)) continue;
         if (xp.parse_bool("vbox_window", ai.vbox_window)) continue;
+        if (xp.parse_int("shmem_ext_size", ai.shmem_ext_size)) continue;
         xp.skip_unexpected(false, "parse_init_data_file");
     }
     fprintf(stderr, "%s: parse_init_data_file: no end tag\n",
@@ -411,7 +423,7 @@ int parse_init_data_file(FILE* f, APP_INIT_DATA& ai) {
     return ERR_XML_PARSE;
 }
 
-APP_CLIENT_SHM::APP_CLIENT_SHM() : shm(NULL) {
+APP_CLIENT_SHM::APP_CLIENT_SHM() : shm(NULL), shm_ext(NULL) {
 }
 
 bool MSG_CHANNEL::get_msg(char *msg) {
@@ -435,6 +447,105 @@ void MSG_CHANNEL::send_msg_overwrite(const char* msg) {
 
 void APP_CLIENT_SHM::reset_msgs() {
     memset(shm, 0, sizeof(SHARED_MEM));
+    if (shm_ext) {
+        memset(shm_ext, 0, sizeof(SHARED_MEM_EXT));
+    }
+}
+
+void APP_CLIENT_SHM::init_ext() {
+    shm_ext = (SHARED_MEM_EXT*)(shm + 1);
+}
+
+void APP_CLIENT_SHM::ring_doorbell() {
+    if (shm_ext) {
+        shm_ext->doorbell.ring();
+    }
+}
+
+void SHM_DOORBELL::ring() {
+#ifdef __linux__
+    __sync_fetch_and_add(&count, 1);
+    syscall(SYS_futex, &count, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+#ifdef __linux__
+// not affected by changes to the system clock
+//
+static double monotonic_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+#endif
+
+bool SHM_DOORBELL::wait(int& seqno, double timeout) {
+#ifdef __linux__
+    double deadline = monotonic_time() + timeout;
+    while (1) {
+        int n = count;
+        if (n != seqno) {
+            seqno = n;
+            return true;
+        }
+        double dt = deadline - monotonic_time();
+        if (dt <= 0) return false;
+        struct timespec ts;
+        ts.tv_sec = (time_t)dt;
+        ts.tv_nsec = (long)((dt - ts.tv_sec)*1e9);
+
+        // returns immediately if count is no longer n;
+        // otherwise sleeps until woken, interrupted, or timed out
+        //
+        syscall(SYS_futex, &count, FUTEX_WAIT, n, &ts, NULL, 0);
+    }
+#else
+    boinc_sleep(timeout);
+    return false;
+#endif
+}
+
+bool SHM_DOORBELL::works() {
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
+}
+
+static inline void memory_barrier() {
+#ifdef _WIN32
+    MemoryBarrier();
+#else
+    __sync_synchronize();
+#endif
+}
+
+void SHM_APP_STATUS::write(const APP_STATUS_DATA& d) {
+    seqno++;
+    memory_barrier();
+    memcpy((void*)&data, &d, sizeof(data));
+    memory_barrier();
+    seqno++;
+}
+
+bool SHM_APP_STATUS::read(APP_STATUS_DATA& d, int& last_seqno) {
+    // the app may be stopped in the middle of a write;
+    // if so, give up and try again next time
+    //
+    for (int i=0; i<100; i++) {
+        int n = seqno;
+        if (n == last_seqno) return false;
+        if (n & 1) continue;
+        memory_barrier();
+        memcpy(&d, (void*)&data, sizeof(d));
+        memory_barrier();
+        if (seqno == n) {
+            last_seqno = n;
+            return true;
+        }
+    }
+    return false;
 }
 
 // Resolve virtual name (in slot dir) to physical path (in project dir).
@@ -22,6 +22,7 @@
 
 #include <vector>
 #include <string>
+#include <cstddef>
 #include <cstdio>
 
 #include "filesys.h"
@@ -92,6 +93,7 @@ struct SHARED_MEM {
         // <checkpoint_cpu_time>...
         // <working_set_size>...
         // <fraction_done> ...
+        // Not used by apps that have SHARED_MEM_EXT::app_status
     MSG_CHANNEL trickle_up;
         // app->core
         // <have_new_trickle_up/>
@@ -100,6 +102,87 @@ struct SHARED_MEM {
         // <have_new_trickle_down/>
 };
 
+// A doorbell lets the client wake an app's timer thread
+// when it sends a message, rather than waiting for the app to poll.
+// The client rings it after writing to a channel;
+// the app waits on it (with a timeout) instead of sleeping.
+// It's a futex, so it works only on Linux;
+// elsewhere ring() does nothing and wait() just sleeps.
+//
+struct SHM_DOORBELL {
+    volatile int count;     // incremented on each ring
+
+    void ring();
+    bool wait(int& seqno, double timeout);
+        // wait until the doorbell has been rung since count was seqno,
+        // or for the timeout.
+        // Returns true (and updates seqno) if rung.
+    static bool works();
+};
+
+// An app's status, as reported every second.
+// Doubles come first, and the number of ints is even,
+// so that the layout is the same in 32- and 64-bit programs.
+//
+#define APP_STATUS_MAX_COUNTERS 8
+
+struct APP_STATUS_DATA {
+    double current_cpu_time;
+    double checkpoint_cpu_time;
+    double fraction_done;
+        // 0 if not reported yet
+    double bytes_sent;
+    double bytes_received;
+    double counters[APP_STATUS_MAX_COUNTERS];
+        // app-defined (see boinc_report_counter())
+    int ncounters;
+    int want_network;
+    int other_pid;
+        // 0 if none
+    int pad;
+};
+
+// The app's status in binary form, protected by a sequence lock:
+// the app (the only writer) makes seqno odd, writes the data,
+// then makes seqno even again.
+// The client copies the data and retries if seqno changed meanwhile.
+// Neither side blocks, and the client doesn't parse anything.
+//
+struct SHM_APP_STATUS {
+    volatile int seqno;
+    int pad;
+    APP_STATUS_DATA data;
+
+    void write(const APP_STATUS_DATA&);
+    bool read(APP_STATUS_DATA&, int& last_seqno);
+        // if the data has changed since last_seqno,
+        // copy it, update last_seqno, and return true
+};
+
+// Additions to shared memory, located after the SHARED_MEM.
+// Apps built with older versions of the API don't know about them,
+// and older clients don't provide them;
+// the client passes the size of this struct in APP_INIT_DATA,
+// and apps must check that a member is included (SHARED_MEM_EXT_HAS)
+// before using it.
+// Add new members at the end,
+// and make their layout the same in 32- and 64-bit programs.
+//
+struct SHARED_MEM_EXT {
+    SHM_DOORBELL doorbell;
+        // core->app: a message has been sent
+        // on process_control_request or trickle_down
+    int pad;
+    SHM_APP_STATUS app_status;
+        // app->core: replaces the app_status channel
+};
+
+#define SHARED_MEM_EXT_HAS(size, member) \
+    ((size) >= (int)(offsetof(SHARED_MEM_EXT, member) + sizeof(((SHARED_MEM_EXT*)0)->member)))
+
+#define SHMEM_SEG_SIZE (sizeof(SHARED_MEM) + sizeof(SHARED_MEM_EXT))
+    // size of the shared-memory segment created by the client
+
 // MSG_QUEUE provides a queuing mechanism for shared-mem messages
 // (which don't have one otherwise)
 //
@@ -122,8 +205,12 @@ struct MSG_QUEUE {
 class APP_CLIENT_SHM {
 public:
     SHARED_MEM *shm;
+    SHARED_MEM_EXT *shm_ext;
+        // NULL if the segment doesn't have one
 
     void reset_msgs();        // resets all messages and clears their flags
+    void init_ext();          // the segment has a SHARED_MEM_EXT; set shm_ext
+    void ring_doorbell();     // wake the app, if it's waiting for messages
 
     APP_CLIENT_SHM();
 };
@@ -211,6 +298,9 @@ struct APP_INIT_DATA {
     //
     double checkpoint_period;     // recommended checkpoint period
     SHMEM_SEG_NAME shmem_seg_name;
+    int shmem_ext_size;
+        // size of the SHARED_MEM_EXT in the segment;
+        // 0 for client versions that don't provide it
     double wu_cpu_time;       // cpu time from previous episodes
 
     APP_INIT_DATA();
@@ -210,10 +210,12 @@ void CC_CONFIG::defaults() {
     allow_multiple_clients = false;
     allow_remote_gui_rpc = false;
     alt_platforms.clear();
+    async_file_threads = 2;
     config_coprocs.clear();
     disallow_attach = false;
     dont_check_file_sizes = false;
     dont_contact_ref_site = false;
+    dont_dedup_files = false;
     lower_client_priority = false;
     dont_suspend_nci = false;
     dont_use_vbox = false;
@@ -227,25 +229,32 @@ void CC_CONFIG::defaults() {
     fetch_minimal_work = false;
     fetch_on_update = false;
     force_auth = "default";
+    hard_link_copied_files = false;
     http_1_0 = false;
+    http_pool_idle_timeout = 60;
+    http_pool_size = 4;
     http_transfer_timeout = 300;
     http_transfer_timeout_bps = 10;
     for (int i=1; i<NPROC_TYPES; i++) {
         ignore_gpu_instance[i].clear();
     }
+    max_download_segments = 4;
     max_event_log_lines = DEFAULT_MAX_EVENT_LOG_LINES;
     max_file_xfers = 8;
     max_file_xfers_per_project = 2;
     max_stderr_file_size = 0;
     max_stdout_file_size = 0;
     max_tasks_reported = 0;
+    max_upload_batch = 10;
     ncpus = -1;
     no_alt_platform = false;
+    no_cgroups = false;
     no_gpus = false;
     no_info_fetch = false;
     no_opencl = false;
     no_priority_change = false;
     os_random_only = false;
+    prestage_jobs = 0;
     process_priority = -1;
     process_priority_special = -1;
     proxy_info.clear();
@@ -257,9 +266,12 @@ void CC_CONFIG::defaults() {
 #endif
     run_apps_manually = false;
     save_stats_days = 30;
+    segmented_download_threshold = 1e8;
     simple_gui_only = false;
     skip_cpu_benchmarks = false;
     start_delay = 0;
+    state_journal = false;
+    state_snapshot = false;
     stderr_head = false;
     suppress_net_info = false;
     unsigned_apps_ok = false;
@@ -331,6 +343,7 @@ int CC_CONFIG::parse_options(XML_PARSER& xp) {
             alt_platforms.push_back(s);
             continue;
         }
+        if (xp.parse_int("async_file_threads", async_file_threads)) continue;
         if (xp.match_tag("coproc")) {
             COPROC c;
             retval = c.parse(xp);
@@ -343,6 +356,7 @@ int CC_CONFIG::parse_options(XML_PARSER& xp) {
         if (xp.parse_bool("disallow_attach", disallow_attach)) continue;
         if (xp.parse_bool("dont_check_file_sizes", dont_check_file_sizes)) continue;
         if (xp.parse_bool("dont_contact_ref_site", dont_contact_ref_site)) continue;
+        if (xp.parse_bool("dont_dedup_files", dont_dedup_files)) continue;
         if (xp.parse_bool("lower_client_priority", lower_client_priority)) continue;
         if (xp.parse_bool("dont_suspend_nci", dont_suspend_nci)) continue;
         if (xp.parse_bool("dont_use_vbox", dont_use_vbox)) continue;
@@ -380,7 +394,10 @@ int CC_CONFIG::parse_options(XML_PARSER& xp) {
             downcase_string(force_auth);
             continue;
         }
+        if (xp.parse_bool("hard_link_copied_files", hard_link_copied_files)) continue;
         if (xp.parse_bool("http_1_0", http_1_0)) continue;
+        if (xp.parse_int("http_pool_idle_timeout", http_pool_idle_timeout)) continue;
+        if (xp.parse_int("http_pool_size", http_pool_size)) continue;
         if (xp.parse_int("http_transfer_timeout", http_transfer_timeout)) continue;
         if (xp.parse_int("http_transfer_timeout_bps", http_transfer_timeout_bps)) continue;
         if (xp.parse_int("ignore_cuda_dev", n) || xp.parse_int("ignore_nvidia_dev", n)) {
@@ -395,19 +412,23 @@ int CC_CONFIG::parse_options(XML_PARSER& xp) {
             ignore_gpu_instance[PROC_TYPE_INTEL_GPU].push_back(n);
             continue;
         }
+        if (xp.parse_int("max_download_segments", max_download_segments)) continue;
         if (xp.parse_int("max_event_log_lines", max_event_log_lines)) continue;
         if (xp.parse_int("max_file_xfers", max_file_xfers)) continue;
         if (xp.parse_int("max_file_xfers_per_project", max_file_xfers_per_project)) continue;
         if (xp.parse_int("max_stderr_file_size", max_stderr_file_size)) continue;
         if (xp.parse_int("max_stdout_file_size", max_stdout_file_size)) continue;
         if (xp.parse_int("max_tasks_reported", max_tasks_reported)) continue;
+        if (xp.parse_int("max_upload_batch", max_upload_batch)) continue;
         if (xp.parse_int("ncpus", ncpus)) continue;
         if (xp.parse_bool("no_alt_platform", no_alt_platform)) continue;
+        if (xp.parse_bool("no_cgroups", no_cgroups)) continue;
         if (xp.parse_bool("no_gpus", no_gpus)) continue;
         if (xp.parse_bool("no_info_fetch", no_info_fetch)) continue;
         if (xp.parse_bool("no_opencl", no_opencl)) continue;
         if (xp.parse_bool("no_priority_change", no_priority_change)) continue;
         if (xp.parse_bool("os_random_only", os_random_only)) continue;
+        if (xp.parse_int("prestage_jobs", prestage_jobs)) continue;
         if (xp.parse_int("process_priority", process_priority)) continue;
         if (xp.parse_int("process_priority_special", process_priority_special)) continue;
 #ifndef SIM
@@ -424,9 +445,12 @@ int CC_CONFIG::parse_options(XML_PARSER& xp) {
         if (xp.parse_bool("report_results_immediately", report_results_immediately)) continue;
         if (xp.parse_bool("run_apps_manually", run_apps_manually)) continue;
         if (xp.parse_int("save_stats_days", save_stats_days)) continue;
+        if (xp.parse_double("segmented_download_threshold", segmented_download_threshold)) continue;
         if (xp.parse_bool("simple_gui_only", simple_gui_only)) continue;
         if (xp.parse_bool("skip_cpu_benchmarks", skip_cpu_benchmarks)) continue;
         if (xp.parse_double("start_delay", start_delay)) continue;
+        if (xp.parse_bool("state_journal", state_journal)) continue;
+        if (xp.parse_bool("state_snapshot", state_snapshot)) continue;
         if (xp.parse_bool("stderr_head", stderr_head)) continue;
         if (xp.parse_bool("suppress_net_info", suppress_net_info)) continue;
         if (xp.parse_bool("unsigned_apps_ok", unsigned_apps_ok)) continue;
@@ -519,6 +543,11 @@ int CC_CONFIG::write(MIOFILE& out, LOG_FLAGS& log_flags) {
         );
     }
 
+    out.printf(
+        "        <async_file_threads>%d</async_file_threads>\n",
+        async_file_threads
+    );
+
     for (int k=1; k<config_coprocs.n_rsc; k++) {
         if (!config_coprocs.coprocs[k].specified_in_config) continue;
         out.printf(
@@ -547,6 +576,7 @@ int CC_CONFIG::write(MIOFILE& out, LOG_FLAGS& log_flags) {
         "        <disallow_attach>%d</disallow_attach>\n"
         "        <dont_check_file_sizes>%d</dont_check_file_sizes>\n"
         "        <dont_contact_ref_site>%d</dont_contact_ref_site>\n"
+        "        <dont_dedup_files>%d</dont_dedup_files>\n"
         "        <lower_client_priority>%d</lower_client_priority>\n"
         "        <dont_suspend_nci>%d</dont_suspend_nci>\n"
         "        <dont_use_vbox>%d</dont_use_vbox>\n"
@@ -554,6 +584,7 @@ int CC_CONFIG::write(MIOFILE& out, LOG_FLAGS& log_flags) {
         disallow_attach,
         dont_check_file_sizes,
         dont_contact_ref_site,
+        dont_dedup_files,
         lower_client_priority,
         dont_suspend_nci,
         dont_use_vbox,
@@ -585,7 +616,10 @@ int CC_CONFIG::write(MIOFILE& out, LOG_FLAGS& log_flags) {
         "        <fetch_minimal_work>%d</fetch_minimal_work>\n"
         "        <fetch_on_update>%d</fetch_on_update>\n"
         "        <force_auth>%s</force_auth>\n"
+        "        <hard_link_copied_files>%d</hard_link_copied_files>\n"
         "        <http_1_0>%d</http_1_0>\n"
+        "        <http_pool_idle_timeout>%d</http_pool_idle_timeout>\n"
+        "        <http_pool_size>%d</http_pool_size>\n"
         "        <http_transfer_timeout>%d</http_transfer_timeout>\n"
         "        <http_transfer_timeout_bps>%d</http_transfer_timeout_bps>\n",
         exit_after_finish,
@@ -594,7 +628,10 @@ int CC_CONFIG::write(MIOFILE& out, LOG_FLAGS& log_flags) {
         fetch_minimal_work,
         fetch_on_update,
         force_auth.c_str(),
+        hard_link_copied_files,
         http_1_0,
+        http_pool_idle_timeout,
+        http_pool_size,
         http_transfer_timeout,
         http_transfer_timeout_bps
     );
@@ -621,34 +658,42 @@ int CC_CONFIG::write(MIOFILE& out, LOG_FLAGS& log_flags) {
     }
 
     out.printf(
+        "        <max_download_segments>%d</max_download_segments>\n"
         "        <max_event_log_lines>%d</max_event_log_lines>\n"
         "        <max_file_xfers>%d</max_file_xfers>\n"
         "        <max_file_xfers_per_project>%d</max_file_xfers_per_project>\n"
         "        <max_stderr_file_size>%d</max_stderr_file_size>\n"
         "        <max_stdout_file_size>%d</max_stdout_file_size>\n"
         "        <max_tasks_reported>%d</max_tasks_reported>\n"
+        "        <max_upload_batch>%d</max_upload_batch>\n"
         "        <ncpus>%d</ncpus>\n"
         "        <no_alt_platform>%d</no_alt_platform>\n"
+        "        <no_cgroups>%d</no_cgroups>\n"
         "        <no_gpus>%d</no_gpus>\n"
         "        <no_info_fetch>%d</no_info_fetch>\n"
         "        <no_opencl>%d</no_opencl>\n"
         "        <no_priority_change>%d</no_priority_change>\n"
         "        <os_random_only>%d</os_random_only>\n"
+        "        <prestage_jobs>%d</prestage_jobs>\n"
         "        <process_priority>%d</process_priority>\n"
         "        <process_priority_special>%d</process_priority_special>\n",
+        max_download_segments,
         max_event_log_lines,
         max_file_xfers,
         max_file_xfers_per_project,
         max_stderr_file_size,
         max_stdout_file_size,
         max_tasks_reported,
+        max_upload_batch,
         ncpus,
         no_alt_platform,
+        no_cgroups,
         no_gpus,
         no_info_fetch,
         no_opencl,
         no_priority_change,
         os_random_only,
+        prestage_jobs,
         process_priority,
         process_priority_special
     );
@@ -660,9 +705,12 @@ int CC_CONFIG::write(MIOFILE& out, LOG_FLAGS& log_flags) {
         "        <report_results_immediately>%d</report_results_immediately>\n"
         "        <run_apps_manually>%d</run_apps_manually>\n"
         "        <save_stats_days>%d</save_stats_days>\n"
+        "        <segmented_download_threshold>%.0f</segmented_download_threshold>\n"
         "        <skip_cpu_benchmarks>%d</skip_cpu_benchmarks>\n"
         "        <simple_gui_only>%d</simple_gui_only>\n"
         "        <start_delay>%f</start_delay>\n"
+        "        <state_journal>%d</state_journal>\n"
+        "        <state_snapshot>%d</state_snapshot>\n"
         "        <stderr_head>%d</stderr_head>\n"
         "        <suppress_net_info>%d</suppress_net_info>\n"
         "        <unsigned_apps_ok>%d</unsigned_apps_ok>\n"
@@ -674,9 +722,12 @@ int CC_CONFIG::write(MIOFILE& out, LOG_FLAGS& log_flags) {
         report_results_immediately,
         run_apps_manually,
         save_stats_days,
+        segmented_download_threshold,
         skip_cpu_benchmarks,
         simple_gui_only,
         start_delay,
+        state_journal,
+        state_snapshot,
         stderr_head,
         suppress_net_info,
         unsigned_apps_ok,
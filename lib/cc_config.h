@@ -146,10 +146,14 @@ struct CC_CONFIG {
     bool allow_multiple_clients;
     bool allow_remote_gui_rpc;
     std::vector<std::string> alt_platforms;
+    int async_file_threads;
+        // max number of threads doing large file copies and verifies;
+        // zero means do them in the main loop, 64KB at a time
     COPROCS config_coprocs;
     bool disallow_attach;
     bool dont_check_file_sizes;
     bool dont_contact_ref_site;
+    bool dont_dedup_files;
     bool dont_suspend_nci;
     bool dont_use_vbox;
     bool dont_use_wsl;
@@ -162,24 +166,44 @@ struct CC_CONFIG {
     bool fetch_minimal_work;
     bool fetch_on_update;
     std::string force_auth;
+    bool hard_link_copied_files;
+        // hard-link files that would be copied into slot dirs.
+        // Use only if apps don't modify their input files
     bool http_1_0;
+    int http_pool_idle_timeout;
+        // don't reuse HTTP connections idle longer than this
+    int http_pool_size;
+        // keep up to this many idle libcurl handles per server.
+        // 0: don't pool handles, and don't share TLS sessions
+        // and DNS lookups between transfers
     int http_transfer_timeout_bps;
     int http_transfer_timeout;
     std::vector<int> ignore_gpu_instance[NPROC_TYPES];
     bool lower_client_priority;
+    int max_download_segments;
+        // download large files in up to this many concurrent segments.
+        // 1: don't use segments
     int max_event_log_lines;
     int max_file_xfers;
     int max_file_xfers_per_project;
     int max_stderr_file_size;
     int max_stdout_file_size;
     int max_tasks_reported;
+    int max_upload_batch;
+        // send up to this many small uploads to a server in one request.
+        // 1: send each file separately
     int ncpus;
     bool no_alt_platform;
+    bool no_cgroups;
+        // (Linux) don't run tasks in their own cgroups
     bool no_gpus;
     bool no_info_fetch;
     bool no_opencl;
     bool no_priority_change;
     bool os_random_only;
+    int prestage_jobs;
+        // set up slot dirs for up to this many jobs likely to run next,
+        // if they need large files copied
     int process_priority;
     int process_priority_special;
     PROXY_INFO proxy_info;
@@ -187,9 +211,17 @@ struct CC_CONFIG {
     bool report_results_immediately;
     bool run_apps_manually;
     int save_stats_days;
+    double segmented_download_threshold;
+        // use segments for downloads at least this large (bytes)
     bool skip_cpu_benchmarks;
     bool simple_gui_only;
     double start_delay;
+    bool state_journal;
+        // append changed objects to a journal
+        // rather than rewriting the whole state file
+    bool state_snapshot;
+        // on exit, also write a binary snapshot of files and tasks;
+        // used on startup in place of parsing them from the state file
     bool stderr_head;
     bool suppress_net_info;
     bool unsigned_apps_ok;
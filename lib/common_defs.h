@@ -110,6 +110,21 @@
     // high-priority message from scheduler
     // (used internally within the client;
     // changed to MSG_USER_ALERT before passing to manager)
+
+// classes of events a GUI RPC connection can subscribe to
+// (see subscribe_events)
+//
+#define GUI_EVENT_TASK      1
+    // task started, suspended, exited etc. (<task_event>)
+#define GUI_EVENT_RESULT    2
+    // result state changed (<result_event>)
+#define GUI_EVENT_TRANSFER  4
+    // file transfer progress (<file_transfer>) and end (<transfer_done>)
+#define GUI_EVENT_MESSAGE   8
+    // new message (<msg>)
+#define GUI_EVENT_NOTICE    16
+    // new notice (<notice>)
+#define GUI_EVENT_ALL       31
     
 // values for suspend_reason, network_suspend_reason
 // Notes:
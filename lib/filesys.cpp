@@ -51,6 +51,12 @@
 #if HAVE_SYS_RESOURCE_H
 #include <sys/resource.h>
 #endif
+#if HAVE_SYS_IOCTL_H
+#include <sys/ioctl.h>
+#endif
+#if HAVE_LINUX_FS_H
+#include <linux/fs.h>
+#endif
 #if HAVE_SYS_MOUNT_H
 #if HAVE_SYS_PARAM_H
 #include <sys/param.h>
@@ -621,6 +627,17 @@ int boinc_copy(const char* orig, const char* newf) {
         fclose(src);
         return ERR_FOPEN;
     }
+
+    // If the filesystem can share the data (reflink)
+    // or copy it in the kernel, let it
+    //
+    retval = boinc_copy_fd(fileno(src), fileno(dst));
+    if (retval != ERR_NOT_IMPLEMENTED) {
+        fclose(src);
+        if (fclose(dst)) return ERR_FCLOSE;
+        return retval;
+    }
+    retval = 0;
     while (1) {
         n = fread(buf, 1, sizeof(buf), src);
         if (n <= 0) {
@@ -650,6 +667,59 @@ int boinc_copy(const char* orig, const char* newf) {
 #endif
 }
 
+#ifndef _WIN32
+// Copy the contents of one open file to another
+// without moving the data through user space:
+// first try a reflink (the files share data blocks until one is written;
+// btrfs, XFS, ...), then copy_file_range().
+// Both files must be at offset zero.
+// Return ERR_NOT_IMPLEMENTED if neither works and nothing was copied,
+// in which case the caller should copy the data itself.
+//
+int boinc_clone_fd(int from_fd, int to_fd) {
+#ifdef FICLONE
+    if (ioctl(to_fd, FICLONE, from_fd) == 0) return 0;
+#endif
+    return ERR_NOT_IMPLEMENTED;
+}
+
+int boinc_copy_fd(int from_fd, int to_fd) {
+    if (!boinc_clone_fd(from_fd, to_fd)) return 0;
+#ifdef HAVE_COPY_FILE_RANGE
+    bool copied_any = false;
+    while (1) {
+        ssize_t n = copy_file_range(from_fd, NULL, to_fd, NULL, 1<<30, 0);
+        if (n == 0) return 0;
+        if (n < 0) {
+            // not supported by the kernel or between these filesystems;
+            // that shows up on the first call
+            //
+            if (!copied_any) break;
+            return ERR_FWRITE;
+        }
+        copied_any = true;
+    }
+#endif
+    return ERR_NOT_IMPLEMENTED;
+}
+#endif
+
+// make a second name for an existing file (a hard link).
+// Both must be on the same filesystem
+//
+int boinc_hard_link(const char* existing, const char* newf) {
+#ifdef _WIN32
+    if (!CreateHardLinkA(newf, existing, NULL)) {
+        return ERR_SYMLINK;
+    }
+#else
+    if (link(existing, newf)) {
+        return ERR_SYMLINK;
+    }
+#endif
+    return 0;
+}
+
 #ifndef _WIN32
 // Copy file's ownership and permissions to the extent we are allowed
 //
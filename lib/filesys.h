@@ -50,11 +50,14 @@ extern "C" {
         // retry a few times on failure
         // Unix: set close-on-exec flag
     extern int boinc_copy(const char* orig, const char* newf);
+    extern int boinc_hard_link(const char* existing, const char* newf);
     extern int boinc_rename(const char* old, const char* newf);
     extern int boinc_mkdir(const char*);
 #ifdef _WIN32
     extern int boinc_allocate_file(const char*, double size);
 #else
+    extern int boinc_clone_fd(int from_fd, int to_fd);
+    extern int boinc_copy_fd(int from_fd, int to_fd);
     extern int boinc_copy_attributes(const char* orig, const char* newf);
     extern int boinc_chown(const char*, gid_t);
 #endif
@@ -340,6 +340,48 @@ int RPC_CLIENT::get_reply(char*& mbuf) {
     return 0;
 }
 
+// Once events are subscribed to, replies and event batches
+// can arrive back to back.
+// Get the next complete message whose root element is root_tag;
+// keep others (and partial messages) in recv_buf.
+//
+int RPC_CLIENT::get_message(const char* root_tag, string& msg, double timeout) {
+    char buf[8192];
+    char tag[256];
+    double end_time = dtime() + timeout;
+
+    snprintf(tag, sizeof(tag), "<%s>", root_tag);
+    while (1) {
+        size_t start = 0;
+        while (1) {
+            size_t end = recv_buf.find('\003', start);
+            if (end == string::npos) break;
+            size_t p = recv_buf.find(tag, start);
+            if (p != string::npos && p < end) {
+                msg = recv_buf.substr(start, end-start);
+                recv_buf.erase(start, end+1-start);
+                return 0;
+            }
+            start = end+1;
+        }
+
+        double left = end_time - dtime();
+        if (left < 0) left = 0;
+        fd_set read_fds;
+        struct timeval tv;
+        FD_ZERO(&read_fds);
+        FD_SET(sock, &read_fds);
+        tv.tv_sec = (long)left;
+        tv.tv_usec = (long)((left - tv.tv_sec)*1000000);
+        int n = select(sock+1, &read_fds, NULL, NULL, &tv);
+        if (n < 0) return ERR_SELECT;
+        if (n == 0) return ERR_TIMEOUT;
+        n = recv(sock, buf, sizeof(buf), 0);
+        if (n <= 0) return ERR_READ;
+        recv_buf.append(buf, n);
+    }
+}
+
 RPC::RPC(RPC_CLIENT* rc) : xp(&fin) {
     mbuf = 0;
     rpc_client = rc;
@@ -385,6 +385,37 @@ struct GR_PROXY_INFO {
     void clear();
 };
 
+// The delta forms of get_state(), get_results() and get_file_transfers()
+// return only the workunits, results or transfers that have changed
+// since the previous call, and the ones that have been deleted;
+// these are merged into the structure passed in.
+// Keep the structure from one call to the next;
+// the first call (or one after a client restart) gets everything.
+//
+struct DELTA_ITEM {
+    std::string project_url;
+    std::string name;
+};
+
+struct DELTA_INFO {
+    unsigned long long seqno;
+    double seqno_epoch;
+        // from the last reply; sent with the next request
+    bool full;
+        // the last reply was complete
+    std::vector<DELTA_ITEM> deleted_wus;
+    std::vector<DELTA_ITEM> deleted_results;
+    std::vector<DELTA_ITEM> deleted_file_transfers;
+
+    DELTA_INFO() {
+        clear();
+    }
+    void clear();
+    void request(const char* rpc_name, char* buf, int len);
+    bool parse_tag(XML_PARSER&);
+    bool parse_line(const char* buf, XML_PARSER&);
+};
+
 // Represents the entire client state.
 // Call get_state() infrequently.
 //
@@ -403,6 +434,7 @@ struct CC_STATE {
     TIME_STATS time_stats;
     bool have_nvidia;           // deprecated; include for compat (set by <have_cuda/>)
     bool have_ati;              // deprecated; include for compat
+    DELTA_INFO delta;
 
     CC_STATE();
 
@@ -422,6 +454,8 @@ struct CC_STATE {
     void print();
     void clear();
     int parse(XML_PARSER&);
+    int link_result(RESULT*, PROJECT*, WORKUNIT*);
+    void merge_delta(CC_STATE&);
     inline bool have_gpu() {
         return !host_info.coprocs.none()
             || have_nvidia || have_ati      // for old clients
@@ -454,6 +488,7 @@ struct DISK_USAGE {
 
 struct RESULTS {
     std::vector<RESULT*> results;
+    DELTA_INFO delta;
 
     RESULTS(){}
 
@@ -463,6 +498,7 @@ struct RESULTS {
 
 struct FILE_TRANSFERS {
     std::vector<FILE_TRANSFER*> file_transfers;
+    DELTA_INFO delta;
 
     FILE_TRANSFERS();
 
@@ -491,6 +527,47 @@ struct NOTICES {
     void clear();
 };
 
+// an event sent to a connection that did subscribe_events().
+// Which fields are used depends on the type
+//
+struct CC_EVENT {
+    int type;
+        // GUI_EVENT_*
+    std::string project_url;
+    std::string name;
+        // of the result (task, result) or file (transfer)
+    int active_task_state;
+    int scheduler_state;
+    double elapsed_time;
+    double fraction_done;
+        // task
+    int state;
+    int exit_status;
+        // result
+    bool transfer_done;
+        // transfer: if false, progress is in file_transfer
+    FILE_TRANSFER file_transfer;
+    bool is_upload;
+    int status;
+        // transfer done
+    MESSAGE msg;
+    NOTICE notice;
+
+    CC_EVENT();
+    void clear();
+};
+
+struct CC_EVENTS {
+    std::vector<CC_EVENT> events;
+    int dropped;
+        // the client discarded this many events because we fell behind;
+        // poll to get in sync
+
+    CC_EVENTS();
+    void clear();
+    int parse(XML_PARSER&);
+};
+
 struct ACCT_MGR_INFO {
     std::string acct_mgr_name;
     std::string acct_mgr_url;
@@ -670,9 +747,12 @@ struct RPC_CLIENT {
     double timeout;
     bool retry;
     sockaddr_storage addr;
+    std::string recv_buf;
+        // after subscribe_events(): data received but not yet returned
 
     int send_request(const char*);
     int get_reply(char*&);
+    int get_message(const char* root_tag, std::string&, double timeout);
     RPC_CLIENT();
     ~RPC_CLIENT();
     int get_ip_addr(const char* host, int port);
@@ -695,9 +775,12 @@ struct RPC_CLIENT {
     int authorize(const char* passwd);
     int exchange_versions(VERSION_INFO&);
     int get_state(CC_STATE&);
+    int get_state_delta(CC_STATE&);
     int get_results(RESULTS&, bool active_only = false);
+    int get_results_delta(RESULTS&);
     int get_old_results(std::vector<OLD_RESULT>&);
     int get_file_transfers(FILE_TRANSFERS&);
+    int get_file_transfers_delta(FILE_TRANSFERS&);
     int get_simple_gui_info(SIMPLE_GUI_INFO&);
     int get_project_status(PROJECTS&);
     int get_all_projects_list(ALL_PROJECTS_LIST&);
@@ -717,6 +800,13 @@ struct RPC_CLIENT {
     int get_message_count(int& seqno);
     int get_notices(int seqno, NOTICES&);
     int get_notices_public(int seqno, NOTICES&);
+    int subscribe_events(int mask);
+        // mask is GUI_EVENT_* bits; 0 to unsubscribe.
+        // The client then sends events on this connection;
+        // use only subscribe_events() and get_events() on it
+    int get_events(CC_EVENTS&, double timeout);
+        // wait up to timeout seconds for the next batch of events;
+        // return ERR_TIMEOUT if none
     int file_transfer_op(FILE_TRANSFER&, const char*);
     int result_op(RESULT&, const char*);
     int get_host_info(HOST_INFO&);
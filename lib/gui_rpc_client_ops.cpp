@@ -63,6 +63,8 @@
 #include <cstring>
 #include <locale>
 #include <algorithm>
+#include <map>
+#include <set>
 #endif
 
 #include "diagnostics.h"
@@ -81,6 +83,8 @@
 using std::string;
 using std::vector;
 using std::sort;
+using std::map;
+using std::set;
 
 int OLD_RESULT::parse(XML_PARSER& xp) {
     memset(this, 0, sizeof(OLD_RESULT));
@@ -907,6 +911,7 @@ int CC_STATE::parse(XML_PARSER& xp) {
         }
         if (xp.match_tag("/client_state")) break;
 
+        if (delta.parse_tag(xp)) continue;
         if (xp.parse_bool("executing_as_daemon", executing_as_daemon)) continue;
         if (xp.match_tag("project")) {
             project = new PROJECT();
@@ -970,34 +975,13 @@ int CC_STATE::parse(XML_PARSER& xp) {
                 delete result;
                 continue;
             }
-            result->project = project;
-            result->wup = lookup_wu(project, result->wu_name);
-            if (!result->wup) {
-                delete result;
-                continue;
-            }
-            result->app = result->wup->app;
-            APP_VERSION* avp;
-            if (strlen(result->platform)) {
-                avp = lookup_app_version(
-                    project, result->app,
-                    result->platform, result->version_num, result->plan_class
-                );
-            } else if (result->version_num) {
-                avp = lookup_app_version(
-                    project, result->app,
-                    result->version_num, result->plan_class
-                );
-            } else {
-                avp = lookup_app_version(
-                    project, result->app, result->wup->version_num
-                );
-            }
-            if (!avp) {
+            retval = link_result(
+                result, project, lookup_wu(project, result->wu_name)
+            );
+            if (retval) {
                 delete result;
                 continue;
             }
-            result->avp = avp;
             results.push_back(result);
             continue;
         }
@@ -1025,6 +1009,230 @@ int CC_STATE::parse(XML_PARSER& xp) {
     return 0;
 }
 
+// set a result's project, workunit, app and app version
+//
+int CC_STATE::link_result(RESULT* result, PROJECT* project, WORKUNIT* wup) {
+    if (!project || !wup) return ERR_NOT_FOUND;
+    result->project = project;
+    result->wup = wup;
+    result->app = wup->app;
+    APP_VERSION* avp;
+    if (strlen(result->platform)) {
+        avp = lookup_app_version(
+            project, result->app,
+            result->platform, result->version_num, result->plan_class
+        );
+    } else if (result->version_num) {
+        avp = lookup_app_version(
+            project, result->app,
+            result->version_num, result->plan_class
+        );
+    } else {
+        avp = lookup_app_version(
+            project, result->app, wup->version_num
+        );
+    }
+    if (!avp) return ERR_NOT_FOUND;
+    result->avp = avp;
+    return 0;
+}
+
+static string delta_key(const char* url, const char* name) {
+    return string(url) + " " + name;
+}
+
+// Replace this state with d, the reply to a get_state_delta().
+// If d is a delta, first move our workunits and results that
+// haven't changed or been deleted into d,
+// linking them to d's projects, apps and app versions.
+//
+void CC_STATE::merge_delta(CC_STATE& d) {
+    unsigned int i;
+    if (d.delta.seqno && !d.delta.full) {
+        set<string> remove;
+        map<string, WORKUNIT*> wu_map;
+        for (i=0; i<d.wus.size(); i++) {
+            WORKUNIT* wup = d.wus[i];
+            string key = delta_key(wup->project->master_url, wup->name);
+            remove.insert(key);
+            wu_map[key] = wup;
+        }
+        for (i=0; i<d.delta.deleted_wus.size(); i++) {
+            DELTA_ITEM& di = d.delta.deleted_wus[i];
+            remove.insert(delta_key(di.project_url.c_str(), di.name.c_str()));
+        }
+        for (i=0; i<wus.size(); i++) {
+            WORKUNIT* wup = wus[i];
+            string key = delta_key(wup->project->master_url, wup->name);
+            PROJECT* p = d.lookup_project(wup->project->master_url);
+            APP* app = p?d.lookup_app(p, wup->app_name):NULL;
+            if (remove.count(key) || !app) {
+                delete wup;
+                continue;
+            }
+            wup->project = p;
+            wup->app = app;
+            d.wus.push_back(wup);
+            wu_map[key] = wup;
+        }
+        wus.clear();
+
+        remove.clear();
+        for (i=0; i<d.results.size(); i++) {
+            RESULT* rp = d.results[i];
+            remove.insert(delta_key(rp->project_url, rp->name));
+        }
+        for (i=0; i<d.delta.deleted_results.size(); i++) {
+            DELTA_ITEM& di = d.delta.deleted_results[i];
+            remove.insert(delta_key(di.project_url.c_str(), di.name.c_str()));
+        }
+        for (i=0; i<results.size(); i++) {
+            RESULT* rp = results[i];
+            if (remove.count(delta_key(rp->project_url, rp->name))) {
+                delete rp;
+                continue;
+            }
+            map<string, WORKUNIT*>::iterator wi = wu_map.find(
+                delta_key(rp->project_url, rp->wu_name)
+            );
+            if (wi == wu_map.end()
+                || d.link_result(rp, d.lookup_project(rp->project_url), wi->second)
+            ) {
+                delete rp;
+                continue;
+            }
+            d.results.push_back(rp);
+        }
+        results.clear();
+    }
+    clear();
+    *this = d;
+
+    // we now own d's objects
+    //
+    d.projects.clear();
+    d.apps.clear();
+    d.app_versions.clear();
+    d.wus.clear();
+    d.results.clear();
+}
+
+void DELTA_INFO::clear() {
+    seqno = 0;
+    seqno_epoch = 0;
+    full = false;
+    deleted_wus.clear();
+    deleted_results.clear();
+    deleted_file_transfers.clear();
+}
+
+void DELTA_INFO::request(const char* rpc_name, char* buf, int len) {
+    snprintf(buf, len,
+        "<%s>\n"
+        "<since_seqno>%llu</since_seqno>\n"
+        "<seqno_epoch>%f</seqno_epoch>\n"
+        "</%s>\n",
+        rpc_name, seqno, seqno_epoch, rpc_name
+    );
+}
+
+static void parse_deleted(
+    XML_PARSER& xp, const char* end_tag, vector<DELTA_ITEM>& items
+) {
+    DELTA_ITEM di;
+    while (!xp.get_tag()) {
+        if (xp.match_tag(end_tag)) break;
+        if (xp.parse_string("project_url", di.project_url)) continue;
+        if (xp.parse_string("name", di.name)) continue;
+    }
+    items.push_back(di);
+}
+
+// handle the delta-related parts of a reply
+//
+bool DELTA_INFO::parse_tag(XML_PARSER& xp) {
+    if (xp.parse_ulonglong("seqno", seqno)) return true;
+    if (xp.parse_double("seqno_epoch", seqno_epoch)) return true;
+    if (xp.parse_bool("full", full)) return true;
+    if (xp.match_tag("deleted_workunit")) {
+        parse_deleted(xp, "/deleted_workunit", deleted_wus);
+        return true;
+    }
+    if (xp.match_tag("deleted_result")) {
+        parse_deleted(xp, "/deleted_result", deleted_results);
+        return true;
+    }
+    return false;
+}
+
+// same, for replies parsed a line at a time
+//
+bool DELTA_INFO::parse_line(const char* buf, XML_PARSER& xp) {
+    const char* p = strstr(buf, "<seqno>");
+    if (p) {
+        seqno = boinc_strtoull(p+strlen("<seqno>"), NULL, 10);
+        return true;
+    }
+    if (parse_double(buf, "<seqno_epoch>", seqno_epoch)) return true;
+    if (match_tag(buf, "<full/>")) {
+        full = true;
+        return true;
+    }
+    if (match_tag(buf, "<deleted_result>")) {
+        parse_deleted(xp, "/deleted_result", deleted_results);
+        return true;
+    }
+    if (match_tag(buf, "<deleted_file_transfer>")) {
+        parse_deleted(xp, "/deleted_file_transfer", deleted_file_transfers);
+        return true;
+    }
+    return false;
+}
+
+static string delta_key(RESULT* rp) {
+    return delta_key(rp->project_url, rp->name);
+}
+
+static string delta_key(FILE_TRANSFER* ftp) {
+    return delta_key(ftp->project_url.c_str(), ftp->name.c_str());
+}
+
+// merge the reply to get_results_delta() or get_file_transfers_delta()
+// into the existing list
+//
+template <class T> static void merge_delta_items(
+    vector<T*>& items, vector<T*>& changed,
+    vector<DELTA_ITEM>& deleted, DELTA_INFO& delta
+) {
+    unsigned int i;
+    vector<T*> kept;
+    if (delta.seqno && !delta.full) {
+        set<string> remove;
+        for (i=0; i<changed.size(); i++) {
+            remove.insert(delta_key(changed[i]));
+        }
+        for (i=0; i<deleted.size(); i++) {
+            remove.insert(
+                delta_key(deleted[i].project_url.c_str(), deleted[i].name.c_str())
+            );
+        }
+        for (i=0; i<items.size(); i++) {
+            if (remove.count(delta_key(items[i]))) {
+                delete items[i];
+            } else {
+                kept.push_back(items[i]);
+            }
+        }
+    } else {
+        for (i=0; i<items.size(); i++) {
+            delete items[i];
+        }
+    }
+    kept.insert(kept.end(), changed.begin(), changed.end());
+    items.swap(kept);
+    changed.clear();
+}
+
 void CC_STATE::clear() {
     unsigned int i;
     for (i=0; i<projects.size(); i++) {
@@ -1052,6 +1260,7 @@ void CC_STATE::clear() {
     host_info.clear_host_info();
     have_nvidia = false;
     have_ati = false;
+    delta.clear();
 }
 
 PROJECT* CC_STATE::lookup_project(const char* url) {
@@ -1168,6 +1377,7 @@ void RESULTS::clear() {
         delete results[i];
     }
     results.clear();
+    delta.clear();
 }
 
 FILE_TRANSFERS::FILE_TRANSFERS() {
@@ -1180,6 +1390,7 @@ void FILE_TRANSFERS::clear() {
         delete file_transfers[i];
     }
     file_transfers.clear();
+    delta.clear();
 }
 
 MESSAGES::MESSAGES() {
@@ -1208,6 +1419,114 @@ void NOTICES::clear() {
     notices.clear();
 }
 
+CC_EVENT::CC_EVENT() {
+    clear();
+}
+
+void CC_EVENT::clear() {
+    type = 0;
+    project_url.clear();
+    name.clear();
+    active_task_state = 0;
+    scheduler_state = 0;
+    elapsed_time = 0;
+    fraction_done = 0;
+    state = 0;
+    exit_status = 0;
+    transfer_done = false;
+    file_transfer.clear();
+    is_upload = false;
+    status = 0;
+    msg.clear();
+    notice.clear();
+}
+
+CC_EVENTS::CC_EVENTS() {
+    clear();
+}
+
+void CC_EVENTS::clear() {
+    events.clear();
+    dropped = 0;
+}
+
+int CC_EVENTS::parse(XML_PARSER& xp) {
+    CC_EVENT e;
+    clear();
+    while (!xp.get_tag()) {
+        if (xp.match_tag("/boinc_gui_rpc_events")) return 0;
+        if (xp.parse_int("dropped", dropped)) continue;
+        if (xp.match_tag("task_event")) {
+            e.clear();
+            e.type = GUI_EVENT_TASK;
+            while (!xp.get_tag()) {
+                if (xp.match_tag("/task_event")) break;
+                if (xp.parse_string("project_url", e.project_url)) continue;
+                if (xp.parse_string("name", e.name)) continue;
+                if (xp.parse_int("active_task_state", e.active_task_state)) continue;
+                if (xp.parse_int("scheduler_state", e.scheduler_state)) continue;
+                if (xp.parse_double("elapsed_time", e.elapsed_time)) continue;
+                if (xp.parse_double("fraction_done", e.fraction_done)) continue;
+            }
+            events.push_back(e);
+            continue;
+        }
+        if (xp.match_tag("result_event")) {
+            e.clear();
+            e.type = GUI_EVENT_RESULT;
+            while (!xp.get_tag()) {
+                if (xp.match_tag("/result_event")) break;
+                if (xp.parse_string("project_url", e.project_url)) continue;
+                if (xp.parse_string("name", e.name)) continue;
+                if (xp.parse_int("state", e.state)) continue;
+                if (xp.parse_int("exit_status", e.exit_status)) continue;
+            }
+            events.push_back(e);
+            continue;
+        }
+        if (xp.match_tag("file_transfer")) {
+            e.clear();
+            e.type = GUI_EVENT_TRANSFER;
+            e.file_transfer.parse(xp);
+            e.project_url = e.file_transfer.project_url;
+            e.name = e.file_transfer.name;
+            e.is_upload = e.file_transfer.is_upload;
+            e.status = e.file_transfer.status;
+            events.push_back(e);
+            continue;
+        }
+        if (xp.match_tag("transfer_done")) {
+            e.clear();
+            e.type = GUI_EVENT_TRANSFER;
+            e.transfer_done = true;
+            while (!xp.get_tag()) {
+                if (xp.match_tag("/transfer_done")) break;
+                if (xp.parse_string("project_url", e.project_url)) continue;
+                if (xp.parse_string("name", e.name)) continue;
+                if (xp.parse_bool("is_upload", e.is_upload)) continue;
+                if (xp.parse_int("status", e.status)) continue;
+            }
+            events.push_back(e);
+            continue;
+        }
+        if (xp.match_tag("msg")) {
+            e.clear();
+            e.type = GUI_EVENT_MESSAGE;
+            e.msg.parse(xp);
+            events.push_back(e);
+            continue;
+        }
+        if (xp.match_tag("notice")) {
+            e.clear();
+            e.type = GUI_EVENT_NOTICE;
+            e.notice.parse(xp);
+            events.push_back(e);
+            continue;
+        }
+    }
+    return ERR_XML_PARSE;
+}
+
 ACCT_MGR_INFO::ACCT_MGR_INFO() {
     clear();
 }
@@ -1500,6 +1819,28 @@ int RPC_CLIENT::get_state(CC_STATE& state) {
     return state.parse(rpc.xp);
 }
 
+// get the workunits and results changed since the last call,
+// and everything else, and merge them into state
+//
+int RPC_CLIENT::get_state_delta(CC_STATE& state) {
+    int retval;
+    SET_LOCALE sl;
+    char buf[256];
+    RPC rpc(this);
+    CC_STATE d;
+
+    state.delta.request("get_state", buf, sizeof(buf));
+    retval = rpc.do_rpc(buf);
+    if (retval) return retval;
+    retval = d.parse(rpc.xp);
+    if (retval) {
+        d.clear();
+        return retval;
+    }
+    state.merge_delta(d);
+    return 0;
+}
+
 int RPC_CLIENT::get_results(RESULTS& t, bool active_only) {
     int retval;
     SET_LOCALE sl;
@@ -1526,6 +1867,34 @@ int RPC_CLIENT::get_results(RESULTS& t, bool active_only) {
     return retval;
 }
 
+// get the results changed since the last call, and merge them into t
+//
+int RPC_CLIENT::get_results_delta(RESULTS& t) {
+    int retval;
+    SET_LOCALE sl;
+    char buf[256];
+    RPC rpc(this);
+    vector<RESULT*> changed;
+    DELTA_INFO delta;
+
+    t.delta.request("get_results", buf, sizeof(buf));
+    retval = rpc.do_rpc(buf);
+    if (retval) return retval;
+    while (rpc.fin.fgets(buf, 256)) {
+        if (match_tag(buf, "</results>")) break;
+        else if (match_tag(buf, "<result>")) {
+            RESULT* rp = new RESULT();
+            rp->parse(rpc.xp);
+            changed.push_back(rp);
+            continue;
+        }
+        else if (delta.parse_line(buf, rpc.xp)) continue;
+    }
+    merge_delta_items(t.results, changed, delta.deleted_results, delta);
+    t.delta = delta;
+    return 0;
+}
+
 int RPC_CLIENT::get_old_results(vector<OLD_RESULT>& r) {
     int retval;
     SET_LOCALE sl;
@@ -1573,6 +1942,36 @@ int RPC_CLIENT::get_file_transfers(FILE_TRANSFERS& t) {
     return retval;
 }
 
+// get the file transfers changed since the last call, and merge them into t
+//
+int RPC_CLIENT::get_file_transfers_delta(FILE_TRANSFERS& t) {
+    int retval;
+    SET_LOCALE sl;
+    char buf[256];
+    RPC rpc(this);
+    vector<FILE_TRANSFER*> changed;
+    DELTA_INFO delta;
+
+    t.delta.request("get_file_transfers", buf, sizeof(buf));
+    retval = rpc.do_rpc(buf);
+    if (retval) return retval;
+    while (rpc.fin.fgets(buf, 256)) {
+        if (match_tag(buf, "</file_transfers>")) break;
+        else if (match_tag(buf, "<file_transfer>")) {
+            FILE_TRANSFER* fip = new FILE_TRANSFER();
+            fip->parse(rpc.xp);
+            changed.push_back(fip);
+            continue;
+        }
+        else if (delta.parse_line(buf, rpc.xp)) continue;
+    }
+    merge_delta_items(
+        t.file_transfers, changed, delta.deleted_file_transfers, delta
+    );
+    t.delta = delta;
+    return 0;
+}
+
 int RPC_CLIENT::get_simple_gui_info(SIMPLE_GUI_INFO& info) {
     int retval;
     SET_LOCALE sl;
@@ -2740,6 +3139,47 @@ int RPC_CLIENT::get_notices_public(int seqno, NOTICES& notices) {
     return parse_notices(rpc.xp, notices);
 }
 
+int RPC_CLIENT::subscribe_events(int mask) {
+    SET_LOCALE sl;
+    char buf[1024];
+    string reply;
+    int retval, n=-1;
+
+    snprintf(buf, sizeof(buf),
+        "<subscribe_events>\n"
+        "%s%s%s%s%s"
+        "</subscribe_events>\n",
+        (mask & GUI_EVENT_TASK)?"   <task/>\n":"",
+        (mask & GUI_EVENT_RESULT)?"   <result/>\n":"",
+        (mask & GUI_EVENT_TRANSFER)?"   <transfer/>\n":"",
+        (mask & GUI_EVENT_MESSAGE)?"   <message/>\n":"",
+        (mask & GUI_EVENT_NOTICE)?"   <notice/>\n":""
+    );
+    if (sock == -1) return ERR_CONNECT;
+    retval = send_request(buf);
+    if (retval) return retval;
+    retval = get_message("boinc_gui_rpc_reply", reply, 60);
+    if (retval) return retval;
+    if (strstr(reply.c_str(), "<unauthorized/>")) return ERR_AUTHENTICATOR;
+    parse_int(reply.c_str(), "<event_mask>", n);
+    if (n != mask) return ERR_NOT_FOUND;
+    return 0;
+}
+
+int RPC_CLIENT::get_events(CC_EVENTS& events, double timeout) {
+    SET_LOCALE sl;
+    string msg;
+    int retval;
+
+    events.clear();
+    retval = get_message("boinc_gui_rpc_events", msg, timeout);
+    if (retval) return retval;
+    MIOFILE fin;
+    fin.init_buf_read(msg.c_str());
+    XML_PARSER xp(&fin);
+    return events.parse(xp);
+}
+
 int RPC_CLIENT::get_daily_xfer_history(DAILY_XFER_HISTORY& dxh) {
     SET_LOCALE sl;
     RPC rpc(this);
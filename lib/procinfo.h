@@ -82,4 +82,18 @@ extern void procinfo_non_boinc(PROCINFO&, PROC_MAP&);
 extern double process_tree_cpu_time(int pid);
     // get the CPU time of the given process and its descendants
 
+#ifdef __linux__
+// functions for tracking a known set of processes,
+// without enumerating all the processes in the system
+
+extern int procinfo_pid(int pid, PROCINFO&);
+    // get info for one process
+
+extern int procinfo_children(int pid, std::vector<int>&);
+    // append the IDs of a process's children
+
+extern int procinfo_system_cpu_time(double&);
+    // get the CPU time of all non-niced processes
+#endif
+
 #endif
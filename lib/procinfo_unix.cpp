@@ -31,6 +31,7 @@
 #endif
 
 #include <cstdio>
+#include <cstdlib>
 #include <string.h>
 #include <sys/param.h>
 #include <ctype.h>
@@ -166,17 +167,130 @@ int PROC_STAT::parse(char* buf) {
     return 1;
 }
 
+#if !defined(HAVE_PROCFS_H) || !defined(HAVE__PROC_SELF_PSINFO)  // linux
+
+// get info for a single process from /proc/PID/stat
+//
+int procinfo_pid(int pid, PROCINFO& p) {
+    FILE* fd;
+    PROC_STAT ps;
+    char pidpath[MAXPATHLEN];
+    char buf[1024];
+    int retval;
+
+    snprintf(pidpath, sizeof(pidpath), "/proc/%d/stat", pid);
+    fd = fopen(pidpath, "r");
+    if (!fd) return ERR_FOPEN;
+    if (fgets(buf, sizeof(buf), fd) == NULL) {
+        retval = ERR_NULL;
+    } else {
+        retval = ps.parse(buf);
+    }
+    fclose(fd);
+    if (retval) return ERR_NULL;
+
+    p.clear();
+    p.id = ps.pid;
+    p.parentid = ps.ppid;
+    p.swap_size = ps.vsize;
+    // rss = pages, need bytes
+    // assumes page size = 4k
+    p.working_set_size = ps.rss * (float)getpagesize();
+    // page faults: I/O + non I/O
+    p.page_fault_count = ps.majflt + ps.minflt;
+    // times are in jiffies, need seconds
+    // assumes 100 jiffies per second
+    p.user_time = ps.utime / 100.;
+    p.kernel_time = ps.stime / 100.;
+    strlcpy(p.command, ps.comm, sizeof(p.command));
+    p.is_low_priority = (ps.priority == 39);
+        // Internally Linux stores the process priority as nice + 20
+        // as -ve values are error codes. Thus this generally gives
+        // a process priority range of 39..0
+    return 0;
+}
+
+// get the children of a process,
+// from /proc/PID/task/TID/children (one file per thread).
+// Returns ERR_NOT_IMPLEMENTED if the kernel doesn't provide these
+// (it's a config option, CONFIG_PROC_CHILDREN)
+//
+int procinfo_children(int pid, vector<int>& children) {
+    char path[MAXPATHLEN];
+    char buf[4096];
+    DIR* dir;
+    dirent* tdir;
+
+    snprintf(path, sizeof(path), "/proc/%d/task/%d/children", pid, pid);
+    if (access(path, R_OK)) {
+        snprintf(path, sizeof(path), "/proc/%d", pid);
+        if (access(path, F_OK)) return ERR_NOT_FOUND;
+        return ERR_NOT_IMPLEMENTED;
+    }
+    snprintf(path, sizeof(path), "/proc/%d/task", pid);
+    dir = opendir(path);
+    if (!dir) return ERR_OPENDIR;
+    while (1) {
+        tdir = readdir(dir);
+        if (!tdir) break;
+        if (!isdigit(tdir->d_name[0])) continue;
+        snprintf(path, sizeof(path),
+            "/proc/%d/task/%s/children", pid, tdir->d_name
+        );
+        FILE* f = fopen(path, "r");
+        if (!f) continue;
+        while (fgets(buf, sizeof(buf), f)) {
+            char* p = buf;
+            while (1) {
+                char* q;
+                long n = strtol(p, &q, 10);
+                if (q == p) break;
+                children.push_back((int)n);
+                p = q;
+            }
+        }
+        fclose(f);
+    }
+    closedir(dir);
+    return 0;
+}
+
+// get the system-wide CPU time (seconds) from /proc/stat:
+// user time of processes not running at reduced (nice) priority,
+// plus system and interrupt time
+//
+int procinfo_system_cpu_time(double& t) {
+    char buf[1024];
+    unsigned long long user, nice, system, idle, iowait, irq, softirq;
+    FILE* f = fopen("/proc/stat", "r");
+    if (!f) return ERR_FOPEN;
+    if (!fgets(buf, sizeof(buf), f)) {
+        fclose(f);
+        return ERR_NULL;
+    }
+    fclose(f);
+    int n = sscanf(buf, "cpu %llu %llu %llu %llu %llu %llu %llu",
+        &user, &nice, &system, &idle, &iowait, &irq, &softirq
+    );
+    if (n != 7) return ERR_NULL;
+    long hz = sysconf(_SC_CLK_TCK);
+    if (hz <= 0) hz = 100;
+    t = (double)(user + system + irq + softirq)/hz;
+    return 0;
+}
+
+#endif
+
 // build table of all processes in system
 //
 int procinfo_setup(PROC_MAP& pm) {
     DIR *dir;
     dirent *piddir;
+    int pid = getpid();
+#if defined(HAVE_PROCFS_H) && defined(HAVE__PROC_SELF_PSINFO)  // solaris
     FILE* fd;
-    PROC_STAT ps;
     char pidpath[MAXPATHLEN];
-    char buf[1024];
-    int pid = getpid();
-    int retval;
+#endif
 
     dir = opendir("/proc");
     if (!dir) {
@@ -220,42 +334,15 @@ int procinfo_setup(PROC_MAP& pm) {
         p.is_boinc_app = (p.id == pid || strcasestr(p.command, "boinc"));
         pm.insert(std::pair(p.id, p));
 #else  // linux
-        sprintf(pidpath, "/proc/%s/stat", piddir->d_name);
-        fd = fopen(pidpath, "r");
-        if (!fd) continue;
-        if (fgets(buf, sizeof(buf), fd) == NULL) {
-            retval = ERR_NULL;
-        } else {
-            retval = ps.parse(buf);
-        }
-        fclose(fd);
-
-        if (retval) {
-            // ps.parse() returns an error if the executable name contains ).
+        PROCINFO p;
+        if (procinfo_pid(atoi(piddir->d_name), p)) {
+            // this fails if the executable name contains ),
+            // or if the process has exited.
             // In that case skip this process.
             //
             continue;
         }
-        PROCINFO p;
-        p.clear();
-        p.id = ps.pid;
-        p.parentid = ps.ppid;
-        p.swap_size = ps.vsize;
-        // rss = pages, need bytes
-        // assumes page size = 4k
-        p.working_set_size = ps.rss * (float)getpagesize();
-        // page faults: I/O + non I/O
-        p.page_fault_count = ps.majflt + ps.minflt;
-        // times are in jiffies, need seconds
-        // assumes 100 jiffies per second
-        p.user_time = ps.utime / 100.;
-        p.kernel_time = ps.stime / 100.;
-        strlcpy(p.command, ps.comm, sizeof(p.command));
         p.is_boinc_app = (p.id == pid || strcasestr(p.command, "boinc"));
-        p.is_low_priority = (ps.priority == 39);
-            // Internally Linux stores the process priority as nice + 20
-            // as -ve values are error codes. Thus this generally gives
-            // a process priority range of 39..0
         pm.insert(std::pair<int, PROCINFO>(p.id, p));
 #endif
     }
@@ -44,10 +44,39 @@ double cpu_time_to_credit(double cpu_time, double cpu_flops_sec) {
     return fpops_to_credit(cpu_time*cpu_flops_sec);
 }
 
+// Append a credit grant to the credit_journal table.
+// This is a single-row insert, so unlike updating the user and team
+// it doesn't contend for locks on popular rows.
+//
+int credit_journal_append(
+    DB_ID_TYPE userid, DB_ID_TYPE teamid, DB_ID_TYPE appid,
+    double start_time, double credit, bool by_app
+) {
+    DB_CREDIT_JOURNAL cj;
+    cj.clear();
+    cj.create_time = dtime();
+    cj.userid = userid;
+    cj.teamid = teamid;
+    cj.appid = appid;
+    cj.start_time = start_time;
+    cj.credit = credit;
+    cj.by_app = by_app;
+    int retval = cj.insert();
+    if (retval) {
+        log_messages.printf(MSG_CRITICAL,
+            "credit journal insert for user %lu failed: %s\n",
+            userid, boincerror(retval)
+        );
+    }
+    return retval;
+}
+
 // Grant the host (and associated user and team)
 // the given amount of credit for work that started at the given time.
 // Update the user and team records,
-// but not the host record (caller must update)
+// but not the host record (caller must update).
+// If config.credit_journal is set, the user and team updates
+// are journaled and done later by credit_aggregator.
 //
 int grant_credit(DB_HOST &host, double start_time, double credit) {
     DB_USER user;
@@ -65,6 +94,12 @@ int grant_credit(DB_HOST &host, double start_time, double credit) {
     );
     host.total_credit += credit;
 
+    if (config.credit_journal) {
+        return credit_journal_append(
+            host.userid, 0, 0, start_time, credit, false
+        );
+    }
+
     // then the user
 
     retval = user.lookup_id(host.userid);
@@ -129,6 +164,13 @@ int grant_credit_by_app(RESULT& result, double credit) {
     char clause1[1024], clause2[1024];
     double now = dtime();
 
+    if (config.credit_journal) {
+        return credit_journal_append(
+            result.userid, result.teamid, result.appid,
+            result.sent_time, credit, true
+        );
+    }
+
     sprintf(clause1, "where userid=%lu and appid=%lu", result.userid, result.appid);
     int retval = cu.lookup(clause1);
     if (retval) {
@@ -65,4 +65,8 @@ extern int write_modified_app_versions(
 );
 
 extern int grant_credit_by_app(RESULT& result, double credit);
+extern int credit_journal_append(
+    DB_ID_TYPE userid, DB_ID_TYPE teamid, DB_ID_TYPE appid,
+    double start_time, double credit, bool by_app
+);
 extern double low_average(std::vector<double>&);
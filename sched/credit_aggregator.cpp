@@ -0,0 +1,405 @@
+// This file is part of BOINC.
+// http://boinc.berkeley.edu
+// Copyright (C) 2026 University of California
+//
+// BOINC is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation,
+// either version 3 of the License, or (at your option) any later version.
+//
+// BOINC is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with BOINC.  If not, see <http://www.gnu.org/licenses/>.
+
+// credit_aggregator: apply journaled credit grants.
+//
+// If <credit_journal> is set in config.xml, the validator appends
+// credit grants to the credit_journal table instead of updating
+// user, team, credit_user and credit_team records.
+// This daemon reads the journal in batches,
+// folds each batch into one update per user/team (and per-app record),
+// and deletes the journal entries.
+// The updates and the deletion are done in a single transaction,
+// so each grant is applied exactly once even if we crash.
+//
+// usage: credit_aggregator [--batch_size N] [--sleep_interval N] [--one_pass]
+
+#include "config.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "boinc_db.h"
+#include "error_numbers.h"
+#include "str_util.h"
+#include "svn_version.h"
+#include "util.h"
+
+#include "sched_config.h"
+#include "sched_msgs.h"
+#include "sched_util.h"
+
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+#define DEFAULT_BATCH_SIZE      1000
+#define DEFAULT_SLEEP_INTERVAL  10
+
+int batch_size = DEFAULT_BATCH_SIZE;
+int sleep_interval = DEFAULT_SLEEP_INTERVAL;
+
+typedef vector<CREDIT_JOURNAL*> CJ_LIST;
+
+// apply a list of grants (in journal order) to an exponential average
+//
+static double fold_grants(CJ_LIST& l, double& expavg, double& expavg_time) {
+    double total = 0;
+    for (unsigned int i=0; i<l.size(); i++) {
+        CREDIT_JOURNAL& cj = *l[i];
+        update_average(
+            cj.create_time, cj.start_time, cj.credit, CREDIT_HALF_LIFE,
+            expavg, expavg_time
+        );
+        total += cj.credit;
+    }
+    return total;
+}
+
+static bool journal_order(const CREDIT_JOURNAL* a, const CREDIT_JOURNAL* b) {
+    return a->id < b->id;
+}
+
+static int update_user_team(map<DB_ID_TYPE, CJ_LIST>& user_grants) {
+    map<DB_ID_TYPE, CJ_LIST> team_grants;
+    map<DB_ID_TYPE, CJ_LIST>::iterator it;
+    char buf[256];
+    int retval;
+
+    for (it = user_grants.begin(); it != user_grants.end(); ++it) {
+        DB_USER user;
+        retval = user.lookup_id(it->first);
+        if (retval == ERR_DB_NOT_FOUND) {
+            // user was deleted; drop the credit
+            continue;
+        }
+        if (retval) {
+            log_messages.printf(MSG_CRITICAL,
+                "lookup of user %lu failed: %s\n",
+                it->first, boincerror(retval)
+            );
+            return retval;
+        }
+        double total = fold_grants(
+            it->second, user.expavg_credit, user.expavg_time
+        );
+        sprintf(buf,
+            "total_credit=total_credit+%.15e, expavg_credit=%.15e, expavg_time=%.15e",
+            total, user.expavg_credit, user.expavg_time
+        );
+        retval = user.update_field(buf);
+        if (retval) {
+            log_messages.printf(MSG_CRITICAL,
+                "update of user %lu failed: %s\n",
+                user.id, boincerror(retval)
+            );
+            return retval;
+        }
+        if (user.teamid) {
+            CJ_LIST& tl = team_grants[user.teamid];
+            tl.insert(tl.end(), it->second.begin(), it->second.end());
+        }
+    }
+
+    for (it = team_grants.begin(); it != team_grants.end(); ++it) {
+        DB_TEAM team;
+        retval = team.lookup_id(it->first);
+        if (retval == ERR_DB_NOT_FOUND) continue;
+        if (retval) {
+            log_messages.printf(MSG_CRITICAL,
+                "lookup of team %lu failed: %s\n",
+                it->first, boincerror(retval)
+            );
+            return retval;
+        }
+
+        // grants from different users are interleaved; restore journal order
+        //
+        CJ_LIST& l = it->second;
+        std::sort(l.begin(), l.end(), journal_order);
+        double total = fold_grants(l, team.expavg_credit, team.expavg_time);
+        sprintf(buf,
+            "total_credit=total_credit+%.15e, expavg_credit=%.15e, expavg_time=%.15e",
+            total, team.expavg_credit, team.expavg_time
+        );
+        retval = team.update_field(buf);
+        if (retval) {
+            log_messages.printf(MSG_CRITICAL,
+                "update of team %lu failed: %s\n",
+                team.id, boincerror(retval)
+            );
+            return retval;
+        }
+    }
+    return 0;
+}
+
+// keyed by (userid, appid) or (teamid, appid)
+//
+typedef map<pair<DB_ID_TYPE, DB_ID_TYPE>, CJ_LIST> BY_APP_MAP;
+
+static int update_credit_user(BY_APP_MAP& m) {
+    char clause1[1024], clause2[1024];
+    int retval;
+
+    for (BY_APP_MAP::iterator it = m.begin(); it != m.end(); ++it) {
+        DB_CREDIT_USER cu;
+        DB_ID_TYPE userid = it->first.first, appid = it->first.second;
+        sprintf(clause1, "where userid=%lu and appid=%lu", userid, appid);
+        retval = cu.lookup(clause1);
+        if (retval) {
+            cu.clear();
+            cu.userid = userid;
+            cu.appid = appid;
+            cu.expavg_time = it->second[0]->create_time;
+            retval = cu.insert();
+            if (retval) return retval;
+        }
+        double total = fold_grants(it->second, cu.expavg, cu.expavg_time);
+        sprintf(clause1,
+            "total=total+%.15e, expavg=%.15e, expavg_time=%.15e, njobs=njobs+%d",
+            total, cu.expavg, cu.expavg_time, (int)it->second.size()
+        );
+        sprintf(clause2, "userid=%lu and appid=%lu", userid, appid);
+        retval = cu.update_fields_noid(clause1, clause2);
+        if (retval) return retval;
+    }
+    return 0;
+}
+
+static int update_credit_team(BY_APP_MAP& m) {
+    char clause1[1024], clause2[1024];
+    int retval;
+
+    for (BY_APP_MAP::iterator it = m.begin(); it != m.end(); ++it) {
+        DB_CREDIT_TEAM ct;
+        DB_ID_TYPE teamid = it->first.first, appid = it->first.second;
+        sprintf(clause1, "where teamid=%lu and appid=%lu", teamid, appid);
+        retval = ct.lookup(clause1);
+        if (retval) {
+            ct.clear();
+            ct.teamid = teamid;
+            ct.appid = appid;
+            ct.expavg_time = it->second[0]->create_time;
+            retval = ct.insert();
+            if (retval) return retval;
+        }
+        double total = fold_grants(it->second, ct.expavg, ct.expavg_time);
+        sprintf(clause1,
+            "total=total+%.15e, expavg=%.15e, expavg_time=%.15e, njobs=njobs+%d",
+            total, ct.expavg, ct.expavg_time, (int)it->second.size()
+        );
+        sprintf(clause2, "teamid=%lu and appid=%lu", teamid, appid);
+        retval = ct.update_fields_noid(clause1, clause2);
+        if (retval) return retval;
+    }
+    return 0;
+}
+
+// delete the given journal entries.
+// Delete them by ID, not by range:
+// a validator transaction may have given a lower ID to an entry
+// that was committed after we read the journal.
+//
+#define DELETE_BATCH_SIZE 300
+    // IDs per query; keeps queries within MAX_QUERY_LEN
+
+static int delete_grants(vector<CREDIT_JOURNAL>& grants) {
+    DB_CREDIT_JOURNAL cj;
+    char buf[256];
+    int retval;
+
+    for (unsigned int i=0; i<grants.size(); i+=DELETE_BATCH_SIZE) {
+        string clause = "id in (";
+        for (unsigned int j=i; j<grants.size() && j<i+DELETE_BATCH_SIZE; j++) {
+            sprintf(buf, "%s%lu", (j==i)?"":",", grants[j].id);
+            clause += buf;
+        }
+        clause += ")";
+        retval = cj.delete_from_db_multi(clause.c_str());
+        if (retval) return retval;
+    }
+    return 0;
+}
+
+// process up to batch_size journal entries in one transaction.
+// Set "nprocessed" to the number of entries applied.
+//
+int do_pass(int& nprocessed) {
+    DB_CREDIT_JOURNAL cj;
+    vector<CREDIT_JOURNAL> grants;
+    map<DB_ID_TYPE, CJ_LIST> user_grants;
+    BY_APP_MAP cu_grants, ct_grants;
+    char buf[256];
+    int retval;
+
+    nprocessed = 0;
+    retval = boinc_db.start_transaction();
+    if (retval) return retval;
+
+    sprintf(buf, "order by id limit %d", batch_size);
+    while (1) {
+        retval = cj.enumerate(buf);
+        if (retval) {
+            if (retval != ERR_DB_NOT_FOUND) {
+                boinc_db.rollback_transaction();
+                return retval;
+            }
+            break;
+        }
+        grants.push_back(cj);
+    }
+    if (grants.empty()) {
+        boinc_db.commit_transaction();
+        return 0;
+    }
+
+    // "grants" doesn't change size from here on,
+    // so pointers into it stay valid
+    //
+    for (unsigned int i=0; i<grants.size(); i++) {
+        CREDIT_JOURNAL& g = grants[i];
+        if (g.by_app) {
+            cu_grants[pair<DB_ID_TYPE, DB_ID_TYPE>(g.userid, g.appid)].push_back(&g);
+            ct_grants[pair<DB_ID_TYPE, DB_ID_TYPE>(g.teamid, g.appid)].push_back(&g);
+        } else {
+            user_grants[g.userid].push_back(&g);
+        }
+    }
+
+    retval = update_user_team(user_grants);
+    if (!retval) retval = update_credit_user(cu_grants);
+    if (!retval) retval = update_credit_team(ct_grants);
+    if (!retval) retval = delete_grants(grants);
+    if (retval) {
+        log_messages.printf(MSG_CRITICAL,
+            "applying credit journal failed: %s; rolling back\n",
+            boincerror(retval)
+        );
+        boinc_db.rollback_transaction();
+        return retval;
+    }
+    retval = boinc_db.commit_transaction();
+    if (retval) return retval;
+
+    nprocessed = (int)grants.size();
+    log_messages.printf(MSG_NORMAL,
+        "applied %d credit grants (%d users, %d user/app records)\n",
+        nprocessed, (int)user_grants.size(), (int)cu_grants.size()
+    );
+    return 0;
+}
+
+void usage(char *name) {
+    fprintf(stderr,
+        "Apply credit grants journaled by the validator\n"
+        "(see <credit_journal> in config.xml).\n\n"
+        "Usage: %s [OPTION]...\n\n"
+        "Options:\n"
+        "  [ --batch_size N ]              Apply at most N grants per transaction\n"
+        "  [ --sleep_interval N ]          Sleep N seconds when journal is empty\n"
+        "  [ --one_pass ]                  Empty the journal, then exit\n"
+        "  [ -d X ]                        Set debug level to X\n"
+        "  [ -h | --help ]                 Shows this help text\n"
+        "  [ -v | --version ]              Shows version information\n",
+        name
+    );
+}
+
+int main(int argc, char** argv) {
+    int retval, i, n;
+    bool one_pass = false;
+
+    check_stop_daemons();
+
+    for (i=1; i<argc; i++) {
+        if (is_arg(argv[i], "batch_size")) {
+            batch_size = atoi(argv[++i]);
+            if (batch_size < 1) batch_size = DEFAULT_BATCH_SIZE;
+        } else if (is_arg(argv[i], "sleep_interval")) {
+            sleep_interval = atoi(argv[++i]);
+        } else if (is_arg(argv[i], "one_pass")) {
+            one_pass = true;
+        } else if (!strcmp(argv[i], "-d")) {
+            if (!argv[++i]) {
+                log_messages.printf(MSG_CRITICAL, "%s requires an argument\n\n", argv[--i]);
+                usage(argv[0]);
+                exit(1);
+            }
+            int dl = atoi(argv[i]);
+            log_messages.set_debug_level(dl);
+            if (dl == 4) g_print_queries = true;
+        } else if (!strcmp(argv[i], "-v") || !strcmp(argv[i], "--version")) {
+            printf("%s\n", SVN_VERSION);
+            exit(0);
+        } else if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
+            usage(argv[0]);
+            exit(0);
+        } else {
+            log_messages.printf(MSG_CRITICAL, "unknown command line argument: %s\n\n", argv[i]);
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+
+    log_messages.printf(MSG_NORMAL, "Starting\n");
+
+    retval = config.parse_file();
+    if (retval) {
+        log_messages.printf(MSG_CRITICAL,
+            "Can't parse config.xml: %s\n", boincerror(retval)
+        );
+        exit(1);
+    }
+    retval = boinc_db.open(
+        config.db_name, config.db_host, config.db_user, config.db_passwd
+    );
+    if (retval) {
+        log_messages.printf(MSG_CRITICAL,
+            "boinc_db.open: %d; %s\n", retval, boinc_db.error_string()
+        );
+        exit(1);
+    }
+    retval = boinc_db.set_isolation_level(READ_COMMITTED);
+    if (retval) {
+        log_messages.printf(MSG_CRITICAL,
+            "boinc_db.set_isolation_level: %d; %s\n", retval, boinc_db.error_string()
+        );
+    }
+
+    while (1) {
+        check_stop_daemons();
+        retval = do_pass(n);
+        if (retval) {
+            log_messages.printf(MSG_CRITICAL,
+                "do_pass(): %s\n", boincerror(retval)
+            );
+            exit(1);
+        }
+        if (n < batch_size) {
+            if (one_pass) break;
+            daemon_sleep(sleep_interval);
+        }
+    }
+    log_messages.printf(MSG_NORMAL, "Done\n");
+    return 0;
+}
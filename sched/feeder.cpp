@@ -37,14 +37,24 @@
 //  [ --purge_stale x ]     remove work items from the shared memory segment
 //                          that have been there for longer then x minutes
 //                          but haven't been assigned
+//  [ --prefetch ]          do DB enumeration in a separate thread
 //
 // The feeder tries to keep the work array filled.
 // It maintains a DB enumerator (DB_WORK_ITEM).
 // scan_work_array() scans the work array.
 // looking for empty slots and trying to fill them in.
 // The enumeration may return results already in the array.
-// So, for each result, we scan the entire array to make sure
-// it's not there already (can this be streamlined?)
+// So, for each result, we check whether it's there already;
+// result_slots maps result ID to slot so this doesn't require
+// scanning the array.
+//
+// If --prefetch is used, a separate thread (with its own DB connection)
+// runs the enumerations and keeps a queue of candidate jobs for each app,
+// of size up to the app's enumeration size
+// (i.e. proportional to its weight if --allapps).
+// scan_work_array() takes jobs from these queues,
+// so filling the array never waits for a DB query.
+// When an enumeration is exhausted, the thread reissues the query.
 //
 // The length of the enum (max and actual) and the number of empty
 // slots may differ; either one may be larger.
@@ -105,7 +115,12 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/param.h>
+#include <pthread.h>
+#include <deque>
+#include <map>
 #include <vector>
+using std::deque;
+using std::map;
 using std::vector;
 
 #include "boinc_db.h"
@@ -161,6 +176,28 @@ bool using_hr;
 bool is_main_feeder = true;
     // false if using --mod or --wmod and this one isn't 0
 
+map<DB_ID_TYPE, int> result_slots;
+    // result ID -> work array slot, for results in the array.
+    // Rebuilt at the start of each array scan;
+    // modified only by the main thread, with queue_mutex held
+
+// The following used if --prefetch:
+//
+bool use_prefetch = false;
+DB_CONN prefetch_db;
+    // DB connection used by the prefetch thread
+
+struct JOB_QUEUE {
+    deque<WORK_ITEM> items;
+    map<DB_ID_TYPE, bool> ids;
+        // IDs of results in items
+};
+JOB_QUEUE* job_queues;
+    // one per app index
+pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+    // signaled by main thread when it takes jobs from queues
+
 void signal_handler(int) {
     log_messages.printf(MSG_NORMAL, "Signaled by simulator\n");
     return;
@@ -231,6 +268,74 @@ void hr_count_slots() {
     }
 }
 
+// See if the result is already in the work array.
+// If so, and another instance of the WU has been sent,
+// bump the infeasible count to encourage it to get sent more quickly
+//
+static bool in_work_array(WORK_ITEM& wi, int& ncollisions) {
+    map<DB_ID_TYPE, int>::iterator it = result_slots.find(wi.res_id);
+    if (it == result_slots.end()) return false;
+    WU_RESULT& wu_result = ssp->wu_results[it->second];
+
+    // the scheduler may have sent the job since we indexed the array
+    //
+    if (wu_result.state == WR_STATE_EMPTY || wu_result.resultid != wi.res_id) {
+        return false;
+    }
+    if (wu_result.infeasible_count == 0) {
+        if (wi.wu.hr_class > 0) {
+            wu_result.infeasible_count++;
+        }
+    }
+    ncollisions++;
+    log_messages.printf(MSG_DEBUG,
+        "result [RESULT#%lu] already in array\n", wi.res_id
+    );
+    return true;
+}
+
+// build the map from result ID to slot
+//
+static void index_work_array() {
+    pthread_mutex_lock(&queue_mutex);
+    result_slots.clear();
+    for (int i=0; i<ssp->max_wu_results; i++) {
+        WU_RESULT& wu_result = ssp->wu_results[i];
+        if (wu_result.state == WR_STATE_EMPTY) continue;
+        result_slots[wu_result.resultid] = i;
+    }
+    pthread_mutex_unlock(&queue_mutex);
+}
+
+// if the WU had an error, mark result as DIDNT_NEED
+//
+static void mark_didnt_need(WORK_ITEM& wi, DB_CONN* db) {
+    char buf[256];
+    DB_RESULT result(db);
+    result.id = wi.res_id;
+    sprintf(buf, "server_state=%d, outcome=%d",
+        RESULT_SERVER_STATE_OVER,
+        RESULT_OUTCOME_DIDNT_NEED
+    );
+    result.update_field(buf);
+    log_messages.printf(MSG_NORMAL,
+        "[RESULT#%lu] WU had error, marking as DIDNT_NEED\n",
+        wi.res_id
+    );
+}
+
+static void get_select_clause(int app_index, char* select_clause, int& enum_size) {
+    if (all_apps) {
+        sprintf(select_clause, "%s and r1.appid=%lu",
+            mod_select_clause, ssp->apps[app_index].id
+        );
+        enum_size = enum_sizes[app_index];
+    } else {
+        strcpy(select_clause, mod_select_clause);
+        enum_size = enum_limit;
+    }
+}
+
 // Enumerate jobs from DB until find one that is not already in the work array.
 // If find one, return true.
 // If reach end of enum for second time on this array scan, return false
@@ -241,19 +346,10 @@ static bool get_job_from_db(
     int& enum_phase,
     int& ncollisions
 ) {
-    bool collision;
-    int retval, j, enum_size;
+    int retval, enum_size;
     char select_clause[256];
     
-    if (all_apps) {
-        sprintf(select_clause, "%s and r1.appid=%lu",
-            mod_select_clause, ssp->apps[app_index].id
-        );
-        enum_size = enum_sizes[app_index];
-    } else {
-        safe_strcpy(select_clause, mod_select_clause);
-        enum_size = enum_limit;
-    }
+    get_select_clause(app_index, select_clause, enum_size);
     int hrt = ssp->apps[app_index].homogeneous_redundancy;
 
     while (1) {
@@ -305,45 +401,13 @@ static bool get_job_from_db(
             // if the WU had an error, mark result as DIDNT_NEED
             //
             if (wi.wu.error_mask) {
-                char buf[256];
-                DB_RESULT result;
-                result.id = wi.res_id;
-                sprintf(buf, "server_state=%d, outcome=%d",
-                    RESULT_SERVER_STATE_OVER,
-                    RESULT_OUTCOME_DIDNT_NEED
-                );
-                result.update_field(buf);
-                log_messages.printf(MSG_NORMAL,
-                    "[RESULT#%lu] WU had error, marking as DIDNT_NEED\n",
-                    wi.res_id
-                );
+                mark_didnt_need(wi, &boinc_db);
                 continue;
             }
 
             // Check for collision (i.e. this result already is in the array)
             //
-            collision = false;
-            for (j=0; j<ssp->max_wu_results; j++) {
-                if (ssp->wu_results[j].state != WR_STATE_EMPTY && ssp->wu_results[j].resultid == wi.res_id) {
-                    // If the result is already in shared mem,
-                    // and another instance of the WU has been sent,
-                    // bump the infeasible count to encourage
-                    // it to get sent more quickly
-                    //
-                    if (ssp->wu_results[j].infeasible_count == 0) {
-                        if (wi.wu.hr_class > 0) {
-                            ssp->wu_results[j].infeasible_count++;
-                        }
-                    }
-                    ncollisions++;
-                    collision = true;
-                    log_messages.printf(MSG_DEBUG,
-                        "result [RESULT#%lu] already in array\n", wi.res_id
-                    );
-                    break;
-                }
-            }
-            if (collision) {
+            if (in_work_array(wi, ncollisions)) {
                 continue;
             }
 
@@ -364,6 +428,109 @@ static bool get_job_from_db(
     return false;   // never reached
 }
 
+// The prefetch thread.
+// Keep each app's job queue at least half full,
+// running (and when exhausted, reissuing) its enumeration.
+//
+static void* prefetch_thread(void*) {
+    vector<DB_WORK_ITEM*> wis;
+    char select_clause[256];
+    int i, retval, enum_size;
+
+    for (i=0; i<napps; i++) {
+        wis.push_back(new DB_WORK_ITEM(&prefetch_db));
+    }
+    while (1) {
+        bool fetched = false;
+        for (i=0; i<napps; i++) {
+            DB_WORK_ITEM& wi = *wis[i];
+            JOB_QUEUE& q = job_queues[i];
+            get_select_clause(i, select_clause, enum_size);
+            int hrt = ssp->apps[i].homogeneous_redundancy;
+
+            pthread_mutex_lock(&queue_mutex);
+            int n = (int)q.items.size();
+            pthread_mutex_unlock(&queue_mutex);
+            if (n > enum_size/2) continue;
+
+            while (n < enum_size) {
+                if (hrt && config.hr_allocate_slots) {
+                    retval = wi.enumerate_all(enum_size, select_clause);
+                } else {
+                    retval = wi.enumerate(enum_size, select_clause, order_clause);
+                }
+                if (retval) {
+                    if (retval != ERR_DB_NOT_FOUND) {
+                        log_messages.printf(MSG_CRITICAL,
+                            "DB connection lost, exiting\n"
+                        );
+                        exit(0);
+                    }
+                    // end of enumeration; next call reissues the query
+                    //
+                    break;
+                }
+                if (!ssp->lookup_app(wi.wu.appid)) continue;
+                if (wi.wu.error_mask) {
+                    mark_didnt_need(wi, &prefetch_db);
+                    continue;
+                }
+                pthread_mutex_lock(&queue_mutex);
+                if (!q.ids.count(wi.res_id) && !result_slots.count(wi.res_id)) {
+                    q.items.push_back(wi);
+                    q.ids[wi.res_id] = true;
+                    fetched = true;
+                }
+                n = (int)q.items.size();
+                pthread_mutex_unlock(&queue_mutex);
+            }
+        }
+        if (!fetched) {
+            struct timespec ts;
+            ts.tv_sec = time(0) + sleep_interval;
+            ts.tv_nsec = 0;
+            pthread_mutex_lock(&queue_mutex);
+            pthread_cond_timedwait(&queue_cond, &queue_mutex, &ts);
+            pthread_mutex_unlock(&queue_mutex);
+        }
+    }
+    return NULL;
+}
+
+// Get a job from the prefetch queue for the given app.
+// Return false if the queue is empty.
+//
+static bool get_job_from_queue(
+    WORK_ITEM& wi, int app_index, int& ncollisions
+) {
+    JOB_QUEUE& q = job_queues[app_index];
+    int hrt = ssp->apps[app_index].homogeneous_redundancy;
+
+    while (1) {
+        pthread_mutex_lock(&queue_mutex);
+        if (q.items.empty()) {
+            pthread_mutex_unlock(&queue_mutex);
+            return false;
+        }
+        wi = q.items.front();
+        q.items.pop_front();
+        q.ids.erase(wi.res_id);
+        pthread_mutex_unlock(&queue_mutex);
+
+        if (in_work_array(wi, ncollisions)) continue;
+        if (hrt && config.hr_allocate_slots) {
+            if (!hr_info.accept(hrt, wi.wu.hr_class)) {
+                log_messages.printf(MSG_DEBUG,
+                    "rejecting [RESULT#%lu] because HR class %d/%d over quota\n",
+                    wi.res_id, hrt, wi.wu.hr_class
+                );
+                continue;
+            }
+        }
+        return true;
+    }
+}
+
 // This function decides the interleaving used for --allapps.
 // Inputs:
 //   n (number of weights)
@@ -458,6 +625,7 @@ static bool scan_work_array(vector<DB_WORK_ITEM> &work_items) {
     int enum_phase[napps];
     int app_index;
     int nadditions=0, ncollisions=0;
+    WORK_ITEM qitem, *item;
     
     for (i=0; i<napps; i++) {
         if (work_items[i].cursor.active) {
@@ -470,6 +638,7 @@ static bool scan_work_array(vector<DB_WORK_ITEM> &work_items) {
     if (using_hr && config.hr_allocate_slots) {
         hr_count_slots();
     }
+    index_work_array();
 
     for (i=0; i<ssp->max_wu_results; i++) {
         app_index = app_indices[i];
@@ -485,31 +654,44 @@ static bool scan_work_array(vector<DB_WORK_ITEM> &work_items) {
                 );
                 purge_stale(wu_result);
                 wu_result.state = WR_STATE_EMPTY;
+                pthread_mutex_lock(&queue_mutex);
+                result_slots.erase(wu_result.resultid);
+                pthread_mutex_unlock(&queue_mutex);
                 // fall through, refill this array slot
             } else {
                 break;
             }
         case WR_STATE_EMPTY:
             if (enum_phase[app_index] == ENUM_OVER) continue;
-            found = get_job_from_db(
-                wi, app_index, enum_phase[app_index], ncollisions
-            );
+            if (use_prefetch) {
+                found = get_job_from_queue(qitem, app_index, ncollisions);
+                if (!found) enum_phase[app_index] = ENUM_OVER;
+                item = &qitem;
+            } else {
+                found = get_job_from_db(
+                    wi, app_index, enum_phase[app_index], ncollisions
+                );
+                item = &wi;
+            }
             if (found) {
                 log_messages.printf(MSG_NORMAL,
                     "adding result [RESULT#%lu] in slot %d\n",
-                    wi.res_id, i
+                    item->res_id, i
                 );
-                wu_result.resultid = wi.res_id;
-                wu_result.res_priority = wi.res_priority;
-                wu_result.res_server_state = wi.res_server_state;
-                wu_result.res_report_deadline = wi.res_report_deadline;
-                wu_result.workunit = wi.wu;
+                wu_result.resultid = item->res_id;
+                wu_result.res_priority = item->res_priority;
+                wu_result.res_server_state = item->res_server_state;
+                wu_result.res_report_deadline = item->res_report_deadline;
+                wu_result.workunit = item->wu;
                 wu_result.state = WR_STATE_PRESENT;
+                pthread_mutex_lock(&queue_mutex);
+                result_slots[item->res_id] = i;
+                pthread_mutex_unlock(&queue_mutex);
                 // If the workunit has already been allocated to a certain
                 // OS then it should be assigned quickly,
                 // so we set its infeasible_count to 1
                 //
-                if (wi.wu.hr_class > 0) {
+                if (item->wu.hr_class > 0) {
                     wu_result.infeasible_count = 1;
                 } else {
                     wu_result.infeasible_count = 0;
@@ -542,6 +724,15 @@ static bool scan_work_array(vector<DB_WORK_ITEM> &work_items) {
         }
     }
     log_messages.printf(MSG_DEBUG, "Added %d results to array\n", nadditions);
+    if (use_prefetch) {
+        // let the prefetch thread refill the queues.
+        // Collisions are expected here (the queues may contain
+        // jobs added to the array since they were fetched)
+        // so they're not a reason to sleep.
+        //
+        pthread_cond_signal(&queue_cond);
+        return nadditions > 0;
+    }
     if (ncollisions) {
         log_messages.printf(MSG_DEBUG,
             "%d results already in array\n", ncollisions
@@ -719,6 +910,7 @@ void usage(char *name) {
         "  [ --mod n i ]                    handle only results with (id mod n) == i\n"
         "  [ --wmod n i ]                   handle only workunits with (id mod n) == i\n"
         "  [ --sleep_interval x ]           sleep x seconds if nothing to do\n"
+        "  [ --prefetch ]                   do DB enumeration in a separate thread\n"
         "  [ -h | --help ]                  Shows this help text.\n"
         "  [ -v | --version ]               Shows version information.\n",
         name, name
@@ -804,6 +996,8 @@ int main(int argc, char** argv) {
                 exit(1);
             }
             sleep_interval = atoi(argv[i]);
+        } else if (is_arg(argv[i], "prefetch")) {
+            use_prefetch = true;
         } else if (is_arg(argv[i], "v") || is_arg(argv[i], "version")) {
             show_version();
             exit(0);
@@ -939,6 +1133,30 @@ int main(int argc, char** argv) {
 
     signal(SIGUSR1, show_state);
 
+#ifndef GCL_SIMULATOR
+    if (use_prefetch) {
+        pthread_t prefetch_tid;
+        job_queues = new JOB_QUEUE[napps];
+        retval = prefetch_db.open(
+            config.db_name, config.db_host, config.db_user, config.db_passwd
+        );
+        if (!retval) {
+            retval = prefetch_db.set_isolation_level(READ_UNCOMMITTED);
+        }
+        if (!retval) {
+            retval = pthread_create(&prefetch_tid, NULL, prefetch_thread, NULL);
+        }
+        if (retval) {
+            log_messages.printf(MSG_CRITICAL,
+                "can't start prefetch thread: %d; not prefetching\n", retval
+            );
+            use_prefetch = false;
+        }
+    }
+#else
+    use_prefetch = false;
+#endif
+
     feeder_loop();
 }
 
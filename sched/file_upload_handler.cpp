@@ -30,6 +30,7 @@
 #include <csignal>
 #include <fcntl.h>
 #include <string>
+#include <vector>
 
 #ifdef _USING_FCGI_
 #include "boinc_fcgi.h"
@@ -51,6 +52,7 @@
 #include "sched_util.h"
 
 using std::string;
+using std::vector;
 
 #define LOCK_FILES
     // comment this out to not lock files
@@ -63,6 +65,29 @@ char this_filename[256];
 string variety = "";
 double start_time();
 
+// A client may send several files in one request:
+// <file_uploads> followed by <file_upload> sections,
+// each being the usual header, <data>, nbytes-offset bytes and a newline.
+// The reply then has a <file_status> element per file;
+// return_error() and return_success() record these
+// rather than writing a reply.
+//
+struct FILE_STATUS {
+    string name;
+    int status;
+    string message;
+};
+bool in_batch = false;
+vector<FILE_STATUS> file_statuses;
+
+static void add_file_status(int status, const char* message) {
+    FILE_STATUS fs;
+    fs.name = this_filename;
+    fs.status = status;
+    fs.message = message;
+    file_statuses.push_back(fs);
+}
+
 inline static const char* get_remote_addr() {
     char* p = getenv("REMOTE_ADDR");
     if (p) return p;
@@ -77,6 +102,15 @@ int return_error(bool transient, const char* message, ...) {
     vsprintf(buf, message, va);
     va_end(va);
 
+    if (in_batch) {
+        add_file_status(transient?1:-1, buf);
+        log_messages.printf(MSG_NORMAL,
+            "Returning error to client %s for %s: %s (%s)\n",
+            get_remote_addr(), this_filename, buf,
+            transient?"transient":"permanent"
+        );
+        return 1;
+    }
     fprintf(stdout,
         "Content-type: text/plain\n\n"
         "<data_server_reply>\n"
@@ -96,6 +130,10 @@ int return_error(bool transient, const char* message, ...) {
 }
 
 int return_success(const char* text) {
+    if (in_batch) {
+        add_file_status(0, "");
+        return 0;
+    }
     fprintf(stdout,
         "Content-type: text/plain\n\n"
         "<data_server_reply>\n"
@@ -110,6 +148,8 @@ int return_success(const char* text) {
 
 #define BLOCK_SIZE  (256*1024)
 double bytes_left=-1;
+    // bytes of the current file's data not yet read from the socket;
+    // -1 if unknown
 
 int accept_empty_file(char* name, char* path) {
     int fd = open(path,
@@ -125,14 +165,21 @@ int accept_empty_file(char* name, char* path) {
     return return_success(0);
 }
 
-// read from socket, discard data
+// read from socket, discard data.
+// In a batch, discard only the rest of the current file
 //
 void copy_socket_to_null(FILE* in) {
     unsigned char buf[BLOCK_SIZE];
 
     while (1) {
-        int n = fread(buf, 1, BLOCK_SIZE, in);
+        int m = BLOCK_SIZE;
+        if (in_batch) {
+            if (bytes_left <= 0) return;
+            if (bytes_left < m) m = (int)bytes_left;
+        }
+        int n = fread(buf, 1, m, in);
         if (n <= 0) return;
+        bytes_left -= n;
     }
 }
 
@@ -156,6 +203,7 @@ int copy_socket_to_file(FILE* in, char* name, char* path, double offset, double
         // try to get m bytes from socket (n>=0 is number actually returned)
         //
         n = fread(buf, 1, m, in);
+        bytes_left -= n;
 
         // delay opening the file until we've done the first socket read
         // to avoid filesystem lockups (WCG, possible paranoia)
@@ -287,8 +335,6 @@ int copy_socket_to_file(FILE* in, char* name, char* path, double offset, double
                 );
             }
         }
-
-        bytes_left -= n;
     }
     // upload complete; set new file permissions if configured
     //
@@ -316,7 +362,9 @@ int handle_file_upload(FILE* in, R_RSA_PUBLIC_KEY& key) {
     bool is_valid, btemp;
 
     strcpy(name, "");
+    strcpy(this_filename, "");
     strcpy(xml_signature, "");
+    bytes_left = -1;
     bool found_data = false;
     while (fgets(buf, 256, in)) {
         log_messages.printf(MSG_DETAIL, "got:%s\n", buf);
@@ -347,6 +395,9 @@ int handle_file_upload(FILE* in, R_RSA_PUBLIC_KEY& key) {
         }
         log_messages.printf(MSG_WARNING, "unrecognized: %s", buf);
     }
+    if (found_data && nbytes >= 0) {
+        bytes_left = (offset < nbytes) ? nbytes - offset : 0;
+    }
     if (strlen(name) == 0) {
         return return_error(ERR_PERMANENT, "Missing name");
     }
@@ -458,6 +509,58 @@ int handle_file_upload(FILE* in, R_RSA_PUBLIC_KEY& key) {
     return retval;
 }
 
+// handle a batch of uploads.
+// ALWAYS generates an HTML reply, with a <file_status> per file.
+// If we lose our place in the stream (e.g. a read error)
+// the remaining files get no status; the client will retry them.
+//
+int handle_file_uploads(FILE* in, R_RSA_PUBLIC_KEY& key) {
+    char buf[256];
+    unsigned int i;
+
+    in_batch = true;
+    file_statuses.clear();
+    while (fgets(buf, 256, in)) {
+        if (match_tag(buf, "</file_uploads>")) break;
+        if (match_tag(buf, "</file_upload>")) continue;
+        if (!match_tag(buf, "<file_upload>")) continue;
+        handle_file_upload(in, key);
+        if (bytes_left < 0 || ferror(in)) break;
+        if (bytes_left > 0) {
+            copy_socket_to_null(in);
+            if (bytes_left > 0) break;
+        }
+    }
+    in_batch = false;
+
+    fprintf(stdout,
+        "Content-type: text/plain\n\n"
+        "<data_server_reply>\n"
+        "    <status>0</status>\n"
+    );
+    for (i=0; i<file_statuses.size(); i++) {
+        FILE_STATUS& fs = file_statuses[i];
+        fprintf(stdout,
+            "    <file_status>\n"
+            "        <name>%s</name>\n"
+            "        <status>%d</status>\n",
+            fs.name.c_str(), fs.status
+        );
+        if (fs.message.size()) {
+            fprintf(stdout,
+                "        <message>%s</message>\n", fs.message.c_str()
+            );
+        }
+        fprintf(stdout, "    </file_status>\n");
+    }
+    fprintf(stdout, "</data_server_reply>\n");
+    log_messages.printf(MSG_NORMAL,
+        "Handled batch of %d uploads from %s\n",
+        (int)file_statuses.size(), get_remote_addr()
+    );
+    return 0;
+}
+
 bool volume_full(char* path) {
     double total, avail;
     int retval = get_filesystem_info(total, avail, path);
@@ -571,6 +674,10 @@ int handle_request(FILE* in, R_RSA_PUBLIC_KEY& key) {
             continue;
         } else if (parse_int(buf, "<core_client_release>", release)) {
             continue;
+        } else if (match_tag(buf, "<file_uploads>")) {
+            retval = handle_file_uploads(in, key);
+            did_something = true;
+            break;
         } else if (match_tag(buf, "<file_upload>")) {
             retval = handle_file_upload(in, key);
             did_something = true;
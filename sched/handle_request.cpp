@@ -37,6 +37,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <sys/stat.h>
+#include <zlib.h>
 
 #include "backend_lib.h"
 #include "boinc_db.h"
@@ -50,6 +51,7 @@
 #include "sched_vda.h"
 
 #include "credit.h"
+#include "sched_db_cache.h"
 #include "sched_files.h"
 #include "sched_main.h"
 #include "sched_types.h"
@@ -257,7 +259,9 @@ int authenticate_user() {
     DB_TEAM team;
 
     if (g_request->hostid) {
-        retval = host.lookup_id(g_request->hostid);
+        retval = cached_host_lookup(
+            g_request->hostid, g_request->rpc_seqno, host
+        );
         while (!retval && host.userid==0) {
             // if host record is zombie, follow link to new host
             //
@@ -286,8 +290,7 @@ int authenticate_user() {
         // and see if the authenticator matches (regular or weak)
         //
         g_request->using_weak_auth = false;
-        sprintf(buf, "where id=%lu", host.userid);
-        retval = user.lookup(buf);
+        retval = cached_user_lookup(host.userid, user);
         if (!retval && !strcmp(user.authenticator, g_request->authenticator)) {
             // req auth matches user auth - go on
         } else {
@@ -488,7 +491,7 @@ got_host:
     //
 
     if (g_reply->user.teamid) {
-        retval = team.lookup_id(g_reply->user.teamid);
+        retval = cached_team_lookup(g_reply->user.teamid, team);
         if (!retval) g_reply->team = team;
     }
 
@@ -509,6 +512,7 @@ got_host:
             sprintf(buf, "cross_project_id='%s'", g_request->cross_project_id);
             unescape_string(g_request->cross_project_id, sizeof(g_request->cross_project_id));
             user.update_field(buf);
+            uncache_user(user.id);
         }
     }
 
@@ -638,6 +642,9 @@ static int update_host_record(HOST& initial_host, HOST& xhost, USER& user) {
         log_messages.printf(MSG_CRITICAL,
             "host.update() failed: %s\n", boincerror(retval)
         );
+        uncache_host(host.id);
+    } else {
+        cache_host(host);
     }
     
     #ifdef BOINCMGE
@@ -874,6 +881,7 @@ int handle_global_prefs() {
                     "user.update_field() failed: %s\n", boincerror(retval)
                 );
             }
+            uncache_user(user.id);
         }
     }
 
@@ -1521,10 +1529,127 @@ static void log_user_messages() {
     }
 }
 
+#define GZIP_BUFSIZE 65536
+
+// Clients send gzip-encoded requests if we tell them to
+// (see gzip_sched_rpcs in sched_config.h).
+// Decompress such a request into a temporary file.
+// Return NULL on error, or if the result would exceed max_request_size.
+//
+static FILE* gunzip_request(FILE* fin) {
+    unsigned char inbuf[GZIP_BUFSIZE], outbuf[GZIP_BUFSIZE];
+    z_stream zs;
+    int zret = Z_OK;
+    double nout = 0;
+    bool too_big = false;
+
+    FILE* f = tmpfile();
+    if (!f) return NULL;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 16+MAX_WBITS) != Z_OK) {
+        fclose(f);
+        return NULL;
+    }
+    while (zret != Z_STREAM_END) {
+        size_t n = fread(inbuf, 1, sizeof(inbuf), fin);
+        if (n == 0) break;
+        zs.next_in = inbuf;
+        zs.avail_in = (uInt)n;
+        do {
+            zs.next_out = outbuf;
+            zs.avail_out = sizeof(outbuf);
+            zret = inflate(&zs, Z_NO_FLUSH);
+            if (zret != Z_OK && zret != Z_STREAM_END) {
+                break;
+            }
+            size_t nbytes = sizeof(outbuf)-zs.avail_out;
+            nout += nbytes;
+            if (nout > config.max_request_size) {
+                too_big = true;
+                break;
+            }
+            fwrite(outbuf, 1, nbytes, f);
+        } while (zs.avail_out == 0 && zret != Z_STREAM_END);
+        if (too_big) break;
+        if (zret != Z_OK && zret != Z_STREAM_END) break;
+    }
+    inflateEnd(&zs);
+    if (too_big) {
+        log_messages.printf(MSG_NORMAL,
+            "gzip-encoded request from IP %s exceeds %.0f bytes\n",
+            get_remote_addr(), config.max_request_size
+        );
+        fclose(f);
+        return NULL;
+    }
+    if (zret != Z_STREAM_END) {
+        log_messages.printf(MSG_NORMAL,
+            "Bad gzip-encoded request from IP %s\n", get_remote_addr()
+        );
+        fclose(f);
+        return NULL;
+    }
+    rewind(f);
+    return f;
+}
+
+// accept gzip-encoded requests only if we asked for them
+//
+static bool request_gzipped() {
+    if (!config.gzip_sched_rpcs) return false;
+    char* p = getenv("HTTP_CONTENT_ENCODING");
+    return p && strstr(p, "gzip");
+}
+
+static bool reply_gzip_ok() {
+    if (!config.gzip_sched_rpcs) return false;
+    char* p = getenv("HTTP_ACCEPT_ENCODING");
+    return p && strstr(p, "gzip");
+}
+
+// Copy a reply (HTTP header lines, blank line, body) from fin to fout,
+// adding a Content-Encoding header and gzipping the body as we go.
+//
+static int gzip_reply(FILE* fin, FILE* fout) {
+    unsigned char inbuf[GZIP_BUFSIZE], outbuf[GZIP_BUFSIZE];
+    char buf[1024];
+    z_stream zs;
+    int flush, zret;
+
+    while (fgets(buf, sizeof(buf), fin)) {
+        if (!strcmp(buf, "\n")) break;
+        fputs(buf, fout);
+    }
+    fprintf(fout, "Content-Encoding: gzip\n\n");
+
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+        16+MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK
+    ) {
+        return ERR_WRITE;
+    }
+    do {
+        size_t n = fread(inbuf, 1, sizeof(inbuf), fin);
+        flush = feof(fin)?Z_FINISH:Z_NO_FLUSH;
+        zs.next_in = inbuf;
+        zs.avail_in = (uInt)n;
+        do {
+            zs.next_out = outbuf;
+            zs.avail_out = sizeof(outbuf);
+            zret = deflate(&zs, flush);
+            fwrite(outbuf, 1, sizeof(outbuf)-zs.avail_out, fout);
+        } while (zs.avail_out == 0);
+        if (n == 0 && flush != Z_FINISH) break;
+    } while (flush != Z_FINISH);
+    deflateEnd(&zs);
+    return (zret == Z_STREAM_END)?0:ERR_WRITE;
+}
+
 void handle_request(FILE* fin, FILE* fout, char* code_sign_key) {
     SCHEDULER_REQUEST sreq;
     SCHEDULER_REPLY sreply;
     char buf[1024];
+    FILE* gz_fin = NULL;
 
     g_request = &sreq;
     g_reply = &sreply;
@@ -1534,6 +1659,22 @@ void handle_request(FILE* fin, FILE* fout, char* code_sign_key) {
 
     log_messages.set_indent_level(1);
 
+    if (request_gzipped()) {
+        gz_fin = gunzip_request(fin);
+        if (!gz_fin) {
+            // the body has been consumed, so we can't parse it as is.
+            // An HTTP error makes the client send uncompressed requests.
+            //
+            fprintf(fout,
+                "Status: 400 Bad Request\n"
+                "Content-type: text/plain\n\n"
+                "Can't decompress request\n"
+            );
+            return;
+        }
+        fin = gz_fin;
+    }
+
     MIOFILE mf;
     XML_PARSER xp(&mf);
     mf.init_file(fin);
@@ -1555,7 +1696,20 @@ void handle_request(FILE* fin, FILE* fout, char* code_sign_key) {
         log_user_messages();
     }
 
-    sreply.write(fout, sreq);
+    if (gz_fin) fclose(gz_fin);
+
+    // To gzip the reply we need its HTTP header lines,
+    // so write it to a temp file first
+    //
+    FILE* reply_file = reply_gzip_ok()?tmpfile():NULL;
+    if (reply_file) {
+        sreply.write(reply_file, sreq);
+        rewind(reply_file);
+        gzip_reply(reply_file, fout);
+        fclose(reply_file);
+    } else {
+        sreply.write(fout, sreq);
+    }
     log_messages.printf(MSG_NORMAL,
         "Scheduler ran %.3f seconds\n", dtime()-start_time
     );
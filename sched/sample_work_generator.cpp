@@ -39,6 +39,7 @@
 #include <cstdlib>
 #include <string>
 #include <cstring>
+#include <vector>
 
 #include "backend_lib.h"
 #include "boinc_db.h"
@@ -71,6 +72,8 @@ const char* in_template_file = "example_app_in";
 const char* out_template_file = "example_app_out";
 
 char* in_template;
+JOB_BATCH job_batch;
+    // jobs are inserted in batches; see main_loop()
 DB_APP app;
 int start_time;
 int seqno;
@@ -80,7 +83,7 @@ int seqno;
 int make_job() {
     DB_WORKUNIT wu;
     char name[256], path[MAXPATHLEN];
-    const char* infiles[1];
+    vector<INFILE_DESC> infiles(1);
     int retval;
 
     // make a unique name (for the job and its input file)
@@ -112,20 +115,13 @@ int make_job() {
     wu.max_error_results = REPLICATION_FACTOR*4;
     wu.max_total_results = REPLICATION_FACTOR*8;
     wu.max_success_results = REPLICATION_FACTOR*4;
-    infiles[0] = name;
+    infiles[0].is_remote = false;
+    safe_strcpy(infiles[0].name, name);
 
-    // Register the job with BOINC
+    // Register the job with BOINC.
+    // The WU record is inserted when the batch is flushed.
     //
-    sprintf(path, "templates/%s", out_template_file);
-    return create_work(
-        wu,
-        in_template,
-        path,
-        config.project_path(path),
-        infiles,
-        1,
-        config
-    );
+    return job_batch.add_job(wu, infiles);
 }
 
 void main_loop() {
@@ -168,6 +164,13 @@ void main_loop() {
                     exit(retval);
                 }
             }
+            retval = job_batch.flush();
+            if (retval) {
+                log_messages.printf(MSG_CRITICAL,
+                    "can't insert jobs: %s\n", boincerror(retval)
+                );
+                exit(retval);
+            }
             // Wait for the transitioner to create instances
             // of the jobs we just created.
             // Otherwise we'll create too many jobs.
@@ -273,6 +276,12 @@ int main(int argc, char** argv) {
         exit(1);
     }
 
+    snprintf(buf, sizeof(buf), "templates/%s", out_template_file);
+    if (job_batch.init(in_template, buf, config)) {
+        log_messages.printf(MSG_CRITICAL, "can't find output template %s\n", buf);
+        exit(1);
+    }
+
     start_time = time(0);
     seqno = 0;
 
@@ -83,6 +83,7 @@ int SCHED_CONFIG::parse(FILE* f) {
     locality_scheduling_workunit_file = new vector<regex_t>;
     locality_scheduling_sticky_file = new vector<regex_t>;
     max_wus_to_send = 10;
+    max_request_size = 64.e6;
     default_disk_max_used_gb = 100.;
     default_disk_max_used_pct = 50.;
     default_disk_min_free_gb = .001;
@@ -233,6 +234,7 @@ int SCHED_CONFIG::parse(FILE* f) {
         if (xp.parse_bool("dont_store_success_stderr", dont_store_success_stderr)) continue;
         if (xp.parse_int("file_deletion_strategy", file_deletion_strategy)) continue;
         if (xp.parse_int("gpu_multiplier", gpu_multiplier)) continue;
+        if (xp.parse_bool("gzip_sched_rpcs", gzip_sched_rpcs)) continue;
         if (xp.parse_bool("ignore_delay_bound", ignore_delay_bound)) continue;
         if (xp.parse_bool("locality_scheduling", locality_scheduling)) continue;
         if (xp.parse_double("locality_scheduler_fraction", locality_scheduler_fraction)) continue;
@@ -272,6 +274,7 @@ int SCHED_CONFIG::parse(FILE* f) {
             continue;
         }
         if (xp.parse_int("max_results_accepted", max_results_accepted)) continue;
+        if (xp.parse_double("max_request_size", max_request_size)) continue;
         if (xp.parse_int("max_wus_to_send", max_wus_to_send)) continue;
         if (xp.parse_int("min_core_client_version", min_core_client_version)) {
             if (min_core_client_version && min_core_client_version < 10000) {
@@ -325,6 +328,9 @@ int SCHED_CONFIG::parse(FILE* f) {
         if (xp.parse_double("version_select_random_factor", version_select_random_factor)) continue;
         if (xp.parse_double("maintenance_delay", maintenance_delay)) continue;
         if (xp.parse_bool("credit_by_app", credit_by_app)) continue;
+        if (xp.parse_bool("credit_journal", credit_journal)) continue;
+        if (xp.parse_double("sched_db_cache_ttl", sched_db_cache_ttl)) continue;
+        if (xp.parse_int("sched_db_cache_size", sched_db_cache_size)) continue;
         if (xp.parse_bool("keyword_sched", keyword_sched)) continue;
         if (xp.parse_bool("rte_no_stats", rte_no_stats)) continue;
 
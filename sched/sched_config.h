@@ -119,6 +119,9 @@ struct SCHED_CONFIG {
     int file_deletion_strategy;
         // select method of automatically deleting files from host
     int gpu_multiplier;             // mult is NCPUS + this*NGPUS
+    bool gzip_sched_rpcs;
+        // tell clients to gzip scheduler requests,
+        // and gzip replies to clients that accept it
     bool ignore_delay_bound;
     bool locality_scheduling;
     double locality_scheduler_fraction;
@@ -136,6 +139,8 @@ struct SCHED_CONFIG {
         // (they'll get reported in the next RPC)
         // This limits the memory usage of the scheduler;
         // otherwise it can crash if the client is reporting thousands of jobs.
+    double max_request_size;
+        // max size of a gzip-encoded request after decompression
     int max_wus_to_send;            // max results per RPC is this * mult
     int min_core_client_version;
     int min_core_client_version_announced;
@@ -184,6 +189,15 @@ struct SCHED_CONFIG {
         // to calculate projected_flops when choosing version.
     bool credit_by_app;
         // store per-app credit info in credit_user and credit_team
+    double sched_db_cache_ttl;
+        // if nonzero, scheduler caches host/user/team records
+        // for up to this many seconds (useful with FastCGI)
+    int sched_db_cache_size;
+        // max # of records of each type in that cache
+    bool credit_journal;
+        // validator appends credit grants to the credit_journal table
+        // rather than updating user and team records;
+        // credit_aggregator applies them in batches
     bool keyword_sched;
         // score jobs based on keywords
     bool rte_no_stats;
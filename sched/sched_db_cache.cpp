@@ -0,0 +1,113 @@
+// This file is part of BOINC.
+// http://boinc.berkeley.edu
+// Copyright (C) 2026 University of California
+//
+// BOINC is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation,
+// either version 3 of the License, or (at your option) any later version.
+//
+// BOINC is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with BOINC.  If not, see <http://www.gnu.org/licenses/>.
+
+// In-process caches of host, user and team records.
+//
+// When the scheduler runs under FastCGI, each process handles
+// many requests, and most hosts contact us every few minutes.
+// Caching the records avoids several DB lookups per request.
+//
+// Enabled if <sched_db_cache_ttl> is nonzero.
+// Entries expire after that many seconds,
+// so changes made elsewhere (e.g. on the web site) are seen
+// within that time.
+//
+// A cached host record is used only if the request's RPC sequence number
+// is the one following the cached record's.
+// If some other scheduler process handled a request from the host
+// since we cached the record, the seqnos won't match
+// and we read the record from the DB.
+//
+// The scheduler writes back only host fields that changed
+// (DB_HOST::update_diff_sched()); after doing so it updates the cache.
+
+#include "sched_config.h"
+#include "sched_db_cache.h"
+
+#define DEFAULT_CACHE_SIZE  10000
+
+static RECORD_CACHE<HOST> host_cache;
+static RECORD_CACHE<USER> user_cache;
+static RECORD_CACHE<TEAM> team_cache;
+
+static inline bool cache_enabled() {
+    return config.sched_db_cache_ttl > 0;
+}
+
+static inline unsigned int cache_size() {
+    return config.sched_db_cache_size>0?config.sched_db_cache_size:DEFAULT_CACHE_SIZE;
+}
+
+int cached_host_lookup(DB_ID_TYPE id, int rpc_seqno, DB_HOST& host) {
+    HOST h;
+    if (cache_enabled() && host_cache.get(id, config.sched_db_cache_ttl, h)) {
+        if (h.rpc_seqno + 1 == rpc_seqno) {
+            HOST& hr = host;
+            hr = h;
+            return 0;
+        }
+        host_cache.remove(id);
+    }
+    int retval = host.lookup_id(id);
+    if (!retval) cache_host(host);
+    return retval;
+}
+
+int cached_user_lookup(DB_ID_TYPE id, DB_USER& user) {
+    USER u;
+    if (cache_enabled() && user_cache.get(id, config.sched_db_cache_ttl, u)) {
+        USER& ur = user;
+        ur = u;
+        return 0;
+    }
+    int retval = user.lookup_id(id);
+    if (!retval) cache_user(user);
+    return retval;
+}
+
+int cached_team_lookup(DB_ID_TYPE id, DB_TEAM& team) {
+    TEAM t;
+    if (cache_enabled() && team_cache.get(id, config.sched_db_cache_ttl, t)) {
+        TEAM& tr = team;
+        tr = t;
+        return 0;
+    }
+    int retval = team.lookup_id(id);
+    if (!retval && cache_enabled()) {
+        t = team;
+        team_cache.put(id, t, cache_size());
+    }
+    return retval;
+}
+
+void cache_host(HOST& host) {
+    if (!cache_enabled()) return;
+    host_cache.put(host.id, host, cache_size());
+}
+
+void cache_user(USER& user) {
+    if (!cache_enabled()) return;
+    user_cache.put(user.id, user, cache_size());
+}
+
+void uncache_host(DB_ID_TYPE id) {
+    host_cache.remove(id);
+}
+
+void uncache_user(DB_ID_TYPE id) {
+    user_cache.remove(id);
+}
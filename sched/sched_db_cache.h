@@ -0,0 +1,85 @@
+// This file is part of BOINC.
+// http://boinc.berkeley.edu
+// Copyright (C) 2026 University of California
+//
+// BOINC is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation,
+// either version 3 of the License, or (at your option) any later version.
+//
+// BOINC is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with BOINC.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BOINC_SCHED_DB_CACHE_H
+#define BOINC_SCHED_DB_CACHE_H
+
+// see sched_db_cache.cpp
+
+#include <list>
+#include <map>
+
+#include "boinc_db.h"
+#include "util.h"
+
+// LRU cache of DB records, keyed by ID.
+// Entries older than ttl seconds are treated as missing.
+//
+template <class T> class RECORD_CACHE {
+    struct ENTRY {
+        T rec;
+        double time;
+        typename std::list<DB_ID_TYPE>::iterator lru_pos;
+    };
+    std::map<DB_ID_TYPE, ENTRY> entries;
+    std::list<DB_ID_TYPE> lru;
+        // most recently used first
+public:
+    bool get(DB_ID_TYPE id, double ttl, T& rec) {
+        typename std::map<DB_ID_TYPE, ENTRY>::iterator it = entries.find(id);
+        if (it == entries.end()) return false;
+        if (dtime() - it->second.time > ttl) {
+            remove(id);
+            return false;
+        }
+        lru.splice(lru.begin(), lru, it->second.lru_pos);
+        rec = it->second.rec;
+        return true;
+    }
+    void put(DB_ID_TYPE id, T& rec, unsigned int max_size) {
+        typename std::map<DB_ID_TYPE, ENTRY>::iterator it = entries.find(id);
+        if (it != entries.end()) {
+            lru.erase(it->second.lru_pos);
+        } else {
+            while (entries.size() >= max_size && !lru.empty()) {
+                entries.erase(lru.back());
+                lru.pop_back();
+            }
+        }
+        lru.push_front(id);
+        ENTRY& e = entries[id];
+        e.rec = rec;
+        e.time = dtime();
+        e.lru_pos = lru.begin();
+    }
+    void remove(DB_ID_TYPE id) {
+        typename std::map<DB_ID_TYPE, ENTRY>::iterator it = entries.find(id);
+        if (it == entries.end()) return;
+        lru.erase(it->second.lru_pos);
+        entries.erase(it);
+    }
+};
+
+extern int cached_host_lookup(DB_ID_TYPE id, int rpc_seqno, DB_HOST&);
+extern int cached_user_lookup(DB_ID_TYPE id, DB_USER&);
+extern int cached_team_lookup(DB_ID_TYPE id, DB_TEAM&);
+extern void cache_host(HOST&);
+extern void cache_user(USER&);
+extern void uncache_host(DB_ID_TYPE id);
+extern void uncache_user(DB_ID_TYPE id);
+
+#endif
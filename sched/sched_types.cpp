@@ -776,6 +776,9 @@ int SCHEDULER_REPLY::write(FILE* fout, SCHEDULER_REQUEST& sreq) {
     if (sreq.core_client_version >= 70028) {
         fprintf(fout, "<dont_use_dcf/>\n");
     }
+    if (config.gzip_sched_rpcs) {
+        fprintf(fout, "<gzip_sched_request/>\n");
+    }
     if (strlen(config.master_url)) {
         fprintf(fout,
             "<master_url>%s</master_url>\n",
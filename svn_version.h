@@ -0,0 +1,8 @@
+#ifndef SVN_VERSION_H
+#define SVN_VERSION_H
+
+#define SVN_VERSION "9f4dfe473bb17de32a63f19644472730a90ddc31 [] (vm:/root/repo [master]) [Server-Release: ]"
+#define GIT_REVISION 0x9f4dfe47
+#define GIT_DATE 1792389726
+
+#endif
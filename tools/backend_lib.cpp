@@ -23,6 +23,7 @@
 #endif
 #include <cstdlib>
 #include <cstring>
+#include <map>
 #include <string>
 #include <vector>
 #include <ctime>
@@ -49,6 +50,7 @@
 
 #include "backend_lib.h"
 
+using std::map;
 using std::string;
 
 // Initialize RNG based on time and PID
@@ -81,6 +83,39 @@ int read_filename(const char* path, char* buf, int len) {
     return retval;
 }
 
+// Get the contents of a result template file.
+// The transitioner creates results for many WUs with the same template,
+// so keep the contents in memory; reread the file if its mod time or size
+// changes (mod times have 1-sec resolution, so also check the size).
+//
+static int read_result_template(const char* path, char* buf, int len) {
+    struct RT_CACHE_ENTRY {
+        time_t mtime;
+        off_t size;
+        string contents;
+    };
+    static map<string, RT_CACHE_ENTRY> rt_cache;
+    struct stat sbuf;
+
+    if (stat(path, &sbuf)) return ERR_STAT;
+    string key(path);
+    map<string, RT_CACHE_ENTRY>::iterator it = rt_cache.find(key);
+    if (it == rt_cache.end()
+        || it->second.mtime != sbuf.st_mtime
+        || it->second.size != sbuf.st_size
+    ) {
+        int retval = read_filename(path, buf, len);
+        if (retval) return retval;
+        RT_CACHE_ENTRY& e = rt_cache[key];
+        e.mtime = sbuf.st_mtime;
+        e.size = sbuf.st_size;
+        e.contents = buf;
+        return 0;
+    }
+    strlcpy(buf, it->second.contents.c_str(), len);
+    return 0;
+}
+
 // initialize an about-to-be-created result, given its WU
 //
 static void initialize_result(DB_RESULT& result, WORKUNIT& wu) {
@@ -168,7 +203,7 @@ int create_result(
     result.priority += priority_increase;
     sprintf(result.name, "%s_%s", wu.name, result_name_suffix);
     sprintf(base_outfile_name, "%s_r%ld_", result.name, lrand48());
-    retval = read_filename(
+    retval = read_result_template(
         result_template_filename, result_template, sizeof(result_template)
     );
     if (retval) {
@@ -227,6 +262,109 @@ int check_files(char** infiles, int ninfiles, SCHED_CONFIG& config_loc) {
     return 0;
 }
 
+// check for presence of result template.
+// we don't need to actually look at it.
+//
+static int check_result_template(
+    const char* result_template_filename, SCHED_CONFIG& config_loc
+) {
+    const char* p = config_loc.project_path(result_template_filename);
+    if (!boinc_file_exists(p)) {
+        fprintf(stderr,
+            "create_work: result template file %s doesn't exist\n", p
+        );
+        return ERR_FILE_MISSING;
+    }
+    if (strlen(result_template_filename) > sizeof(WORKUNIT::result_template_file)-1) {
+        fprintf(stderr,
+            "result template filename is too big: %d bytes, max is %d\n",
+            (int)strlen(result_template_filename),
+            (int)sizeof(WORKUNIT::result_template_file)-1
+        );
+        return ERR_BUFFER_OVERFLOW;
+    }
+    return 0;
+}
+
+// check a WU's parameters, and fill in the rest of its fields
+//
+static int finish_wu(DB_WORKUNIT& wu, const char* result_template_filename) {
+    strlcpy(wu.result_template_file, result_template_filename, sizeof(wu.result_template_file));
+
+    if (wu.rsc_fpops_est == 0) {
+        fprintf(stderr, "no rsc_fpops_est given; can't create job\n");
+        return ERR_NO_OPTION;
+    }
+    if (wu.rsc_fpops_bound == 0) {
+        fprintf(stderr, "no rsc_fpops_bound given; can't create job\n");
+        return ERR_NO_OPTION;
+    }
+    if (wu.rsc_disk_bound == 0) {
+        fprintf(stderr, "no rsc_disk_bound given; can't create job\n");
+        return ERR_NO_OPTION;
+    }
+    if (wu.target_nresults == 0) {
+        fprintf(stderr, "no target_nresults given; can't create job\n");
+        return ERR_NO_OPTION;
+    }
+    if (wu.max_error_results == 0) {
+        fprintf(stderr, "no max_error_results given; can't create job\n");
+        return ERR_NO_OPTION;
+    }
+    if (wu.max_total_results == 0) {
+        fprintf(stderr, "no max_total_results given; can't create job\n");
+        return ERR_NO_OPTION;
+    }
+    if (wu.max_success_results == 0) {
+        fprintf(stderr, "no max_success_results given; can't create job\n");
+        return ERR_NO_OPTION;
+    }
+    if (wu.max_success_results > wu.max_total_results) {
+        fprintf(stderr, "max_success_results > max_total_results; can't create job\n");
+        return ERR_INVALID_PARAM;
+    }
+    if (wu.max_error_results > wu.max_total_results) {
+        fprintf(stderr, "max_error_results > max_total_results; can't create job\n");
+        return ERR_INVALID_PARAM;
+    }
+    if (wu.target_nresults > wu.max_success_results) {
+        fprintf(stderr, "target_nresults > max_success_results; can't create job\n");
+        return ERR_INVALID_PARAM;
+    }
+    if (wu.transitioner_flags) {
+        wu.transition_time = INT_MAX;
+    } else {
+        wu.transition_time = time(0);
+    }
+    return 0;
+}
+
+// fill in the WU's XML doc and check its parameters
+//
+static int prepare_wu(
+    DB_WORKUNIT& wu,
+    const char* _wu_template,
+    const char* result_template_filename,
+    vector<INFILE_DESC> &infiles,
+    SCHED_CONFIG& config_loc,
+    const char* command_line,
+    const char* additional_xml
+) {
+    int retval;
+    char wu_template[BLOB_SIZE];
+
+    safe_strcpy(wu_template, _wu_template);
+    wu.create_time = time(0);
+    retval = process_input_template(
+        wu, wu_template, infiles, config_loc, command_line, additional_xml
+    );
+    if (retval) {
+        fprintf(stderr, "process_input_template(): %s\n", boincerror(retval));
+        return retval;
+    }
+    return finish_wu(wu, result_template_filename);
+}
+
 // variant where input files are described by a list of names,
 // for use by work generators
 //
@@ -281,7 +419,6 @@ int create_work2(
     char* query_string
 ) {
     int retval;
-    char wu_template[BLOB_SIZE];
 
 #if 0
     retval = check_files(infiles, ninfiles, config_loc);
@@ -291,82 +428,14 @@ int create_work2(
     }
 #endif
 
-    safe_strcpy(wu_template, _wu_template);
-    wu.create_time = time(0);
-    retval = process_input_template(
-        wu, wu_template, infiles, config_loc, command_line, additional_xml
+    retval = check_result_template(result_template_filename, config_loc);
+    if (retval) return retval;
+    retval = prepare_wu(
+        wu, _wu_template, result_template_filename, infiles, config_loc,
+        command_line, additional_xml
     );
-    if (retval) {
-        fprintf(stderr, "process_input_template(): %s\n", boincerror(retval));
-        return retval;
-    }
-
-    // check for presence of result template.
-    // we don't need to actually look at it.
-    //
-    const char* p = config_loc.project_path(result_template_filename);
-    if (!boinc_file_exists(p)) {
-        fprintf(stderr,
-            "create_work: result template file %s doesn't exist\n", p
-        );
-        return retval;
-    }
-
-    if (strlen(result_template_filename) > sizeof(wu.result_template_file)-1) {
-        fprintf(stderr,
-            "result template filename is too big: %d bytes, max is %d\n",
-            (int)strlen(result_template_filename),
-            (int)sizeof(wu.result_template_file)-1
-        );
-        return ERR_BUFFER_OVERFLOW;
-    }
-    strlcpy(wu.result_template_file, result_template_filename, sizeof(wu.result_template_file));
+    if (retval) return retval;
 
-    if (wu.rsc_fpops_est == 0) {
-        fprintf(stderr, "no rsc_fpops_est given; can't create job\n");
-        return ERR_NO_OPTION;
-    }
-    if (wu.rsc_fpops_bound == 0) {
-        fprintf(stderr, "no rsc_fpops_bound given; can't create job\n");
-        return ERR_NO_OPTION;
-    }
-    if (wu.rsc_disk_bound == 0) {
-        fprintf(stderr, "no rsc_disk_bound given; can't create job\n");
-        return ERR_NO_OPTION;
-    }
-    if (wu.target_nresults == 0) {
-        fprintf(stderr, "no target_nresults given; can't create job\n");
-        return ERR_NO_OPTION;
-    }
-    if (wu.max_error_results == 0) {
-        fprintf(stderr, "no max_error_results given; can't create job\n");
-        return ERR_NO_OPTION;
-    }
-    if (wu.max_total_results == 0) {
-        fprintf(stderr, "no max_total_results given; can't create job\n");
-        return ERR_NO_OPTION;
-    }
-    if (wu.max_success_results == 0) {
-        fprintf(stderr, "no max_success_results given; can't create job\n");
-        return ERR_NO_OPTION;
-    }
-    if (wu.max_success_results > wu.max_total_results) {
-        fprintf(stderr, "max_success_results > max_total_results; can't create job\n");
-        return ERR_INVALID_PARAM;
-    }
-    if (wu.max_error_results > wu.max_total_results) {
-        fprintf(stderr, "max_error_results > max_total_results; can't create job\n");
-        return ERR_INVALID_PARAM;
-    }
-    if (wu.target_nresults > wu.max_success_results) {
-        fprintf(stderr, "target_nresults > max_success_results; can't create job\n");
-        return ERR_INVALID_PARAM;
-    }
-    if (wu.transitioner_flags) {
-        wu.transition_time = INT_MAX;
-    } else {
-        wu.transition_time = time(0);
-    }
     if (query_string) {
         wu.db_print_values(query_string);
     } else if (wu.id) {
@@ -391,6 +460,82 @@ int create_work2(
     return 0;
 }
 
+int JOB_BATCH::init(
+    const char* _wu_template,
+    const char* _result_template_filename,
+    SCHED_CONFIG& config_loc,
+    int _max_jobs
+) {
+    int retval = check_result_template(_result_template_filename, config_loc);
+    if (retval) return retval;
+    retval = input_template.parse(_wu_template, config_loc);
+    if (retval) {
+        fprintf(stderr, "JOB_BATCH: can't parse input template: %s\n",
+            boincerror(retval)
+        );
+        return retval;
+    }
+    result_template_filename = _result_template_filename;
+    config = &config_loc;
+    max_jobs = _max_jobs;
+    njobs = 0;
+    values.clear();
+    return 0;
+}
+
+int JOB_BATCH::add_job(
+    DB_WORKUNIT& wu,
+    vector<INFILE_DESC>& infiles,
+    const char* command_line,
+    const char* additional_xml
+) {
+    char value_buf[MAX_QUERY_LEN];
+    int retval;
+
+    wu.create_time = time(0);
+    retval = input_template.fill_in(
+        wu, infiles, *config, command_line, additional_xml
+    );
+    if (retval) {
+        fprintf(stderr, "JOB_BATCH: fill_in(): %s\n", boincerror(retval));
+        return retval;
+    }
+    retval = finish_wu(wu, result_template_filename.c_str());
+    if (retval) return retval;
+    wu.db_print_values(value_buf);
+
+    // MySQL can handle queries of at least 1 MB
+    //
+    int n = strlen(value_buf);
+    if (njobs && values.size() + 2*n > 1000000) {
+        retval = flush();
+        if (retval) return retval;
+    }
+    if (njobs) values += ",";
+    values += value_buf;
+    njobs++;
+    if (njobs >= max_jobs) {
+        return flush();
+    }
+    return 0;
+}
+
+int JOB_BATCH::flush() {
+    DB_WORKUNIT wu;
+    if (!njobs) return 0;
+    int retval = wu.insert_batch(values);
+    if (retval) {
+        fprintf(stderr,
+            "JOB_BATCH: insert_batch() of %d jobs failed: %s\n",
+            njobs, boinc_db.error_string()
+        );
+        return retval;
+    }
+    values.clear();
+    njobs = 0;
+    return 0;
+}
+
 // STUFF RELATED TO FILE UPLOAD/DOWNLOAD
 
 int get_file_xml(
@@ -19,6 +19,9 @@
 #define BOINC_BACKEND_LIB_H
 
 #include <limits.h>
+#include <set>
+#include <string>
+#include <vector>
 
 #include "crypt.h"
 #include "sched_config.h"
@@ -115,6 +118,94 @@ extern int create_work2(
     char* query_string = 0
 );
 
+// An input template, parsed once so that many jobs can be made from it
+// (see JOB_BATCH).
+// Constant files (those with <physical_name>) are looked up at parse time;
+// the other files are filled in from the INFILE_DESCs of each job.
+//
+struct INPUT_TEMPLATE_FILE {
+    std::string xml;
+        // elements copied verbatim from the template
+    std::string const_xml;
+        // constant file: the complete <file_info> element
+    INFILE_DESC const_infile;
+    bool is_constant;
+    bool gzip;
+    std::vector<std::string> urls;
+    std::string md5;
+    double nbytes;
+        // if > 0, a remote file whose URLs, MD5 and size are in the template
+    double gzipped_nbytes;
+};
+
+struct INPUT_TEMPLATE_FILE_REF {
+    std::string xml;
+        // the contents of the <file_ref>, except <file_name>
+    bool default_open_name;
+        // <copy_file/> but no <open_name>; open name is the file name
+};
+
+struct INPUT_TEMPLATE {
+    std::vector<INPUT_TEMPLATE_FILE> files;
+    int nfiles_before_wu;
+        // the <file_info>s preceding <workunit>; these are the file refs
+    int nvar_files;
+    std::vector<INPUT_TEMPLATE_FILE_REF> file_refs;
+    std::vector<std::string> wu_xml;
+        // the rest of <workunit>, split at the <file_ref>s;
+        // wu_xml[i] precedes file_refs[i]
+    bool has_command_line;
+    WORKUNIT params;
+    std::set<std::string> params_given;
+        // job parameters (rsc_fpops_est etc.) given in the template
+
+    int parse(const char* tmplate, SCHED_CONFIG&);
+    int fill_in(
+        WORKUNIT&,
+        vector<INFILE_DESC>& var_infiles,
+        SCHED_CONFIG&,
+        const char* command_line,
+        const char* additional_xml
+    );
+};
+
+// Create many jobs with the same input and result templates.
+// The input template is parsed once and the result template checked once;
+// workunit records are inserted with multi-row inserts
+// every max_jobs jobs (and when flush() is called).
+// Results are created by the transitioner as usual.
+// Workunit IDs are not known to the caller.
+//
+struct JOB_BATCH {
+    INPUT_TEMPLATE input_template;
+    std::string result_template_filename;
+    SCHED_CONFIG* config;
+    int max_jobs;
+    int njobs;
+        // # of jobs in "values", not yet inserted
+    std::string values;
+
+    JOB_BATCH() {
+        config = NULL;
+        max_jobs = 1;
+        njobs = 0;
+    }
+    int init(
+        const char* wu_template,
+        const char* result_template_filename,
+            // relative to project root
+        SCHED_CONFIG&,
+        int max_jobs = 1000
+    );
+    int add_job(
+        DB_WORKUNIT& wu,
+        vector<INFILE_DESC>& infiles,
+        const char* command_line = NULL,
+        const char* additional_xml = NULL
+    );
+    int flush();
+};
+
 extern int stage_file(const char*, bool);
 
 // the following functions return XML that can be put in
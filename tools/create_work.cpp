@@ -29,6 +29,7 @@
 #include <ctime>
 #include <string>
 #include <map>
+#include <vector>
 #include <sys/param.h>
 #include <unistd.h>
 
@@ -42,12 +43,17 @@
 #include "util.h"
 
 #include "backend_lib.h"
+#include "process_input_template.h"
 
 using std::string;
 using std::map;
+using std::vector;
+
+#define DEFAULT_STAGE_THREADS   4
 
 bool verbose = false;
 bool continue_on_error = false;
+int stage_threads = DEFAULT_STAGE_THREADS;
 
 void usage() {
     fprintf(stderr,
@@ -78,6 +84,7 @@ void usage() {
         "   [ --rsc_fpops_bound x ]\n"
         "   [ --rsc_memory_bound x ]\n"
         "   [ --size_class n ]\n"
+        "   [ --stage_threads n ]           with --stdin: stage/hash input files with n threads\n"
         "   [ --stdin ]\n"
         "   [ --target_host ID ]\n"
         "   [ --target_nresults n ]\n"
@@ -331,6 +338,8 @@ int main(int argc, char** argv) {
             exit(0);
         } else if (arg(argv, i, "stdin")) {
             use_stdin = true;
+        } else if (arg(argv, i, "stage_threads")) {
+            stage_threads = atoi(argv[++i]);
         } else if (arg(argv, i, (char*)"remote_file")) {
             INFILE_DESC id;
             id.is_remote = true;
@@ -453,9 +462,38 @@ int main(int argc, char** argv) {
             DB_WORKUNIT wu;
             int _argc;
             char* _argv[100], value_buf[MAX_QUERY_LEN];
-            for (int j=0; ; j++) {
-                char* p = fgets(buf, sizeof(buf), stdin);
-                if (p == NULL) break;
+            vector<string> lines, names;
+
+            // read all the job descriptions, and stage and hash
+            // their distinct input files in parallel.
+            // create_work2() then gets MD5s from the cache.
+            //
+            while (fgets(buf, sizeof(buf), stdin)) {
+                lines.push_back(string(buf));
+            }
+            JOB_DESC* scan = new JOB_DESC;
+            for (unsigned int j=0; j<lines.size(); j++) {
+                safe_strcpy(buf, lines[j].c_str());
+                scan->infiles.clear();
+                _argc = parse_command_line(buf, _argv);
+                scan->parse_cmdline(_argc, _argv);
+                for (unsigned int k=0; k<scan->infiles.size(); k++) {
+                    if (scan->infiles[k].is_remote) continue;
+                    names.push_back(string(scan->infiles[k].name));
+                }
+            }
+            delete scan;
+            retval = stage_input_files(names, config, stage_threads);
+            if (retval && !continue_on_error) {
+                fprintf(stderr,
+                    "create_work: staging input files failed: %s\n",
+                    boincerror(retval)
+                );
+                exit(1);
+            }
+
+            for (int j=0; j<(int)lines.size(); j++) {
+                safe_strcpy(buf, lines[j].c_str());
                 JOB_DESC jd2 = jd;
                 strcpy(jd2.wu.name, "");
                 _argc = parse_command_line(buf, _argv);
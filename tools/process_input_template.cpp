@@ -18,10 +18,16 @@
 // process_input_template():
 // fill in the workunit's XML document (wu.xml_doc)
 // by scanning the input template, macro-substituting the input files,
-// and putting in the command line element and additional XML
+// and putting in the command line element and additional XML.
+// This is done in two steps: INPUT_TEMPLATE::parse() parses the template
+// and looks up constant files, and INPUT_TEMPLATE::fill_in() does the rest.
 
 #include <stdio.h>
+#include <algorithm>
+#include <map>
+#include <set>
 #include <string>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -29,12 +35,14 @@
 #include "filesys.h"
 #include "md5_file.h"
 #include "str_replace.h"
+#include "str_util.h"
 
 #include "sched_config.h"
 #include "sched_util.h"
 
 #include "process_input_template.h"
 
+using std::map;
 using std::string;
 using std::vector;
 
@@ -145,82 +153,359 @@ static void write_md5_info(
     return;
 }
 
-// generate a <file_info> element for workunit XML doc,
-// based on the input template and list of variable files
+// In-memory cache of MD5 info for staged input files,
+// keyed by path and validated by file size and mod time.
+// When creating many jobs that share input files,
+// each file is hashed only once.
 //
-// Inputs:
-// xp: parser for input template
-// var_infiles: list of files descs passed to create_work (i.e. var files)
+// If config.cache_md5_info is set the cache is also kept
+// in a file in the project directory (MD5_CACHE_FILENAME),
+// one line "md5 nbytes mtime path" per entry (later lines win),
+// so that later runs don't rehash unchanged files.
+// Entries are appended as files are hashed.
+// Entries are checked against the file's size and mod time when used,
+// so loading the cache doesn't stat every file in it.
 //
-// Outputs:
-// infiles: vector (appended to) of all input files
-// out:
+// The cache holds at most MD5_CACHE_MAX entries;
+// beyond that, the least recently used half is dropped.
+// When the file is loaded, it's rewritten without entries
+// that have been superseded or dropped.
+// The per-file .md5 files are still read and written as before.
 //
-// Actions:
-//   as an input file for create_work.
-// out: append the <file_info> element for the WU XML doc
-// If not a constant file:
-// increment nfiles_parsed
+#define MD5_CACHE_FILENAME "md5_cache"
+#define MD5_CACHE_MAX   100000
+
+struct MD5_INFO {
+    char md5[33];
+    double nbytes;
+    time_t mtime;
+    unsigned long last_used;
+};
+
+static map<string, MD5_INFO> md5_cache;
+static unsigned long md5_cache_seqno = 0;
+static bool md5_cache_loaded = false;
+static pthread_mutex_t md5_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// if the cache is too big, keep only the MD5_CACHE_MAX/2
+// most recently used entries.
+// call with mutex held
 //
-static int process_file_info(
-    XML_PARSER& xp, SCHED_CONFIG& config_loc,
-    vector<INFILE_DESC> &var_infiles,
-    string& out,
-    vector<INFILE_DESC> &infiles,
-    int& n_var_infiles
+static void trim_md5_cache() {
+    if (md5_cache.size() <= MD5_CACHE_MAX) return;
+    unsigned long cutoff = md5_cache_seqno - MD5_CACHE_MAX/2;
+    map<string, MD5_INFO>::iterator it = md5_cache.begin();
+    while (it != md5_cache.end()) {
+        if (it->second.last_used <= cutoff) {
+            md5_cache.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+static bool md5_cache_older(
+    map<string, MD5_INFO>::iterator a, map<string, MD5_INFO>::iterator b
+) {
+    return a->second.last_used < b->second.last_used;
+}
+
+// write the cache file from the in-memory cache,
+// least recently used entries first
+//
+static void rewrite_md5_cache(const char* path) {
+    char tmp_path[MAXPATHLEN];
+    int n = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    if (n < 0 || n >= (int)sizeof(tmp_path)) return;
+#ifndef _USING_FCGI_
+    FILE *fp=fopen(tmp_path, "w");
+#else
+    FCGI_FILE *fp=FCGI::fopen(tmp_path, "w");
+#endif
+    if (!fp) return;
+    vector<map<string, MD5_INFO>::iterator> entries;
+    map<string, MD5_INFO>::iterator it;
+    for (it = md5_cache.begin(); it != md5_cache.end(); ++it) {
+        entries.push_back(it);
+    }
+    sort(entries.begin(), entries.end(), md5_cache_older);
+    for (unsigned int i=0; i<entries.size(); i++) {
+        MD5_INFO& mi = entries[i]->second;
+        fprintf(fp, "%s %.15e %ld %s\n",
+            mi.md5, mi.nbytes, (long)mi.mtime, entries[i]->first.c_str()
+        );
+    }
+    if (fclose(fp)) {
+        unlink(tmp_path);
+        return;
+    }
+    if (rename(tmp_path, path)) {
+        unlink(tmp_path);
+    }
+}
+
+// call with mutex held
+//
+static void load_md5_cache(SCHED_CONFIG& config_loc) {
+    char path[MAXPATHLEN], buf[MAXPATHLEN+256], md5[33];
+    double nbytes;
+    long mtime;
+    int n, nlines = 0;
+
+    md5_cache_loaded = true;
+    if (!config_loc.cache_md5_info) return;
+    safe_strcpy(path, config_loc.project_path(MD5_CACHE_FILENAME));
+#ifndef _USING_FCGI_
+    FILE *fp=fopen(path, "r");
+#else
+    FCGI_FILE *fp=FCGI::fopen(path, "r");
+#endif
+    if (!fp) return;
+    while (fgets(buf, sizeof(buf), fp)) {
+        nlines++;
+        n = 0;
+        if (sscanf(buf, "%32s %lf %ld %n", md5, &nbytes, &mtime, &n) != 3) {
+            continue;
+        }
+        if (!n) continue;
+        char* fpath = buf + n;
+        strip_whitespace(fpath);
+        if (!strlen(fpath)) continue;
+        MD5_INFO& mi = md5_cache[string(fpath)];
+        safe_strcpy(mi.md5, md5);
+        mi.nbytes = nbytes;
+        mi.mtime = (time_t)mtime;
+        mi.last_used = ++md5_cache_seqno;
+    }
+    fclose(fp);
+
+    trim_md5_cache();
+    if (nlines > (int)md5_cache.size()) {
+        rewrite_md5_cache(path);
+    }
+}
+
+// call with mutex held
+//
+static void append_md5_cache(
+    SCHED_CONFIG& config_loc, const char* path, MD5_INFO& mi
+) {
+    char cpath[MAXPATHLEN];
+    if (!config_loc.cache_md5_info) return;
+    safe_strcpy(cpath, config_loc.project_path(MD5_CACHE_FILENAME));
+#ifndef _USING_FCGI_
+    FILE *fp=fopen(cpath, "a");
+#else
+    FCGI_FILE *fp=FCGI::fopen(cpath, "a");
+#endif
+    if (!fp) return;
+    fprintf(fp, "%s %.15e %ld %s\n", mi.md5, mi.nbytes, (long)mi.mtime, path);
+    fclose(fp);
+}
+
+// get the MD5 and size of a file in the download hierarchy,
+// using the caches if possible.
+// Can be called from multiple threads.
+//
+static int get_md5_info(
+    const char* path, SCHED_CONFIG& config_loc, char* md5, double& nbytes
+) {
+    struct stat filestat;
+    MD5_INFO mi;
+
+    if (stat(path, &filestat)) {
+        return ERR_FILE_MISSING;
+    }
+    string key(path);
+
+    pthread_mutex_lock(&md5_cache_mutex);
+    if (!md5_cache_loaded) {
+        load_md5_cache(config_loc);
+    }
+    map<string, MD5_INFO>::iterator it = md5_cache.find(key);
+    if (it != md5_cache.end()
+        && it->second.mtime == filestat.st_mtime
+        && it->second.nbytes == (double)filestat.st_size
+    ) {
+        strcpy(md5, it->second.md5);
+        nbytes = it->second.nbytes;
+        it->second.last_used = ++md5_cache_seqno;
+        pthread_mutex_unlock(&md5_cache_mutex);
+        return 0;
+    }
+    pthread_mutex_unlock(&md5_cache_mutex);
+
+    // the .md5 file has only its mod time to go by; check the size too
+    //
+    if (!config_loc.cache_md5_info
+        || !got_md5_info(path, md5, &nbytes)
+        || nbytes != (double)filestat.st_size
+    ) {
+        int retval = md5_file(path, md5, nbytes);
+        if (retval) {
+            fprintf(stderr,
+                "process_input_template: md5_file %s\n",
+                boincerror(retval)
+            );
+            return retval;
+        } else if (config_loc.cache_md5_info) {
+            write_md5_info(path, md5, nbytes);
+        }
+    }
+
+    safe_strcpy(mi.md5, md5);
+    mi.nbytes = nbytes;
+    mi.mtime = filestat.st_mtime;
+    pthread_mutex_lock(&md5_cache_mutex);
+    mi.last_used = ++md5_cache_seqno;
+    md5_cache[key] = mi;
+    append_md5_cache(config_loc, path, mi);
+    trim_md5_cache();
+    pthread_mutex_unlock(&md5_cache_mutex);
+    return 0;
+}
+
+// Make sure the given input file is in the download hierarchy
+// (if it isn't, look for it at top level and copy)
+// and get its MD5 and size.
+//
+static int stage_input_file(
+    const char* name, SCHED_CONFIG& config_loc,
+    char* path, char* md5, double& nbytes
+) {
+    char top_download_path[MAXPATHLEN];
+    int retval;
+
+    retval = dir_hier_path(
+        name, config_loc.download_dir, config_loc.uldl_dir_fanout, path, true
+    );
+    if (retval) return retval;
+
+    if (!boinc_file_exists(path)) {
+        sprintf(top_download_path,
+            "%s/%s",config_loc.download_dir, name
+        );
+        boinc_copy(top_download_path, path);
+        printf("copy %s to %s\n", top_download_path, path);
+    }
+    return get_md5_info(path, config_loc, md5, nbytes);
+}
+
+struct STAGE_CONTEXT {
+    vector<string>* names;
+    SCHED_CONFIG* config;
+    unsigned int next;
+    int retval;
+    pthread_mutex_t mutex;
+};
+
+static void* stage_thread(void* arg) {
+    STAGE_CONTEXT* sc = (STAGE_CONTEXT*)arg;
+    char path[MAXPATHLEN], md5[33];
+    double nbytes;
+
+    while (1) {
+        pthread_mutex_lock(&sc->mutex);
+        if (sc->retval || sc->next >= sc->names->size()) {
+            pthread_mutex_unlock(&sc->mutex);
+            break;
+        }
+        const char* name = (*sc->names)[sc->next++].c_str();
+        pthread_mutex_unlock(&sc->mutex);
+
+        int retval = stage_input_file(name, *sc->config, path, md5, nbytes);
+        if (retval) {
+            fprintf(stderr, "can't stage %s: %s\n", name, boincerror(retval));
+            pthread_mutex_lock(&sc->mutex);
+            sc->retval = retval;
+            pthread_mutex_unlock(&sc->mutex);
+        }
+    }
+    return NULL;
+}
+
+// Stage and hash a set of (local) input files using nthreads threads,
+// so that subsequent process_input_template() calls
+// find their MD5 info in the cache.
+// Duplicates in "names" are OK.
+//
+int stage_input_files(
+    vector<string>& names, SCHED_CONFIG& config_loc, int nthreads
+) {
+    map<string, bool> seen;
+    vector<string> distinct;
+    STAGE_CONTEXT sc;
+    vector<pthread_t> threads;
+
+    for (unsigned int i=0; i<names.size(); i++) {
+        if (seen.count(names[i])) continue;
+        seen[names[i]] = true;
+        distinct.push_back(names[i]);
+    }
+    if (distinct.empty()) return 0;
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > (int)distinct.size()) nthreads = (int)distinct.size();
+
+    sc.names = &distinct;
+    sc.config = &config_loc;
+    sc.next = 0;
+    sc.retval = 0;
+    pthread_mutex_init(&sc.mutex, NULL);
+
+    for (int i=0; i<nthreads; i++) {
+        pthread_t t;
+        if (pthread_create(&t, NULL, stage_thread, &sc)) break;
+        threads.push_back(t);
+    }
+    if (threads.empty()) {
+        stage_thread(&sc);
+    }
+    for (unsigned int i=0; i<threads.size(); i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&sc.mutex);
+    return sc.retval;
+}
+
+// parse a <file_info> element of the input template.
+// A constant file (<physical_name> given) is looked up now,
+// and its complete <file_info> element generated.
+// Other elements are copied to f.xml.
+//
+static int parse_file_info(
+    XML_PARSER& xp, SCHED_CONFIG& config_loc, INPUT_TEMPLATE_FILE& f
 ) {
-    vector<string> urls;
-    bool gzip = false;
     int retval, itemp;
-    double nbytes, nbytesdef = -1, gzipped_nbytes;
-    string md5str, urlstr, tmpstr;
+    double nbytes;
+    string urlstr, tmpstr;
     char physical_name[256];
-    char buf[BLOB_SIZE], path[MAXPATHLEN], top_download_path[MAXPATHLEN];
-    char gzip_path[MAXPATHLEN];
-    char md5[33], url[256], gzipped_url[256], buf2[256];
-    INFILE_DESC var_infile, infile;
+    char buf[BLOB_SIZE], path[MAXPATHLEN];
+    char md5[33], url[256];
 
     strcpy(physical_name, "");
+    f.is_constant = false;
+    f.gzip = false;
+    f.nbytes = -1;
+    f.gzipped_nbytes = 0;
 
-    out += "<file_info>\n";
     while (!xp.get_tag()) {
-        if (xp.parse_bool("gzip", gzip)) {
+        if (xp.parse_bool("gzip", f.gzip)) {
             continue;
         } else if (xp.parse_str("physical_name", physical_name, sizeof(physical_name))) {
             continue;
         } else if (xp.parse_string("url", urlstr)) {
-            urls.push_back(urlstr);
+            f.urls.push_back(urlstr);
             continue;
         } else if (xp.parse_int("number", itemp)) {
             // ignore
             continue;
-        } else if (xp.parse_string("md5_cksum", md5str)) {
+        } else if (xp.parse_string("md5_cksum", f.md5)) {
             continue;
-        } else if (xp.parse_double("nbytes", nbytesdef)) {
+        } else if (xp.parse_double("nbytes", f.nbytes)) {
             continue;
-        } else if (xp.parse_double("gzipped_nbytes", gzipped_nbytes)) {
+        } else if (xp.parse_double("gzipped_nbytes", f.gzipped_nbytes)) {
             continue;
         } else if (xp.match_tag("/file_info")) {
-            // there are four cases:
-            // - normal file
-            // - constant file
-            //   <physical_name> is given
-            // - remote file, specified as create_work() arg
-            //   URL, size etc. are given in INFILE_DESC
-            // - remote file, specified in template
-            //   URL, size etc. are given in template
-            //
-            if (!strlen(physical_name)) {
-                if (n_var_infiles >= (int)var_infiles.size()) {
-                    fprintf(stderr,
-                        "Too few var input files given; need at least %d\n",
-                        n_var_infiles+1
-                    );
-                    return ERR_XML_PARSE;
-                }
-                var_infile = var_infiles[n_var_infiles];
-            }
-
             if (strlen(physical_name)) {
                 // constant file case
                 //
@@ -250,204 +535,67 @@ static int process_file_info(
                     md5,
                     nbytes
                 );
-                strcpy(infile.name, physical_name);
-                strcpy(infile.md5, md5);
-                infile.nbytes = nbytes;
-            } else if (nbytesdef > 0) {
+                f.const_xml = "<file_info>\n" + f.xml + buf + "</file_info>\n";
+                strcpy(f.const_infile.name, physical_name);
+                strcpy(f.const_infile.md5, md5);
+                f.const_infile.nbytes = nbytes;
+                f.is_constant = true;
+            } else if (f.nbytes > 0) {
                 // remote file specified in template
                 //
-                if (md5str == "" || urlstr == "") {
+                if (f.md5 == "" || f.urls.empty()) {
                     fprintf(stderr, "All file properties must be defined "
                         "if at least one is defined (url, md5_cksum, nbytes)\n"
                     );
                     return ERR_XML_PARSE;
                 }
-                if (gzip && !gzipped_nbytes) {
+                if (f.gzip && !f.gzipped_nbytes) {
                     fprintf(stderr, "Must specify gzipped_nbytes\n");
                     return ERR_XML_PARSE;
                 }
-                urlstr = "";
-                for (unsigned int i=0; i<urls.size(); i++) {
-                    urlstr += "    <url>" + urls.at(i) + string(var_infile.name) + "</url>\n";
-                    if (gzip) {
-                        urlstr += "    <gzipped_url>" + urls.at(i) + string(var_infile.name) + ".gz</gzipped_url>\n";
-                    }
-                }
-                sprintf(buf,
-                    "    <name>%s</name>\n"
-                    "%s"
-                    "    <md5_cksum>%s</md5_cksum>\n"
-                    "    <nbytes>%.0f</nbytes>\n",
-                    var_infile.name,
-                    urlstr.c_str(),
-                    md5str.c_str(),
-                    nbytesdef
-                );
-                if (gzip) {
-                    sprintf(buf2, "    <gzipped_nbytes>%.0f</gzipped_nbytes>\n",
-                        gzipped_nbytes
-                    );
-                    strcat(buf, buf2);
-                }
-                strcpy(infile.name, var_infile.name);
-                strcpy(infile.md5, md5str.c_str());
-                infile.nbytes = nbytesdef;
-            } else if (var_infile.is_remote) {
-                // remote file specified in create_work() arg
-                //
-                sprintf(buf2, "jf_%s", var_infile.md5);
-                sprintf(buf,
-                    "    <name>%s</name>\n"
-                    "    <url>%s</url>\n"
-                    "    <md5_cksum>%s</md5_cksum>\n"
-                    "    <nbytes>%.0f</nbytes>\n",
-                    buf2,
-                    var_infile.url,
-                    var_infile.md5,
-                    var_infile.nbytes
-                );
-                strcpy(infile.name, buf2);
-                strcpy(infile.md5, var_infile.md5);
-                infile.nbytes = var_infile.nbytes;
-            } else {
-                // normal case. we need to find file size and MD5;
-                // stage the file if needed
-                //
-                dir_hier_path(
-                    var_infile.name, config_loc.download_dir,
-                    config_loc.uldl_dir_fanout, path, true
-                );
-
-                // if file isn't found in hierarchy,
-                // look for it at top level and copy
-                //
-                if (!boinc_file_exists(path)) {
-                    sprintf(top_download_path,
-                        "%s/%s",config_loc.download_dir, var_infile.name
-                    );
-                    boinc_copy(top_download_path, path);
-                    printf("copy %s to %s\n", top_download_path, path);
-                }
-
-                if (!config_loc.cache_md5_info || !got_md5_info(path, md5, &nbytes)) {
-                    retval = md5_file(path, md5, nbytes);
-                    if (retval) {
-                        fprintf(stderr,
-                            "process_input_template: md5_file %s\n",
-                            boincerror(retval)
-                        );
-                        return retval;
-                    } else if (config_loc.cache_md5_info) {
-                        write_md5_info(path, md5, nbytes);
-                    }
-                }
-
-                dir_hier_url(
-                    var_infile.name, config_loc.download_url,
-                    config_loc.uldl_dir_fanout, url
-                );
-
-                if (gzip) {
-                    sprintf(gzip_path, "%s.gz", path);
-                    retval = file_size(gzip_path, gzipped_nbytes);
-                    if (retval) {
-                        fprintf(stderr,
-                            "process_input_template: missing gzip file %s\n",
-                            gzip_path
-                        );
-                        return ERR_FILE_MISSING;
-                    }
-                    sprintf(gzipped_url,
-                        "    <gzipped_url>%s.gz</gzipped_url>\n"
-                        "    <gzipped_nbytes>%.0f</gzipped_nbytes>\n",
-                        url, gzipped_nbytes
-                    );
-                } else {
-                    strcpy(gzipped_url, "");
-                }
-
-                sprintf(buf,
-                    "    <name>%s</name>\n"
-                    "    <url>%s</url>\n"
-                    "%s"
-                    "    <md5_cksum>%s</md5_cksum>\n"
-                    "    <nbytes>%.0f</nbytes>\n",
-                    var_infile.name,
-                    url,
-                    gzipped_url,
-                    md5,
-                    nbytes
-                );
-                strcpy(infile.name, var_infile.name);
-                strcpy(infile.md5, md5);
-                infile.nbytes = nbytes;
             }
-            infiles.push_back(infile);
-            if (!strlen(physical_name)) {
-                n_var_infiles++;
-            }
-            out += buf;
-            out += "</file_info>\n";
             break;
         } else {
             // copy any other elements from input template to XML doc
             //
             retval = xp.copy_element(tmpstr);
             if (retval) return retval;
-            out += tmpstr;
-            out += "\n";
+            f.xml += tmpstr;
+            f.xml += "\n";
         }
     }
     return 0;
 }
 
-// parse the <workunit> elements, which includes file refs and job params
+// parse the <workunit> element, which includes file refs and job params
 //
-static int process_workunit(
-    XML_PARSER& xp, WORKUNIT& wu, string& out,
-    vector<INFILE_DESC> &infiles,
-    const char* command_line,
-    const char* additional_xml
-) {
+static int parse_workunit(XML_PARSER& xp, INPUT_TEMPLATE& it) {
     char buf[256], open_name[256];
-    string tmpstr, cmdline;
-    int retval, n_file_refs=0, itemp;
+    string out, tmpstr, cmdline;
+    int retval, itemp;
+    WORKUNIT& wu = it.params;
 
-    out += "<workunit>\n";
-    if (command_line) {
-        //fprintf(stderr, "appending command line: %s\n", command_line);
-        out += "<command_line>\n";
-        out += command_line;
-        out += "\n</command_line>\n";
-    }
     while (!xp.get_tag()) {
         if (xp.match_tag("/workunit")) {
-            if (additional_xml && strlen(additional_xml)) {
-                out += additional_xml;
-                out += "\n";
-            }
-            out += "</workunit>";
             break;
         } else if (xp.match_tag("file_ref")) {
-            out += "<file_ref>\n";
+            INPUT_TEMPLATE_FILE_REF fr;
             bool found_open_name = false, found_copy_file = false;
-            if (n_file_refs >= (int)infiles.size()) {
+            if (it.file_refs.size() >= it.files.size()) {
                 fprintf(stderr, "too many <file_ref>s\n");
                 return ERR_XML_PARSE;
             }
-            INFILE_DESC& id = infiles[n_file_refs];
-            sprintf(buf, "    <file_name>%s</file_name>\n", id.name);
-            out += buf;
+            fr.default_open_name = false;
 
             while (!xp.get_tag()) {
                 if (xp.parse_str("open_name", open_name, sizeof(open_name))) {
                     sprintf(buf, "    <open_name>%s</open_name>\n", open_name);
-                    out += buf;
+                    fr.xml += buf;
                     found_open_name = true;
                     continue;
                 } else if (xp.parse_int("file_number", itemp)) {
                 } else if (xp.match_tag("copy_file/")) {
-                    out += "    <copy_file/>\n";
+                    fr.xml += "    <copy_file/>\n";
                     found_copy_file = true;
                     continue;
                 } else if (xp.match_tag("/file_ref")) {
@@ -455,10 +603,8 @@ static int process_workunit(
                         fprintf(stderr, "No open name found and copy_file not specified\n");
                         return ERR_XML_PARSE;
                     } else if (!found_open_name && found_copy_file) {
-                        sprintf(buf, "    <open_name>%s</open_name>\n", id.name);
-                        out += buf;
+                        fr.default_open_name = true;
                     }
-                    out += "</file_ref>\n";
                     break;
                 } else if (xp.parse_string("file_name", tmpstr)) {
                     fprintf(stderr, "<file_name> ignored in <file_ref> element.\n");
@@ -466,45 +612,33 @@ static int process_workunit(
                 } else {
                     retval = xp.copy_element(tmpstr);
                     if (retval) return retval;
-                    out += tmpstr;
-                    out += "\n";
+                    fr.xml += tmpstr;
+                    fr.xml += "\n";
                 }
             }
-            n_file_refs++;
+            it.wu_xml.push_back(out);
+            out = "";
+            it.file_refs.push_back(fr);
         } else if (xp.parse_string("command_line", cmdline)) {
-            if (command_line) {
-                fprintf(stderr, "Can't specify command line twice\n");
-                return ERR_XML_PARSE;
-            }
+            it.has_command_line = true;
             out += "<command_line>\n";
             out += cmdline;
             out += "\n</command_line>\n";
-        } else if (xp.parse_double("rsc_fpops_est", wu.rsc_fpops_est)) {
-            continue;
-        } else if (xp.parse_double("rsc_fpops_bound", wu.rsc_fpops_bound)) {
-            continue;
-        } else if (xp.parse_double("rsc_memory_bound", wu.rsc_memory_bound)) {
-            continue;
-        } else if (xp.parse_double("rsc_bandwidth_bound", wu.rsc_bandwidth_bound)) {
-            continue;
-        } else if (xp.parse_double("rsc_disk_bound", wu.rsc_disk_bound)) {
-            continue;
-        } else if (xp.parse_int("batch", wu.batch)) {
-            continue;
-        } else if (xp.parse_int("delay_bound", wu.delay_bound)){
-            continue;
-        } else if (xp.parse_int("min_quorum", wu.min_quorum)) {
-            continue;
-        } else if (xp.parse_int("target_nresults", wu.target_nresults)) {
-            continue;
-        } else if (xp.parse_int("max_error_results", wu.max_error_results)) {
-            continue;
-        } else if (xp.parse_int("max_total_results", wu.max_total_results)) {
-            continue;
-        } else if (xp.parse_int("max_success_results", wu.max_success_results)) {
-            continue;
-        } else if (xp.parse_int("size_class", wu.size_class)) {
-            continue;
+        } else if (xp.parse_double("rsc_fpops_est", wu.rsc_fpops_est)
+            || xp.parse_double("rsc_fpops_bound", wu.rsc_fpops_bound)
+            || xp.parse_double("rsc_memory_bound", wu.rsc_memory_bound)
+            || xp.parse_double("rsc_bandwidth_bound", wu.rsc_bandwidth_bound)
+            || xp.parse_double("rsc_disk_bound", wu.rsc_disk_bound)
+            || xp.parse_int("batch", wu.batch)
+            || xp.parse_int("delay_bound", wu.delay_bound)
+            || xp.parse_int("min_quorum", wu.min_quorum)
+            || xp.parse_int("target_nresults", wu.target_nresults)
+            || xp.parse_int("max_error_results", wu.max_error_results)
+            || xp.parse_int("max_total_results", wu.max_total_results)
+            || xp.parse_int("max_success_results", wu.max_success_results)
+            || xp.parse_int("size_class", wu.size_class)
+        ) {
+            it.params_given.insert(xp.parsed_tag);
         } else {
             retval = xp.copy_element(tmpstr);
             if (retval) return retval;
@@ -512,38 +646,32 @@ static int process_workunit(
             out += "\n";
         }
     }
-    if (n_file_refs != (int)infiles.size()) {
+    it.wu_xml.push_back(out);
+    if (it.file_refs.size() != it.files.size()) {
         fprintf(stderr, "#file refs != #file infos\n");
         return ERR_XML_PARSE;
     }
+    it.nfiles_before_wu = (int)it.files.size();
     return 0;
 }
 
-// fill in the workunit's XML document (wu.xml_doc)
-// by scanning the input template, macro-substituting the input files,
-// and putting in the command line element and additional XML
+// parse an input template.
+// Everything that doesn't depend on the job is done here,
+// so that fill_in() needn't look at the template again.
 //
-int process_input_template(
-    WORKUNIT& wu,
-    char* tmplate,
-    vector<INFILE_DESC> &var_infiles,
-        // files passed as args to create_work
-    SCHED_CONFIG& config_loc,
-    const char* command_line,
-    const char* additional_xml
-) {
-    string out;
+int INPUT_TEMPLATE::parse(const char* tmplate, SCHED_CONFIG& config_loc) {
     int retval;
     bool found_workunit=false;
-    vector<INFILE_DESC> infiles;
-        // this gets filled in as we scan <file_info>s
-    int n_var_infiles=0;
-        // number of non-constant infiles scanned
-        // this is an index into var_infiles
-        
-    // "out" is the XML we're creating
-    //
-    out = "";
+
+    files.clear();
+    file_refs.clear();
+    wu_xml.clear();
+    params.clear();
+    params_given.clear();
+    nfiles_before_wu = 0;
+    nvar_files = 0;
+    has_command_line = false;
+
     MIOFILE mf;
     XML_PARSER xp(&mf);
     mf.init_buf_read(tmplate);
@@ -552,16 +680,18 @@ int process_input_template(
         if (xp.match_tag("input_template")) continue;
         if (xp.match_tag("/input_template")) continue;
         if (xp.match_tag("file_info")) {
-            retval = process_file_info(
-                xp, config_loc, var_infiles,
-                out, infiles, n_var_infiles
-            );
+            INPUT_TEMPLATE_FILE f;
+            retval = parse_file_info(xp, config_loc, f);
             if (retval) return retval;
+            if (!f.is_constant) nvar_files++;
+            files.push_back(f);
         } else if (xp.match_tag("workunit")) {
+            if (found_workunit) {
+                fprintf(stderr, "process_input_template: bad WU template - multiple <workunit>s\n");
+                return ERR_XML_PARSE;
+            }
             found_workunit = true;
-            retval = process_workunit(
-                xp, wu, out, infiles, command_line, additional_xml
-            );
+            retval = parse_workunit(xp, *this);
             if (retval) return retval;
         }
     }
@@ -569,13 +699,232 @@ int process_input_template(
         fprintf(stderr, "process_input_template: bad WU template - no <workunit>\n");
         return ERR_XML_PARSE;
     }
-    if (n_var_infiles != (int)var_infiles.size()) {
+    return 0;
+}
+
+// generate a <file_info> element for a non-constant file
+// of the input template, given the corresponding var file.
+// Append it to "out", and return the file's description in "infile".
+//
+// there are three cases:
+// - normal file
+// - remote file, specified as create_work() arg
+//   URL, size etc. are given in INFILE_DESC
+// - remote file, specified in template
+//   URL, size etc. are given in template
+//
+static int fill_in_file_info(
+    INPUT_TEMPLATE_FILE& f, INFILE_DESC& var_infile,
+    SCHED_CONFIG& config_loc, string& out, INFILE_DESC& infile
+) {
+    int retval;
+    double nbytes, gzipped_nbytes;
+    string urlstr;
+    char buf[BLOB_SIZE], path[MAXPATHLEN];
+    char gzip_path[MAXPATHLEN];
+    char md5[33], url[256], gzipped_url[256], buf2[256];
+
+    if (f.nbytes > 0) {
+        // remote file specified in template
+        //
+        for (unsigned int i=0; i<f.urls.size(); i++) {
+            urlstr += "    <url>" + f.urls.at(i) + string(var_infile.name) + "</url>\n";
+            if (f.gzip) {
+                urlstr += "    <gzipped_url>" + f.urls.at(i) + string(var_infile.name) + ".gz</gzipped_url>\n";
+            }
+        }
+        sprintf(buf,
+            "    <name>%s</name>\n"
+            "%s"
+            "    <md5_cksum>%s</md5_cksum>\n"
+            "    <nbytes>%.0f</nbytes>\n",
+            var_infile.name,
+            urlstr.c_str(),
+            f.md5.c_str(),
+            f.nbytes
+        );
+        if (f.gzip) {
+            sprintf(buf2, "    <gzipped_nbytes>%.0f</gzipped_nbytes>\n",
+                f.gzipped_nbytes
+            );
+            strcat(buf, buf2);
+        }
+        strcpy(infile.name, var_infile.name);
+        strcpy(infile.md5, f.md5.c_str());
+        infile.nbytes = f.nbytes;
+    } else if (var_infile.is_remote) {
+        // remote file specified in create_work() arg
+        //
+        sprintf(buf2, "jf_%s", var_infile.md5);
+        sprintf(buf,
+            "    <name>%s</name>\n"
+            "    <url>%s</url>\n"
+            "    <md5_cksum>%s</md5_cksum>\n"
+            "    <nbytes>%.0f</nbytes>\n",
+            buf2,
+            var_infile.url,
+            var_infile.md5,
+            var_infile.nbytes
+        );
+        strcpy(infile.name, buf2);
+        strcpy(infile.md5, var_infile.md5);
+        infile.nbytes = var_infile.nbytes;
+    } else {
+        // normal case. we need to find file size and MD5;
+        // stage the file if needed
+        //
+        retval = stage_input_file(
+            var_infile.name, config_loc, path, md5, nbytes
+        );
+        if (retval) return retval;
+
+        dir_hier_url(
+            var_infile.name, config_loc.download_url,
+            config_loc.uldl_dir_fanout, url
+        );
+
+        if (f.gzip) {
+            sprintf(gzip_path, "%s.gz", path);
+            retval = file_size(gzip_path, gzipped_nbytes);
+            if (retval) {
+                fprintf(stderr,
+                    "process_input_template: missing gzip file %s\n",
+                    gzip_path
+                );
+                return ERR_FILE_MISSING;
+            }
+            sprintf(gzipped_url,
+                "    <gzipped_url>%s.gz</gzipped_url>\n"
+                "    <gzipped_nbytes>%.0f</gzipped_nbytes>\n",
+                url, gzipped_nbytes
+            );
+        } else {
+            strcpy(gzipped_url, "");
+        }
+
+        sprintf(buf,
+            "    <name>%s</name>\n"
+            "    <url>%s</url>\n"
+            "%s"
+            "    <md5_cksum>%s</md5_cksum>\n"
+            "    <nbytes>%.0f</nbytes>\n",
+            var_infile.name,
+            url,
+            gzipped_url,
+            md5,
+            nbytes
+        );
+        strcpy(infile.name, var_infile.name);
+        strcpy(infile.md5, md5);
+        infile.nbytes = nbytes;
+    }
+    out += "<file_info>\n";
+    out += f.xml;
+    out += buf;
+    out += "</file_info>\n";
+    return 0;
+}
+
+// fill in a workunit from a parsed input template:
+// its job parameters, and its XML document (wu.xml_doc),
+// with the var files substituted and the command line element
+// and additional XML put in
+//
+int INPUT_TEMPLATE::fill_in(
+    WORKUNIT& wu,
+    vector<INFILE_DESC> &var_infiles,
+        // files passed as args to create_work
+    SCHED_CONFIG& config_loc,
+    const char* command_line,
+    const char* additional_xml
+) {
+    string out;
+    char buf[2048];
+    int retval;
+    vector<INFILE_DESC> infiles;
+        // this gets filled in as we go through the <file_info>s
+    int n_var_infiles=0;
+        // number of non-constant infiles done
+        // this is an index into var_infiles
+
+    if (command_line && has_command_line) {
+        fprintf(stderr, "Can't specify command line twice\n");
+        return ERR_XML_PARSE;
+    }
+    if ((int)var_infiles.size() < nvar_files) {
+        fprintf(stderr,
+            "Too few var input files given; need at least %d\n", nvar_files
+        );
+        return ERR_XML_PARSE;
+    }
+    if ((int)var_infiles.size() != nvar_files) {
         fprintf(stderr,
             "process_input_template: %d input files given, but template has %d\n",
-            (int)var_infiles.size(), n_var_infiles
+            (int)var_infiles.size(), nvar_files
         );
         return ERR_XML_PARSE;
     }
+
+    // "out" is the XML we're creating
+    //
+    for (unsigned int i=0; i<=files.size(); i++) {
+        if ((int)i == nfiles_before_wu) {
+            out += "<workunit>\n";
+            if (command_line) {
+                out += "<command_line>\n";
+                out += command_line;
+                out += "\n</command_line>\n";
+            }
+            for (unsigned int j=0; j<file_refs.size(); j++) {
+                INFILE_DESC& id = infiles[j];
+                out += wu_xml[j];
+                out += "<file_ref>\n";
+                sprintf(buf, "    <file_name>%s</file_name>\n", id.name);
+                out += buf;
+                out += file_refs[j].xml;
+                if (file_refs[j].default_open_name) {
+                    sprintf(buf, "    <open_name>%s</open_name>\n", id.name);
+                    out += buf;
+                }
+                out += "</file_ref>\n";
+            }
+            out += wu_xml.back();
+            if (additional_xml && strlen(additional_xml)) {
+                out += additional_xml;
+                out += "\n";
+            }
+            out += "</workunit>";
+        }
+        if (i == files.size()) break;
+
+        INPUT_TEMPLATE_FILE& f = files[i];
+        if (f.is_constant) {
+            out += f.const_xml;
+            infiles.push_back(f.const_infile);
+            continue;
+        }
+        INFILE_DESC infile;
+        retval = fill_in_file_info(
+            f, var_infiles[n_var_infiles++], config_loc, out, infile
+        );
+        if (retval) return retval;
+        infiles.push_back(infile);
+    }
+
+    if (params_given.count("rsc_fpops_est")) wu.rsc_fpops_est = params.rsc_fpops_est;
+    if (params_given.count("rsc_fpops_bound")) wu.rsc_fpops_bound = params.rsc_fpops_bound;
+    if (params_given.count("rsc_memory_bound")) wu.rsc_memory_bound = params.rsc_memory_bound;
+    if (params_given.count("rsc_bandwidth_bound")) wu.rsc_bandwidth_bound = params.rsc_bandwidth_bound;
+    if (params_given.count("rsc_disk_bound")) wu.rsc_disk_bound = params.rsc_disk_bound;
+    if (params_given.count("batch")) wu.batch = params.batch;
+    if (params_given.count("delay_bound")) wu.delay_bound = params.delay_bound;
+    if (params_given.count("min_quorum")) wu.min_quorum = params.min_quorum;
+    if (params_given.count("target_nresults")) wu.target_nresults = params.target_nresults;
+    if (params_given.count("max_error_results")) wu.max_error_results = params.max_error_results;
+    if (params_given.count("max_total_results")) wu.max_total_results = params.max_total_results;
+    if (params_given.count("max_success_results")) wu.max_success_results = params.max_success_results;
+    if (params_given.count("size_class")) wu.size_class = params.size_class;
+
     if (out.size() > sizeof(wu.xml_doc)-1) {
         fprintf(stderr,
             "create_work: WU XML field is too long (%d bytes; max is %d)\n",
@@ -588,6 +937,28 @@ int process_input_template(
     return 0;
 }
 
+// fill in the workunit's XML document (wu.xml_doc)
+// by scanning the input template, macro-substituting the input files,
+// and putting in the command line element and additional XML.
+// To make many jobs from one template, use INPUT_TEMPLATE directly.
+//
+int process_input_template(
+    WORKUNIT& wu,
+    char* tmplate,
+    vector<INFILE_DESC> &var_infiles,
+        // files passed as args to create_work
+    SCHED_CONFIG& config_loc,
+    const char* command_line,
+    const char* additional_xml
+) {
+    INPUT_TEMPLATE it;
+    int retval = it.parse(tmplate, config_loc);
+    if (retval) return retval;
+    return it.fill_in(
+        wu, var_infiles, config_loc, command_line, additional_xml
+    );
+}
+
 #ifdef TEST
 SCHED_CONFIG config_loc;
 
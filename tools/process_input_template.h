@@ -18,6 +18,7 @@
 #ifndef BOINC_PROCESS_INPUT_TEMPLATE_H
 #define BOINC_PROCESS_INPUT_TEMPLATE_H
 
+#include <string>
 #include <vector>
 
 #include "boinc_db.h"
@@ -33,4 +34,8 @@ extern int process_input_template(
     const char* additional_xml
 );
 
+extern int stage_input_files(
+    std::vector<std::string>& names, SCHED_CONFIG& config_loc, int nthreads
+);
+
 #endif